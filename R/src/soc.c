@@ -80,6 +80,76 @@ SEXP r_so_SO_all_standard_errors(SEXP so)
     return df;
 }
 
+SEXP r_so_SO_all_relative_standard_errors(SEXP so)
+{
+    so_Table *table = so_SO_all_relative_standard_errors(R_ExternalPtrAddr(so));
+
+    if (!table) {
+        error("Could not gather any relative standard errors");
+    }
+
+    SEXP df = table2df(table);
+    so_Table_free(table);
+
+    return df;
+}
+
+SEXP r_so_SO_all_shrinkage(SEXP so)
+{
+    so_Table *table = so_SO_all_shrinkage(R_ExternalPtrAddr(so));
+
+    if (!table) {
+        error("Could not gather any shrinkage");
+    }
+
+    SEXP df = table2df(table);
+    so_Table_free(table);
+
+    return df;
+}
+
+SEXP r_so_SO_all_ofv(SEXP so)
+{
+    so_Table *table = so_SO_all_ofv(R_ExternalPtrAddr(so));
+
+    if (!table) {
+        error("Could not gather any objective function values");
+    }
+
+    SEXP df = table2df(table);
+    so_Table_free(table);
+
+    return df;
+}
+
+SEXP r_so_SO_all_objective_measures(SEXP so)
+{
+    so_Table *table = so_SO_all_objective_measures(R_ExternalPtrAddr(so));
+
+    if (!table) {
+        error("Could not gather any objective function measures");
+    }
+
+    SEXP df = table2df(table);
+    so_Table_free(table);
+
+    return df;
+}
+
+SEXP r_so_SO_all_messages(SEXP so)
+{
+    so_Table *table = so_SO_all_messages(R_ExternalPtrAddr(so));
+
+    if (!table) {
+        error("Could not gather any messages");
+    }
+
+    SEXP df = table2df(table);
+    so_Table_free(table);
+
+    return df;
+}
+
 SEXP r_so_SO_is_structural_parameter(SEXP so, SEXP name)
 {
     const char *c_name = CHAR(STRING_ELT(name, 0));
@@ -256,18 +326,27 @@ SEXP table2df(so_Table *table)
         pharmml_valueType vt = so_Table_get_valueType(table, j);
         if (vt == PHARMML_VALUETYPE_REAL) {
             double *col1 = (double *) so_Table_get_column_from_number(table, j);
+            if (!col1) {
+                error("Out of memory");
+            }
             PROTECT(col = NEW_NUMERIC(numrows));
             double *ptr = NUMERIC_POINTER(col);
             memcpy(ptr, col1, numrows * sizeof(double));
             SET_ELEMENT(list, j, col);
         } else if (vt == PHARMML_VALUETYPE_INT) {
             int *col1 = (int *) so_Table_get_column_from_number(table, j);
+            if (!col1) {
+                error("Out of memory");
+            }
             PROTECT(col = NEW_INTEGER(numrows));
             int *ptr = INTEGER_POINTER(col);
             memcpy(ptr, col1, numrows * sizeof(int));
             SET_ELEMENT(list, j, col);
         } else if (vt == PHARMML_VALUETYPE_STRING) {
             char **col2 = (char **) so_Table_get_column_from_number(table, j);
+            if (!col2) {
+                error("Out of memory");
+            }
             PROTECT(col = NEW_STRING(numrows));
             for (int i = 0; i < numrows; i++) {
                 SET_STRING_ELT(col, i, mkChar(col2[i]));
@@ -16,7 +16,7 @@
 
 import os
 import common
-from structure import need_name
+from structure import need_name, message_index_members
 
 class genclass:
     def __init__(self, name, structure, namespaces):
@@ -45,6 +45,14 @@ class genclass:
         # prefix a class name with the namespace prefix
         return self.namespaces[name] + "_" + name
 
+    def print_invalidate_message_index(self, name, f, appending=False):
+        # Changing an indexed member makes the message index stale. New SOBlocks are added to the index when it is used.
+        if name in message_index_members.get(self.name, []):
+            if self.class_name != "so_SO":
+                print("\tso_MessageIndex_invalidate(self->message_index);", file=f)
+            elif not appending:
+                print("\tso_MessageIndex_invalidate(&self->message_index);", file=f)
+
     def create_code(self):
         with open(self.name + ".c", "w") as f:
             common.output_file = f
@@ -62,6 +70,8 @@ class genclass:
             if self.extends:
                 self.create_get_set_base()
             self.create_xml()
+            if self.class_name == "so_SO":
+                self.create_xml_start_end()
             self.create_start()
             self.create_end()
             self.create_characters()
@@ -73,8 +83,11 @@ class genclass:
         print("#include <libxml/xmlwriter.h>", file=f)
         print("#include <pharmml/common_types.h>", file=f)
         print("#include <pharmml/string.h>", file=f)
+        print("#include <so/private/stats.h>", file=f)
         print('#include <', self.namespace, '/', self.name, '.h>', sep='', file=f)
         print('#include <', self.namespace, '/private/', self.name, '.h>', sep='', file=f)
+        if self.name in message_index_members:
+            print("#include <so/private/MessageIndex.h>", file=f)
         print(file=f)
 
     def create_new(self):
@@ -188,6 +201,8 @@ class genclass:
         print("void ", self.class_name, "_free(", self.class_name, " *self)", sep='', file=f)
         print("{", file=f)
         print("\tif (self) {", file=f)
+        if self.class_name == "so_SO":      # The message index must be freed while the indexed objects are alive
+            print("\t\tso_MessageIndex_invalidate(&self->message_index);", file=f)
 
         if self.children:
             for e in self.children:
@@ -209,8 +224,8 @@ class genclass:
                 if a['type'] == 'type_string':
                     print("\t\tif (self->", a['name'], ") free(self->", a['name'], ");", sep='', file=f)
         if self.extends:
-            print("\t\tfree(self->base);", file=f)
-        if self.class_name == "so_SO":      # Special case for SO path
+            print("\t\t", self.prefix_class(self.extends), "_unref(self->base);", sep='', file=f)
+        if self.class_name == "so_SO":      # Special case for SO path and message index
             print("\t\tfree(self->path);", file=f)
         print("\t\tfree(self);", file=f)
         print("\t}", file=f)
@@ -299,6 +314,7 @@ class genclass:
                 if a['type'] == 'type_string':
                     print("int ", self.class_name, "_set_", a['name'], "(", self.class_name, " *self, char *value)", sep='', file=f)
                     print("{", file=f)
+                    self.print_invalidate_message_index(a['name'], f)
                     print("\tif (!value) {", file=f)
                     print("\t\tself->", a['name'], " = value;", sep='', file=f)
                     print("\t\treturn 0;", file=f)
@@ -316,6 +332,7 @@ class genclass:
                 elif a['type'] == 'type_int':
                     print("void ", self.class_name, "_set_", a['name'], "(", self.class_name, " *self, int *value)", sep='', file=f)
                     print("{", file=f)
+                    self.print_invalidate_message_index(a['name'], f)
                     print("\tif (value) {", file=f)
                     print("\t\tself->", a['name'], "_number = *value;", sep='', file=f)
                     print("\t\tself->", a['name'], " = &(self->", a['name'], "_number);", sep='', file=f)
@@ -332,6 +349,7 @@ class genclass:
                     if e['type'] == "type_string":
                         print("int ", self.class_name, "_set_", e['name'], "(", self.class_name, " *self, char *value)", sep='', file=f)
                         print("{", file=f)
+                        self.print_invalidate_message_index(e['name'], f)
                         print("\tif (!value) {", file=f)
                         print("\t\tself->", e['name'], " = value;", sep='', file=f)
                         print("\t\treturn 0;", file=f)
@@ -349,6 +367,7 @@ class genclass:
                     elif e['type'] == "type_real":
                         print("void ", self.class_name, "_set_", e['name'], "(", self.class_name, " *self, double *value)", sep='', file=f)
                         print("{", file=f)
+                        self.print_invalidate_message_index(e['name'], f)
                         print("\tif (value) {", file=f)
                         print("\t\tself->", e['name'], "_number = *value;", sep='', file=f)
                         print("\t\tself->", e['name'], " = &(self->", e['name'], "_number);", sep='', file=f)
@@ -360,6 +379,7 @@ class genclass:
                     elif e['type'] == "type_int":
                         print("void ", self.class_name, "_set_", e['name'], "(", self.class_name, " *self, int *value)", sep='', file=f)
                         print("{", file=f)
+                        self.print_invalidate_message_index(e['name'], f)
                         print("\tif (value) {", file=f)
                         print("\t\tself->", e['name'], "_number = *value;", sep='', file=f)
                         print("\t\tself->", e['name'], " = &(self->", e['name'], "_number);", sep='', file=f)
@@ -371,6 +391,7 @@ class genclass:
                     else:
                         print("void ", self.class_name, "_set_", e['name'], "(", self.class_name, " *self, ", self.prefix_class(e['type']), " *value)", sep='', file=f)
                         print("{", file=f)
+                        self.print_invalidate_message_index(e['name'], f)
                         print("\t", self.prefix_class(e['type']), "_unref(self->", e['name'], ");", sep='', file=f)
                         print("\tself->", e['name'], " = value;", sep='', file=f)
                         print("}", file=f)
@@ -384,6 +405,7 @@ class genclass:
                     is_array = e.get('array', False)
                     print(self.prefix_class(e['type']), " *", self.class_name, "_create_", e['name'], "(", self.class_name, " *self)", sep='', file=f)
                     print("{", file=f)
+                    self.print_invalidate_message_index(e['name'], f, is_array)
                     print("\t", self.prefix_class(e['type']), " *obj = ", self.prefix_class(e['type']), "_new(", sep='', end='', file=f)
                     #if e['type'] in need_name:
                     #    print('"', end='', file=f)
@@ -416,6 +438,7 @@ class genclass:
                 if e.get('array', False):
                     print("int ", self.class_name, "_add_", e['name'], "(", self.class_name, " *self, ", self.prefix_class(e['type']), " *child)", sep='', file=f)
                     print("{", file=f)
+                    self.print_invalidate_message_index(e['name'], f, True)
                     print("\t", self.prefix_class(e['type']), " **new_array = realloc(self->", e['name'], ", (self->num_", e['name'], " + 1) * sizeof(", self.prefix_class(e['type']), " *));", sep='', file=f)
                     print("\tif (!new_array) {", file=f)
                     print("\t\treturn 1;", file=f)
@@ -429,6 +452,7 @@ class genclass:
 
                     print("int ", self.class_name, "_remove_", e['name'], "(", self.class_name, " *self, int index)", sep='', file=f)
                     print("{", file=f)
+                    self.print_invalidate_message_index(e['name'], f)
                     print("\tint size = self->num_", e['name'], ";", sep='', file=f)
                     print("\tif (index >= size) {", file=f)
                     print("\t\treturn 0;", file=f)
@@ -496,6 +520,24 @@ class genclass:
                 print("self->", e['name'], ' || ', sep='', end='', file=f)
             print("self->", items_to_test[-1]['name'], ") {", sep='', file=f)
 
+        self.print_xml_start_tag(f)
+
+        if self.children:
+            for e in self.children:
+                self.print_xml_child(e, f)
+
+        if self.children or self.attributes:
+            print("\t\trc = xmlTextWriterEndElement(writer);", file=f)
+            print("\t\tif (rc < 0) return 1;", file=f)
+            if not self.extends:
+                print("\t\tso_stats_end_element();", file=f)
+            print("\t}", file=f)
+
+        print("\treturn 0;", file=f)
+        print("}", file=f)
+        print(file=f)
+
+    def print_xml_start_tag(self, f):
         if self.extends:
             print("\t\trc = ", self.prefix_class(self.extends), "_xml(self->base, writer, element_name);", sep='', file=f)
             print("\t\tif (rc != 0) return rc;", file=f)
@@ -507,9 +549,11 @@ class genclass:
             if self.name in need_name:
                 print('\t\trc = xmlTextWriterStartElement(writer, BAD_CAST element_name);', sep='', file=f)
                 print('\t\tif (rc < 0) return 1;', file=f)
+                print('\t\tso_stats_start_element(element_name);', file=f)
             else:
                 print('\t\trc = xmlTextWriterStartElement(writer, BAD_CAST "', self.prefix, name, '");', sep='', file=f)
                 print('\t\tif (rc < 0) return 1;', file=f)
+                print('\t\tso_stats_start_element("', self.prefix, name, '");', sep='', file=f)
 
         if self.fixed_attributes:
             for a in self.fixed_attributes:
@@ -530,50 +574,66 @@ class genclass:
                     print('\t\t\tif (rc < 0) return 1;', file=f)
                 print("\t\t}", file=f)
 
-        if self.children:
-            for e in self.children:
-                print("\t\tif (self->", e['name'], ") {", sep='', file=f)
-                if e['type'] in need_name:
-                    extra = ", \"" + e['name'] + "\""
-                else:
-                    extra = ""
-                is_array = e.get('array', False)
-                if is_array:
-                    print("\t\t\tfor (int i = 0; i < self->num_", e['name'], "; i++) {" ,sep='', file=f)
-                    print("\t\t\t\trc = ", self.prefix_class(e['type']), "_xml(self->", e['name'], "[i], writer", extra, ");", sep='', file=f)
-                    print("\t\t\t\tif (rc != 0) return 1;", file=f)
-                    print("\t\t\t}", file=f)
-                else:
-                    if e['type'] == "type_string" or e['type'] == "type_real" or e['type'] == "type_int":
-                        element_name = e['name']
-                        if e.get('prefix', False):
-                            element_name = e['prefix'] + ":" + element_name
-                        if e['type'] == "type_string":
-                            print("\t\t\trc = xmlTextWriterWriteElement(writer, BAD_CAST \"", element_name, "\", BAD_CAST self->", e['name'], ");", sep='', file=f)
-                            print("\t\t\tif (rc < 0) return 1;", file=f)
-                        elif e['type'] == "type_real":
-                            print("\t\t\tchar *number_string = pharmml_double_to_string(self->", e['name'], "_number);", sep='', file=f)
-                            print("\t\t\tif (!number_string) return 1;", file=f)
-                            print("\t\t\trc = xmlTextWriterWriteElement(writer, BAD_CAST \"", element_name, "\", BAD_CAST number_string);", sep='', file=f)
-                            print("\t\t\tfree(number_string);", file=f)
-                            print("\t\t\tif (rc < 0) return 1;", file=f)
-                        elif e['type'] == "type_int":
-                            print("\t\t\tchar *number_string = pharmml_int_to_string(self->", e['name'], "_number);", sep='', file=f)
-                            print("\t\t\tif (!number_string) return 1;", file=f)
-                            print("\t\t\trc = xmlTextWriterWriteElement(writer, BAD_CAST \"", element_name, "\", BAD_CAST number_string);", sep='', file=f)
-                            print("\t\t\tfree(number_string);", file=f)
-                            print("\t\t\tif (rc < 0) return 1;", file=f)
-                    else:
-                        print("\t\t\trc = ", self.prefix_class(e['type']), "_xml(self->", e['name'], ", writer", extra, ");", sep='', file=f)
-                        print("\t\t\tif (rc != 0) return rc;", file=f)
-
-                print("\t\t}", file=f)
+    def print_xml_child(self, e, f):
+        print("\t\tif (self->", e['name'], ") {", sep='', file=f)
+        if e['type'] in need_name:
+            extra = ", \"" + e['name'] + "\""
+        else:
+            extra = ""
+        is_array = e.get('array', False)
+        if is_array:
+            print("\t\t\tfor (int i = 0; i < self->num_", e['name'], "; i++) {" ,sep='', file=f)
+            print("\t\t\t\trc = ", self.prefix_class(e['type']), "_xml(self->", e['name'], "[i], writer", extra, ");", sep='', file=f)
+            print("\t\t\t\tif (rc != 0) return 1;", file=f)
+            print("\t\t\t}", file=f)
+        else:
+            if e['type'] == "type_string" or e['type'] == "type_real" or e['type'] == "type_int":
+                element_name = e['name']
+                if e.get('prefix', False):
+                    element_name = e['prefix'] + ":" + element_name
+                print("\t\t\tso_stats_count_element(\"", element_name, "\");", sep='', file=f)
+                if e['type'] == "type_string":
+                    print("\t\t\trc = xmlTextWriterWriteElement(writer, BAD_CAST \"", element_name, "\", BAD_CAST self->", e['name'], ");", sep='', file=f)
+                    print("\t\t\tif (rc < 0) return 1;", file=f)
+                elif e['type'] == "type_real":
+                    print("\t\t\tchar *number_string = pharmml_double_to_string(self->", e['name'], "_number);", sep='', file=f)
+                    print("\t\t\tif (!number_string) return 1;", file=f)
+                    print("\t\t\trc = xmlTextWriterWriteElement(writer, BAD_CAST \"", element_name, "\", BAD_CAST number_string);", sep='', file=f)
+                    print("\t\t\tfree(number_string);", file=f)
+                    print("\t\t\tif (rc < 0) return 1;", file=f)
+                elif e['type'] == "type_int":
+                    print("\t\t\tchar *number_string = pharmml_int_to_string(self->", e['name'], "_number);", sep='', file=f)
+                    print("\t\t\tif (!number_string) return 1;", file=f)
+                    print("\t\t\trc = xmlTextWriterWriteElement(writer, BAD_CAST \"", element_name, "\", BAD_CAST number_string);", sep='', file=f)
+                    print("\t\t\tfree(number_string);", file=f)
+                    print("\t\t\tif (rc < 0) return 1;", file=f)
+            else:
+                print("\t\t\trc = ", self.prefix_class(e['type']), "_xml(self->", e['name'], ", writer", extra, ");", sep='', file=f)
+                print("\t\t\tif (rc != 0) return rc;", file=f)
 
-        if self.children or self.attributes:
-            print("\t\trc = xmlTextWriterEndElement(writer);", file=f)
-            print("\t\tif (rc < 0) return 1;", file=f)
-            print("\t}", file=f)
+        print("\t\t}", file=f)
 
+    # Write the start tag and the end tag of the SO separately so that the SOBlocks can be written in between
+    def create_xml_start_end(self):
+        f = self.c_file
+        blocks = [i for i, e in enumerate(self.children) if e['name'] == 'SOBlock'][0]
+        print("int ", self.class_name, "_xml_start(", self.class_name, " *self, xmlTextWriterPtr writer)", sep='', file=f)
+        print("{", file=f)
+        print("\tint rc;", file=f)
+        self.print_xml_start_tag(f)
+        for e in self.children[:blocks]:
+            self.print_xml_child(e, f)
+        print("\treturn 0;", file=f)
+        print("}", file=f)
+        print(file=f)
+        print("int ", self.class_name, "_xml_end(", self.class_name, " *self, xmlTextWriterPtr writer)", sep='', file=f)
+        print("{", file=f)
+        print("\tint rc;", file=f)
+        for e in self.children[blocks + 1:]:
+            self.print_xml_child(e, f)
+        print("\t\trc = xmlTextWriterEndElement(writer);", file=f)
+        print("\t\tif (rc < 0) return 1;", file=f)
+        print("\t\tso_stats_end_element();", file=f)
         print("\treturn 0;", file=f)
         print("}", file=f)
         print(file=f)
@@ -663,7 +723,7 @@ class genclass:
 
     def create_end(self):
         f = self.c_file
-        print("void ", self.class_name, "_end_element(", self.class_name, " *self, const char *localname)", sep='', file=f)
+        print("int ", self.class_name, "_end_element(", self.class_name, " *self, const char *localname)", sep='', file=f)
         print("{", file=f)
 
         if self.children:
@@ -679,10 +739,16 @@ class genclass:
             for e in self.children:
                 if e['type'] != "type_string" and e['type'] != "type_real" and e['type'] != "type_int":
                     print(" else if (self->in_", e['name'], ") {", sep='', file=f)
-                    print("\t\t", self.prefix_class(e['type']), "_end_element(self->", e['name'], sep='', end='', file=f)
+                    child = "self->" + e['name']
                     if e.get("array", False):
-                        print("[self->num_", e['name'], " - 1]", sep='', end='', file=f)
-                    print(", localname);", file=f)
+                        child += "[self->num_" + e['name'] + " - 1]"
+                    # The handwritten Matrix cannot fail when ending an element. It keeps its error instead.
+                    if e['type'] in self.structure or e['type'] == 'Table':
+                        print("\t\treturn ", self.prefix_class(e['type']), "_end_element(", child, ", localname);", sep='', file=f)
+                    else:
+                        print("\t\t", self.prefix_class(e['type']), "_end_element(", child, ", localname);", sep='', file=f)
+                        if e['type'] == 'Matrix':
+                            print("\t\treturn so_Matrix_has_error(", child, ");", sep='', file=f)
                     print("\t}", end='', file=f)
 
             print(file=f)
@@ -691,10 +757,15 @@ class genclass:
             if self.children:
                 print(" else {", file=f)
                 print("\t", end='', file=f)
-            print("\t", self.prefix_class(self.extends), "_end_element(self->base, localname);", sep='', file=f)
+            if self.extends in self.structure or self.extends == 'Table':
+                print("\treturn ", self.prefix_class(self.extends), "_end_element(self->base, localname);", sep='', file=f)
+            else:
+                print("\t", self.prefix_class(self.extends), "_end_element(self->base, localname);", sep='', file=f)
             if self.children:
-                print("\t}", end='', file=f)
+                print("\t}", file=f)
 
+        if not self.extends or self.children or (self.extends not in self.structure and self.extends != 'Table'):
+            print("\treturn 0;", file=f)
         print("}", file=f)
         print(file=f)
 
@@ -711,8 +782,7 @@ class genclass:
                     print("\t", end='', file=f)
                 print("if (self->in_", self.children[i]['name'], ") {", sep='', file=f)
                 if self.children[i]['type'] == "type_string":
-                    print("\t\tself->", self.children[i]['name'], " = pharmml_strndup(ch, len);", sep='', file=f)
-                    print("\t\tif (!self->", self.children[i]['name'], ") {", sep='', file=f)
+                    print("\t\tif (pharmml_strnappend(&self->", self.children[i]['name'], ", ch, len)) {", sep='', file=f)
                     print("\t\t\treturn 1;", file=f)
                     print("\t\t}", file=f)
                 elif self.children[i]['type'] == "type_real":
@@ -1017,13 +1087,16 @@ class genclass:
 
             print(file=f)
             print("int ", self.class_name, "_start_element(", self.class_name, " *self, const char *localname, int nb_attributes, const char **attributes);", sep='', file=f)
-            print("void ", self.class_name, "_end_element(", self.class_name, " *self, const char *localname);", sep='', file=f)
+            print("int ", self.class_name, "_end_element(", self.class_name, " *self, const char *localname);", sep='', file=f)
             print("int ", self.class_name, "_characters(", self.class_name, " *self, const char *ch, int len);", sep='', file=f)
             if self.name in need_name:
                 extra = ", char *element_name"
             else:
                 extra = ""
             print("int ", self.class_name, "_xml(", self.class_name, " *self, xmlTextWriterPtr writer", extra, ");", sep='', file=f)
+            if self.class_name == "so_SO":
+                print("int ", self.class_name, "_xml_start(", self.class_name, " *self, xmlTextWriterPtr writer);", sep='', file=f)
+                print("int ", self.class_name, "_xml_end(", self.class_name, " *self, xmlTextWriterPtr writer);", sep='', file=f)
             if self.attributes:
                 print("int ", self.class_name, "_init_attributes(", self.class_name, " *self, int nb_attributes, const char **attributes);", sep='', file=f)
             print(file=f)
@@ -23,6 +23,14 @@ need_name = [
     'Table', 'Matrix', 'ExternalFile', 'SimulationSubType'
 ]
 
+# Members of classes that are in the message index of the SO. Changing them makes the index stale.
+message_index_members = {
+    'SO' : [ 'SOBlock' ],
+    'SOBlock' : [ 'TaskInformation' ],
+    'TaskInformation' : [ 'Message' ],
+    'Message' : [ 'type', 'Toolname', 'Severity' ],
+}
+
 namespaces = {
     'Table' : 'so',
     'Matrix' : 'so',
@@ -52,7 +60,7 @@ structure = {
             { 'name' : "writtenVersion", 'value' : "0.3.1" },
         ],
         'xpath' : 'SO',
-        'fields' : [ 'int error;', 'char *path;' ],
+        'fields' : [ 'int error;', 'char *path;', 'struct so_stats *stats;', 'struct so_MessageIndex *message_index;' ],
         'namespace' : 'so'
     },
     'PharmMLRef' : {
@@ -80,6 +88,7 @@ structure = {
             { 'name' : 'blkId', 'type' : 'type_string' },
         ],
         'xpath' : 'SO/SOBlock',
+        'fields' : [ 'struct so_MessageIndex **message_index;' ],
         'namespace' : 'so'
     },
     'ToolSettings' : {
@@ -106,6 +115,7 @@ structure = {
             { 'name' : 'NumberIterations', 'type' : 'type_int' },
         ],
         'xpath' : 'SO/SOBlock/TaskInformation',
+        'fields' : [ 'struct so_MessageIndex **message_index;' ],
         'namespace' : 'so'
     },
     'Message' : {
@@ -119,6 +129,7 @@ structure = {
             { 'name' : 'type', 'type' : 'type_string' },
         ],
         'xpath' : 'SO/SOBlock/TaskInformation/Message',
+        'fields' : [ 'struct so_MessageIndex **message_index;' ],
         'namespace' : 'so'
     },
     'Estimation' : {
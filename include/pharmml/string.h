@@ -24,6 +24,7 @@ int pharmml_string_to_int(const char *str);
 char *pharmml_int_to_string(int x);
 char *pharmml_strdup(const char *str);
 char *pharmml_strndup(const char *str, size_t n);
+int pharmml_strnappend(char **str, const char *append, size_t n);
 int pharmml_copy_string_array(char **source, char **dest, int length);
 void pharmml_free_string_array(char **array, int length);
 int so_string_path_length(char *path);
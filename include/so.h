@@ -20,8 +20,15 @@
 
 #include <so/SO.h>
 #include <so/SOBlock.h>
+#include <so/stats.h>
+#include <so/ReadContext.h>
+#include <so/compression.h>
+#include <so/Scan.h>
+#include <so/TableView.h>
+#include <so/Predicate.h>
 #include <so/soext.h>
 #include <so/SOBlock_ext.h>
+#include <so/Writer.h>
 #include <pharmml/string.h>
 
 #endif
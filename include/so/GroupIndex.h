@@ -0,0 +1,34 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_GROUPINDEX_H
+#define _SO_GROUPINDEX_H
+
+/** \struct so_GroupIndex
+	 \brief An index of the rows of a table grouped by ID
+*/
+typedef struct so_GroupIndex so_GroupIndex;
+
+int so_GroupIndex_get_number_of_groups(so_GroupIndex *self);
+int so_GroupIndex_find(so_GroupIndex *self, char *id);
+char *so_GroupIndex_get_id(so_GroupIndex *self, int group);
+int so_GroupIndex_get_number_of_rows(so_GroupIndex *self, int group);
+int *so_GroupIndex_get_rows(so_GroupIndex *self, int group);
+int so_GroupIndex_get_group_of_row(so_GroupIndex *self, int row);
+
+#endif
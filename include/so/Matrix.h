@@ -22,6 +22,9 @@
 
 typedef struct so_Matrix so_Matrix;
 
+// Storage of the data of a matrix. Symmetric matrices can be stored with only the lower triangle packed row by row.
+typedef enum { SO_MATRIX_DENSE, SO_MATRIX_PACKED_SYMMETRIC } so_MatrixStorage;
+
 so_Matrix *so_Matrix_new(void);
 so_Matrix *so_Matrix_copy(so_Matrix *source);
 void so_Matrix_free(so_Matrix *self);
@@ -35,5 +38,20 @@ char *so_Matrix_get_ColumnNames(so_Matrix *self, int index);
 int so_Matrix_set_RowNames(so_Matrix *self, int index, char *RowName);
 int so_Matrix_set_ColumnNames(so_Matrix *self, int index, char *ColumnName);
 double *so_Matrix_get_data(so_Matrix *self);
+int so_Matrix_set_symmetric_size(so_Matrix *self, int size);
+so_MatrixStorage so_Matrix_get_storage(so_Matrix *self);
+int so_Matrix_set_storage(so_Matrix *self, so_MatrixStorage storage);
+int so_Matrix_is_symmetric(so_Matrix *self);
+double so_Matrix_get_element(so_Matrix *self, int row, int col);
+void so_Matrix_set_element(so_Matrix *self, int row, int col, double value);
+double *so_Matrix_get_packed_data(so_Matrix *self);
+so_Matrix *so_Matrix_correlation(so_Matrix *self);
+so_Matrix *so_Matrix_covariance(so_Matrix *self, double *sd);
+so_Matrix *so_Matrix_cholesky(so_Matrix *self);
+int so_Matrix_is_positive_definite(so_Matrix *self);
+so_Matrix *so_Matrix_inverse(so_Matrix *self);
+int so_Matrix_log_determinant(so_Matrix *self, double *logdet);
+int so_Matrix_eigen(so_Matrix *self, double *values, so_Matrix **vectors);
+int so_Matrix_condition_number(so_Matrix *self, double *condition);
 
 #endif
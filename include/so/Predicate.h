@@ -0,0 +1,42 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_PREDICATE_H
+#define _SO_PREDICATE_H
+
+#include <so/Table.h>
+#include <so/TableView.h>
+
+/** \struct so_Predicate
+	 \brief A condition on the rows of a table
+*/
+typedef struct so_Predicate so_Predicate;
+
+typedef enum { SO_PREDICATE_EQ, SO_PREDICATE_NE, SO_PREDICATE_LT, SO_PREDICATE_LE, SO_PREDICATE_GT, SO_PREDICATE_GE } so_PredicateOp;
+
+so_Predicate *so_Predicate_new_compare(char *column, so_PredicateOp op, double value);
+so_Predicate *so_Predicate_new_range(char *column, double low, double high);
+so_Predicate *so_Predicate_new_string_equal(char *column, char *value);
+so_Predicate *so_Predicate_new_and(so_Predicate *left, so_Predicate *right);
+so_Predicate *so_Predicate_new_or(so_Predicate *left, so_Predicate *right);
+void so_Predicate_free(so_Predicate *self);
+int *so_Predicate_evaluate(so_Predicate *self, so_Table *table, int *numrows);
+so_Table *so_Table_select(so_Table *self, so_Predicate *predicate, char **columns, int num_columns);
+so_TableView *so_Table_select_view(so_Table *self, so_Predicate *predicate);
+
+#endif
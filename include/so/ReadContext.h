@@ -0,0 +1,39 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_READCONTEXT_H
+#define _SO_READCONTEXT_H
+
+#include <so/stats.h>
+#include <so/Table.h>
+
+/** \struct so_ReadContext
+	 \brief Options for reading an SO
+*/
+typedef struct so_ReadContext so_ReadContext;
+
+so_ReadContext *so_ReadContext_new(void);
+void so_ReadContext_free(so_ReadContext *self);
+void so_ReadContext_set_stats(so_ReadContext *self, so_stats *stats);
+so_stats *so_ReadContext_get_stats(so_ReadContext *self);
+void so_ReadContext_set_real_storage(so_ReadContext *self, so_RealStorage storage, int min_rows);
+so_RealStorage so_ReadContext_get_real_storage(so_ReadContext *self);
+void so_ReadContext_set_real_decimals(so_ReadContext *self, int decimals);
+int so_ReadContext_get_real_decimals(so_ReadContext *self);
+
+#endif
@@ -0,0 +1,56 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef _SO_SCAN_H
+#define _SO_SCAN_H
+
+#include <stddef.h>
+#include <pharmml/common_types.h>
+
+/** \struct so_Scan
+	 \brief Metadata of an SO collected by so_SO_scan without loading the tables
+*/
+typedef struct so_Scan so_Scan;
+
+void so_Scan_free(so_Scan *self);
+char *so_Scan_get_id(so_Scan *self);
+char *so_Scan_get_metadataFile(so_Scan *self);
+char *so_Scan_get_PharmMLRef(so_Scan *self);
+int so_Scan_get_number_of_SOBlocks(so_Scan *self);
+char *so_Scan_get_blkId(so_Scan *self, int block);
+int so_Scan_get_number_of_tool_files(so_Scan *self, int block);
+char *so_Scan_get_tool_file(so_Scan *self, int block, int index);
+int so_Scan_get_number_of_messages(so_Scan *self, int block);
+int so_Scan_get_max_severity(so_Scan *self, int block);
+double so_Scan_get_RunTime(so_Scan *self, int block);
+int so_Scan_get_number_of_tables(so_Scan *self);
+int so_Scan_get_table_block(so_Scan *self, int table);
+char *so_Scan_get_table_path(so_Scan *self, int table);
+int so_Scan_get_table_number_of_rows(so_Scan *self, int table);
+int so_Scan_get_table_number_of_columns(so_Scan *self, int table);
+char *so_Scan_get_table_columnId(so_Scan *self, int table, int column);
+char *so_Scan_get_table_columnType(so_Scan *self, int table, int column);
+pharmml_valueType so_Scan_get_table_valueType(so_Scan *self, int table, int column);
+size_t so_Scan_get_table_offset(so_Scan *self, int table);
+size_t so_Scan_get_table_length(so_Scan *self, int table);
+int so_Scan_find_table(so_Scan *self, char *blkId, char *path);
+int so_Scan_write_index(so_Scan *self, char *filename);
+so_Scan *so_Scan_read_index(char *filename);
+
+#endif
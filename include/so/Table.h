@@ -21,9 +21,30 @@
 #include <string.h>
 #include <pharmml/common_types.h>
 #include <so/ExternalFile.h>
+#include <so/GroupIndex.h>
 
 typedef struct so_Table so_Table;
 
+typedef enum { SO_JOIN_INNER, SO_JOIN_LEFT, SO_JOIN_FULL } so_JoinType;
+
+// Storage of the data of a column. Run-length and constant encoded columns store one value per run of equal values.
+// Real columns can be stored narrowed as float or as int scaled by a power of ten.
+typedef enum { SO_COLUMN_PLAIN, SO_COLUMN_RLE, SO_COLUMN_CONSTANT, SO_COLUMN_FLOAT32, SO_COLUMN_SCALED_INT32 } so_ColumnEncoding;
+
+// How to store the real columns of large tables
+typedef enum { SO_REAL_DOUBLE, SO_REAL_FLOAT32, SO_REAL_SCALED_INT32 } so_RealStorage;
+
+// A run of rows having the same value. Initialize with SO_COLUMN_RUN_INIT before iterating with so_Table_next_run
+typedef struct {
+    int index;      // Number of the run
+    int start;      // First row of the run
+    int length;     // Number of rows in the run
+    void *value;    // Pointer to the value of all rows in the run
+    double real;    // The widened value of a narrowed real column. value will point here.
+} so_ColumnRun;
+
+#define SO_COLUMN_RUN_INIT { -1, 0, 0, NULL, 0 }
+
 so_Table *so_Table_new(void);
 so_Table *so_Table_copy(so_Table *source);
 void so_Table_free(so_Table *table);
@@ -43,6 +64,11 @@ int so_Table_get_number_of_columns(so_Table *self);
 int so_Table_get_number_of_rows(so_Table *self);
 void *so_Table_get_column_from_number(so_Table *self, int number);
 void *so_Table_get_column_from_name(so_Table *self, char *name);
+void *so_Table_get_writable_column(so_Table *self, int number);
+so_ColumnEncoding so_Table_get_encoding(so_Table *self, int number);
+int so_Table_encode_columns(so_Table *self);
+int so_Table_narrow_real_columns(so_Table *self, so_RealStorage storage, int decimals);
+int so_Table_next_run(so_Table *self, int number, so_ColumnRun *run);
 int so_Table_get_index_from_name(so_Table *self, char *name);
 int so_Table_new_column(so_Table *self, char *columnId, pharmml_columnType *columnTypes, int num_columnTypes, pharmml_valueType valueType, void *data);
 int so_Table_new_column_no_copy(so_Table *self, char *columnId, pharmml_columnType *columnTypes, int num_columnTypes, pharmml_valueType valueType, void *data);
@@ -52,9 +78,16 @@ int so_Table_idv_column(so_Table *self);
 char *so_Table_idv_column_name(so_Table *self);
 int so_Table_dv_column(so_Table *self);
 char *so_Table_dv_column_name(so_Table *self);
+so_GroupIndex *so_Table_group_index(so_Table *self);
 void so_Table_set_ExternalFile(so_Table *self, so_ExternalFile *value);
 so_ExternalFile *so_Table_get_ExternalFile(so_Table *self);
 so_ExternalFile *so_Table_create_ExternalFile(so_Table *self);
 void so_Table_set_write_external_file(so_Table *self, int write_external_file);
+so_Table *so_Table_column_summary(so_Table *self, int column, int by_id);
+so_Table *so_Table_column_quantiles(so_Table *self, int column, double *probs, int num_probs, int by_id);
+so_Table *so_Table_bootstrap_summary(so_Table *self, int original_row, double *probs, int num_probs);
+int *so_Table_sort_permutation(so_Table *self, int *key_columns, int num_keys);
+int so_Table_apply_permutation(so_Table *self, int *permutation);
+so_Table *so_Table_join(so_Table *left, so_Table *right, char **key_columns, int num_keys, so_JoinType join_type);
 
 #endif
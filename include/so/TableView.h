@@ -0,0 +1,38 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_TABLEVIEW_H
+#define _SO_TABLEVIEW_H
+
+#include <so/Table.h>
+
+/** \struct so_TableView
+	 \brief A selection and ordering of the rows of an so_Table without copying the data
+*/
+typedef struct so_TableView so_TableView;
+
+so_TableView *so_TableView_new(so_Table *table, int *rows, int numrows);
+void so_TableView_free(so_TableView *self);
+so_Table *so_TableView_get_table(so_TableView *self);
+int so_TableView_get_number_of_rows(so_TableView *self);
+int *so_TableView_get_rows(so_TableView *self);
+int so_TableView_gather_column(so_TableView *self, int column, void *dest);
+so_Table *so_TableView_materialize(so_TableView *self);
+so_TableView *so_Table_sorted_view(so_Table *self, int *key_columns, int num_keys);
+
+#endif
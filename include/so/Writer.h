@@ -0,0 +1,51 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SO_WRITER_H
+#define _SO_WRITER_H
+
+#include <stdbool.h>
+#include <so/SO.h>
+#include <so/SOBlock.h>
+#include <so/Table.h>
+#include <so/soext.h>
+
+/** \struct so_Writer
+	 \brief Incremental writer of an SO document
+*/
+typedef struct so_Writer so_Writer;
+
+so_Writer *so_Writer_new(char *filename, int pretty);
+so_Writer *so_Writer_new_callback(so_write_callback write, so_close_callback close, void *callback_context, int pretty);
+int so_Writer_start(so_Writer *self, so_SO *header);
+int so_Writer_add_SOBlock(so_Writer *self, so_SOBlock *block);
+int so_Writer_start_SOBlock(so_Writer *self, char *blkId);
+int so_Writer_start_element(so_Writer *self, char *name);
+int so_Writer_write_attribute(so_Writer *self, char *name, char *value);
+int so_Writer_end_element(so_Writer *self);
+int so_Writer_start_table(so_Writer *self, char *element_name, so_Table *definition);
+int so_Writer_start_row(so_Writer *self);
+int so_Writer_add_real(so_Writer *self, double value);
+int so_Writer_add_int(so_Writer *self, int value);
+int so_Writer_add_string(so_Writer *self, char *value);
+int so_Writer_add_bool(so_Writer *self, bool value);
+int so_Writer_end_row(so_Writer *self);
+int so_Writer_end_table(so_Writer *self);
+int so_Writer_flush(so_Writer *self);
+int so_Writer_close(so_Writer *self);
+
+#endif
@@ -0,0 +1,26 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SO_COMPRESSION_H
+#define _SO_COMPRESSION_H
+
+typedef enum { SO_COMPRESSION_NONE, SO_COMPRESSION_GZIP, SO_COMPRESSION_ZSTD } so_Compression;
+
+int so_compression_is_available(so_Compression compression);
+so_Compression so_compression_from_filename(const char *filename);
+
+#endif
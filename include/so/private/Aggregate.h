@@ -0,0 +1,58 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SO_PRIVATE_AGGREGATE_H
+#define _SO_PRIVATE_AGGREGATE_H
+
+#include <so/Table.h>
+#include <so/private/column.h>
+#include <so/private/hash.h>
+
+// Aggregation of values from many items, e.g. SOBlocks, into one table. The items are split into
+// contiguous ranges that are mapped in parallel, each into a segment having its own columns. The
+// segments are then merged in item order, so that columns appear in order of first appearance.
+// Cells that are never set get NA, 0, "" or false depending on the valueType. All values of a column
+// must have the same valueType or the aggregation fails.
+
+// Number of segments per thread to balance the load of items of different size
+#define SO_AGGREGATE_SEGMENTS_PER_THREAD 4
+
+typedef struct {
+    so_Hash *index;         // columnId to column number
+    so_Column **columns;
+    int numcols;
+    int alloced_cols;
+    int numrows;
+    int alloced_rows;       // Rows allocated in each column
+    int group_start;        // First row of the rows added last
+    int failed;
+} so_AggregateSegment;
+
+// Map one item into the segment by adding rows and setting their values. Return 0 for success.
+typedef int (*so_AggregateMap)(so_AggregateSegment *segment, int item, void *context);
+
+pharmml_valueType so_aggregate_valueType(pharmml_valueType valueType);
+so_Table *so_aggregate(int num_items, so_AggregateMap map, void *context);
+int so_AggregateSegment_new_rows(so_AggregateSegment *self, int n);
+int so_AggregateSegment_set_value(so_AggregateSegment *self, char *columnId, pharmml_columnType *columnTypes, int num_columnTypes, pharmml_valueType valueType, void *value);
+int so_AggregateSegment_set_real(so_AggregateSegment *self, char *columnId, double value);
+int so_AggregateSegment_set_int(so_AggregateSegment *self, char *columnId, int value);
+int so_AggregateSegment_set_string(so_AggregateSegment *self, char *columnId, char *value);
+int so_AggregateSegment_set_column(so_AggregateSegment *self, so_Column *source);
+int so_AggregateSegment_append_table(so_AggregateSegment *self, so_Table *table);
+
+#endif
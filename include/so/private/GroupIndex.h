@@ -0,0 +1,39 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_PRIVATE_GROUPINDEX_H
+#define _SO_PRIVATE_GROUPINDEX_H
+
+#include <so/GroupIndex.h>
+#include <so/private/hash.h>
+
+struct so_GroupIndex {
+    so_Hash *hash;          // ID to group number
+    char **ids;             // ID of each group as string. NULL for the group of missing IDs.
+    int num_groups;
+    int missing_group;      // Group of the rows with a missing ID or -1
+    int numrows;
+    int *offsets;           // Rows of group g are rows[offsets[g]] to rows[offsets[g + 1] - 1]
+    int *rows;
+    int *group_of_row;
+};
+
+so_GroupIndex *so_GroupIndex_new(int numrows, char **ids);
+void so_GroupIndex_free(so_GroupIndex *self);
+
+#endif
@@ -20,12 +20,38 @@
 
 #include <libxml/xmlwriter.h>
 
+// Smallest number of elements allocated when growing the arrays used while reading
+#define SO_MATRIX_MIN_ALLOC 16
+
+// Size of the square tiles of the blocked linear algebra kernels
+#define SO_MATRIX_BLOCK 64
+
+// Maximum number of iterations per eigenvalue before the eigensolver gives up
+#define SO_MATRIX_MAX_QL_ITERATIONS 60
+
+// Index of element (row, col) with col <= row in the packed lower triangle
+#define SO_MATRIX_PACKED_INDEX(row, col) ((size_t) (row) * ((row) + 1) / 2 + (col))
+
 struct so_Matrix {
-    double *data;
+    double *data;               // Row major. Only the lower triangle if storage is SO_MATRIX_PACKED_SYMMETRIC
+    so_MatrixStorage storage;
     char **rownames;
     char **colnames;
     int numcols;
     int numrows;
+    char *names;                // Arena holding all names that were read. Names in the arena are not freed one by one.
+    size_t names_size;
+    size_t names_alloced;
+    size_t *rowname_offsets;    // Offsets of the names into the arena while reading
+    size_t rowname_offsets_alloced;
+    size_t *colname_offsets;
+    size_t colname_offsets_alloced;
+    char *row_text;             // The texts of the Reals of the current MatrixRow separated by NULs
+    size_t row_text_size;
+    size_t row_text_alloced;
+    size_t rows_alloced;        // Number of rows that data has room for while reading
+    int rownames_known;         // RowNames have been read so the number of rows is known
+    int error;                  // Set if reading failed. Reported by the next call that can fail
     int current_row;
     int current_col;
     int in_matrix;
@@ -41,5 +67,7 @@ int so_Matrix_xml(so_Matrix *self, xmlTextWriterPtr writer, char *element_name);
 int so_Matrix_start_element(so_Matrix *self, const char *localname, int nb_attributes, const char **attributes);
 void so_Matrix_end_element(so_Matrix *self, const char *localname);
 int so_Matrix_characters(so_Matrix *self, const char *ch, int len);
+int so_Matrix_has_error(so_Matrix *self);
+size_t so_Matrix_data_size(so_Matrix *self);
 
 #endif
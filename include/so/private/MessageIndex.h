@@ -0,0 +1,67 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SO_PRIVATE_MESSAGEINDEX_H
+#define _SO_PRIVATE_MESSAGEINDEX_H
+
+#include <so/SOBlock.h>
+#include <so/Message.h>
+#include <so/private/hash.h>
+
+// Index of the TaskInformation messages of all SOBlocks of an SO. The messages are grouped
+// by their type and Toolname and each group keeps a histogram of the severities. The index
+// is extended block by block while reading and when SOBlocks have been added. The indexed
+// SOBlocks, TaskInformations and Messages point to the index of the SO so that their
+// mutators can free it. It is then rebuilt when next used.
+
+// Severities are clamped to 0 - SO_MESSAGE_MAX_SEVERITY. A missing Severity counts as 0.
+#define SO_MESSAGE_MAX_SEVERITY 10
+
+typedef struct {
+    so_Message *message;
+    int block;
+    int severity;
+    int group;
+} so_MessageEntry;
+
+typedef struct {
+    char *type;
+    char *toolname;
+    int histogram[SO_MESSAGE_MAX_SEVERITY + 1];
+} so_MessageGroup;
+
+struct so_MessageIndex {
+    so_MessageEntry *entries;       // All messages in document order
+    int num_entries;
+    int alloced_entries;
+    so_MessageGroup *groups;
+    int num_groups;
+    so_Hash *group_hash;            // type and toolname joined by a unit separator to group number
+    int num_blocks;                 // Number of SOBlocks indexed
+    int alloced_blocks;
+    so_SOBlock **blocks;            // The indexed SOBlocks to be detached when the index is freed
+    struct so_MessageIndex **owner; // Where the SO keeps the index
+};
+
+typedef struct so_MessageIndex so_MessageIndex;
+
+so_MessageIndex *so_MessageIndex_new(so_MessageIndex **owner);
+void so_MessageIndex_free(so_MessageIndex *self);
+void so_MessageIndex_invalidate(so_MessageIndex **index);
+int so_MessageIndex_add_SOBlock(so_MessageIndex *self, so_SOBlock *block);
+
+#endif
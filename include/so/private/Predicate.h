@@ -0,0 +1,37 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_PRIVATE_PREDICATE_H
+#define _SO_PRIVATE_PREDICATE_H
+
+#include <so/Predicate.h>
+
+typedef enum { SO_PREDICATE_COMPARE, SO_PREDICATE_RANGE, SO_PREDICATE_STRING_EQUAL, SO_PREDICATE_AND, SO_PREDICATE_OR } so_PredicateType;
+
+struct so_Predicate {
+    so_PredicateType type;
+    char *column;
+    so_PredicateOp op;
+    double value;
+    double high;
+    char *string;
+    so_Predicate *left;
+    so_Predicate *right;
+};
+
+#endif
@@ -0,0 +1,37 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_PRIVATE_READCONTEXT_H
+#define _SO_PRIVATE_READCONTEXT_H
+
+#include <so/ReadContext.h>
+
+struct so_ReadContext {
+    so_stats *stats;
+    so_RealStorage real_storage;
+    int real_min_rows;          // Only tables with at least this many rows get narrowed real columns
+    int real_decimals;          // Decimals to keep for SO_REAL_SCALED_INT32
+};
+
+// The options of the read in progress or NULL if none. Each thread has its own.
+extern so_ReadContext *so_ReadContext_current;
+#ifdef _OPENMP
+#pragma omp threadprivate(so_ReadContext_current)
+#endif
+
+#endif
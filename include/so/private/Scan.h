@@ -0,0 +1,81 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_PRIVATE_SCAN_H
+#define _SO_PRIVATE_SCAN_H
+
+#include <libxml/xmlIO.h>
+#include <so/Scan.h>
+#include <so/Table.h>
+
+// Bytes requested from the input at a time
+#define SO_SCAN_READ_SIZE 65536
+
+// Elements nested deeper than this are not part of table paths
+#define SO_SCAN_MAX_DEPTH 32
+
+typedef struct {
+    char *blkId;
+    int num_tool_files;
+    char **tool_files;          // ds:path of each ToolSettings/File
+    int num_messages;
+    int max_severity;           // -1 if no message has a Severity
+    double run_time;            // NA if not available
+} so_ScanBlock;
+
+typedef struct {
+    int block;                  // -1 for tables outside of SOBlocks
+    char *path;                 // Element names from the SOBlock down to the table element separated by '/'
+    int num_columns;
+    char **columnIds;
+    char **columnTypes;
+    pharmml_valueType *valueTypes;
+    int numrows;
+    size_t definition_start;    // Byte range of the ds:Definition element
+    size_t definition_end;
+    size_t table_start;         // Byte range of the ds:Table element. Both 0 for an ExternalFile.
+    size_t table_end;
+    size_t end;                 // Offset of the end tag of the table element
+    int num_namespaces;         // Namespaces declared between the SO element and the ds:Definition
+    char **namespace_prefixes;  // NULL for the default namespace
+    char **namespace_uris;
+} so_ScanTable;
+
+struct so_Scan {
+    char *id;
+    char *metadataFile;
+    char *PharmMLRef;
+    int num_namespaces;         // Namespaces declared on the SO element
+    char **namespace_prefixes;  // NULL for the default namespace
+    char **namespace_uris;
+    int num_blocks;
+    so_ScanBlock *blocks;
+    int num_tables;
+    so_ScanTable *tables;
+    size_t size;                // Length of the uncompressed document
+};
+
+so_Scan *so_Scan_read(xmlParserInputBufferPtr input);
+so_Scan *so_Scan_new(void);
+int so_Scan_new_block(so_Scan *self);
+int so_Scan_new_table(so_Scan *self);
+int so_Scan_new_column(so_ScanTable *table);
+int so_Scan_add_namespace(int *num_namespaces, char ***prefixes, char ***uris, const char *prefix, const char *uri);
+so_Table *so_Scan_load_table(so_Scan *self, const char *filename, int table);
+
+#endif
@@ -21,11 +21,27 @@
 #include <so/Table.h>
 #include <so/private/column.h>
 #include <so/ExternalFile.h>
+#include <so/GroupIndex.h>
 #include <libxml/xmlwriter.h>
+#include <stdbool.h>
+
+// Number of rows that are gathered row by row while parsing before being transposed into the columns
+#define SO_TABLE_STAGING_ROWS 1024
+
+// Number of rows per tile when transposing the staged rows
+#define SO_TABLE_TRANSPOSE_TILE 64
+
+typedef union {
+    double real;
+    int integer;
+    char *string;
+    bool boolean;
+} so_TableCell;
 
 struct so_Table {
     so_Column **columns;
     so_ExternalFile *ExternalFile;
+    so_GroupIndex *group_index;     // Cached index of the ID column. Cleared when the table changes
     int (*superclass_func)(void *, xmlTextWriterPtr writer);
     void *superclass;
     int write_external_file;
@@ -40,12 +56,19 @@ struct so_Table {
     int in_real;
     int in_int;
     int in_string;
+    so_TableCell *staging;      // Row major block of rows that are not yet in the columns
+    int staged_rows;
     int reference_count;
 };
 
 int so_Table_xml(so_Table *self, xmlTextWriterPtr writer, char *element_name);
+int so_Table_xml_start(so_Table *self, xmlTextWriterPtr writer, char *element_name);
+int so_Table_xml_definition(so_Table *self, xmlTextWriterPtr writer);
+int so_Table_xml_cell(xmlTextWriterPtr writer, pharmml_valueType valueType, void *value);
 int so_Table_start_element(so_Table *table, const char *localname, int nb_attributes, const char **attributes);
-void so_Table_end_element(so_Table *table, const char *localname);
+int so_Table_end_element(so_Table *table, const char *localname);
 int so_Table_characters(so_Table *table, const char *ch, int len);
+void so_Table_clear_index(so_Table *self);
+int so_Table_reduce_column(so_Table *self, int column, int *n, double *sum, double *min, double *max);
 
 #endif
@@ -0,0 +1,32 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_PRIVATE_TABLEVIEW_H
+#define _SO_PRIVATE_TABLEVIEW_H
+
+#include <so/TableView.h>
+
+struct so_TableView {
+    so_Table *table;
+    int *rows;
+    int numrows;
+};
+
+so_Table *so_TableView_project(so_TableView *self, int *columns, int num_columns);
+
+#endif
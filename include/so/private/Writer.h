@@ -0,0 +1,42 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SO_PRIVATE_WRITER_H
+#define _SO_PRIVATE_WRITER_H
+
+#include <libxml/xmlwriter.h>
+#include <pharmml/common_types.h>
+#include <so/Writer.h>
+
+// Number of rows written between flushes of the output while streaming a table
+#define SO_WRITER_FLUSH_ROWS 1024
+
+struct so_Writer {
+    xmlTextWriterPtr writer;
+    xmlOutputBufferPtr out;         // Owned by the text writer
+    int started;                    // The SO element has been started
+    int depth;                      // Number of open elements inside the SO element
+    int failed;                     // Set on the first error. All later calls will fail
+    so_Table *definition;           // Definition of the table being written until its columns have been written
+    pharmml_valueType *valueTypes;  // Value types of the columns of the table being written or NULL
+    int numcols;
+    int table_depth;                // Depth of the table element
+    int current_column;             // Next column of the row being built or -1 if not in a row
+    int rows_since_flush;
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <pharmml/common_types.h>
+#include <so/Table.h>
 
 
 typedef struct {
@@ -32,10 +33,25 @@ typedef struct {
     int used_memory;
     int len;
     void *column;
+    int *shared;        // Reference count of column if the buffer is shared between copies
+    so_ColumnEncoding encoding;
+    int num_runs;       // Number of runs of an encoded column. column then holds one value per run
+    int *run_ends;      // Row after the last row of each run for run-length encoding
+    int decimals;       // Number of decimals kept by the scaled int encoding. Negative for multiples of powers of ten.
 } so_Column;
 
 so_Column *so_Column_new(void);
+so_Column *so_Column_copy(so_Column *col);
 void so_Column_free(so_Column *col);
+int so_Column_make_writable(so_Column *col);
+int so_Column_unref_shared(int *shared);
+int so_Column_reserve(so_Column *col, int n);
+int so_Column_decode(so_Column *col);
+int so_Column_encode(so_Column *col);
+int so_Column_narrow(so_Column *col, so_RealStorage storage, int decimals);
+int so_Column_next_run(so_Column *col, so_ColumnRun *run);
+void *so_Column_run_cell(so_Column *col, so_ColumnRun *run, int row);
+int so_Column_add_run(so_Column *col, void *value, int count);
 int so_Column_set_columnId(so_Column *col, char *columnId);
 void so_Column_set_valueType_from_string(so_Column *col, char *valueType);
 int so_Column_add_columnType_from_string(so_Column *col, char *columnType);
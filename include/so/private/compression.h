@@ -0,0 +1,37 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SO_PRIVATE_COMPRESSION_H
+#define _SO_PRIVATE_COMPRESSION_H
+
+#include <libxml/parser.h>
+#include <libxml/xmlIO.h>
+#include <so/compression.h>
+
+// Default levels when no level is given
+#define SO_GZIP_DEFAULT_LEVEL 6
+#define SO_ZSTD_DEFAULT_LEVEL 3
+
+so_Compression so_compression_of_file(const char *filename);
+xmlParserCtxtPtr so_zstd_create_parser_context(const char *filename);
+xmlParserInputBufferPtr so_zstd_create_input_buffer(const char *filename);
+xmlOutputBufferPtr so_zstd_create_output_buffer(const char *filename, int level);
+xmlOutputBufferPtr so_compression_create_output_buffer(const char *filename, so_Compression compression, int level);
+xmlParserInputBufferPtr so_compression_create_input_buffer(const char *filename);
+int so_compression_close_output(xmlOutputBufferPtr out);
+
+#endif
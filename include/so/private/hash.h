@@ -0,0 +1,42 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_PRIVATE_HASH_H
+#define _SO_PRIVATE_HASH_H
+
+// Open addressing hash table mapping strings to integers
+
+// FNV-1a. Hashes of several values are built by passing the offset to the first so_Hash_bytes.
+#define SO_HASH_FNV_OFFSET 2166136261u
+#define SO_HASH_FNV_PRIME 16777619u
+
+typedef struct {
+    char **keys;
+    int *values;
+    int size;
+    int count;
+} so_Hash;
+
+so_Hash *so_Hash_new(int expected_count);
+void so_Hash_free(so_Hash *self);
+int so_Hash_get(so_Hash *self, const char *key);
+int so_Hash_put(so_Hash *self, const char *key, int value);
+unsigned int so_Hash_string(const char *key);
+unsigned int so_Hash_bytes(const void *data, size_t length, unsigned int hash);
+
+#endif
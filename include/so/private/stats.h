@@ -0,0 +1,79 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_PRIVATE_STATS_H
+#define _SO_PRIVATE_STATS_H
+
+#include <so/stats.h>
+#include <so/private/hash.h>
+
+// Named counters in order of first appearance
+typedef struct {
+    so_Hash *index;
+    char **names;
+    long *counts;
+    double *seconds;
+    int size;
+} so_stats_counter;
+
+typedef struct {
+    size_t bytes;
+    so_stats_counter elements;
+    so_stats_counter sections;
+    long cells[PHARMML_VALUETYPE_ERROR + 1];
+    size_t string_bytes;
+    double conversion_time;
+} so_stats_direction;
+
+struct so_stats {
+    so_stats_direction read;
+    so_stats_direction write;
+    long column_reallocs;
+    size_t column_realloc_bytes;
+    so_stats_mode mode;
+    int depth;
+    int section;
+    double section_start;
+};
+
+// The statistics currently being collected or NULL if collection is turned off. Each thread has its own.
+extern so_stats *so_stats_current;
+#ifdef _OPENMP
+#pragma omp threadprivate(so_stats_current)
+#endif
+
+void so_stats_begin(so_stats *stats, so_stats_mode mode);
+void so_stats_end(void);
+void so_stats_merge(so_stats *self, so_stats *other);
+void so_stats_add_bytes(size_t bytes);
+void so_stats_count_element(const char *name);
+void so_stats_start_element(const char *name);
+void so_stats_end_element(void);
+void so_stats_section_begin(const char *name);
+void so_stats_section_end(void);
+void so_stats_count_cell(pharmml_valueType valueType);
+void so_stats_count_cells(pharmml_valueType valueType, long n);
+void so_stats_count_string(size_t bytes);
+void so_stats_count_realloc(size_t bytes);
+double so_stats_string_to_double(const char *str);
+void so_stats_strings_to_doubles(const char *str, double *values, int n);
+int so_stats_string_to_int(const char *str);
+char *so_stats_double_to_string(double x);
+char *so_stats_int_to_string(int x);
+
+#endif
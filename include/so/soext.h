@@ -18,12 +18,45 @@
 #ifndef _SO_SOEXT_H
 #define _SO_SOEXT_H
 
+#include <stddef.h>
+#include <so/SO.h>
+#include <so/stats.h>
+#include <so/ReadContext.h>
+#include <so/compression.h>
+#include <so/Scan.h>
+
+// Callbacks for reading and writing an SO. Same as the I/O callbacks of libxml.
+typedef int (*so_read_callback)(void *context, char *buffer, int len);
+typedef int (*so_write_callback)(void *context, const char *buffer, int len);
+typedef int (*so_close_callback)(void *context);
+
 char *so_get_last_error(void);
 so_SO *so_SO_read(char *filename);
+so_SO *so_SO_read_with_context(char *filename, so_ReadContext *context);
+so_SO *so_SO_read_callback(so_read_callback read, so_close_callback close, void *callback_context, so_ReadContext *context);
+so_SO *so_SO_read_memory(const char *buffer, size_t size, so_ReadContext *context);
+so_SO *so_SO_read_fd(int fd, so_ReadContext *context);
+so_Scan *so_SO_scan(char *filename);
+so_Table *so_SO_load_table_at(char *filename, so_Scan *scan, int table);
 int so_SO_write(so_SO *self, char *filename, int pretty);
+int so_SO_write_compressed(so_SO *self, char *filename, int pretty, so_Compression compression, int level);
+int so_SO_write_callback(so_SO *self, so_write_callback write, so_close_callback close, void *callback_context, int pretty);
+int so_SO_write_memory(so_SO *self, char **buffer, size_t *size, int pretty);
+int so_SO_write_fd(so_SO *self, int fd, int pretty);
+int so_SO_set_path(so_SO *self, char *path);
+char *so_SO_get_path(so_SO *self);
+void so_SO_set_stats(so_SO *self, so_stats *stats);
+so_stats *so_SO_get_stats(so_SO *self);
 so_SOBlock *so_SO_get_SOBlock_from_name(so_SO *self, char *name);
 so_Table *so_SO_all_population_estimates(so_SO *self);
 so_Table *so_SO_all_standard_errors(so_SO *self);
+so_Table *so_SO_all_relative_standard_errors(so_SO *self);
+so_Table *so_SO_all_shrinkage(so_SO *self);
+so_Table *so_SO_all_ofv(so_SO *self);
+so_Table *so_SO_all_objective_measures(so_SO *self);
+so_Table *so_SO_all_messages(so_SO *self);
+int so_SO_count_messages(so_SO *self, int min_severity, char *type, char *toolname);
+so_Message **so_SO_find_messages(so_SO *self, int min_severity, char *type, char *toolname, int *num_messages);
 int so_SO_is_ruv_parameter(so_SO *self, const char *name);
 int so_SO_is_structural_parameter(so_SO *self, const char *name);
 int so_SO_is_correlation_parameter(so_SO *self, const char *name);
@@ -0,0 +1,49 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SO_STATS_H
+#define _SO_STATS_H
+
+#include <stdio.h>
+#include <pharmml/common_types.h>
+
+/** \struct so_stats
+	 \brief Counters and timings collected while reading or writing an SO
+*/
+typedef struct so_stats so_stats;
+
+typedef enum { SO_STATS_READ, SO_STATS_WRITE } so_stats_mode;
+
+so_stats *so_stats_new(void);
+void so_stats_free(so_stats *self);
+void so_stats_reset(so_stats *self);
+size_t so_stats_get_bytes(so_stats *self, so_stats_mode mode);
+int so_stats_get_number_of_elements(so_stats *self, so_stats_mode mode);
+char *so_stats_get_element_name(so_stats *self, so_stats_mode mode, int index);
+long so_stats_get_element_count(so_stats *self, so_stats_mode mode, int index);
+long so_stats_get_cells(so_stats *self, so_stats_mode mode, pharmml_valueType valueType);
+size_t so_stats_get_string_bytes(so_stats *self, so_stats_mode mode);
+double so_stats_get_number_conversion_time(so_stats *self, so_stats_mode mode);
+int so_stats_get_number_of_sections(so_stats *self, so_stats_mode mode);
+char *so_stats_get_section_name(so_stats *self, so_stats_mode mode, int index);
+double so_stats_get_section_time(so_stats *self, so_stats_mode mode, int index);
+long so_stats_get_column_reallocs(so_stats *self);
+size_t so_stats_get_column_realloc_bytes(so_stats *self);
+int so_stats_print(so_stats *self, FILE *fp);
+
+#endif
@@ -0,0 +1,380 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <so/private/Aggregate.h>
+#include <so/private/Table.h>
+#include <pharmml/common_types.h>
+#include <pharmml/string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* IDs are aggregated as strings */
+pharmml_valueType so_aggregate_valueType(pharmml_valueType valueType)
+{
+    return valueType == PHARMML_VALUETYPE_ID ? PHARMML_VALUETYPE_STRING : valueType;
+}
+
+// Fill rows with the value of cells that are not set. Strings are NULL until the segments are merged.
+static void so_aggregate_fill_missing(so_Column *column, int start, int end)
+{
+    if (column->valueType == PHARMML_VALUETYPE_REAL) {
+        double na = pharmml_na();
+        for (int i = start; i < end; i++) {
+            ((double *) column->column)[i] = na;
+        }
+    } else {
+        int size = pharmml_valueType_to_size(column->valueType);
+        memset((char *) column->column + (size_t) start * size, 0, (size_t) (end - start) * size);
+    }
+}
+
+static void so_AggregateSegment_clear(so_AggregateSegment *self)
+{
+    for (int col = 0; col < self->numcols; col++) {
+        so_Column *column = self->columns[col];
+        if (column->valueType == PHARMML_VALUETYPE_STRING && column->column) {
+            for (int i = 0; i < self->numrows; i++) {
+                free(((char **) column->column)[i]);
+            }
+        }
+        so_Column_free(column);
+    }
+    free(self->columns);
+    so_Hash_free(self->index);
+}
+
+/* Add n rows to the segment. The values set after this call will be set for all of the new rows */
+int so_AggregateSegment_new_rows(so_AggregateSegment *self, int n)
+{
+    int numrows = self->numrows + n;
+    if (numrows > self->alloced_rows) {
+        int alloced_rows = self->alloced_rows ? self->alloced_rows : 16;
+        while (alloced_rows < numrows) {
+            alloced_rows *= 2;
+        }
+        for (int col = 0; col < self->numcols; col++) {
+            so_Column *column = self->columns[col];
+            void *data = realloc(column->column, (size_t) alloced_rows * pharmml_valueType_to_size(column->valueType));
+            if (!data) {
+                self->failed = 1;
+                return 1;
+            }
+            column->column = data;
+        }
+        self->alloced_rows = alloced_rows;
+    }
+    for (int col = 0; col < self->numcols; col++) {
+        so_aggregate_fill_missing(self->columns[col], self->numrows, numrows);
+    }
+    self->group_start = self->numrows;
+    self->numrows = numrows;
+    return 0;
+}
+
+// Get a column of the segment creating it if needed. Fails if the column already has another valueType.
+static so_Column *so_AggregateSegment_column(so_AggregateSegment *self, char *columnId, pharmml_columnType *columnTypes, int num_columnTypes, pharmml_valueType valueType)
+{
+    if (!self->index) {
+        self->index = so_Hash_new(16);
+        if (!self->index) {
+            self->failed = 1;
+            return NULL;
+        }
+    }
+
+    int col = so_Hash_get(self->index, columnId);
+    if (col >= 0) {
+        so_Column *column = self->columns[col];
+        if (column->valueType != valueType) {
+            self->failed = 1;
+            return NULL;
+        }
+        return column;
+    }
+
+    if (self->numcols == self->alloced_cols) {
+        int alloced_cols = self->alloced_cols ? 2 * self->alloced_cols : 16;
+        so_Column **columns = realloc(self->columns, alloced_cols * sizeof(so_Column *));
+        if (!columns) {
+            self->failed = 1;
+            return NULL;
+        }
+        self->columns = columns;
+        self->alloced_cols = alloced_cols;
+    }
+
+    so_Column *column = so_Column_new();
+    if (!column) {
+        self->failed = 1;
+        return NULL;
+    }
+    so_Column_set_valueType(column, valueType);
+    int fail = so_Column_set_columnId(column, columnId);
+    for (int i = 0; i < num_columnTypes; i++) {
+        fail |= so_Column_add_columnType(column, columnTypes[i]);
+    }
+    column->column = malloc(((size_t) self->alloced_rows + 1) * pharmml_valueType_to_size(valueType));
+    if (fail || !column->column || so_Hash_put(self->index, columnId, self->numcols)) {
+        so_Column_free(column);
+        self->failed = 1;
+        return NULL;
+    }
+    so_aggregate_fill_missing(column, 0, self->numrows);
+    self->columns[self->numcols++] = column;
+    return column;
+}
+
+/* Set the value of a column for all rows added last. value points to a double, int, char * or bool
+ * depending on the valueType. Setting a value of a column already having another valueType is an error. */
+int so_AggregateSegment_set_value(so_AggregateSegment *self, char *columnId, pharmml_columnType *columnTypes, int num_columnTypes, pharmml_valueType valueType, void *value)
+{
+    valueType = so_aggregate_valueType(valueType);
+    so_Column *column = so_AggregateSegment_column(self, columnId, columnTypes, num_columnTypes, valueType);
+    if (!column) {
+        return self->failed;
+    }
+
+    for (int i = self->group_start; i < self->numrows; i++) {
+        if (valueType == PHARMML_VALUETYPE_STRING) {
+            char **cell = (char **) column->column + i;
+            free(*cell);
+            *cell = pharmml_strdup(*(char **) value ? *(char **) value : "");
+            if (!*cell) {
+                self->failed = 1;
+                return 1;
+            }
+        } else {
+            int size = pharmml_valueType_to_size(valueType);
+            memcpy((char *) column->column + (size_t) i * size, value, size);
+        }
+    }
+    return 0;
+}
+
+int so_AggregateSegment_set_real(so_AggregateSegment *self, char *columnId, double value)
+{
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    return so_AggregateSegment_set_value(self, columnId, &undefined, 1, PHARMML_VALUETYPE_REAL, &value);
+}
+
+int so_AggregateSegment_set_int(so_AggregateSegment *self, char *columnId, int value)
+{
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    return so_AggregateSegment_set_value(self, columnId, &undefined, 1, PHARMML_VALUETYPE_INT, &value);
+}
+
+int so_AggregateSegment_set_string(so_AggregateSegment *self, char *columnId, char *value)
+{
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    return so_AggregateSegment_set_value(self, columnId, &undefined, 1, PHARMML_VALUETYPE_STRING, &value);
+}
+
+/* Copy the first rows of a column into the rows added last. It is an error if the column has fewer rows.
+ * The source column is only read, also if it is encoded, so that columns shared between copies of tables
+ * can be used from many threads. */
+int so_AggregateSegment_set_column(so_AggregateSegment *self, so_Column *source)
+{
+    pharmml_valueType valueType = so_aggregate_valueType(source->valueType);
+    so_Column *column = so_AggregateSegment_column(self, source->columnId, source->columnType, source->num_columnType, valueType);
+    if (!column) {
+        return self->failed;
+    }
+
+    int numrows = self->numrows - self->group_start;
+    if (source->len < numrows) {
+        self->failed = 1;
+        return 1;
+    }
+    int size = pharmml_valueType_to_size(valueType);
+    char *dest = (char *) column->column + (size_t) self->group_start * size;
+    if (source->encoding == SO_COLUMN_PLAIN && valueType != PHARMML_VALUETYPE_STRING) {
+        memcpy(dest, source->column, (size_t) numrows * size);
+        return 0;
+    }
+
+    so_ColumnRun run = SO_COLUMN_RUN_INIT;
+    while (so_Column_next_run(source, &run) && run.start < numrows) {
+        for (int i = run.start; i < run.start + run.length && i < numrows; i++) {
+            if (valueType == PHARMML_VALUETYPE_STRING) {
+                char *str = *(char **) run.value;
+                free(((char **) dest)[i]);
+                ((char **) dest)[i] = pharmml_strdup(str ? str : "");
+                if (!((char **) dest)[i]) {
+                    self->failed = 1;
+                    return 1;
+                }
+            } else {
+                memcpy(dest + (size_t) i * size, run.value, size);
+            }
+        }
+    }
+    return 0;
+}
+
+/* Add all rows of a table to the segment */
+int so_AggregateSegment_append_table(so_AggregateSegment *self, so_Table *table)
+{
+    if (so_AggregateSegment_new_rows(self, table->numrows)) {
+        return 1;
+    }
+    for (int col = 0; col < table->numcols; col++) {
+        if (so_AggregateSegment_set_column(self, table->columns[col])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Move the rows of a segment into their place in the merged columns. Fails if a column has another
+// valueType than in the segments before.
+static int so_AggregateSegment_merge(so_AggregateSegment *self, so_Table *table, int offset)
+{
+    for (int col = 0; col < table->numcols; col++) {
+        so_Column *target = table->columns[col];
+        int size = pharmml_valueType_to_size(target->valueType);
+        char *dest = (char *) target->column + (size_t) offset * size;
+        int local = self->index ? so_Hash_get(self->index, target->columnId) : -1;
+        so_Column *source = local >= 0 ? self->columns[local] : NULL;
+        if (source && source->valueType != target->valueType) {
+            return 1;
+        }
+
+        if (target->valueType == PHARMML_VALUETYPE_STRING) {
+            char **strings = (char **) dest;
+            for (int i = 0; i < self->numrows; i++) {
+                char **cell = source ? (char **) source->column + i : NULL;
+                if (cell && *cell) {
+                    strings[i] = *cell;         // The string is moved
+                    *cell = NULL;
+                } else {
+                    strings[i] = pharmml_strdup("");
+                    if (!strings[i]) {
+                        return 1;
+                    }
+                }
+            }
+        } else if (source) {
+            memcpy(dest, source->column, (size_t) self->numrows * size);
+        } else {
+            so_aggregate_fill_missing(target, offset, offset + self->numrows);
+        }
+    }
+    return 0;
+}
+
+/* Map all items into segments in parallel and merge the segments into a new table
+ * with the rows of the items in order. Returns NULL if a map failed, if a column got values of different
+ * valueTypes or out of memory. */
+so_Table *so_aggregate(int num_items, so_AggregateMap map, void *context)
+{
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+    int num_segments = num_threads * SO_AGGREGATE_SEGMENTS_PER_THREAD;
+    if (num_segments > num_items) {
+        num_segments = num_items;
+    }
+
+    so_AggregateSegment *segments = calloc(num_segments + 1, sizeof(so_AggregateSegment));
+    int *offsets = malloc((num_segments + 1) * sizeof(int));
+    so_Table *table = so_Table_new();
+    so_Hash *index = so_Hash_new(16);
+    if (!segments || !offsets || !table || !index) {
+        goto fail;
+    }
+
+    // Map each range of items into its own segment
+    int failed = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) reduction(|:failed)
+#endif
+    for (int s = 0; s < num_segments; s++) {
+        int first = (int) ((long) num_items * s / num_segments);
+        int last = (int) ((long) num_items * (s + 1) / num_segments);
+        for (int item = first; item < last && !segments[s].failed; item++) {
+            segments[s].failed |= map(&segments[s], item, context);
+        }
+        failed |= segments[s].failed;
+    }
+    if (failed) {
+        goto fail;
+    }
+
+    // Union of the columns of the segments in order of first appearance
+    int numrows = 0;
+    for (int s = 0; s < num_segments; s++) {
+        offsets[s] = numrows;
+        numrows += segments[s].numrows;
+        for (int col = 0; col < segments[s].numcols; col++) {
+            so_Column *column = segments[s].columns[col];
+            if (so_Hash_get(index, column->columnId) == -1) {
+                if (so_Hash_put(index, column->columnId, table->numcols) ||
+                        so_Table_new_column_no_copy(table, column->columnId, column->columnType, column->num_columnType, column->valueType, NULL)) {
+                    goto fail;
+                }
+            }
+        }
+    }
+    so_Table_set_number_of_rows(table, numrows);
+    for (int col = 0; col < table->numcols; col++) {
+        so_Column *column = table->columns[col];
+        int size = pharmml_valueType_to_size(column->valueType);
+        column->column = calloc((size_t) numrows + 1, size);     // Zeroed so that strings can be freed if merging fails
+        if (!column->column) {
+            goto fail;
+        }
+        column->len = numrows;
+        column->used_memory = numrows * size;
+        column->alloced_memory = column->used_memory;
+    }
+
+    // The segments have disjoint rows so they can be merged independently
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) reduction(|:failed)
+#endif
+    for (int s = 0; s < num_segments; s++) {
+        failed |= so_AggregateSegment_merge(&segments[s], table, offsets[s]);
+    }
+    if (failed) {
+        goto fail;
+    }
+
+    for (int s = 0; s < num_segments; s++) {
+        so_AggregateSegment_clear(&segments[s]);
+    }
+    free(segments);
+    free(offsets);
+    so_Hash_free(index);
+    return table;
+
+fail:
+    if (segments) {
+        for (int s = 0; s < num_segments; s++) {
+            so_AggregateSegment_clear(&segments[s]);
+        }
+    }
+    free(segments);
+    free(offsets);
+    so_Hash_free(index);
+    so_Table_free(table);
+    return NULL;
+}
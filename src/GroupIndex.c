@@ -0,0 +1,221 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+
+#include <so/GroupIndex.h>
+#include <so/private/GroupIndex.h>
+#include <so/private/hash.h>
+#include <pharmml/string.h>
+
+/** \struct so_GroupIndex
+	 \brief An index of the rows of a table grouped by ID
+
+    Groups are numbered from 0 in order of first appearance of the ID in the table.
+    The rows of each group are kept in increasing order. Rows with a missing ID form
+    a group of their own.
+*/
+
+// Build an index from the ID of each row. The groups are found through a hash of
+// the IDs and the rows are then placed per group with a counting sort.
+so_GroupIndex *so_GroupIndex_new(int numrows, char **ids)
+{
+    so_GroupIndex *index = calloc(sizeof(so_GroupIndex), 1);
+    if (!index) {
+        return NULL;
+    }
+
+    index->numrows = numrows;
+    index->missing_group = -1;
+    index->hash = so_Hash_new(numrows);
+    index->group_of_row = malloc((numrows + 1) * sizeof(int));
+    index->rows = malloc((numrows + 1) * sizeof(int));
+    int *first_row = malloc((numrows + 1) * sizeof(int));
+    if (!index->hash || !index->group_of_row || !index->rows || !first_row) {
+        free(first_row);
+        so_GroupIndex_free(index);
+        return NULL;
+    }
+
+    for (int i = 0; i < numrows; i++) {
+        if (!ids[i]) {
+            if (index->missing_group == -1) {
+                index->missing_group = index->num_groups++;
+                first_row[index->missing_group] = i;
+            }
+            index->group_of_row[i] = index->missing_group;
+            continue;
+        }
+        int group = so_Hash_get(index->hash, ids[i]);
+        if (group == -1) {
+            group = index->num_groups++;
+            first_row[group] = i;
+            if (so_Hash_put(index->hash, ids[i], group)) {
+                free(first_row);
+                so_GroupIndex_free(index);
+                return NULL;
+            }
+        }
+        index->group_of_row[i] = group;
+    }
+
+    int num_groups = index->num_groups;
+    index->offsets = calloc(num_groups + 1, sizeof(int));
+    index->ids = calloc(num_groups + 1, sizeof(char *));
+    if (!index->offsets || !index->ids) {
+        free(first_row);
+        so_GroupIndex_free(index);
+        return NULL;
+    }
+
+    for (int g = 0; g < num_groups; g++) {
+        if (g == index->missing_group) {
+            continue;
+        }
+        index->ids[g] = pharmml_strdup(ids[first_row[g]]);
+        if (!index->ids[g]) {
+            free(first_row);
+            so_GroupIndex_free(index);
+            return NULL;
+        }
+    }
+    free(first_row);
+
+    for (int i = 0; i < numrows; i++) {
+        index->offsets[index->group_of_row[i] + 1]++;
+    }
+    for (int g = 0; g < num_groups; g++) {
+        index->offsets[g + 1] += index->offsets[g];
+    }
+    int *next = malloc((num_groups + 1) * sizeof(int));
+    if (!next) {
+        so_GroupIndex_free(index);
+        return NULL;
+    }
+    for (int g = 0; g < num_groups; g++) {
+        next[g] = index->offsets[g];
+    }
+    for (int i = 0; i < numrows; i++) {
+        index->rows[next[index->group_of_row[i]]++] = i;
+    }
+    free(next);
+
+    return index;
+}
+
+void so_GroupIndex_free(so_GroupIndex *self)
+{
+    if (self) {
+        so_Hash_free(self->hash);
+        if (self->ids) {
+            pharmml_free_string_array(self->ids, self->num_groups);
+        }
+        free(self->offsets);
+        free(self->rows);
+        free(self->group_of_row);
+        free(self);
+    }
+}
+
+/** \memberof so_GroupIndex
+ * Get the number of groups, i.e. the number of different IDs
+ * \param self - pointer to an so_GroupIndex
+ * \return The number of groups
+ */
+int so_GroupIndex_get_number_of_groups(so_GroupIndex *self)
+{
+    return self->num_groups;
+}
+
+/** \memberof so_GroupIndex
+ * Find the group of an ID
+ * \param self - pointer to an so_GroupIndex
+ * \param id - the ID to look for. Integer IDs are given in decimal notation. NULL to find the group of missing IDs.
+ * \return The group number or -1 if the ID is not in the table
+ */
+int so_GroupIndex_find(so_GroupIndex *self, char *id)
+{
+    if (!id) {
+        return self->missing_group;
+    }
+    return so_Hash_get(self->hash, id);
+}
+
+/** \memberof so_GroupIndex
+ * Get the ID of a group
+ * \param self - pointer to an so_GroupIndex
+ * \param group - the group number
+ * \return The ID as a string or NULL if the group does not exist or is the group of missing IDs
+ */
+char *so_GroupIndex_get_id(so_GroupIndex *self, int group)
+{
+    if (group < 0 || group >= self->num_groups) {
+        return NULL;
+    }
+    return self->ids[group];
+}
+
+/** \memberof so_GroupIndex
+ * Get the number of rows in a group
+ * \param self - pointer to an so_GroupIndex
+ * \param group - the group number
+ * \return The number of rows or 0 if the group does not exist
+ * \sa so_GroupIndex_get_rows
+ */
+int so_GroupIndex_get_number_of_rows(so_GroupIndex *self, int group)
+{
+    if (group < 0 || group >= self->num_groups) {
+        return 0;
+    }
+    return self->offsets[group + 1] - self->offsets[group];
+}
+
+/** \memberof so_GroupIndex
+ * Get the row numbers of a group. Iterate over the rows of a group with
+ * \code
+ * int *rows = so_GroupIndex_get_rows(index, group);
+ * for (int i = 0; i < so_GroupIndex_get_number_of_rows(index, group); i++) {
+ *     double value = data[rows[i]];
+ * }
+ * \endcode
+ * \param self - pointer to an so_GroupIndex
+ * \param group - the group number
+ * \return Pointer to an array of row numbers in increasing order or NULL if the group does not exist
+ * \sa so_GroupIndex_get_number_of_rows
+ */
+int *so_GroupIndex_get_rows(so_GroupIndex *self, int group)
+{
+    if (group < 0 || group >= self->num_groups) {
+        return NULL;
+    }
+    return self->rows + self->offsets[group];
+}
+
+/** \memberof so_GroupIndex
+ * Get the group of a row
+ * \param self - pointer to an so_GroupIndex
+ * \param row - the row number
+ * \return The group number or -1 if the row does not exist
+ */
+int so_GroupIndex_get_group_of_row(so_GroupIndex *self, int row)
+{
+    if (row < 0 || row >= self->numrows) {
+        return -1;
+    }
+    return self->group_of_row[row];
+}
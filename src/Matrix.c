@@ -21,6 +21,7 @@
 
 #include <so/Matrix.h>
 #include <so/private/Matrix.h>
+#include <so/private/stats.h>
 #include <pharmml/common_types.h>
 #include <pharmml/string.h>
 
@@ -28,6 +29,65 @@
 	 \brief A structure representing a matrix
 */
 
+// Check if a name is stored in the name arena
+static bool so_Matrix_in_arena(so_Matrix *self, char *name)
+{
+    return self->names && name >= self->names && name < self->names + self->names_size;
+}
+
+static void so_Matrix_free_name(so_Matrix *self, char *name)
+{
+    if (!so_Matrix_in_arena(self, name)) {
+        free(name);
+    }
+}
+
+// Copy a name of source into dest. Names in the arena of source point into the already copied arena of dest.
+static char *so_Matrix_copy_name(so_Matrix *source, so_Matrix *dest, char *name, bool *fail)
+{
+    if (!name) {
+        return NULL;
+    }
+    if (so_Matrix_in_arena(source, name)) {
+        return dest->names + (name - source->names);
+    }
+    char *copy = pharmml_strdup(name);
+    if (!copy) {
+        *fail = true;
+    }
+    return copy;
+}
+
+// Make room for at least needed elements in an array. The size is doubled to get linear time for reading.
+static int so_Matrix_grow(void **array, size_t *alloced, size_t needed, size_t element_size)
+{
+    if (needed <= *alloced) {
+        return 0;
+    }
+    size_t new_alloced = *alloced < SO_MATRIX_MIN_ALLOC ? SO_MATRIX_MIN_ALLOC : *alloced;
+    while (new_alloced < needed) {
+        new_alloced *= 2;
+    }
+    void *new_array = realloc(*array, new_alloced * element_size);
+    if (!new_array) {
+        return 1;
+    }
+    *array = new_array;
+    *alloced = new_alloced;
+    return 0;
+}
+
+// Append characters to a text buffer
+static int so_Matrix_append_text(char **text, size_t *size, size_t *alloced, const char *ch, int len)
+{
+    if (so_Matrix_grow((void **) text, alloced, *size + len, 1)) {
+        return 1;
+    }
+    memcpy(*text + *size, ch, len);
+    *size += len;
+    return 0;
+}
+
 /** \memberof so_Matrix
  * Create a new empty so_Matrix structure.
  * \return A pointer to the newly created struct or NULL if memory allocation failed
@@ -53,23 +113,30 @@ so_Matrix *so_Matrix_copy(so_Matrix *source)
     so_Matrix *dest = so_Matrix_new();
     if (dest) {
         bool fail = false;
-        if (so_Matrix_set_size(dest, source->numrows, source->numcols) != 0) {
-            memcpy(dest->data, source->data, source->numrows * source->numcols * sizeof(double));
-            for (int i = 0; i < source->numrows; i++) {
-                dest->rownames[i] = pharmml_strdup(source->rownames[i]); 
-                if (!dest->rownames[i]) {
+        int fail_size;
+        if (source->storage == SO_MATRIX_PACKED_SYMMETRIC) {
+            fail_size = so_Matrix_set_symmetric_size(dest, source->numrows);
+        } else {
+            fail_size = so_Matrix_set_size(dest, source->numrows, source->numcols);
+        }
+        if (fail_size == 0) {
+            memcpy(dest->data, source->data, so_Matrix_data_size(source) * sizeof(double));
+            // The names in the arena are copied in one go
+            if (source->names) {
+                dest->names = malloc(source->names_size);
+                if (dest->names) {
+                    memcpy(dest->names, source->names, source->names_size);
+                    dest->names_size = source->names_size;
+                    dest->names_alloced = source->names_size;
+                } else {
                     fail = true;
-                    break;
                 }
             }
-            if (!fail) {
-                for (int i = 0; i < source->numcols; i++) {
-                    dest->colnames[i] = pharmml_strdup(source->colnames[i]);
-                    if (!dest->colnames[i]) {
-                        fail = true;
-                        break;
-                    }
-                }
+            for (int i = 0; i < source->numrows && !fail; i++) {
+                dest->rownames[i] = so_Matrix_copy_name(source, dest, source->rownames[i], &fail);
+            }
+            for (int i = 0; i < source->numcols && !fail; i++) {
+                dest->colnames[i] = so_Matrix_copy_name(source, dest, source->colnames[i], &fail);
             }
         } else {
             fail = true;
@@ -95,16 +162,20 @@ void so_Matrix_free(so_Matrix *self)
         free(self->data);
         if (self->rownames) {
             for (int i = 0; i < self->numrows; i++) {
-                free(self->rownames[i]);
+                so_Matrix_free_name(self, self->rownames[i]);
             }
             free(self->rownames);
         }
         if (self->colnames) {
             for (int i = 0; i < self->numcols; i++) {
-                free(self->colnames[i]);
+                so_Matrix_free_name(self, self->colnames[i]);
             }
             free(self->colnames);
         }
+        free(self->names);
+        free(self->rowname_offsets);
+        free(self->colname_offsets);
+        free(self->row_text);
         free(self);
     }
 }
@@ -220,13 +291,11 @@ char *so_Matrix_get_ColumnNames(so_Matrix *self, int index)
  */
 int so_Matrix_set_RowNames(so_Matrix *self, int index, char *RowName)
 {
-    if (self->rownames[index]) {
-        free(self->rownames[index]);
-    }
     char *new_name = pharmml_strdup(RowName); 
     if (!new_name) {
         return 1;
     }
+    so_Matrix_free_name(self, self->rownames[index]);
     self->rownames[index] = new_name;
     return 0;
 }
@@ -241,24 +310,208 @@ int so_Matrix_set_RowNames(so_Matrix *self, int index, char *RowName)
  */
 int so_Matrix_set_ColumnNames(so_Matrix *self, int index, char *ColumnName)
 {
-    if (self->colnames[index]) {
-        free(self->colnames[index]);
-    }
     char *new_name = pharmml_strdup(ColumnName);
     if (!new_name) {
         return 1;
     }
+    so_Matrix_free_name(self, self->colnames[index]);
     self->colnames[index] = new_name;
     return 0;
 }
 
 /** \memberof so_Matrix
- * Get a pointer to the marix data
+ * Get a pointer to the marix data. A matrix with packed storage will be unpacked.
  * \param self - pointer to an so_Matrix
- * \result - a pointer to the matrix data in row major order
+ * \result - a pointer to the matrix data in row major order or NULL if unpacking failed
+ * \sa so_Matrix_get_element, so_Matrix_get_packed_data
  */
 double *so_Matrix_get_data(so_Matrix *self)
 {
+    if (self->storage != SO_MATRIX_DENSE && so_Matrix_set_storage(self, SO_MATRIX_DENSE)) {
+        return NULL;
+    }
+    return self->data;
+}
+
+// The number of doubles stored for the data
+size_t so_Matrix_data_size(so_Matrix *self)
+{
+    if (self->storage == SO_MATRIX_PACKED_SYMMETRIC) {
+        return SO_MATRIX_PACKED_INDEX(self->numrows, 0);
+    }
+    return (size_t) self->numrows * self->numcols;
+}
+
+/** \memberof so_Matrix
+ * Set the size of a newly created symmetric matrix. Only the lower triangle will be stored.
+ * \param self - pointer to an so_Matrix
+ * \param size - the number of rows and columns
+ * \return - 0 for success
+ * \sa so_Matrix_set_size, so_Matrix_set_element
+ */
+int so_Matrix_set_symmetric_size(so_Matrix *self, int size)
+{
+    self->data = calloc(SO_MATRIX_PACKED_INDEX(size, 0) + 1, sizeof(double));
+    self->colnames = calloc(size + 1, sizeof(char *));
+    self->rownames = calloc(size + 1, sizeof(char *));
+
+    if (self->data && self->colnames && self->rownames) {
+        self->numrows = size;
+        self->numcols = size;
+        self->storage = SO_MATRIX_PACKED_SYMMETRIC;
+        return 0;
+    } else {
+        free(self->data);
+        free(self->colnames);
+        free(self->rownames);
+        self->data = NULL;
+        self->colnames = NULL;
+        self->rownames = NULL;
+        return 1;
+    }
+}
+
+/** \memberof so_Matrix
+ * Get how the data of a matrix is stored
+ * \param self - pointer to an so_Matrix
+ * \return The storage
+ * \sa so_Matrix_set_storage
+ */
+so_MatrixStorage so_Matrix_get_storage(so_Matrix *self)
+{
+    return self->storage;
+}
+
+/** \memberof so_Matrix
+ * Check if a matrix is square and exactly symmetric
+ * \param self - pointer to an so_Matrix
+ * \return 1 if symmetric otherwise 0
+ */
+int so_Matrix_is_symmetric(so_Matrix *self)
+{
+    if (self->storage == SO_MATRIX_PACKED_SYMMETRIC) {
+        return 1;
+    }
+    if (self->numrows != self->numcols) {
+        return 0;
+    }
+    int n = self->numrows;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < i; j++) {
+            if (memcmp(&self->data[i * n + j], &self->data[j * n + i], sizeof(double)) != 0) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Pack the lower triangle in place. Each row moves towards the start of the data.
+static void so_Matrix_pack(so_Matrix *self)
+{
+    int n = self->numrows;
+    for (int i = 1; i < n; i++) {
+        memmove(self->data + SO_MATRIX_PACKED_INDEX(i, 0), self->data + (size_t) i * n, (i + 1) * sizeof(double));
+    }
+    double *new_data = realloc(self->data, (SO_MATRIX_PACKED_INDEX(n, 0) + 1) * sizeof(double));
+    if (new_data) {
+        self->data = new_data;
+    }
+    self->storage = SO_MATRIX_PACKED_SYMMETRIC;
+}
+
+// Unpack the lower triangle in place starting with the last row and then mirror it
+static int so_Matrix_unpack(so_Matrix *self)
+{
+    int n = self->numrows;
+    double *new_data = realloc(self->data, ((size_t) n * n + 1) * sizeof(double));
+    if (!new_data) {
+        return 1;
+    }
+    self->data = new_data;
+    for (int i = n - 1; i > 0; i--) {
+        memmove(self->data + (size_t) i * n, self->data + SO_MATRIX_PACKED_INDEX(i, 0), (i + 1) * sizeof(double));
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            self->data[(size_t) i * n + j] = self->data[(size_t) j * n + i];
+        }
+    }
+    self->storage = SO_MATRIX_DENSE;
+    return 0;
+}
+
+/** \memberof so_Matrix
+ * Change how the data of a matrix is stored. Only square matrices that are exactly symmetric can be packed.
+ * \param self - pointer to an so_Matrix
+ * \param storage - SO_MATRIX_PACKED_SYMMETRIC to store only the lower triangle or SO_MATRIX_DENSE to store all elements
+ * \return 0 for success and 1 if the matrix is not symmetric or memory allocation failed
+ * \sa so_Matrix_get_storage, so_Matrix_is_symmetric
+ */
+int so_Matrix_set_storage(so_Matrix *self, so_MatrixStorage storage)
+{
+    if (storage == self->storage) {
+        return 0;
+    }
+    if (storage == SO_MATRIX_DENSE) {
+        return so_Matrix_unpack(self);
+    }
+    if (!so_Matrix_is_symmetric(self)) {
+        return 1;
+    }
+    so_Matrix_pack(self);
+    return 0;
+}
+
+/** \memberof so_Matrix
+ * Get one element of a matrix. Packed matrices will not be unpacked.
+ * \param self - pointer to an so_Matrix
+ * \param row - the row index
+ * \param col - the column index
+ * \return The value of the element
+ * \sa so_Matrix_set_element, so_Matrix_get_data
+ */
+double so_Matrix_get_element(so_Matrix *self, int row, int col)
+{
+    if (self->storage == SO_MATRIX_PACKED_SYMMETRIC) {
+        return row >= col ? self->data[SO_MATRIX_PACKED_INDEX(row, col)] : self->data[SO_MATRIX_PACKED_INDEX(col, row)];
+    }
+    return self->data[(size_t) row * self->numcols + col];
+}
+
+/** \memberof so_Matrix
+ * Set one element of a matrix. For packed matrices this will also set the mirrored element.
+ * \param self - pointer to an so_Matrix
+ * \param row - the row index
+ * \param col - the column index
+ * \param value - the new value
+ * \sa so_Matrix_get_element
+ */
+void so_Matrix_set_element(so_Matrix *self, int row, int col, double value)
+{
+    if (self->storage == SO_MATRIX_PACKED_SYMMETRIC) {
+        if (row >= col) {
+            self->data[SO_MATRIX_PACKED_INDEX(row, col)] = value;
+        } else {
+            self->data[SO_MATRIX_PACKED_INDEX(col, row)] = value;
+        }
+    } else {
+        self->data[(size_t) row * self->numcols + col] = value;
+    }
+}
+
+/** \memberof so_Matrix
+ * Get a pointer to the packed lower triangle of a symmetric matrix. Element (row, col) with col <= row
+ * is found at index row * (row + 1) / 2 + col.
+ * \param self - pointer to an so_Matrix
+ * \result - a pointer to the packed data or NULL if the matrix is not packed
+ * \sa so_Matrix_set_storage
+ */
+double *so_Matrix_get_packed_data(so_Matrix *self)
+{
+    if (self->storage != SO_MATRIX_PACKED_SYMMETRIC) {
+        return NULL;
+    }
     return self->data;
 }
 
@@ -268,8 +521,10 @@ int so_Matrix_xml(so_Matrix *self, xmlTextWriterPtr writer, char *element_name)
 
     rc = xmlTextWriterStartElement(writer, BAD_CAST element_name);
     if (rc < 0) return 1;
+    so_stats_start_element(element_name);
     rc = xmlTextWriterStartElement(writer, BAD_CAST "ct:Matrix");
     if (rc < 0) return 1;
+    so_stats_count_element("ct:Matrix");
     rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "matrixType", BAD_CAST "Any");
     if (rc < 0) return 1;
 
@@ -292,12 +547,15 @@ int so_Matrix_xml(so_Matrix *self, xmlTextWriterPtr writer, char *element_name)
     for (int row = 0; row < self->numrows; row++) {
         rc = xmlTextWriterStartElement(writer, BAD_CAST "ct:MatrixRow");
         if (rc < 0) return 1;
+        so_stats_count_element("ct:MatrixRow");
         for (int col = 0; col < self->numcols; col++) {
-            char *value_string = pharmml_double_to_string(self->data[row * self->numcols + col]);
+            char *value_string = so_stats_double_to_string(so_Matrix_get_element(self, row, col));
             if (!value_string) return 1;
             rc = xmlTextWriterWriteElement(writer, BAD_CAST "ct:Real", BAD_CAST value_string);
             if (rc < 0) return 1;
             free(value_string);
+            so_stats_count_element("ct:Real");
+            so_stats_count_cell(PHARMML_VALUETYPE_REAL);
         }
         rc = xmlTextWriterEndElement(writer);
         if (rc < 0) return 1;
@@ -307,12 +565,17 @@ int so_Matrix_xml(so_Matrix *self, xmlTextWriterPtr writer, char *element_name)
     if (rc < 0) return 1;
     xmlTextWriterEndElement(writer);
     if (rc < 0) return 1;
+    so_stats_end_element();
     
     return 0;
 }
 
 int so_Matrix_start_element(so_Matrix *self, const char *localname, int nb_attributes, const char **attributes)
 {
+    if (self->error) {
+        return 1;
+    }
+
     if (strcmp("Matrix", localname) == 0) {
         self->in_matrix = 1;
     } else if (strcmp("RowNames", localname) == 0) {
@@ -321,76 +584,181 @@ int so_Matrix_start_element(so_Matrix *self, const char *localname, int nb_attri
         self->in_columnnames = 1;
     } else if (strcmp("MatrixRow", localname) == 0) {
         self->in_matrixrow = 1;
+        self->row_text_size = 0;
+        self->current_col = 0;
     } else if (strcmp("String", localname) == 0) {
+        // A name starts at the end of the arena
         self->in_string = 1;
+        if (self->in_rownames) {
+            if (so_Matrix_grow((void **) &self->rowname_offsets, &self->rowname_offsets_alloced, self->numrows + 1, sizeof(size_t))) {
+                return 1;
+            }
+            self->rowname_offsets[self->numrows++] = self->names_size;
+        } else if (self->in_columnnames) {
+            if (so_Matrix_grow((void **) &self->colname_offsets, &self->colname_offsets_alloced, self->numcols + 1, sizeof(size_t))) {
+                return 1;
+            }
+            self->colname_offsets[self->numcols++] = self->names_size;
+        }
     } else if (strcmp("Real", localname) == 0) {
         self->in_real = 1;
     }
     return 0;
 }
 
+// Convert the Reals of the MatrixRow that was just read and put them into the data
+static int so_Matrix_end_row(so_Matrix *self)
+{
+    // Without ColumnNames the first row gives the number of columns
+    if (self->numcols == 0 && self->current_row == 0) {
+        self->numcols = self->current_col;
+    }
+    if (self->current_col != self->numcols) {
+        return 1;
+    }
+    if (self->rownames_known && self->current_row >= self->numrows) {
+        return 1;
+    }
+    if (self->numcols == 0) {
+        self->current_row++;
+        return 0;
+    }
+    if (self->current_row >= self->rows_alloced) {
+        // With RowNames the number of rows is known. Otherwise grow as needed.
+        size_t old_alloced = self->rows_alloced;
+        size_t needed = self->rownames_known ? self->numrows : self->current_row + 1;
+        if (so_Matrix_grow((void **) &self->data, &self->rows_alloced, needed, self->numcols * sizeof(double))) {
+            return 1;
+        }
+        memset(self->data + old_alloced * self->numcols, 0, (self->rows_alloced - old_alloced) * self->numcols * sizeof(double));
+    }
+
+    so_stats_strings_to_doubles(self->row_text, self->data + self->current_row * self->numcols, self->numcols);
+    so_stats_count_cells(PHARMML_VALUETYPE_REAL, self->numcols);
+    self->current_row++;
+    return 0;
+}
+
+// Set the names and size of the data when the whole matrix has been read. A matrix that could not be
+// read is left empty so that its names and data can still be used.
+static int so_Matrix_end_matrix(so_Matrix *self)
+{
+    if (self->error) {
+        free(self->data);
+        self->data = NULL;
+        self->numrows = 0;
+        self->numcols = 0;
+    } else if (!self->rownames_known) {
+        self->numrows = self->current_row;
+    }
+
+    // The arena does not move anymore so the names can be pointed to
+    self->rownames = calloc(self->numrows ? self->numrows : 1, sizeof(char *));
+    self->colnames = calloc(self->numcols ? self->numcols : 1, sizeof(char *));
+    int fail = !self->rownames || !self->colnames;
+    if (fail) {
+        free(self->rownames);
+        free(self->colnames);
+        free(self->data);
+        self->rownames = NULL;
+        self->colnames = NULL;
+        self->data = NULL;
+        self->numrows = 0;
+        self->numcols = 0;
+    }
+    for (int i = 0; i < self->numrows && self->rowname_offsets; i++) {
+        self->rownames[i] = self->names + self->rowname_offsets[i];
+    }
+    for (int i = 0; i < self->numcols && self->colname_offsets; i++) {
+        self->colnames[i] = self->names + self->colname_offsets[i];
+    }
+    free(self->rowname_offsets);
+    free(self->colname_offsets);
+    free(self->row_text);
+    self->rowname_offsets = NULL;
+    self->colname_offsets = NULL;
+    self->row_text = NULL;
+    if (fail) {
+        return 1;
+    }
+
+    size_t size = self->numrows * self->numcols;
+    if (size && self->rows_alloced < self->numrows) {
+        // Rows that were named but not given
+        double *new_data = realloc(self->data, size * sizeof(double));
+        if (!new_data) {
+            self->numrows = (int) self->rows_alloced;     // Keep only the rows that were given
+            self->rows_alloced = 0;
+            return 1;
+        }
+        memset(new_data + self->rows_alloced * self->numcols, 0, (self->numrows - self->rows_alloced) * self->numcols * sizeof(double));
+        self->data = new_data;
+    } else if (size && self->rows_alloced > self->numrows) {
+        double *new_data = realloc(self->data, size * sizeof(double));
+        if (new_data) {
+            self->data = new_data;
+        }
+    }
+    self->rows_alloced = 0;
+
+    // Covariance, correlation and information matrices are symmetric and need only half the memory
+    if (size && so_Matrix_is_symmetric(self)) {
+        so_Matrix_pack(self);
+    }
+    return 0;
+}
+
 void so_Matrix_end_element(so_Matrix *self, const char *localname)
 {
     if (strcmp("Matrix", localname) == 0) {
         self->in_matrix = 0;
+        if (so_Matrix_end_matrix(self)) {
+            self->error = 1;
+        }
     } else if (strcmp("RowNames", localname) == 0) {
         self->in_rownames = 0;
+        self->rownames_known = 1;
     } else if (strcmp("ColumnNames", localname) == 0) {
         self->in_columnnames = 0;
     } else if (strcmp("MatrixRow", localname) == 0) {
         self->in_matrixrow = 0;
-        self->current_col = 0;
-        self->current_row++;
+        if (!self->error && so_Matrix_end_row(self)) {
+            self->error = 1;
+        }
     } else if (strcmp("String", localname) == 0) {
         self->in_string = 0;
+        if ((self->in_rownames || self->in_columnnames) && so_Matrix_append_text(&self->names, &self->names_size, &self->names_alloced, "", 1)) {
+            self->error = 1;
+        }
     } else if (strcmp("Real", localname) == 0) {
         self->in_real = 0;
-        self->current_col++;
+        if (self->in_matrixrow) {
+            // Each Real gives one NUL terminated string
+            if (so_Matrix_append_text(&self->row_text, &self->row_text_size, &self->row_text_alloced, "", 1)) {
+                self->error = 1;
+            }
+            self->current_col++;
+        }
     }
 }
 
+// Check if reading failed. Errors when ending elements are kept and can be checked here.
+int so_Matrix_has_error(so_Matrix *self)
+{
+    return self->error;
+}
+
 int so_Matrix_characters(so_Matrix *self, const char *ch, int len)
 {
-    if (self->in_rownames && self->in_string) {
-        char *row_name = pharmml_strndup(ch, len);
-        if (!row_name) {
-            return 1;
-        }
-        char **new_rownames = realloc(self->rownames, (self->numrows + 1) * sizeof(char *));
-        if (!new_rownames) {
-            free(row_name);
-            return 1;
-        }
-        self->rownames = new_rownames;
-        self->rownames[self->numrows] = row_name;
-        self->numrows++;
-    } else if (self->in_columnnames && self->in_string) {
-        char *col_name = pharmml_strndup(ch, len);
-        if (!col_name) {
-            return 1;
-        }
-        char **new_colnames = realloc(self->colnames, (self->numcols + 1) * sizeof(char *));
-        if (!new_colnames) {
-            free(col_name);
-            return 1;
-        }
-        self->colnames = new_colnames;
-        self->colnames[self->numcols] = col_name;
-        self->numcols++;
+    if (self->error) {
+        return 1;
+    }
+
+    // Texts can come in more than one chunk so they are gathered until the end of their elements
+    if ((self->in_rownames || self->in_columnnames) && self->in_string) {
+        return so_Matrix_append_text(&self->names, &self->names_size, &self->names_alloced, ch, len);
     } else if (self->in_matrixrow && self->in_real) {
-        if (self->data == NULL) {
-            void *new_data = malloc(self->numcols * self->numrows * sizeof(double));
-            if (!new_data) {
-               return 1;
-            }
-            self->data = new_data; 
-        }
-        char *str = (char *) ch;
-        char saved = str[len];
-        str[len] = '\0';
-        double num = pharmml_string_to_double(str);
-        self->data[self->current_row * self->numcols + self->current_col] = num; 
-        str[len] = saved;
+        return so_Matrix_append_text(&self->row_text, &self->row_text_size, &self->row_text_alloced, ch, len);
     }
 
     return 0;
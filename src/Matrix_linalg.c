@@ -0,0 +1,708 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <so/Matrix.h>
+#include <so/private/Matrix.h>
+
+#ifdef HAVE_LAPACK
+// Fortran LAPACK routines. A row major lower triangle is a column major upper triangle.
+void dpotrf_(const char *uplo, const int *n, double *a, const int *lda, int *info);
+void dpotri_(const char *uplo, const int *n, double *a, const int *lda, int *info);
+void dsyev_(const char *jobz, const char *uplo, const int *n, double *a, const int *lda, double *w, double *work, const int *lwork, int *info);
+#endif
+
+// Get a dense row major copy of a square matrix or NULL if not square or out of memory
+static double *so_Matrix_dense_copy(so_Matrix *self)
+{
+    if (self->numrows != self->numcols) {
+        return NULL;
+    }
+    int n = self->numrows;
+    double *a = malloc(((size_t) n * n + 1) * sizeof(double));
+    if (!a) {
+        return NULL;
+    }
+    if (self->storage == SO_MATRIX_PACKED_SYMMETRIC) {
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j <= i; j++) {
+                a[(size_t) i * n + j] = a[(size_t) j * n + i] = self->data[SO_MATRIX_PACKED_INDEX(i, j)];
+            }
+        }
+    } else {
+        memcpy(a, self->data, (size_t) n * n * sizeof(double));
+    }
+    return a;
+}
+
+// Copy the row and column names of source into a new matrix of the same size
+static int so_Matrix_copy_names_of(so_Matrix *dest, so_Matrix *source)
+{
+    for (int i = 0; i < source->numrows && i < dest->numrows; i++) {
+        if (source->rownames[i] && so_Matrix_set_RowNames(dest, i, source->rownames[i])) {
+            return 1;
+        }
+    }
+    for (int i = 0; i < source->numcols && i < dest->numcols; i++) {
+        if (source->colnames[i] && so_Matrix_set_ColumnNames(dest, i, source->colnames[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Create a packed symmetric matrix with the same names as source
+static so_Matrix *so_Matrix_new_symmetric_like(so_Matrix *source)
+{
+    so_Matrix *matrix = so_Matrix_new();
+    if (!matrix) {
+        return NULL;
+    }
+    if (so_Matrix_set_symmetric_size(matrix, source->numrows) || so_Matrix_copy_names_of(matrix, source)) {
+        so_Matrix_free(matrix);
+        return NULL;
+    }
+    return matrix;
+}
+
+static inline int so_min(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+// Cholesky factorization A = L L^T in place of the lower triangle of a dense row major matrix.
+// The upper triangle is set to zero. Returns 1 if the matrix is not positive definite.
+static int so_cholesky(double *a, int n)
+{
+#ifdef HAVE_LAPACK
+    int info;
+    dpotrf_("U", &n, a, &n, &info);
+    if (info != 0) {
+        return 1;
+    }
+#else
+    // Right looking blocked algorithm. The trailing matrix is updated tile by tile so that
+    // the rows being used stay in cache.
+    for (int k0 = 0; k0 < n; k0 += SO_MATRIX_BLOCK) {
+        int k1 = so_min(k0 + SO_MATRIX_BLOCK, n);
+
+        // Factor the diagonal block
+        for (int j = k0; j < k1; j++) {
+            double *row_j = a + (size_t) j * n;
+            double d = row_j[j];
+            for (int k = k0; k < j; k++) {
+                d -= row_j[k] * row_j[k];
+            }
+            if (!(d > 0)) {
+                return 1;
+            }
+            d = sqrt(d);
+            row_j[j] = d;
+            for (int i = j + 1; i < k1; i++) {
+                double *row_i = a + (size_t) i * n;
+                double s = row_i[j];
+                for (int k = k0; k < j; k++) {
+                    s -= row_i[k] * row_j[k];
+                }
+                row_i[j] = s / d;
+            }
+        }
+
+        // Solve for the panel below the diagonal block
+        for (int i = k1; i < n; i++) {
+            double *row_i = a + (size_t) i * n;
+            for (int j = k0; j < k1; j++) {
+                double *row_j = a + (size_t) j * n;
+                double s = row_i[j];
+                for (int k = k0; k < j; k++) {
+                    s -= row_i[k] * row_j[k];
+                }
+                row_i[j] = s / row_j[j];
+            }
+        }
+
+        // Update the lower triangle of the trailing matrix with the panel
+        for (int i0 = k1; i0 < n; i0 += SO_MATRIX_BLOCK) {
+            int i1 = so_min(i0 + SO_MATRIX_BLOCK, n);
+            for (int j0 = k1; j0 <= i0; j0 += SO_MATRIX_BLOCK) {
+                for (int i = i0; i < i1; i++) {
+                    double *row_i = a + (size_t) i * n;
+                    int j1 = so_min(j0 + SO_MATRIX_BLOCK, i + 1);
+                    for (int j = j0; j < j1; j++) {
+                        double *row_j = a + (size_t) j * n;
+                        double s = 0;
+                        for (int k = k0; k < k1; k++) {
+                            s += row_i[k] * row_j[k];
+                        }
+                        row_i[j] -= s;
+                    }
+                }
+            }
+        }
+    }
+#endif
+
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            a[(size_t) i * n + j] = 0;
+        }
+    }
+    return 0;
+}
+
+// Inverse of a symmetric positive definite matrix from its Cholesky factor L in the lower triangle
+// of a. The lower triangle of the inverse is put into packed. Returns 1 if out of memory.
+static int so_cholesky_inverse(double *a, int n, double *packed)
+{
+#ifdef HAVE_LAPACK
+    int info;
+    dpotri_("U", &n, a, &n, &info);
+    if (info != 0) {
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        memcpy(packed + SO_MATRIX_PACKED_INDEX(i, 0), a + (size_t) i * n, (i + 1) * sizeof(double));
+    }
+#else
+    // Invert L row by row. Row i of the inverse only needs the rows above it.
+    double *row = malloc((n + 1) * sizeof(double));
+    if (!row) {
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        double *l_i = a + (size_t) i * n;
+        for (int j = 0; j < i; j++) {
+            double s = 0;
+            for (int k = j; k < i; k++) {
+                s -= l_i[k] * a[(size_t) k * n + j];
+            }
+            row[j] = s / l_i[i];
+        }
+        row[i] = 1 / l_i[i];
+        memcpy(l_i, row, (i + 1) * sizeof(double));
+    }
+    free(row);
+
+    // A^-1 = L^-T L^-1 accumulated as one rank one update per row of L^-1
+    memset(packed, 0, SO_MATRIX_PACKED_INDEX(n, 0) * sizeof(double));
+    for (int k = 0; k < n; k++) {
+        double *r = a + (size_t) k * n;
+        for (int i = 0; i <= k; i++) {
+            double *out = packed + SO_MATRIX_PACKED_INDEX(i, 0);
+            double r_i = r[i];
+            for (int j = 0; j <= i; j++) {
+                out[j] += r_i * r[j];
+            }
+        }
+    }
+#endif
+    return 0;
+}
+
+/** \memberof so_Matrix
+ * Calculate the correlation matrix from a covariance matrix. Rows with a non-positive variance get NaN correlations.
+ * \param self - pointer to a square symmetric so_Matrix
+ * \return A new packed symmetric matrix with the same names or NULL if not square or out of memory
+ * \sa so_Matrix_covariance
+ */
+so_Matrix *so_Matrix_correlation(so_Matrix *self)
+{
+    if (self->numrows != self->numcols) {
+        return NULL;
+    }
+    int n = self->numrows;
+    double *sd = malloc((n + 1) * sizeof(double));
+    so_Matrix *cor = sd ? so_Matrix_new_symmetric_like(self) : NULL;
+    if (!cor) {
+        free(sd);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) {
+        double var = so_Matrix_get_element(self, i, i);
+        sd[i] = var > 0 ? sqrt(var) : NAN;
+    }
+    for (int i = 0; i < n; i++) {
+        double *out = cor->data + SO_MATRIX_PACKED_INDEX(i, 0);
+        for (int j = 0; j < i; j++) {
+            out[j] = so_Matrix_get_element(self, i, j) / (sd[i] * sd[j]);
+        }
+        out[i] = isnan(sd[i]) ? NAN : 1.0;
+    }
+    free(sd);
+    return cor;
+}
+
+/** \memberof so_Matrix
+ * Calculate the covariance matrix from a correlation matrix and standard deviations
+ * \param self - pointer to a square symmetric so_Matrix with correlations
+ * \param sd - array of the standard deviations of the rows
+ * \return A new packed symmetric matrix with the same names or NULL if not square or out of memory
+ * \sa so_Matrix_correlation
+ */
+so_Matrix *so_Matrix_covariance(so_Matrix *self, double *sd)
+{
+    if (self->numrows != self->numcols) {
+        return NULL;
+    }
+    so_Matrix *cov = so_Matrix_new_symmetric_like(self);
+    if (!cov) {
+        return NULL;
+    }
+    for (int i = 0; i < self->numrows; i++) {
+        double *out = cov->data + SO_MATRIX_PACKED_INDEX(i, 0);
+        for (int j = 0; j <= i; j++) {
+            out[j] = so_Matrix_get_element(self, i, j) * sd[i] * sd[j];
+        }
+    }
+    return cov;
+}
+
+/** \memberof so_Matrix
+ * Calculate the Cholesky factor L of a symmetric positive definite matrix A = L L^T.
+ * Only the lower triangle of the matrix is used.
+ * \param self - pointer to a square so_Matrix
+ * \return A new dense lower triangular matrix with the same names or NULL if the matrix is not positive definite, not square or out of memory
+ * \sa so_Matrix_is_positive_definite
+ */
+so_Matrix *so_Matrix_cholesky(so_Matrix *self)
+{
+    double *a = so_Matrix_dense_copy(self);
+    if (!a) {
+        return NULL;
+    }
+    if (so_cholesky(a, self->numrows)) {
+        free(a);
+        return NULL;
+    }
+
+    so_Matrix *chol = so_Matrix_new();
+    if (!chol || so_Matrix_set_size(chol, self->numrows, self->numcols) || so_Matrix_copy_names_of(chol, self)) {
+        so_Matrix_free(chol);
+        free(a);
+        return NULL;
+    }
+    free(chol->data);
+    chol->data = a;
+    return chol;
+}
+
+/** \memberof so_Matrix
+ * Check if a symmetric matrix is positive definite by attempting a Cholesky factorization
+ * \param self - pointer to a square so_Matrix
+ * \return 1 if positive definite, 0 if not and -1 if out of memory or not square
+ */
+int so_Matrix_is_positive_definite(so_Matrix *self)
+{
+    double *a = so_Matrix_dense_copy(self);
+    if (!a) {
+        return -1;
+    }
+    int fail = so_cholesky(a, self->numrows);
+    free(a);
+    return !fail;
+}
+
+/** \memberof so_Matrix
+ * Calculate the inverse of a symmetric positive definite matrix, for example the covariance matrix from the FIM
+ * \param self - pointer to a square so_Matrix
+ * \return A new packed symmetric matrix with the same names or NULL if the matrix is not positive definite, not square or out of memory
+ * \sa so_Matrix_cholesky
+ */
+so_Matrix *so_Matrix_inverse(so_Matrix *self)
+{
+    double *a = so_Matrix_dense_copy(self);
+    if (!a) {
+        return NULL;
+    }
+    so_Matrix *inverse = NULL;
+    if (!so_cholesky(a, self->numrows)) {
+        inverse = so_Matrix_new_symmetric_like(self);
+        if (inverse && so_cholesky_inverse(a, self->numrows, inverse->data)) {
+            so_Matrix_free(inverse);
+            inverse = NULL;
+        }
+    }
+    free(a);
+    return inverse;
+}
+
+/** \memberof so_Matrix
+ * Calculate the natural logarithm of the determinant of a symmetric positive definite matrix,
+ * for example of the FIM for the D-criterion
+ * \param self - pointer to a square so_Matrix
+ * \param logdet - pointer to where the log determinant will be stored
+ * \return 0 for success or 1 if the matrix is not positive definite, not square or out of memory
+ */
+int so_Matrix_log_determinant(so_Matrix *self, double *logdet)
+{
+    double *a = so_Matrix_dense_copy(self);
+    if (!a) {
+        return 1;
+    }
+    int n = self->numrows;
+    if (so_cholesky(a, n)) {
+        free(a);
+        return 1;
+    }
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += log(a[(size_t) i * n + i]);
+    }
+    free(a);
+    *logdet = 2 * sum;
+    return 0;
+}
+
+#ifndef HAVE_LAPACK
+// Reduce the symmetric matrix in v to tridiagonal form with Householder transformations (tred2 of EISPACK).
+// On return d has the diagonal, e the subdiagonal in e[1..n-1] and v the orthogonal transformation.
+static void so_tridiagonalize(double *v, int n, double *d, double *e)
+{
+#define V(i, j) v[(size_t) (i) * n + (j)]
+    for (int j = 0; j < n; j++) {
+        d[j] = V(n - 1, j);
+    }
+
+    for (int i = n - 1; i > 0; i--) {
+        double scale = 0.0;
+        double h = 0.0;
+        for (int k = 0; k < i; k++) {
+            scale += fabs(d[k]);
+        }
+        if (scale == 0.0) {
+            e[i] = d[i - 1];
+            for (int j = 0; j < i; j++) {
+                d[j] = V(i - 1, j);
+                V(i, j) = 0.0;
+                V(j, i) = 0.0;
+            }
+        } else {
+            for (int k = 0; k < i; k++) {
+                d[k] /= scale;
+                h += d[k] * d[k];
+            }
+            double f = d[i - 1];
+            double g = sqrt(h);
+            if (f > 0) {
+                g = -g;
+            }
+            e[i] = scale * g;
+            h = h - f * g;
+            d[i - 1] = f - g;
+            for (int j = 0; j < i; j++) {
+                e[j] = 0.0;
+            }
+
+            for (int j = 0; j < i; j++) {
+                f = d[j];
+                V(j, i) = f;
+                g = e[j] + V(j, j) * f;
+                for (int k = j + 1; k <= i - 1; k++) {
+                    g += V(k, j) * d[k];
+                    e[k] += V(k, j) * f;
+                }
+                e[j] = g;
+            }
+            f = 0.0;
+            for (int j = 0; j < i; j++) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+            double hh = f / (h + h);
+            for (int j = 0; j < i; j++) {
+                e[j] -= hh * d[j];
+            }
+            for (int j = 0; j < i; j++) {
+                f = d[j];
+                g = e[j];
+                for (int k = j; k <= i - 1; k++) {
+                    V(k, j) -= (f * e[k] + g * d[k]);
+                }
+                d[j] = V(i - 1, j);
+                V(i, j) = 0.0;
+            }
+        }
+        d[i] = h;
+    }
+
+    // Accumulate the transformations
+    for (int i = 0; i < n - 1; i++) {
+        V(n - 1, i) = V(i, i);
+        V(i, i) = 1.0;
+        double h = d[i + 1];
+        if (h != 0.0) {
+            for (int k = 0; k <= i; k++) {
+                d[k] = V(k, i + 1) / h;
+            }
+            for (int j = 0; j <= i; j++) {
+                double g = 0.0;
+                for (int k = 0; k <= i; k++) {
+                    g += V(k, i + 1) * V(k, j);
+                }
+                for (int k = 0; k <= i; k++) {
+                    V(k, j) -= g * d[k];
+                }
+            }
+        }
+        for (int k = 0; k <= i; k++) {
+            V(k, i + 1) = 0.0;
+        }
+    }
+    for (int j = 0; j < n; j++) {
+        d[j] = V(n - 1, j);
+        V(n - 1, j) = 0.0;
+    }
+    V(n - 1, n - 1) = 1.0;
+    e[0] = 0.0;
+}
+
+// Diagonalize a symmetric tridiagonal matrix with the implicit QL method (tql2 of EISPACK).
+// The eigenvalues end up sorted ascending in d and the eigenvectors in the columns of v.
+// Returns 1 if the iteration did not converge.
+static int so_tridiagonal_ql(double *v, int n, double *d, double *e)
+{
+    for (int i = 1; i < n; i++) {
+        e[i - 1] = e[i];
+    }
+    e[n - 1] = 0.0;
+
+    double f = 0.0;
+    double tst1 = 0.0;
+    double eps = pow(2.0, -52.0);
+    for (int l = 0; l < n; l++) {
+        // Find a small subdiagonal element
+        if (fabs(d[l]) + fabs(e[l]) > tst1) {
+            tst1 = fabs(d[l]) + fabs(e[l]);
+        }
+        int m = l;
+        while (m < n - 1) {
+            if (fabs(e[m]) <= eps * tst1) {
+                break;
+            }
+            m++;
+        }
+
+        if (m > l) {
+            int iter = 0;
+            do {
+                if (++iter > SO_MATRIX_MAX_QL_ITERATIONS) {
+                    return 1;
+                }
+                // Compute the implicit shift
+                double g = d[l];
+                double p = (d[l + 1] - g) / (2.0 * e[l]);
+                double r = hypot(p, 1.0);
+                if (p < 0) {
+                    r = -r;
+                }
+                d[l] = e[l] / (p + r);
+                d[l + 1] = e[l] * (p + r);
+                double dl1 = d[l + 1];
+                double h = g - d[l];
+                for (int i = l + 2; i < n; i++) {
+                    d[i] -= h;
+                }
+                f = f + h;
+
+                // Implicit QL transformation
+                p = d[m];
+                double c = 1.0;
+                double c2 = c;
+                double c3 = c;
+                double el1 = e[l + 1];
+                double s = 0.0;
+                double s2 = 0.0;
+                for (int i = m - 1; i >= l; i--) {
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    g = c * e[i];
+                    h = c * p;
+                    r = hypot(p, e[i]);
+                    e[i + 1] = s * r;
+                    s = e[i] / r;
+                    c = p / r;
+                    p = c * d[i] - s * g;
+                    d[i + 1] = h + s * (c * g + s * d[i]);
+                    for (int k = 0; k < n; k++) {
+                        h = V(k, i + 1);
+                        V(k, i + 1) = s * V(k, i) + c * h;
+                        V(k, i) = c * V(k, i) - s * h;
+                    }
+                }
+                p = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            } while (fabs(e[l]) > eps * tst1);
+        }
+        d[l] = d[l] + f;
+        e[l] = 0.0;
+    }
+
+    // Sort the eigenvalues and the eigenvectors
+    for (int i = 0; i < n - 1; i++) {
+        int k = i;
+        double p = d[i];
+        for (int j = i + 1; j < n; j++) {
+            if (d[j] < p) {
+                k = j;
+                p = d[j];
+            }
+        }
+        if (k != i) {
+            d[k] = d[i];
+            d[i] = p;
+            for (int j = 0; j < n; j++) {
+                p = V(j, i);
+                V(j, i) = V(j, k);
+                V(j, k) = p;
+            }
+        }
+    }
+    return 0;
+#undef V
+}
+#endif
+
+/** \memberof so_Matrix
+ * Calculate the eigenvalues and optionally the eigenvectors of a symmetric matrix
+ * \param self - pointer to a square symmetric so_Matrix
+ * \param values - array with room for one value per row. Will be filled with the eigenvalues in ascending order.
+ * \param vectors - pointer to where a new dense matrix having the eigenvectors as columns will be stored or NULL to not calculate eigenvectors
+ * \return 0 for success or 1 if not square, out of memory or the iteration did not converge
+ * \sa so_Matrix_condition_number
+ */
+int so_Matrix_eigen(so_Matrix *self, double *values, so_Matrix **vectors)
+{
+    double *v = so_Matrix_dense_copy(self);
+    if (!v) {
+        return 1;
+    }
+    int n = self->numrows;
+    if (n == 0) {
+        free(v);
+        v = NULL;
+    }
+
+#ifdef HAVE_LAPACK
+    int info = 0;
+    if (n > 0) {
+        int lwork = -1;
+        double optimal;
+        dsyev_(vectors ? "V" : "N", "U", &n, v, &n, values, &optimal, &lwork, &info);
+        lwork = (int) optimal;
+        double *work = malloc(lwork * sizeof(double));
+        if (!work) {
+            free(v);
+            return 1;
+        }
+        dsyev_(vectors ? "V" : "N", "U", &n, v, &n, values, work, &lwork, &info);
+        free(work);
+        // The column major eigenvectors are the rows of v
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < i; j++) {
+                double temp = v[(size_t) i * n + j];
+                v[(size_t) i * n + j] = v[(size_t) j * n + i];
+                v[(size_t) j * n + i] = temp;
+            }
+        }
+    }
+    if (info != 0) {
+        free(v);
+        return 1;
+    }
+#else
+    if (n > 0) {
+        double *e = malloc(n * sizeof(double));
+        if (!e) {
+            free(v);
+            return 1;
+        }
+        so_tridiagonalize(v, n, values, e);
+        int fail = so_tridiagonal_ql(v, n, values, e);
+        free(e);
+        if (fail) {
+            free(v);
+            return 1;
+        }
+    }
+#endif
+
+    if (vectors) {
+        so_Matrix *matrix = so_Matrix_new();
+        if (!matrix || so_Matrix_set_size(matrix, n, n)) {
+            so_Matrix_free(matrix);
+            free(v);
+            return 1;
+        }
+        for (int i = 0; i < n; i++) {
+            if (self->rownames[i] && so_Matrix_set_RowNames(matrix, i, self->rownames[i])) {
+                so_Matrix_free(matrix);
+                free(v);
+                return 1;
+            }
+        }
+        if (v) {
+            free(matrix->data);
+            matrix->data = v;
+            v = NULL;
+        }
+        *vectors = matrix;
+    }
+    free(v);
+    return 0;
+}
+
+/** \memberof so_Matrix
+ * Calculate the condition number of a symmetric matrix as the ratio of the largest to the smallest absolute eigenvalue
+ * \param self - pointer to a square symmetric so_Matrix
+ * \param condition - pointer to where the condition number will be stored. Infinity for singular matrices.
+ * \return 0 for success or 1 if not square, empty or out of memory
+ * \sa so_Matrix_eigen
+ */
+int so_Matrix_condition_number(so_Matrix *self, double *condition)
+{
+    int n = self->numrows;
+    if (n == 0) {
+        return 1;
+    }
+    double *values = malloc(n * sizeof(double));
+    if (!values) {
+        return 1;
+    }
+    if (so_Matrix_eigen(self, values, NULL)) {
+        free(values);
+        return 1;
+    }
+    double max = 0;
+    double min = INFINITY;
+    for (int i = 0; i < n; i++) {
+        double x = fabs(values[i]);
+        if (x > max) {
+            max = x;
+        }
+        if (x < min) {
+            min = x;
+        }
+    }
+    free(values);
+    *condition = min > 0 ? max / min : INFINITY;
+    return 0;
+}
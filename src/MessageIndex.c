@@ -0,0 +1,189 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <so/SOBlock.h>
+#include <so/TaskInformation.h>
+#include <so/Message.h>
+#include <so/private/SOBlock.h>
+#include <so/private/TaskInformation.h>
+#include <so/private/Message.h>
+#include <so/private/MessageIndex.h>
+#include <so/private/hash.h>
+#include <pharmml/string.h>
+
+// Separates the type from the toolname in the keys of the group hash
+#define SO_MESSAGE_KEY_SEPARATOR '\x1f'
+
+so_MessageIndex *so_MessageIndex_new(so_MessageIndex **owner)
+{
+    so_MessageIndex *index = calloc(sizeof(so_MessageIndex), 1);
+    if (!index) {
+        return NULL;
+    }
+    index->owner = owner;
+    index->group_hash = so_Hash_new(8);
+    if (!index->group_hash) {
+        free(index);
+        return NULL;
+    }
+    return index;
+}
+
+// Point an indexed SOBlock, its TaskInformation and its messages to the index of the SO or to NULL
+static void so_MessageIndex_attach(so_SOBlock *block, so_MessageIndex **owner)
+{
+    block->message_index = owner;
+    so_TaskInformation *ti = block->TaskInformation;
+    if (ti) {
+        ti->message_index = owner;
+        for (int i = 0; i < ti->num_Message; i++) {
+            ti->Message[i]->message_index = owner;
+        }
+    }
+}
+
+void so_MessageIndex_free(so_MessageIndex *self)
+{
+    if (self) {
+        for (int i = 0; i < self->num_blocks; i++) {
+            so_MessageIndex_attach(self->blocks[i], NULL);
+        }
+        for (int i = 0; i < self->num_groups; i++) {
+            free(self->groups[i].type);
+            free(self->groups[i].toolname);
+        }
+        free(self->groups);
+        so_Hash_free(self->group_hash);
+        free(self->entries);
+        free(self->blocks);
+        free(self);
+    }
+}
+
+// Free the index of an SO if it has one. Called before anything that is in the index is changed.
+void so_MessageIndex_invalidate(so_MessageIndex **index)
+{
+    if (index && *index) {
+        so_MessageIndex_free(*index);
+        *index = NULL;
+    }
+}
+
+static int so_MessageIndex_severity(so_Message *message)
+{
+    int *severity = so_Message_get_Severity(message);
+    if (!severity || *severity < 0) {
+        return 0;
+    }
+    return *severity > SO_MESSAGE_MAX_SEVERITY ? SO_MESSAGE_MAX_SEVERITY : *severity;
+}
+
+// Find the group of a type and toolname creating it if needed. Return -1 if out of memory.
+static int so_MessageIndex_group(so_MessageIndex *self, char *type, char *toolname)
+{
+    type = type ? type : "";
+    toolname = toolname ? toolname : "";
+    size_t type_len = strlen(type);
+    size_t toolname_len = strlen(toolname);
+    char *key = malloc(type_len + toolname_len + 2);
+    if (!key) {
+        return -1;
+    }
+    memcpy(key, type, type_len);
+    key[type_len] = SO_MESSAGE_KEY_SEPARATOR;
+    memcpy(key + type_len + 1, toolname, toolname_len + 1);
+
+    int group = so_Hash_get(self->group_hash, key);
+    if (group == -1) {
+        so_MessageGroup *new_groups = realloc(self->groups, (self->num_groups + 1) * sizeof(so_MessageGroup));
+        if (!new_groups) {
+            free(key);
+            return -1;
+        }
+        self->groups = new_groups;
+        so_MessageGroup *g = &self->groups[self->num_groups];
+        memset(g, 0, sizeof(so_MessageGroup));
+        g->type = pharmml_strdup(type);
+        g->toolname = pharmml_strdup(toolname);
+        if (!g->type || !g->toolname || so_Hash_put(self->group_hash, key, self->num_groups)) {
+            free(g->type);
+            free(g->toolname);
+            free(key);
+            return -1;
+        }
+        group = self->num_groups++;
+    }
+
+    free(key);
+    return group;
+}
+
+// Add the messages of the next SOBlock to the index. Return 0 for success.
+int so_MessageIndex_add_SOBlock(so_MessageIndex *self, so_SOBlock *block)
+{
+    if (self->num_blocks == self->alloced_blocks) {
+        int new_size = self->alloced_blocks ? 2 * self->alloced_blocks : 16;
+        so_SOBlock **new_blocks = realloc(self->blocks, new_size * sizeof(so_SOBlock *));
+        if (!new_blocks) {
+            return 1;
+        }
+        self->blocks = new_blocks;
+        self->alloced_blocks = new_size;
+    }
+
+    so_TaskInformation *ti = so_SOBlock_get_TaskInformation(block);
+    int num_messages = ti ? so_TaskInformation_get_number_of_Message(ti) : 0;
+
+    if (self->num_entries + num_messages > self->alloced_entries) {
+        int new_size = self->alloced_entries ? 2 * self->alloced_entries : 64;
+        while (new_size < self->num_entries + num_messages) {
+            new_size *= 2;
+        }
+        so_MessageEntry *new_entries = realloc(self->entries, new_size * sizeof(so_MessageEntry));
+        if (!new_entries) {
+            return 1;
+        }
+        self->entries = new_entries;
+        self->alloced_entries = new_size;
+    }
+
+    for (int i = 0; i < num_messages; i++) {
+        so_Message *message = so_TaskInformation_get_Message(ti, i);
+        int group = so_MessageIndex_group(self, so_Message_get_type(message), so_Message_get_Toolname(message));
+        if (group == -1) {
+            self->num_entries -= i;     // Leave the index as before the block was added
+            return 1;
+        }
+        so_MessageEntry *entry = &self->entries[self->num_entries++];
+        entry->message = message;
+        entry->block = self->num_blocks;
+        entry->severity = so_MessageIndex_severity(message);
+        entry->group = group;
+    }
+    for (int i = self->num_entries - num_messages; i < self->num_entries; i++) {
+        self->groups[self->entries[i].group].histogram[self->entries[i].severity]++;
+    }
+
+    self->blocks[self->num_blocks] = block;
+    self->num_blocks++;
+    so_MessageIndex_attach(block, self->owner);
+
+    return 0;
+}
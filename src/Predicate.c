@@ -0,0 +1,357 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <so/Predicate.h>
+#include <so/private/Predicate.h>
+#include <so/private/Table.h>
+#include <so/private/TableView.h>
+#include <pharmml/common_types.h>
+#include <pharmml/string.h>
+
+/** \struct so_Predicate
+	 \brief A condition on the rows of a table
+
+    Predicates are comparisons of a named real, int or boolean column with a value, ranges
+    and string equality that can be combined with AND and OR. NA and NaN never fulfill a
+    comparison or range, not even SO_PREDICATE_NE.
+*/
+
+static so_Predicate *so_Predicate_new_leaf(so_PredicateType type, char *column)
+{
+    so_Predicate *predicate = calloc(sizeof(so_Predicate), 1);
+    if (!predicate) {
+        return NULL;
+    }
+    predicate->type = type;
+    predicate->column = pharmml_strdup(column);
+    if (!predicate->column) {
+        free(predicate);
+        return NULL;
+    }
+    return predicate;
+}
+
+/** \memberof so_Predicate
+ * Create a predicate comparing a real, int or boolean column with a value
+ * \param column - columnId of the column
+ * \param op - the comparison operator
+ * \param value - the value to compare with. Booleans are 0 or 1.
+ * \return A pointer to the new predicate or NULL if memory allocation failed
+ * \sa so_Predicate_free
+ */
+so_Predicate *so_Predicate_new_compare(char *column, so_PredicateOp op, double value)
+{
+    so_Predicate *predicate = so_Predicate_new_leaf(SO_PREDICATE_COMPARE, column);
+    if (predicate) {
+        predicate->op = op;
+        predicate->value = value;
+    }
+    return predicate;
+}
+
+/** \memberof so_Predicate
+ * Create a predicate for values of a real or int column in an inclusive range
+ * \param column - columnId of the column
+ * \param low - smallest value in the range
+ * \param high - largest value in the range
+ * \return A pointer to the new predicate or NULL if memory allocation failed
+ * \sa so_Predicate_free
+ */
+so_Predicate *so_Predicate_new_range(char *column, double low, double high)
+{
+    so_Predicate *predicate = so_Predicate_new_leaf(SO_PREDICATE_RANGE, column);
+    if (predicate) {
+        predicate->value = low;
+        predicate->high = high;
+    }
+    return predicate;
+}
+
+/** \memberof so_Predicate
+ * Create a predicate for a string column being equal to a string
+ * \param column - columnId of the column
+ * \param value - the string to compare with
+ * \return A pointer to the new predicate or NULL if memory allocation failed
+ * \sa so_Predicate_free
+ */
+so_Predicate *so_Predicate_new_string_equal(char *column, char *value)
+{
+    so_Predicate *predicate = so_Predicate_new_leaf(SO_PREDICATE_STRING_EQUAL, column);
+    if (predicate) {
+        predicate->string = pharmml_strdup(value);
+        if (!predicate->string) {
+            so_Predicate_free(predicate);
+            return NULL;
+        }
+    }
+    return predicate;
+}
+
+static so_Predicate *so_Predicate_new_combination(so_PredicateType type, so_Predicate *left, so_Predicate *right)
+{
+    if (!left || !right) {
+        so_Predicate_free(left);
+        so_Predicate_free(right);
+        return NULL;
+    }
+    so_Predicate *predicate = calloc(sizeof(so_Predicate), 1);
+    if (!predicate) {
+        so_Predicate_free(left);
+        so_Predicate_free(right);
+        return NULL;
+    }
+    predicate->type = type;
+    predicate->left = left;
+    predicate->right = right;
+    return predicate;
+}
+
+/** \memberof so_Predicate
+ * Create a predicate that is fulfilled if both of two predicates are. The new predicate
+ * takes ownership of the two predicates. If any of them is NULL, e.g. from a failed
+ * allocation, the other will be freed and NULL returned.
+ * \param left - pointer to the first predicate
+ * \param right - pointer to the second predicate
+ * \return A pointer to the new predicate or NULL if memory allocation failed
+ * \sa so_Predicate_new_or
+ */
+so_Predicate *so_Predicate_new_and(so_Predicate *left, so_Predicate *right)
+{
+    return so_Predicate_new_combination(SO_PREDICATE_AND, left, right);
+}
+
+/** \memberof so_Predicate
+ * Create a predicate that is fulfilled if any of two predicates are. The new predicate
+ * takes ownership of the two predicates. If any of them is NULL, e.g. from a failed
+ * allocation, the other will be freed and NULL returned.
+ * \param left - pointer to the first predicate
+ * \param right - pointer to the second predicate
+ * \return A pointer to the new predicate or NULL if memory allocation failed
+ * \sa so_Predicate_new_and
+ */
+so_Predicate *so_Predicate_new_or(so_Predicate *left, so_Predicate *right)
+{
+    return so_Predicate_new_combination(SO_PREDICATE_OR, left, right);
+}
+
+/** \memberof so_Predicate
+ * Free a predicate and all predicates combined into it
+ * \param self - pointer to the predicate to free
+ */
+void so_Predicate_free(so_Predicate *self)
+{
+    if (self) {
+        free(self->column);
+        free(self->string);
+        so_Predicate_free(self->left);
+        so_Predicate_free(self->right);
+        free(self);
+    }
+}
+
+// The comparison loops are written without branches on the data so that they can be vectorized
+#define SO_PREDICATE_COMPARE_LOOP(TYPE, EXPR) \
+    { \
+        TYPE *x = (TYPE *) col->column; \
+        for (int i = 0; i < n; i++) { \
+            mask[i] = (EXPR); \
+        } \
+    }
+
+#define SO_PREDICATE_COMPARE_OPS(TYPE, CAST) \
+    switch (self->op) { \
+        case SO_PREDICATE_EQ: SO_PREDICATE_COMPARE_LOOP(TYPE, CAST x[i] == v) break; \
+        case SO_PREDICATE_NE: SO_PREDICATE_COMPARE_LOOP(TYPE, (CAST x[i] != v) & (CAST x[i] == CAST x[i])) break; \
+        case SO_PREDICATE_LT: SO_PREDICATE_COMPARE_LOOP(TYPE, CAST x[i] < v) break; \
+        case SO_PREDICATE_LE: SO_PREDICATE_COMPARE_LOOP(TYPE, CAST x[i] <= v) break; \
+        case SO_PREDICATE_GT: SO_PREDICATE_COMPARE_LOOP(TYPE, CAST x[i] > v) break; \
+        case SO_PREDICATE_GE: SO_PREDICATE_COMPARE_LOOP(TYPE, CAST x[i] >= v) break; \
+    }
+
+// Evaluate the predicate for all rows into a mask of 0 and 1
+static int so_Predicate_evaluate_mask(so_Predicate *self, so_Table *table, unsigned char *mask)
+{
+    int n = table->numrows;
+
+    if (self->type == SO_PREDICATE_AND || self->type == SO_PREDICATE_OR) {
+        unsigned char *right_mask = malloc(n + 1);
+        if (!right_mask) {
+            return 1;
+        }
+        if (so_Predicate_evaluate_mask(self->left, table, mask) || so_Predicate_evaluate_mask(self->right, table, right_mask)) {
+            free(right_mask);
+            return 1;
+        }
+        if (self->type == SO_PREDICATE_AND) {
+            for (int i = 0; i < n; i++) {
+                mask[i] &= right_mask[i];
+            }
+        } else {
+            for (int i = 0; i < n; i++) {
+                mask[i] |= right_mask[i];
+            }
+        }
+        free(right_mask);
+        return 0;
+    }
+
+    int index = so_Table_get_index_from_name(table, self->column);
+    if (index == -1) {
+        return 1;
+    }
+    so_Column *col = table->columns[index];
+    if (so_Column_decode(col)) {
+        return 1;
+    }
+
+    if (self->type == SO_PREDICATE_STRING_EQUAL) {
+        if (col->valueType != PHARMML_VALUETYPE_STRING) {
+            return 1;
+        }
+        char **x = (char **) col->column;
+        for (int i = 0; i < n; i++) {
+            mask[i] = (strcmp(x[i], self->string) == 0);
+        }
+    } else if (self->type == SO_PREDICATE_RANGE) {
+        double low = self->value;
+        double high = self->high;
+        if (col->valueType == PHARMML_VALUETYPE_REAL) {
+            SO_PREDICATE_COMPARE_LOOP(double, (x[i] >= low) & (x[i] <= high))
+        } else if (col->valueType == PHARMML_VALUETYPE_INT) {
+            SO_PREDICATE_COMPARE_LOOP(int, ((double) x[i] >= low) & ((double) x[i] <= high))
+        } else {
+            return 1;
+        }
+    } else {
+        double v = self->value;
+        if (col->valueType == PHARMML_VALUETYPE_REAL) {
+            SO_PREDICATE_COMPARE_OPS(double, )
+        } else if (col->valueType == PHARMML_VALUETYPE_INT) {
+            SO_PREDICATE_COMPARE_OPS(int, (double))
+        } else if (col->valueType == PHARMML_VALUETYPE_BOOLEAN) {
+            SO_PREDICATE_COMPARE_OPS(bool, (double))
+        } else {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/** \memberof so_Predicate
+ * Find the rows of a table that fulfill a predicate
+ * \param self - pointer to an so_Predicate
+ * \param table - pointer to the so_Table
+ * \param numrows - pointer to where the number of found rows will be stored
+ * \return A newly allocated array of the row numbers in increasing order to be freed by the
+ * caller or NULL if a column was not found, had the wrong valueType or memory allocation failed
+ * \sa so_Table_select
+ */
+int *so_Predicate_evaluate(so_Predicate *self, so_Table *table, int *numrows)
+{
+    int n = table->numrows;
+    unsigned char *mask = malloc(n + 1);
+    int *rows = malloc((n + 1) * sizeof(int));
+    if (!mask || !rows || so_Predicate_evaluate_mask(self, table, mask)) {
+        free(mask);
+        free(rows);
+        return NULL;
+    }
+
+    // Compact the mask into a selection vector
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        rows[count] = i;
+        count += mask[i];
+    }
+    free(mask);
+
+    *numrows = count;
+    return rows;
+}
+
+/** \memberof so_Table
+ * Create a view of the rows of a table that fulfill a predicate
+ * \param self - pointer to an so_Table
+ * \param predicate - pointer to an so_Predicate or NULL for all rows
+ * \return A new so_TableView or NULL if a column of the predicate was not found, had the wrong
+ * valueType or memory allocation failed
+ * \sa so_Table_select
+ */
+so_TableView *so_Table_select_view(so_Table *self, so_Predicate *predicate)
+{
+    int numrows;
+    int *rows;
+    if (predicate) {
+        rows = so_Predicate_evaluate(predicate, self, &numrows);
+    } else {
+        numrows = self->numrows;
+        rows = malloc((numrows + 1) * sizeof(int));
+        for (int i = 0; rows && i < numrows; i++) {
+            rows[i] = i;
+        }
+    }
+    if (!rows) {
+        return NULL;
+    }
+
+    so_TableView *view = so_TableView_new(self, rows, numrows);
+    free(rows);
+    return view;
+}
+
+/** \memberof so_Table
+ * Create a new table with the rows of a table that fulfill a predicate and a selection of the columns
+ * \param self - pointer to an so_Table
+ * \param predicate - pointer to an so_Predicate or NULL for all rows
+ * \param columns - array of columnIds of the columns to include or NULL for all columns
+ * \param num_columns - number of columnIds in the columns array
+ * \return A new so_Table or NULL if a column was not found, had the wrong valueType or
+ * memory allocation failed
+ * \sa so_Table_select_view
+ */
+so_Table *so_Table_select(so_Table *self, so_Predicate *predicate, char **columns, int num_columns)
+{
+    int *indices = NULL;
+    if (columns) {
+        indices = malloc((num_columns + 1) * sizeof(int));
+        if (!indices) {
+            return NULL;
+        }
+        for (int i = 0; i < num_columns; i++) {
+            indices[i] = so_Table_get_index_from_name(self, columns[i]);
+            if (indices[i] == -1) {
+                free(indices);
+                return NULL;
+            }
+        }
+    }
+
+    so_TableView *view = so_Table_select_view(self, predicate);
+    if (!view) {
+        free(indices);
+        return NULL;
+    }
+
+    so_Table *table = so_TableView_project(view, indices, columns ? num_columns : self->numcols);
+    so_TableView_free(view);
+    free(indices);
+    return table;
+}
@@ -0,0 +1,123 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+
+#include <so/ReadContext.h>
+#include <so/private/ReadContext.h>
+
+/** \struct so_ReadContext
+	 \brief Options for reading an SO
+*/
+
+so_ReadContext *so_ReadContext_current = NULL;
+
+/** \memberof so_ReadContext
+ * Create a new so_ReadContext with default options
+ * \return A pointer to the newly created struct or NULL if memory allocation failed
+ * \sa so_SO_read_with_context, so_ReadContext_free
+ */
+so_ReadContext *so_ReadContext_new(void)
+{
+    so_ReadContext *context = calloc(sizeof(so_ReadContext), 1);
+    if (context) {
+        context->real_decimals = 6;
+    }
+
+    return context;
+}
+
+/** \memberof so_ReadContext
+ * Free all memory associated with an so_ReadContext. Attached so_stats will not be freed.
+ * \param self - a pointer to the structure to free
+ */
+void so_ReadContext_free(so_ReadContext *self)
+{
+    free(self);
+}
+
+/** \memberof so_ReadContext
+ * Collect statistics while reading. The stats will also be attached to the read SO.
+ * \param self - pointer to an so_ReadContext
+ * \param stats - pointer to an so_stats or NULL to not collect statistics
+ * \sa so_ReadContext_get_stats, so_SO_set_stats
+ */
+void so_ReadContext_set_stats(so_ReadContext *self, so_stats *stats)
+{
+    self->stats = stats;
+}
+
+/** \memberof so_ReadContext
+ * Get the statistics structure attached to a read context
+ * \param self - pointer to an so_ReadContext
+ * \return A pointer to the so_stats or NULL if none was attached
+ * \sa so_ReadContext_set_stats
+ */
+so_stats *so_ReadContext_get_stats(so_ReadContext *self)
+{
+    return self->stats;
+}
+
+/** \memberof so_ReadContext
+ * Store the real columns of large tables with less precision to save memory. The columns
+ * are widened to double when their data is accessed with so_Table_get_column_from_number
+ * or so_Table_get_column_from_name. Columns that are run-length or constant encoded are not narrowed.
+ * \param self - pointer to an so_ReadContext
+ * \param storage - SO_REAL_FLOAT32, SO_REAL_SCALED_INT32 or SO_REAL_DOUBLE for full precision (the default)
+ * \param min_rows - only tables with at least this number of rows will have narrowed columns
+ * \sa so_ReadContext_set_real_decimals, so_Table_narrow_real_columns
+ */
+void so_ReadContext_set_real_storage(so_ReadContext *self, so_RealStorage storage, int min_rows)
+{
+    self->real_storage = storage;
+    self->real_min_rows = min_rows;
+}
+
+/** \memberof so_ReadContext
+ * Get how real columns of large tables will be stored
+ * \param self - pointer to an so_ReadContext
+ * \return The storage of real columns
+ * \sa so_ReadContext_set_real_storage
+ */
+so_RealStorage so_ReadContext_get_real_storage(so_ReadContext *self)
+{
+    return self->real_storage;
+}
+
+/** \memberof so_ReadContext
+ * Set the number of decimals to keep when storing real columns as scaled ints.
+ * Columns with values too large to be stored with this number of decimals keep fewer. The default is 6.
+ * \param self - pointer to an so_ReadContext
+ * \param decimals - number of decimals to keep
+ * \sa so_ReadContext_set_real_storage
+ */
+void so_ReadContext_set_real_decimals(so_ReadContext *self, int decimals)
+{
+    self->real_decimals = decimals;
+}
+
+/** \memberof so_ReadContext
+ * Get the number of decimals to keep when storing real columns as scaled ints
+ * \param self - pointer to an so_ReadContext
+ * \return The number of decimals
+ * \sa so_ReadContext_set_real_decimals
+ */
+int so_ReadContext_get_real_decimals(so_ReadContext *self)
+{
+    return self->real_decimals;
+}
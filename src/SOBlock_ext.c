@@ -17,12 +17,18 @@
 
 #include <stdlib.h>
 #include <memory.h>
+#include <math.h>
 #include <libxml/SAX.h>
 
 #include <so.h>
 #include <so/private/SO.h>
 #include <so/private/SOBlock.h>
 #include <so/Table.h>
+#include <so/private/Table.h>
+#include <so/private/hash.h>
+#include <so/private/Aggregate.h>
+#include <pharmml/string.h>
+#include <pharmml/common_types.h>
 
 void so_SOBlock_add_rawresults_datafile(so_SOBlock *self, char *description, char *path, char *oid)
 {
@@ -81,6 +87,53 @@ void so_SOBlock_add_message(so_SOBlock *self, char *type, char *toolname, char *
     so_Message_set_Severity(m, &severity);
 }
 
+// A profile table of a simulation with its name and replicate
+typedef struct {
+    so_Table *table;
+    char *name;
+    int replicate;
+} so_ProfileSlice;
+
+typedef struct {
+    so_ProfileSlice *slices;
+    int have_name;
+} so_ProfileSlices;
+
+static int so_SOBlock_map_profile(so_AggregateSegment *segment, int item, void *context)
+{
+    so_ProfileSlices *profiles = (so_ProfileSlices *) context;
+    so_ProfileSlice *slice = &profiles->slices[item];
+    if (so_AggregateSegment_append_table(segment, slice->table)) {
+        return 1;
+    }
+    if (profiles->have_name && so_AggregateSegment_set_string(segment, "name", slice->name)) {
+        return 1;
+    }
+    return so_AggregateSegment_set_int(segment, "replicate", slice->replicate);
+}
+
+// Move a column to the end of a table
+static void so_Table_move_column_last(so_Table *table, char *columnId)
+{
+    int index = so_Table_get_index_from_name(table, columnId);
+    if (index >= 0) {
+        so_Column *column = table->columns[index];
+        memmove(table->columns + index, table->columns + index + 1, (table->numcols - index - 1) * sizeof(so_Column *));
+        table->columns[table->numcols - 1] = column;
+    }
+}
+
+/** \memberof so_SOBlock
+ * Merge all SimulatedProfiles tables of all SimulationBlocks into one table. The table will have
+ * one column for each unique columnId followed by a name column if any profile has a name and a replicate column.
+ * Rows of columns that are missing from a profile get NA, 0, "" or false depending on the valueType.
+ * A column must have the same valueType in all profiles. This includes columns of the profiles named name or
+ * replicate, which must then be strings and integers.
+ * Columns are stored run-length or constant encoded when this saves memory. If libsoc was built with OpenMP
+ * the profiles are copied in parallel.
+ * \param self - pointer to an so_SOBlock
+ * \return A new so_Table or NULL if no simulated profiles were available, valueTypes of columns differed or memory allocation failed
+ */
 so_Table *so_SOBlock_all_simulated_profiles(so_SOBlock *self)
 {
     so_Simulation *simulation = so_SOBlock_get_Simulation(self);
@@ -88,95 +141,176 @@ so_Table *so_SOBlock_all_simulated_profiles(so_SOBlock *self)
     int num_simulation_blocks = so_Simulation_get_number_of_SimulationBlock(simulation);
     if (!num_simulation_blocks) return NULL;
 
-    so_Table *table = so_Table_new();
-
-    if (!table) {
-        return table;
+    int num_slices = 0;
+    for (int i = 0; i < num_simulation_blocks; i++) {
+        so_SimulationBlock *block = so_Simulation_get_SimulationBlock(simulation, i);
+        num_slices += so_SimulationBlock_get_number_of_SimulatedProfiles(block);
+    }
+    so_ProfileSlices profiles = { malloc((num_slices + 1) * sizeof(so_ProfileSlice)), 0 };
+    if (!profiles.slices) {
+        return NULL;
     }
 
-    int numcols = 0;
-    int have_name = 0;
-
-    // Find all blocks and profiles and create one column for each unique column
+    int slice = 0;
     for (int i = 0; i < num_simulation_blocks; i++) {
         so_SimulationBlock *block = so_Simulation_get_SimulationBlock(simulation, i);
+        int *replicate = so_SimulationBlock_get_replicate(block);
         int num_simulation_profiles = so_SimulationBlock_get_number_of_SimulatedProfiles(block);
         for (int j = 0; j < num_simulation_profiles; j++) {
             so_SimulationSubType *subtype = so_SimulationBlock_get_SimulatedProfiles(block, j);
-            if (so_SimulationSubType_get_name(subtype)) {  // Have a name?
-                have_name = 1;
-            }
-            so_Table *current_table = so_SimulationSubType_get_base(subtype);
-            int current_numcols = so_Table_get_number_of_columns(current_table);
-            for (int col = 0; col < current_numcols; col++) {
-                pharmml_valueType value_type = so_Table_get_valueType(current_table, col);
-                pharmml_columnType *column_type = so_Table_get_columnType(current_table, col);
-                int num_column_types = so_Table_get_num_columnTypes(current_table, col);
-                char *columnId = so_Table_get_columnId(current_table, col);
-                if (so_Table_get_index_from_name(table, columnId) == -1) {    // Do we not yet have this column?
-                    so_Table_new_column_no_copy(table, columnId, column_type, num_column_types, value_type, NULL);
-                    numcols++;
-                }
+            profiles.slices[slice].table = so_SimulationSubType_get_base(subtype);
+            profiles.slices[slice].name = so_SimulationSubType_get_name(subtype);
+            profiles.slices[slice].replicate = replicate ? *replicate : 0;
+            if (profiles.slices[slice].name) {
+                profiles.have_name = 1;
             }
+            slice++;
         }
     }
-    pharmml_columnType undefined[] = { PHARMML_COLTYPE_UNDEFINED };
-    if (have_name) {
-        so_Table_new_column_no_copy(table, "name", undefined, 1, PHARMML_VALUETYPE_STRING, NULL);
+
+    so_Table *table = so_aggregate(num_slices, so_SOBlock_map_profile, &profiles);
+    free(profiles.slices);
+    if (!table) {
+        return NULL;
     }
-    so_Table_new_column_no_copy(table, "replicate", undefined, 1, PHARMML_VALUETYPE_INT, NULL);
 
-    // Add data
-    for (int i = 0; i < num_simulation_blocks; i++) {
-        so_SimulationBlock *block = so_Simulation_get_SimulationBlock(simulation, i);
-        int num_simulation_profiles = so_SimulationBlock_get_number_of_SimulatedProfiles(block);
-        for (int j = 0; j < num_simulation_profiles; j++) {
-            so_SimulationSubType *subtype = so_SimulationBlock_get_SimulatedProfiles(block, j);
-            so_Table *current_table = so_SimulationSubType_get_base(subtype);
-            int current_numrows = so_Table_get_number_of_rows(current_table); 
-
-            // Loop through all cols except name and replicate
-            for (int col = 0; col < numcols; col++) {
-                so_Column *target_column = table->columns[col];
-                char *columnId = so_Table_get_columnId(table, col);
-                void *data = so_Table_get_column_from_name(current_table, columnId);
-                pharmml_valueType value_type = so_Table_get_valueType(current_table, col);
-                if (data) {      // Is this column available?
-                    for (int row = 0; row < current_numrows; row++) {
-                        if (value_type == PHARMML_VALUETYPE_REAL) {
-                            double *real = (double *) data;     // FIXME: Need special merge function
-                            so_Column_add_real(target_column, real[row]);
-                        } else {    // FIXME: Assume string
-                            char **string = (char **) data;
-                            so_Column_add_string(target_column, string[row]);
-                        }
-                    }
-                } else {
-                    for (int row = 0; row < current_numrows; row++) {
-                        so_Column_add_real(target_column, pharmml_na());
-                    }
-                } 
-            }
+    if (profiles.have_name) {
+        so_Table_move_column_last(table, "name");
+    }
+    if (num_slices == 0) {
+        pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+        if (so_Table_new_column_no_copy(table, "replicate", &undefined, 1, PHARMML_VALUETYPE_INT, NULL)) {
+            so_Table_free(table);
+            return NULL;
+        }
+    }
+    so_Table_move_column_last(table, "replicate");
 
-            // Handle name column
-            if (have_name) {
-                so_Column *name_column = table->columns[numcols];
-                char *name = so_SimulationSubType_get_name(subtype);
-                for (int row = 0; row < current_numrows; row++) {
-                    so_Column_add_string(name_column, name);
-                } 
-            }
+    // Covariates, names, replicates and other columns that are constant per profile are stored encoded
+    if (so_Table_encode_columns(table)) {
+        so_Table_free(table);
+        return NULL;
+    }
 
-            // Handle replicate column
-            so_Column *replicate_column = table->columns[numcols + have_name];
-            int *replicate = so_SimulationBlock_get_replicate(block);
-            for (int row = 0; row < current_numrows; row++) {
-                so_Column_add_int(replicate_column, *replicate);
+    return table;
+}
+
+// Create a table with one row per parameter having the names in the first column and the values in the second
+static so_Table *so_SOBlock_new_parameter_table(char **names, char *value_name, double *values, int numrows)
+{
+    so_Table *table = so_Table_new();
+    if (!table) {
+        return NULL;
+    }
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    so_Table_set_number_of_rows(table, numrows);
+    if (so_Table_new_column(table, "parameter", &undefined, 1, PHARMML_VALUETYPE_STRING, names) ||
+            so_Table_new_column(table, value_name, &undefined, 1, PHARMML_VALUETYPE_REAL, values)) {
+        so_Table_free(table);
+        return NULL;
+    }
+    return table;
+}
+
+// Calculate the relative standard errors in percent of the estimates in the one row table of population estimates
+static int so_SOBlock_relative_standard_errors(so_Table *estimates, char **names, double *se, double *rse, int numrows)
+{
+    int numcols = so_Table_get_number_of_columns(estimates);
+    so_Hash *index = so_Hash_new(numcols);
+    if (!index) {
+        return 1;
+    }
+    for (int col = 0; col < numcols; col++) {
+        if (so_Hash_put(index, so_Table_get_columnId(estimates, col), col)) {
+            so_Hash_free(index);
+            return 1;
+        }
+    }
+
+    for (int row = 0; row < numrows; row++) {
+        int col = so_Hash_get(index, names[row]);
+        rse[row] = pharmml_na();
+        if (col >= 0 && so_Table_get_number_of_rows(estimates) > 0 && so_Table_get_valueType(estimates, col) == PHARMML_VALUETYPE_REAL) {
+            so_ColumnRun run = SO_COLUMN_RUN_INIT;      // Read without decoding as SOBlocks can be handled in parallel
+            double estimate = *(double *) so_Column_run_cell(estimates->columns[col], &run, 0);
+            if (estimate != 0 && !isnan(se[row])) {
+                rse[row] = 100 * se[row] / fabs(estimate);
             }
+        }
+    }
 
-            table->numrows += current_numrows;
+    so_Hash_free(index);
+    return 0;
+}
+
+/** \memberof so_SOBlock
+ * Derive the StandardError and RelativeStandardError tables of the MLE precision estimates from the CovarianceMatrix
+ * if the tables are missing. The standard errors are the square roots of the diagonal and the relative standard errors
+ * are given in percent of the estimates in PopulationEstimates/MLE. Tables that are already available are kept.
+ * \param self - pointer to an so_SOBlock
+ * \return 0 for success or if there was nothing to derive, 1 if out of memory
+ * \sa so_SO_all_standard_errors, so_SO_all_relative_standard_errors
+ */
+int so_SOBlock_derive_standard_errors(so_SOBlock *self)
+{
+    so_Estimation *est = so_SOBlock_get_Estimation(self);
+    so_PrecisionPopulationEstimates *ppe = est ? so_Estimation_get_PrecisionPopulationEstimates(est) : NULL;
+    so_MLE *mle = ppe ? so_PrecisionPopulationEstimates_get_MLE(ppe) : NULL;
+    so_Matrix *cov = mle ? so_MLE_get_CovarianceMatrix(mle) : NULL;
+    if (!cov) {
+        return 0;
+    }
+
+    so_PopulationEstimates *pe = so_Estimation_get_PopulationEstimates(est);
+    so_Table *estimates = pe ? so_PopulationEstimates_get_MLE(pe) : NULL;
+    int need_se = !so_MLE_get_StandardError(mle);
+    int need_rse = !so_MLE_get_RelativeStandardError(mle) && estimates;
+
+    int numrows = so_Matrix_get_number_of_rows(cov);
+    if (!(need_se || need_rse) || numrows == 0 || numrows != so_Matrix_get_number_of_columns(cov)) {
+        return 0;
+    }
+    char **names = malloc(numrows * sizeof(char *));
+    double *se = malloc(2 * numrows * sizeof(double));
+    if (!names || !se) {
+        free(names);
+        free(se);
+        return 1;
+    }
+    double *rse = se + numrows;
+    for (int i = 0; i < numrows; i++) {
+        names[i] = so_Matrix_get_RowNames(cov, i);
+        if (!names[i]) {        // Parameters cannot be identified
+            free(names);
+            free(se);
+            return 0;
         }
+        double variance = so_Matrix_get_element(cov, i, i);
+        se[i] = variance >= 0 ? sqrt(variance) : pharmml_na();
     }
 
-    return table;
+    int fail = 0;
+    if (need_se) {
+        so_Table *table = so_SOBlock_new_parameter_table(names, "SE", se, numrows);
+        if (table) {
+            so_MLE_set_StandardError(mle, table);
+        } else {
+            fail = 1;
+        }
+    }
+    if (need_rse && !fail) {
+        fail = so_SOBlock_relative_standard_errors(estimates, names, se, rse, numrows);
+        if (!fail) {
+            so_Table *table = so_SOBlock_new_parameter_table(names, "RSE", rse, numrows);
+            if (table) {
+                so_MLE_set_RelativeStandardError(mle, table);
+            } else {
+                fail = 1;
+            }
+        }
+    }
+
+    free(names);
+    free(se);
+    return fail;
 }
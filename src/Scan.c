@@ -0,0 +1,824 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <libxml/parser.h>
+#include <libxml/parserInternals.h>
+
+#include <so/Scan.h>
+#include <so/private/Scan.h>
+#include <pharmml/common_types.h>
+#include <pharmml/string.h>
+
+/** \struct so_Scan
+	 \brief Metadata of an SO collected by so_SO_scan without loading the tables
+
+    The SOBlocks and tables are numbered from 0 in document order. Byte offsets are
+    counted in the uncompressed document.
+*/
+
+// Elements with text content that is kept
+typedef enum { SO_SCAN_TEXT_NONE, SO_SCAN_TEXT_TOOL_FILE, SO_SCAN_TEXT_SEVERITY, SO_SCAN_TEXT_RUNTIME } so_ScanText;
+
+typedef struct {
+    so_Scan *scan;
+    xmlParserCtxtPtr ctxt;
+    int depth;                  // Number of open elements
+    const char *names[SO_SCAN_MAX_DEPTH];   // Open elements. The names are owned by the dictionary of the parser.
+    int in_block;
+    int in_tool_settings;
+    int in_task_information;
+    int table;                  // Table of the element being read or -1
+    int table_depth;            // Depth of the element of the table
+    so_ScanText capture;
+    char *text;
+    size_t offset;              // Offset after the data last given to the parser
+    size_t tag_start;           // Offset of the last '<' given to the parser
+    int skip;                   // Set when the parser is positioned after a ds:Table start tag
+    char *close_tag;            // "</prefix:Table" and "<prefix:Row" of the table being skipped
+    char *row_tag;
+    int num_namespaces;         // Namespaces declared on the open elements below the SO element
+    char **namespace_prefixes;
+    char **namespace_uris;
+    int *namespace_depths;      // Depth of the element declaring each namespace
+    int failed;
+} so_ScanState;
+
+// Make room for one more element in an array holding count elements. The capacity is doubled
+// at the powers of two so that it does not need to be stored.
+static int so_scan_grow(void **array, int count, size_t size)
+{
+    if (count == 0 || (count & (count - 1)) == 0) {
+        void *new_array = realloc(*array, (count ? 2 * count : 1) * size);
+        if (!new_array) {
+            return 1;
+        }
+        *array = new_array;
+    }
+    return 0;
+}
+
+static char *so_scan_attribute(int nb_attributes, const char **attributes, const char *name)
+{
+    for (int i = 0; i < nb_attributes; i++) {
+        if (strcmp(attributes[5 * i], name) == 0) {
+            return pharmml_strndup(attributes[5 * i + 3], attributes[5 * i + 4] - attributes[5 * i + 3]);
+        }
+    }
+    return NULL;
+}
+
+static int so_scan_is_dataset(const char *URI)
+{
+    if (!URI) {
+        return 0;
+    }
+    size_t len = strlen(URI);
+    return len >= 8 && strcmp(URI + len - 8, "/Dataset") == 0;
+}
+
+static char *so_scan_qname(const char *start, const char *prefix, const char *localname)
+{
+    size_t len = strlen(start) + (prefix ? strlen(prefix) + 1 : 0) + strlen(localname) + 1;
+    char *qname = malloc(len);
+    if (qname) {
+        sprintf(qname, "%s%s%s%s", start, prefix ? prefix : "", prefix ? ":" : "", localname);
+    }
+    return qname;
+}
+
+// The element names from the SOBlock down to the parent of the current element
+static char *so_scan_table_path(so_ScanState *state)
+{
+    int first = state->in_block ? 2 : 1;
+    int last = state->depth - 1 < SO_SCAN_MAX_DEPTH ? state->depth - 1 : SO_SCAN_MAX_DEPTH;
+    size_t len = 1;
+    for (int i = first; i < last; i++) {
+        len += strlen(state->names[i]) + 1;
+    }
+    char *path = malloc(len);
+    if (path) {
+        path[0] = '\0';
+        for (int i = first; i < last; i++) {
+            if (i > first) {
+                strcat(path, "/");
+            }
+            strcat(path, state->names[i]);
+        }
+    }
+    return path;
+}
+
+so_Scan *so_Scan_new(void)
+{
+    return calloc(sizeof(so_Scan), 1);
+}
+
+// Add an SOBlock without any information
+int so_Scan_new_block(so_Scan *self)
+{
+    if (so_scan_grow((void **) &self->blocks, self->num_blocks, sizeof(so_ScanBlock))) {
+        return 1;
+    }
+    so_ScanBlock *block = &self->blocks[self->num_blocks++];
+    memset(block, 0, sizeof(so_ScanBlock));
+    block->max_severity = -1;
+    block->run_time = pharmml_na();
+    return 0;
+}
+
+// Add a table without columns
+int so_Scan_new_table(so_Scan *self)
+{
+    if (so_scan_grow((void **) &self->tables, self->num_tables, sizeof(so_ScanTable))) {
+        return 1;
+    }
+    so_ScanTable *table = &self->tables[self->num_tables++];
+    memset(table, 0, sizeof(so_ScanTable));
+    table->block = -1;
+    return 0;
+}
+
+// Add a column with NULL columnId and columnType
+int so_Scan_new_column(so_ScanTable *table)
+{
+    if (so_scan_grow((void **) &table->columnIds, table->num_columns, sizeof(char *)) ||
+            so_scan_grow((void **) &table->columnTypes, table->num_columns, sizeof(char *)) ||
+            so_scan_grow((void **) &table->valueTypes, table->num_columns, sizeof(pharmml_valueType))) {
+        return 1;
+    }
+    int col = table->num_columns++;
+    table->columnIds[col] = NULL;
+    table->columnTypes[col] = NULL;
+    table->valueTypes[col] = PHARMML_VALUETYPE_ERROR;
+    return 0;
+}
+
+// Add a copy of a namespace declaration to a pair of arrays. The prefix is NULL for the default namespace.
+int so_Scan_add_namespace(int *num_namespaces, char ***prefixes, char ***uris, const char *prefix, const char *uri)
+{
+    if (so_scan_grow((void **) prefixes, *num_namespaces, sizeof(char *)) ||
+            so_scan_grow((void **) uris, *num_namespaces, sizeof(char *))) {
+        return 1;
+    }
+    char *prefix_copy = prefix ? pharmml_strdup(prefix) : NULL;
+    char *uri_copy = pharmml_strdup(uri ? uri : "");
+    if ((prefix && !prefix_copy) || !uri_copy) {
+        free(prefix_copy);
+        free(uri_copy);
+        return 1;
+    }
+    (*prefixes)[*num_namespaces] = prefix_copy;
+    (*uris)[*num_namespaces] = uri_copy;
+    (*num_namespaces)++;
+    return 0;
+}
+
+static int so_scan_root(so_ScanState *state, int nb_namespaces, const char **namespaces, int nb_attributes, const char **attributes)
+{
+    so_Scan *scan = state->scan;
+    scan->id = so_scan_attribute(nb_attributes, attributes, "id");
+    scan->metadataFile = so_scan_attribute(nb_attributes, attributes, "metadataFile");
+
+    for (int i = 0; i < nb_namespaces; i++) {
+        if (so_Scan_add_namespace(&scan->num_namespaces, &scan->namespace_prefixes, &scan->namespace_uris,
+                    namespaces[2 * i], namespaces[2 * i + 1])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Keep the namespaces declared on an element below the SO element while it is open
+static int so_scan_push_namespaces(so_ScanState *state, int depth, int nb_namespaces, const char **namespaces)
+{
+    for (int i = 0; i < nb_namespaces; i++) {
+        if (so_scan_grow((void **) &state->namespace_depths, state->num_namespaces, sizeof(int))) {
+            return 1;
+        }
+        state->namespace_depths[state->num_namespaces] = depth;
+        if (so_Scan_add_namespace(&state->num_namespaces, &state->namespace_prefixes, &state->namespace_uris,
+                    namespaces[2 * i], namespaces[2 * i + 1])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void so_scan_pop_namespaces(so_ScanState *state, int depth)
+{
+    while (state->num_namespaces > 0 && state->namespace_depths[state->num_namespaces - 1] >= depth) {
+        state->num_namespaces--;
+        free(state->namespace_prefixes[state->num_namespaces]);
+        free(state->namespace_uris[state->num_namespaces]);
+    }
+}
+
+static int so_scan_same_prefix(const char *a, const char *b)
+{
+    return (!a && !b) || (a && b && strcmp(a, b) == 0);
+}
+
+// Copy the namespaces in scope on the elements above depth into a table. Declarations
+// that are shadowed by a declaration further down are left out.
+static int so_scan_table_namespaces(so_ScanState *state, so_ScanTable *table, int depth)
+{
+    for (int i = state->num_namespaces - 1; i >= 0; i--) {
+        if (state->namespace_depths[i] >= depth) {
+            continue;
+        }
+        int shadowed = 0;
+        for (int j = 0; j < table->num_namespaces; j++) {
+            if (so_scan_same_prefix(table->namespace_prefixes[j], state->namespace_prefixes[i])) {
+                shadowed = 1;
+                break;
+            }
+        }
+        if (!shadowed && so_Scan_add_namespace(&table->num_namespaces, &table->namespace_prefixes, &table->namespace_uris,
+                    state->namespace_prefixes[i], state->namespace_uris[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int so_scan_new_block(so_ScanState *state, int nb_attributes, const char **attributes)
+{
+    so_Scan *scan = state->scan;
+    if (so_Scan_new_block(scan)) {
+        return 1;
+    }
+    scan->blocks[scan->num_blocks - 1].blkId = so_scan_attribute(nb_attributes, attributes, "blkId");
+    state->in_block = 1;
+    return 0;
+}
+
+static int so_scan_new_table(so_ScanState *state)
+{
+    so_Scan *scan = state->scan;
+    if (so_Scan_new_table(scan)) {
+        return 1;
+    }
+    so_ScanTable *table = &scan->tables[scan->num_tables - 1];
+    table->block = state->in_block ? scan->num_blocks - 1 : -1;
+    table->definition_start = state->tag_start;
+    table->path = so_scan_table_path(state);
+    if (!table->path || so_scan_table_namespaces(state, table, state->depth - 1)) {
+        return 1;
+    }
+    state->table = scan->num_tables - 1;
+    state->table_depth = state->depth - 2;
+    return 0;
+}
+
+static int so_scan_new_column(so_ScanTable *table, int nb_attributes, const char **attributes)
+{
+    if (so_Scan_new_column(table)) {
+        return 1;
+    }
+    int col = table->num_columns - 1;
+    table->columnIds[col] = so_scan_attribute(nb_attributes, attributes, "columnId");
+    table->columnTypes[col] = so_scan_attribute(nb_attributes, attributes, "columnType");
+    char *valueType = so_scan_attribute(nb_attributes, attributes, "valueType");
+    table->valueTypes[col] = valueType ? pharmml_string_to_valueType(valueType) : PHARMML_VALUETYPE_ERROR;
+    free(valueType);
+    return !table->columnIds[col] || !table->columnTypes[col];
+}
+
+static int so_scan_start_table(so_ScanState *state, const char *prefix)
+{
+    so_ScanTable *table = &state->scan->tables[state->table];
+    table->table_start = state->tag_start;
+    free(state->close_tag);
+    free(state->row_tag);
+    state->close_tag = so_scan_qname("</", prefix, "Table");
+    state->row_tag = so_scan_qname("<", prefix, "Row");
+    if (!state->close_tag || !state->row_tag) {
+        return 1;
+    }
+    state->skip = 1;
+    return 0;
+}
+
+static void so_scan_on_start_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI,
+    int nb_namespaces, const xmlChar **namespaces, int nb_attributes, int nb_defaulted, const xmlChar **attributes)
+{
+    so_ScanState *state = (so_ScanState *) ctx;
+    const char *name = (const char *) localname;
+    const char **attr = (const char **) attributes;
+    int depth = state->depth;
+    int fail = 0;
+
+    if (depth < SO_SCAN_MAX_DEPTH) {
+        state->names[depth] = name;
+    }
+    state->depth++;
+
+    if (depth > 0 && so_scan_push_namespaces(state, depth, nb_namespaces, (const char **) namespaces)) {
+        fail = 1;
+    } else if (depth == 0) {
+        fail = so_scan_root(state, nb_namespaces, (const char **) namespaces, nb_attributes, attr);
+    } else if (depth == 1 && strcmp(name, "PharmMLRef") == 0) {
+        free(state->scan->PharmMLRef);
+        state->scan->PharmMLRef = so_scan_attribute(nb_attributes, attr, "name");
+    } else if (depth == 1 && strcmp(name, "SOBlock") == 0) {
+        fail = so_scan_new_block(state, nb_attributes, attr);
+    } else if (depth == 2 && state->in_block) {
+        state->in_tool_settings = strcmp(name, "ToolSettings") == 0;
+        state->in_task_information = strcmp(name, "TaskInformation") == 0;
+    } else if (state->in_tool_settings && depth == 4 && strcmp(name, "path") == 0) {
+        state->capture = SO_SCAN_TEXT_TOOL_FILE;
+    } else if (state->in_task_information) {
+        so_ScanBlock *block = &state->scan->blocks[state->scan->num_blocks - 1];
+        if (depth == 3 && strcmp(name, "Message") == 0) {
+            block->num_messages++;
+        } else if (depth == 4 && strcmp(name, "Severity") == 0) {
+            state->capture = SO_SCAN_TEXT_SEVERITY;
+        } else if (depth == 3 && strcmp(name, "RunTime") == 0) {
+            state->capture = SO_SCAN_TEXT_RUNTIME;
+        }
+    } else if (so_scan_is_dataset((const char *) URI)) {
+        if (strcmp(name, "Definition") == 0) {
+            fail = so_scan_new_table(state);
+        } else if (strcmp(name, "Column") == 0 && state->table >= 0) {
+            fail = so_scan_new_column(&state->scan->tables[state->table], nb_attributes, attr);
+        } else if (strcmp(name, "Table") == 0 && state->table >= 0) {
+            fail = so_scan_start_table(state, (const char *) prefix);
+        }
+    }
+
+    if (fail) {
+        state->failed = 1;
+        xmlStopParser(state->ctxt);
+    }
+}
+
+static void so_scan_end_text(so_ScanState *state)
+{
+    so_ScanBlock *block = &state->scan->blocks[state->scan->num_blocks - 1];
+    char *text = state->text ? state->text : "";
+
+    if (state->capture == SO_SCAN_TEXT_TOOL_FILE) {
+        if (so_scan_grow((void **) &block->tool_files, block->num_tool_files, sizeof(char *))) {
+            state->failed = 1;
+            return;
+        }
+        block->tool_files[block->num_tool_files++] = state->text ? state->text : pharmml_strdup("");
+        state->text = NULL;
+    } else if (state->capture == SO_SCAN_TEXT_SEVERITY) {
+        int severity = pharmml_string_to_int(text);
+        block->max_severity = severity > block->max_severity ? severity : block->max_severity;
+    } else if (state->capture == SO_SCAN_TEXT_RUNTIME) {
+        block->run_time = pharmml_string_to_double(text);
+    }
+
+    free(state->text);
+    state->text = NULL;
+    state->capture = SO_SCAN_TEXT_NONE;
+}
+
+static void so_scan_on_end_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI)
+{
+    so_ScanState *state = (so_ScanState *) ctx;
+    const char *name = (const char *) localname;
+    state->depth--;
+    int depth = state->depth;
+
+    if (state->capture != SO_SCAN_TEXT_NONE) {
+        so_scan_end_text(state);
+    } else if (depth == 1 && state->in_block) {
+        state->in_block = 0;
+    } else if (depth == 2) {
+        state->in_tool_settings = 0;
+        state->in_task_information = 0;
+    } else if (state->table >= 0 && so_scan_is_dataset((const char *) URI)) {
+        so_ScanTable *table = &state->scan->tables[state->table];
+        if (strcmp(name, "Definition") == 0) {
+            table->definition_end = state->offset;
+        } else if (strcmp(name, "Table") == 0) {
+            table->table_end = state->offset;
+            state->skip = 0;
+        }
+    }
+    if (state->table >= 0 && depth == state->table_depth) {
+        state->scan->tables[state->table].end = state->tag_start;
+        state->table = -1;
+    }
+    so_scan_pop_namespaces(state, depth);
+}
+
+static void so_scan_on_characters(void *ctx, const xmlChar *ch, int len)
+{
+    so_ScanState *state = (so_ScanState *) ctx;
+    if (state->capture != SO_SCAN_TEXT_NONE && pharmml_strnappend(&state->text, (const char *) ch, len)) {
+        state->failed = 1;
+        xmlStopParser(state->ctxt);
+    }
+}
+
+static int so_scan_is_tag_end(char c)
+{
+    return c == '>' || c == '/' || c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Skip the rows of a ds:Table counting them. Return 1 when the end tag has been found and then leave
+// *pos at its '<'. Otherwise *pos is left where matching should continue when more data is available.
+static int so_scan_skip_rows(so_ScanState *state, const char *data, size_t *pos, size_t len, int eof)
+{
+    size_t close_len = strlen(state->close_tag);
+    size_t row_len = strlen(state->row_tag);
+    size_t keep = (close_len > row_len ? close_len : row_len) + 1;
+    const char *p = data + *pos;
+    const char *end = data + len;
+    const char *limit = eof ? end : ((size_t) (end - p) > keep ? end - keep : p);   // A match starting before limit can be checked
+    so_ScanTable *table = &state->scan->tables[state->table];
+
+    while (p < limit) {
+        p = memchr(p, '<', limit - p);
+        if (!p) {
+            p = limit;
+            break;
+        }
+        if ((size_t) (end - p) > close_len && memcmp(p, state->close_tag, close_len) == 0 && so_scan_is_tag_end(p[close_len])) {
+            *pos = p - data;
+            return 1;
+        }
+        if ((size_t) (end - p) > row_len && memcmp(p, state->row_tag, row_len) == 0 && so_scan_is_tag_end(p[row_len])) {
+            table->numrows++;
+        }
+        p++;
+    }
+
+    *pos = p - data;
+    return 0;
+}
+
+// Give the parser the next tag with the text before it. Return 0 if no complete tag was available.
+static int so_scan_feed_tag(so_ScanState *state, const char *data, size_t *pos, size_t len, size_t consumed)
+{
+    const char *start = data + *pos;
+    const char *gt = memchr(start, '>', len - *pos);
+    if (!gt) {
+        return 0;
+    }
+    for (const char *p = gt; p >= start; p--) {
+        if (*p == '<') {
+            state->tag_start = consumed + (p - data);
+            break;
+        }
+    }
+    size_t n = gt - start + 1;
+    *pos += n;
+    state->offset = consumed + *pos;
+    xmlParseChunk(state->ctxt, start, n, 0);
+    return 1;
+}
+
+// Scan an SO reading from an input buffer. All markup except the contents of ds:Table elements is
+// given to a push parser one tag at a time so that the parser never sees the rows. The rows are
+// instead skipped by searching for the end tag in the raw data while counting the row start tags.
+so_Scan *so_Scan_read(xmlParserInputBufferPtr input)
+{
+    so_ScanState state;
+    memset(&state, 0, sizeof(so_ScanState));
+    state.table = -1;
+    state.scan = so_Scan_new();
+    if (!state.scan) {
+        return NULL;
+    }
+
+    xmlSAXHandler sax_handler;
+    memset(&sax_handler, 0, sizeof(xmlSAXHandler));
+    sax_handler.initialized = XML_SAX2_MAGIC;
+    sax_handler.startElementNs = so_scan_on_start_element;
+    sax_handler.endElementNs = so_scan_on_end_element;
+    sax_handler.characters = so_scan_on_characters;
+
+    state.ctxt = xmlCreatePushParserCtxt(&sax_handler, &state, NULL, 0, NULL);
+    if (!state.ctxt) {
+        so_Scan_free(state.scan);
+        return NULL;
+    }
+
+    size_t consumed = 0;        // Bytes of the input that have been removed from the buffer
+    size_t pos = 0;
+    int eof = 0;
+    int error = 0;
+    while (!state.failed && state.ctxt->wellFormed) {
+        const char *data = (const char *) xmlBufContent(input->buffer);
+        size_t len = xmlBufUse(input->buffer);
+        if (state.skip) {
+            if (so_scan_skip_rows(&state, data, &pos, len, eof)) {
+                state.skip = 0;
+                continue;
+            }
+        } else if (so_scan_feed_tag(&state, data, &pos, len, consumed)) {
+            continue;
+        }
+
+        if (eof) {      // Trailing text or an unterminated document
+            state.offset = consumed + len;
+            xmlParseChunk(state.ctxt, data + pos, len - pos, 0);
+            break;
+        }
+        xmlBufShrink(input->buffer, pos);
+        consumed += pos;
+        pos = 0;
+        int n = xmlParserInputBufferGrow(input, SO_SCAN_READ_SIZE);
+        if (n < 0) {
+            error = 1;
+            break;
+        }
+        eof = (n == 0);
+    }
+    if (!state.failed && !error) {
+        xmlParseChunk(state.ctxt, NULL, 0, 1);
+    }
+
+    int fail = state.failed || error || !state.ctxt->wellFormed || state.depth != 0;
+    state.scan->size = state.offset;
+    xmlFreeParserCtxt(state.ctxt);
+    free(state.text);
+    free(state.close_tag);
+    free(state.row_tag);
+    so_scan_pop_namespaces(&state, 0);
+    free(state.namespace_prefixes);
+    free(state.namespace_uris);
+    free(state.namespace_depths);
+    if (fail) {
+        so_Scan_free(state.scan);
+        return NULL;
+    }
+
+    return state.scan;
+}
+
+/** \memberof so_Scan
+ * Free all memory associated with an so_Scan
+ * \param self - pointer to an so_Scan
+ */
+void so_Scan_free(so_Scan *self)
+{
+    if (self) {
+        free(self->id);
+        free(self->metadataFile);
+        free(self->PharmMLRef);
+        pharmml_free_string_array(self->namespace_prefixes, self->num_namespaces);
+        pharmml_free_string_array(self->namespace_uris, self->num_namespaces);
+        for (int i = 0; i < self->num_blocks; i++) {
+            free(self->blocks[i].blkId);
+            pharmml_free_string_array(self->blocks[i].tool_files, self->blocks[i].num_tool_files);
+        }
+        free(self->blocks);
+        for (int i = 0; i < self->num_tables; i++) {
+            so_ScanTable *table = &self->tables[i];
+            free(table->path);
+            pharmml_free_string_array(table->columnIds, table->num_columns);
+            pharmml_free_string_array(table->columnTypes, table->num_columns);
+            free(table->valueTypes);
+            pharmml_free_string_array(table->namespace_prefixes, table->num_namespaces);
+            pharmml_free_string_array(table->namespace_uris, table->num_namespaces);
+        }
+        free(self->tables);
+        free(self);
+    }
+}
+
+/** \memberof so_Scan
+ * Get the id attribute of the SO
+ * \param self - pointer to an so_Scan
+ * \return The id or NULL if not available
+ */
+char *so_Scan_get_id(so_Scan *self)
+{
+    return self->id;
+}
+
+/** \memberof so_Scan
+ * Get the metadataFile attribute of the SO
+ * \param self - pointer to an so_Scan
+ * \return The name of the metadata file or NULL if not available
+ */
+char *so_Scan_get_metadataFile(so_Scan *self)
+{
+    return self->metadataFile;
+}
+
+/** \memberof so_Scan
+ * Get the name of the PharmML file referenced by the PharmMLRef of the SO
+ * \param self - pointer to an so_Scan
+ * \return The name of the PharmML file or NULL if not available
+ */
+char *so_Scan_get_PharmMLRef(so_Scan *self)
+{
+    return self->PharmMLRef;
+}
+
+/** \memberof so_Scan
+ * Get the number of SOBlocks of the SO
+ * \param self - pointer to an so_Scan
+ * \return The number of SOBlocks
+ */
+int so_Scan_get_number_of_SOBlocks(so_Scan *self)
+{
+    return self->num_blocks;
+}
+
+/** \memberof so_Scan
+ * Get the blkId of an SOBlock
+ * \param self - pointer to an so_Scan
+ * \param block - the number of the SOBlock
+ * \return The blkId or NULL if not available
+ */
+char *so_Scan_get_blkId(so_Scan *self, int block)
+{
+    return self->blocks[block].blkId;
+}
+
+/** \memberof so_Scan
+ * Get the number of files in the ToolSettings of an SOBlock
+ * \param self - pointer to an so_Scan
+ * \param block - the number of the SOBlock
+ * \return The number of files
+ * \sa so_Scan_get_tool_file
+ */
+int so_Scan_get_number_of_tool_files(so_Scan *self, int block)
+{
+    return self->blocks[block].num_tool_files;
+}
+
+/** \memberof so_Scan
+ * Get the path of a file in the ToolSettings of an SOBlock
+ * \param self - pointer to an so_Scan
+ * \param block - the number of the SOBlock
+ * \param index - the number of the file
+ * \return The path of the file
+ */
+char *so_Scan_get_tool_file(so_Scan *self, int block, int index)
+{
+    return self->blocks[block].tool_files[index];
+}
+
+/** \memberof so_Scan
+ * Get the number of messages in the TaskInformation of an SOBlock
+ * \param self - pointer to an so_Scan
+ * \param block - the number of the SOBlock
+ * \return The number of messages
+ */
+int so_Scan_get_number_of_messages(so_Scan *self, int block)
+{
+    return self->blocks[block].num_messages;
+}
+
+/** \memberof so_Scan
+ * Get the highest severity of the messages in the TaskInformation of an SOBlock
+ * \param self - pointer to an so_Scan
+ * \param block - the number of the SOBlock
+ * \return The highest severity or -1 if no message has a severity
+ */
+int so_Scan_get_max_severity(so_Scan *self, int block)
+{
+    return self->blocks[block].max_severity;
+}
+
+/** \memberof so_Scan
+ * Get the RunTime from the TaskInformation of an SOBlock
+ * \param self - pointer to an so_Scan
+ * \param block - the number of the SOBlock
+ * \return The run time or NA if not available
+ */
+double so_Scan_get_RunTime(so_Scan *self, int block)
+{
+    return self->blocks[block].run_time;
+}
+
+/** \memberof so_Scan
+ * Get the number of tables in the SO
+ * \param self - pointer to an so_Scan
+ * \return The number of tables
+ */
+int so_Scan_get_number_of_tables(so_Scan *self)
+{
+    return self->num_tables;
+}
+
+/** \memberof so_Scan
+ * Get the SOBlock of a table
+ * \param self - pointer to an so_Scan
+ * \param table - the number of the table
+ * \return The number of the SOBlock or -1 if the table is not in an SOBlock
+ */
+int so_Scan_get_table_block(so_Scan *self, int table)
+{
+    return self->tables[table].block;
+}
+
+/** \memberof so_Scan
+ * Get the path of a table. This is the names of the elements from the SOBlock down to the table
+ * separated by '/', e.g. "Estimation/PopulationEstimates/MLE".
+ * \param self - pointer to an so_Scan
+ * \param table - the number of the table
+ * \return The path of the table
+ */
+char *so_Scan_get_table_path(so_Scan *self, int table)
+{
+    return self->tables[table].path;
+}
+
+/** \memberof so_Scan
+ * Get the number of rows of a table
+ * \param self - pointer to an so_Scan
+ * \param table - the number of the table
+ * \return The number of rows. 0 for a table stored in an external file.
+ */
+int so_Scan_get_table_number_of_rows(so_Scan *self, int table)
+{
+    return self->tables[table].numrows;
+}
+
+/** \memberof so_Scan
+ * Get the number of columns of a table
+ * \param self - pointer to an so_Scan
+ * \param table - the number of the table
+ * \return The number of columns
+ */
+int so_Scan_get_table_number_of_columns(so_Scan *self, int table)
+{
+    return self->tables[table].num_columns;
+}
+
+/** \memberof so_Scan
+ * Get the columnId of a column of a table
+ * \param self - pointer to an so_Scan
+ * \param table - the number of the table
+ * \param column - the number of the column
+ * \return The columnId
+ */
+char *so_Scan_get_table_columnId(so_Scan *self, int table, int column)
+{
+    return self->tables[table].columnIds[column];
+}
+
+/** \memberof so_Scan
+ * Get the columnType of a column of a table as written in the SO
+ * \param self - pointer to an so_Scan
+ * \param table - the number of the table
+ * \param column - the number of the column
+ * \return The columnType. Multiple columnTypes are separated by spaces.
+ */
+char *so_Scan_get_table_columnType(so_Scan *self, int table, int column)
+{
+    return self->tables[table].columnTypes[column];
+}
+
+/** \memberof so_Scan
+ * Get the valueType of a column of a table
+ * \param self - pointer to an so_Scan
+ * \param table - the number of the table
+ * \param column - the number of the column
+ * \return The valueType
+ */
+pharmml_valueType so_Scan_get_table_valueType(so_Scan *self, int table, int column)
+{
+    return self->tables[table].valueTypes[column];
+}
+
+/** \memberof so_Scan
+ * Get the byte offset of the ds:Table element holding the rows of a table
+ * \param self - pointer to an so_Scan
+ * \param table - the number of the table
+ * \return The offset from the start of the uncompressed document. 0 for a table stored in an external file.
+ * \sa so_Scan_get_table_length
+ */
+size_t so_Scan_get_table_offset(so_Scan *self, int table)
+{
+    return self->tables[table].table_start;
+}
+
+/** \memberof so_Scan
+ * Get the length in bytes of the ds:Table element holding the rows of a table
+ * \param self - pointer to an so_Scan
+ * \param table - the number of the table
+ * \return The length including the start and end tags. 0 for a table stored in an external file.
+ * \sa so_Scan_get_table_offset
+ */
+size_t so_Scan_get_table_length(so_Scan *self, int table)
+{
+    return self->tables[table].table_end - self->tables[table].table_start;
+}
@@ -0,0 +1,562 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <libxml/parser.h>
+#include <libxml/parserInternals.h>
+#include <libxml/entities.h>
+#include <libxml/xmlwriter.h>
+
+#include <so/Scan.h>
+#include <so/private/Scan.h>
+#include <so/Table.h>
+#include <so/private/Table.h>
+#include <pharmml/common_types.h>
+#include <pharmml/string.h>
+
+// Version of the format of the index files
+#define SO_SCAN_INDEX_VERSION 1
+
+// A range of an SO file available in memory
+typedef struct {
+    const char *data;
+    void *base;                 // Start of the mapping or buffer to release
+    size_t length;              // Length of the mapping
+} so_ScanRange;
+
+static int so_scan_write_attribute(xmlTextWriterPtr writer, const char *name, const char *value)
+{
+    if (!value) {
+        return 0;
+    }
+    return xmlTextWriterWriteAttribute(writer, BAD_CAST name, BAD_CAST value) < 0;
+}
+
+static int so_scan_write_size(xmlTextWriterPtr writer, const char *name, size_t value)
+{
+    return xmlTextWriterWriteFormatAttribute(writer, BAD_CAST name, "%zu", value) < 0;
+}
+
+static int so_scan_write_namespaces(xmlTextWriterPtr writer, int num_namespaces, char **prefixes, char **uris)
+{
+    int fail = 0;
+    for (int i = 0; i < num_namespaces && !fail; i++) {
+        fail = xmlTextWriterStartElement(writer, BAD_CAST "Namespace") < 0 ||
+            so_scan_write_attribute(writer, "prefix", prefixes[i]) ||
+            so_scan_write_attribute(writer, "uri", uris[i]) ||
+            xmlTextWriterEndElement(writer) < 0;
+    }
+    return fail;
+}
+
+static int so_scan_write_block(xmlTextWriterPtr writer, so_ScanBlock *block)
+{
+    int fail = xmlTextWriterStartElement(writer, BAD_CAST "SOBlock") < 0 ||
+        so_scan_write_attribute(writer, "blkId", block->blkId) ||
+        xmlTextWriterWriteFormatAttribute(writer, BAD_CAST "numberOfMessages", "%d", block->num_messages) < 0;
+    if (!fail && block->max_severity >= 0) {
+        fail = xmlTextWriterWriteFormatAttribute(writer, BAD_CAST "maxSeverity", "%d", block->max_severity) < 0;
+    }
+    if (!fail && !pharmml_is_na(block->run_time)) {
+        fail = xmlTextWriterWriteFormatAttribute(writer, BAD_CAST "runTime", "%.17g", block->run_time) < 0;
+    }
+    for (int i = 0; i < block->num_tool_files && !fail; i++) {
+        fail = xmlTextWriterStartElement(writer, BAD_CAST "ToolFile") < 0 ||
+            so_scan_write_attribute(writer, "path", block->tool_files[i]) ||
+            xmlTextWriterEndElement(writer) < 0;
+    }
+    return fail || xmlTextWriterEndElement(writer) < 0;
+}
+
+static int so_scan_write_table(xmlTextWriterPtr writer, so_ScanTable *table)
+{
+    int fail = xmlTextWriterStartElement(writer, BAD_CAST "Table") < 0 ||
+        xmlTextWriterWriteFormatAttribute(writer, BAD_CAST "block", "%d", table->block) < 0 ||
+        so_scan_write_attribute(writer, "path", table->path) ||
+        xmlTextWriterWriteFormatAttribute(writer, BAD_CAST "numberOfRows", "%d", table->numrows) < 0 ||
+        so_scan_write_size(writer, "definitionStart", table->definition_start) ||
+        so_scan_write_size(writer, "definitionEnd", table->definition_end) ||
+        so_scan_write_size(writer, "tableStart", table->table_start) ||
+        so_scan_write_size(writer, "tableEnd", table->table_end) ||
+        so_scan_write_size(writer, "end", table->end) ||
+        so_scan_write_namespaces(writer, table->num_namespaces, table->namespace_prefixes, table->namespace_uris);
+    for (int i = 0; i < table->num_columns && !fail; i++) {
+        fail = xmlTextWriterStartElement(writer, BAD_CAST "Column") < 0 ||
+            so_scan_write_attribute(writer, "columnId", table->columnIds[i]) ||
+            so_scan_write_attribute(writer, "columnType", table->columnTypes[i]);
+        if (!fail && table->valueTypes[i] != PHARMML_VALUETYPE_ERROR) {
+            fail = so_scan_write_attribute(writer, "valueType", pharmml_valueType_to_string(table->valueTypes[i]));
+        }
+        fail = fail || xmlTextWriterEndElement(writer) < 0;
+    }
+    return fail || xmlTextWriterEndElement(writer) < 0;
+}
+
+/** \memberof so_Scan
+ * Save an so_Scan to an index file. The index can be read back with so_Scan_read_index
+ * to get random access to the tables of the SO file without scanning it again.
+ * \param self - pointer to an so_Scan
+ * \param filename - name of the index file to write
+ * \return 0 for success
+ * \sa so_Scan_read_index, so_SO_load_table_at
+ */
+int so_Scan_write_index(so_Scan *self, char *filename)
+{
+    xmlTextWriterPtr writer = xmlNewTextWriterFilename(filename, 0);
+    if (!writer) {
+        return 1;
+    }
+
+    int fail = xmlTextWriterSetIndent(writer, 1) < 0 ||
+        xmlTextWriterSetIndentString(writer, BAD_CAST "  ") < 0 ||
+        xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL) < 0 ||
+        xmlTextWriterStartElement(writer, BAD_CAST "SOIndex") < 0 ||
+        xmlTextWriterWriteFormatAttribute(writer, BAD_CAST "version", "%d", SO_SCAN_INDEX_VERSION) < 0 ||
+        so_scan_write_size(writer, "size", self->size) ||
+        so_scan_write_attribute(writer, "id", self->id) ||
+        so_scan_write_attribute(writer, "metadataFile", self->metadataFile) ||
+        so_scan_write_attribute(writer, "PharmMLRef", self->PharmMLRef) ||
+        so_scan_write_namespaces(writer, self->num_namespaces, self->namespace_prefixes, self->namespace_uris);
+    for (int i = 0; i < self->num_blocks && !fail; i++) {
+        fail = so_scan_write_block(writer, &self->blocks[i]);
+    }
+    for (int i = 0; i < self->num_tables && !fail; i++) {
+        fail = so_scan_write_table(writer, &self->tables[i]);
+    }
+    fail = fail || xmlTextWriterEndDocument(writer) < 0 || xmlTextWriterFlush(writer) < 0;
+
+    xmlFreeTextWriter(writer);
+    return fail;
+}
+
+// A copy of the value of an attribute. NULL if not available and *fail is set if out of memory.
+static char *so_scan_index_string(int nb_attributes, const char **attributes, const char *name, int *fail)
+{
+    for (int i = 0; i < nb_attributes; i++) {
+        if (strcmp(attributes[5 * i], name) == 0) {
+            char *value = pharmml_strndup(attributes[5 * i + 3], attributes[5 * i + 4] - attributes[5 * i + 3]);
+            if (!value) {
+                *fail = 1;
+            }
+            return value;
+        }
+    }
+    return NULL;
+}
+
+static size_t so_scan_index_size(int nb_attributes, const char **attributes, const char *name, int *fail)
+{
+    char *value = so_scan_index_string(nb_attributes, attributes, name, fail);
+    size_t size = value ? (size_t) strtoull(value, NULL, 10) : 0;
+    free(value);
+    return size;
+}
+
+static int so_scan_index_int(int nb_attributes, const char **attributes, const char *name, int default_value, int *fail)
+{
+    char *value = so_scan_index_string(nb_attributes, attributes, name, fail);
+    int result = value ? pharmml_string_to_int(value) : default_value;
+    free(value);
+    return result;
+}
+
+static int so_scan_index_namespace(int nb_attributes, const char **attributes, int *num_namespaces, char ***prefixes, char ***uris)
+{
+    int fail = 0;
+    char *prefix = so_scan_index_string(nb_attributes, attributes, "prefix", &fail);
+    char *uri = so_scan_index_string(nb_attributes, attributes, "uri", &fail);
+    fail = fail || so_Scan_add_namespace(num_namespaces, prefixes, uris, prefix, uri);
+    free(prefix);
+    free(uri);
+    return fail;
+}
+
+typedef struct {
+    so_Scan *scan;
+    xmlParserCtxtPtr ctxt;
+    int depth;
+    int failed;
+} so_ScanIndexState;
+
+static int so_scan_index_element(so_ScanIndexState *state, const char *name, int nb_attributes, const char **attributes)
+{
+    so_Scan *scan = state->scan;
+    int fail = 0;
+
+    if (state->depth == 0) {
+        if (strcmp(name, "SOIndex") != 0 || so_scan_index_int(nb_attributes, attributes, "version", 0, &fail) != SO_SCAN_INDEX_VERSION) {
+            return 1;
+        }
+        scan->size = so_scan_index_size(nb_attributes, attributes, "size", &fail);
+        scan->id = so_scan_index_string(nb_attributes, attributes, "id", &fail);
+        scan->metadataFile = so_scan_index_string(nb_attributes, attributes, "metadataFile", &fail);
+        scan->PharmMLRef = so_scan_index_string(nb_attributes, attributes, "PharmMLRef", &fail);
+    } else if (state->depth == 1 && strcmp(name, "Namespace") == 0) {
+        fail = so_scan_index_namespace(nb_attributes, attributes, &scan->num_namespaces, &scan->namespace_prefixes, &scan->namespace_uris);
+    } else if (state->depth == 1 && strcmp(name, "SOBlock") == 0) {
+        if (so_Scan_new_block(scan)) {
+            return 1;
+        }
+        so_ScanBlock *block = &scan->blocks[scan->num_blocks - 1];
+        block->blkId = so_scan_index_string(nb_attributes, attributes, "blkId", &fail);
+        block->num_messages = so_scan_index_int(nb_attributes, attributes, "numberOfMessages", 0, &fail);
+        block->max_severity = so_scan_index_int(nb_attributes, attributes, "maxSeverity", -1, &fail);
+        char *run_time = so_scan_index_string(nb_attributes, attributes, "runTime", &fail);
+        if (run_time) {
+            block->run_time = pharmml_string_to_double(run_time);
+            free(run_time);
+        }
+    } else if (state->depth == 2 && strcmp(name, "ToolFile") == 0 && scan->num_blocks > 0) {
+        so_ScanBlock *block = &scan->blocks[scan->num_blocks - 1];
+        char **new_files = realloc(block->tool_files, (block->num_tool_files + 1) * sizeof(char *));
+        if (!new_files) {
+            return 1;
+        }
+        block->tool_files = new_files;
+        block->tool_files[block->num_tool_files] = so_scan_index_string(nb_attributes, attributes, "path", &fail);
+        block->num_tool_files++;
+    } else if (state->depth == 1 && strcmp(name, "Table") == 0) {
+        if (so_Scan_new_table(scan)) {
+            return 1;
+        }
+        so_ScanTable *table = &scan->tables[scan->num_tables - 1];
+        table->block = so_scan_index_int(nb_attributes, attributes, "block", -1, &fail);
+        table->path = so_scan_index_string(nb_attributes, attributes, "path", &fail);
+        table->numrows = so_scan_index_int(nb_attributes, attributes, "numberOfRows", 0, &fail);
+        table->definition_start = so_scan_index_size(nb_attributes, attributes, "definitionStart", &fail);
+        table->definition_end = so_scan_index_size(nb_attributes, attributes, "definitionEnd", &fail);
+        table->table_start = so_scan_index_size(nb_attributes, attributes, "tableStart", &fail);
+        table->table_end = so_scan_index_size(nb_attributes, attributes, "tableEnd", &fail);
+        table->end = so_scan_index_size(nb_attributes, attributes, "end", &fail);
+        fail = fail || !table->path || table->block >= scan->num_blocks || table->end < table->definition_start;
+    } else if (state->depth == 2 && scan->num_tables > 0) {
+        so_ScanTable *table = &scan->tables[scan->num_tables - 1];
+        if (strcmp(name, "Namespace") == 0) {
+            fail = so_scan_index_namespace(nb_attributes, attributes, &table->num_namespaces, &table->namespace_prefixes, &table->namespace_uris);
+        } else if (strcmp(name, "Column") == 0) {
+            if (so_Scan_new_column(table)) {
+                return 1;
+            }
+            int col = table->num_columns - 1;
+            table->columnIds[col] = so_scan_index_string(nb_attributes, attributes, "columnId", &fail);
+            table->columnTypes[col] = so_scan_index_string(nb_attributes, attributes, "columnType", &fail);
+            char *valueType = so_scan_index_string(nb_attributes, attributes, "valueType", &fail);
+            if (valueType) {
+                table->valueTypes[col] = pharmml_string_to_valueType(valueType);
+                free(valueType);
+            }
+            fail = fail || !table->columnIds[col] || !table->columnTypes[col];
+        }
+    }
+
+    return fail;
+}
+
+static void so_scan_index_on_start_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI,
+    int nb_namespaces, const xmlChar **namespaces, int nb_attributes, int nb_defaulted, const xmlChar **attributes)
+{
+    so_ScanIndexState *state = (so_ScanIndexState *) ctx;
+    if (!state->failed && so_scan_index_element(state, (const char *) localname, nb_attributes, (const char **) attributes)) {
+        state->failed = 1;
+        xmlStopParser(state->ctxt);
+    }
+    state->depth++;
+}
+
+static void so_scan_index_on_end_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI)
+{
+    so_ScanIndexState *state = (so_ScanIndexState *) ctx;
+    state->depth--;
+}
+
+/** \memberof so_Scan
+ * Read an index file written by so_Scan_write_index
+ * \param filename - name of the index file
+ * \return A pointer to a new so_Scan or NULL for error
+ * \sa so_Scan_write_index, so_SO_scan
+ */
+so_Scan *so_Scan_read_index(char *filename)
+{
+    so_ScanIndexState state;
+    memset(&state, 0, sizeof(so_ScanIndexState));
+    state.scan = so_Scan_new();
+    if (!state.scan) {
+        return NULL;
+    }
+    state.ctxt = xmlCreateFileParserCtxt(filename);
+    if (!state.ctxt) {
+        so_Scan_free(state.scan);
+        return NULL;
+    }
+
+    xmlSAXHandler sax_handler;
+    memset(&sax_handler, 0, sizeof(xmlSAXHandler));
+    sax_handler.initialized = XML_SAX2_MAGIC;
+    sax_handler.startElementNs = so_scan_index_on_start_element;
+    sax_handler.endElementNs = so_scan_index_on_end_element;
+
+    xmlSAXHandlerPtr old_sax = state.ctxt->sax;
+    state.ctxt->sax = &sax_handler;
+    state.ctxt->userData = &state;
+    xmlParseDocument(state.ctxt);
+    int fail = state.failed || !state.ctxt->wellFormed;
+    state.ctxt->sax = old_sax;
+    state.ctxt->userData = NULL;
+    xmlFreeParserCtxt(state.ctxt);
+
+    if (fail) {
+        so_Scan_free(state.scan);
+        return NULL;
+    }
+    return state.scan;
+}
+
+/** \memberof so_Scan
+ * Find a table given the SOBlock and the element names leading to it
+ * \param self - pointer to an so_Scan
+ * \param blkId - the blkId of the SOBlock or NULL for any SOBlock
+ * \param path - the path of the table as given by so_Scan_get_table_path or any number of trailing
+ * element names of it, e.g. "IndivObservationPrediction"
+ * \return The number of the first matching table or -1 if no table matches
+ * \sa so_Scan_get_table_path, so_SO_load_table_at
+ */
+int so_Scan_find_table(so_Scan *self, char *blkId, char *path)
+{
+    size_t path_length = strlen(path);
+    for (int i = 0; i < self->num_tables; i++) {
+        so_ScanTable *table = &self->tables[i];
+        if (blkId) {
+            char *table_blkId = table->block >= 0 ? self->blocks[table->block].blkId : NULL;
+            if (!table_blkId || strcmp(table_blkId, blkId) != 0) {
+                continue;
+            }
+        }
+        size_t length = strlen(table->path);
+        if (length >= path_length && strcmp(table->path + length - path_length, path) == 0 &&
+                (length == path_length || table->path[length - path_length - 1] == '/')) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Make the range [start, end) of a file available in memory. The file must still have the given size.
+static int so_scan_map_range(const char *filename, size_t file_size, size_t start, size_t end, so_ScanRange *range)
+{
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size != file_size) {
+        close(fd);
+        return 1;
+    }
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t map_start = start - start % page_size;
+    range->length = end - map_start;
+    range->base = mmap(NULL, range->length, PROT_READ, MAP_PRIVATE, fd, (off_t) map_start);
+    close(fd);
+    if (range->base == MAP_FAILED) {
+        return 1;
+    }
+    range->data = (const char *) range->base + (start - map_start);
+    return 0;
+#else
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        return 1;
+    }
+    int fail = fseek(fp, 0, SEEK_END) != 0 || (size_t) ftell(fp) != file_size || fseek(fp, (long) start, SEEK_SET) != 0;
+    range->length = end - start;
+    range->base = fail ? NULL : malloc(range->length);
+    fail = !range->base || fread(range->base, 1, range->length, fp) != range->length;
+    fclose(fp);
+    if (fail) {
+        free(range->base);
+        return 1;
+    }
+    range->data = range->base;
+    return 0;
+#endif
+}
+
+static void so_scan_unmap_range(so_ScanRange *range)
+{
+#ifndef _WIN32
+    munmap(range->base, range->length);
+#else
+    free(range->base);
+#endif
+}
+
+static int so_scan_append_namespace(char **tag, const char *prefix, const char *uri)
+{
+    xmlChar *escaped = xmlEncodeSpecialChars(NULL, BAD_CAST uri);
+    if (!escaped) {
+        return 1;
+    }
+    int fail = pharmml_strnappend(tag, " xmlns", 6) ||
+        (prefix && (pharmml_strnappend(tag, ":", 1) || pharmml_strnappend(tag, prefix, strlen(prefix)))) ||
+        pharmml_strnappend(tag, "=\"", 2) ||
+        pharmml_strnappend(tag, (const char *) escaped, strlen((const char *) escaped)) ||
+        pharmml_strnappend(tag, "\"", 1);
+    xmlFree(escaped);
+    return fail;
+}
+
+// Start tag of an element declaring the namespaces in scope for a table
+static char *so_scan_wrapper_tag(so_Scan *self, so_ScanTable *table)
+{
+    char *tag = NULL;
+    int fail = pharmml_strnappend(&tag, "<SO", 3);
+    for (int i = 0; i < table->num_namespaces && !fail; i++) {
+        fail = so_scan_append_namespace(&tag, table->namespace_prefixes[i], table->namespace_uris[i]);
+    }
+    for (int i = 0; i < self->num_namespaces && !fail; i++) {
+        const char *prefix = self->namespace_prefixes[i];
+        int shadowed = 0;
+        for (int j = 0; j < table->num_namespaces; j++) {
+            const char *table_prefix = table->namespace_prefixes[j];
+            if ((!prefix && !table_prefix) || (prefix && table_prefix && strcmp(prefix, table_prefix) == 0)) {
+                shadowed = 1;
+            }
+        }
+        if (!shadowed) {
+            fail = so_scan_append_namespace(&tag, prefix, self->namespace_uris[i]);
+        }
+    }
+    fail = fail || pharmml_strnappend(&tag, ">", 1);
+    if (fail) {
+        free(tag);
+        return NULL;
+    }
+    return tag;
+}
+
+typedef struct {
+    so_Table *table;
+    xmlParserCtxtPtr ctxt;
+    int depth;
+    int failed;
+} so_ScanLoadState;
+
+static void so_scan_load_on_start_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI,
+    int nb_namespaces, const xmlChar **namespaces, int nb_attributes, int nb_defaulted, const xmlChar **attributes)
+{
+    so_ScanLoadState *state = (so_ScanLoadState *) ctx;
+    if (state->depth > 0 && so_Table_start_element(state->table, (const char *) localname, nb_attributes, (const char **) attributes)) {
+        state->failed = 1;
+        xmlStopParser(state->ctxt);
+    }
+    state->depth++;
+}
+
+static void so_scan_load_on_end_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI)
+{
+    so_ScanLoadState *state = (so_ScanLoadState *) ctx;
+    state->depth--;
+    if (state->depth > 0 && so_Table_end_element(state->table, (const char *) localname)) {
+        state->failed = 1;
+        xmlStopParser(state->ctxt);
+    }
+}
+
+static void so_scan_load_on_characters(void *ctx, const xmlChar *ch, int len)
+{
+    so_ScanLoadState *state = (so_ScanLoadState *) ctx;
+    if (state->depth > 1 && so_Table_characters(state->table, (const char *) ch, len)) {
+        state->failed = 1;
+        xmlStopParser(state->ctxt);
+    }
+}
+
+// Load one table of an uncompressed SO file. The part of the file from the ds:Definition to the end tag
+// of the table element is mapped into memory and parsed inside an element declaring the namespaces
+// that were in scope for the table.
+so_Table *so_Scan_load_table(so_Scan *self, const char *filename, int table)
+{
+    so_ScanTable *scan_table = &self->tables[table];
+    so_ScanRange range;
+    if (scan_table->end <= scan_table->definition_start ||
+            so_scan_map_range(filename, self->size, scan_table->definition_start, scan_table->end, &range)) {
+        return NULL;
+    }
+    size_t length = scan_table->end - scan_table->definition_start;
+    if (range.data[0] != '<') {     // The file has changed since it was scanned
+        so_scan_unmap_range(&range);
+        return NULL;
+    }
+
+    so_ScanLoadState state;
+    memset(&state, 0, sizeof(so_ScanLoadState));
+    char *wrapper = so_scan_wrapper_tag(self, scan_table);
+    state.table = so_Table_new();
+    if (!wrapper || !state.table) {
+        goto fail;
+    }
+
+    xmlSAXHandler sax_handler;
+    memset(&sax_handler, 0, sizeof(xmlSAXHandler));
+    sax_handler.initialized = XML_SAX2_MAGIC;
+    sax_handler.startElementNs = so_scan_load_on_start_element;
+    sax_handler.endElementNs = so_scan_load_on_end_element;
+    sax_handler.characters = so_scan_load_on_characters;
+
+    state.ctxt = xmlCreatePushParserCtxt(&sax_handler, &state, NULL, 0, NULL);
+    if (!state.ctxt) {
+        goto fail;
+    }
+    xmlParseChunk(state.ctxt, wrapper, strlen(wrapper), 0);
+    for (size_t pos = 0; pos < length && !state.failed && state.ctxt->wellFormed; pos += SO_SCAN_READ_SIZE) {
+        size_t n = length - pos < SO_SCAN_READ_SIZE ? length - pos : SO_SCAN_READ_SIZE;
+        xmlParseChunk(state.ctxt, range.data + pos, n, 0);
+    }
+    if (!state.failed && state.ctxt->wellFormed) {
+        xmlParseChunk(state.ctxt, "</SO>", 5, 1);
+    }
+    int fail = state.failed || !state.ctxt->wellFormed || state.depth != 0;
+    xmlFreeParserCtxt(state.ctxt);
+    if (fail) {
+        goto fail;
+    }
+
+    free(wrapper);
+    so_scan_unmap_range(&range);
+    return state.table;
+
+fail:
+    free(wrapper);
+    so_Table_free(state.table);
+    so_scan_unmap_range(&range);
+    return NULL;
+}
@@ -27,8 +27,11 @@
 #include <pharmml/common_types.h>
 #include <pharmml/string.h>
 #include <so/private/column.h>
+#include <so/private/stats.h>
 #include <so/ExternalFile.h>
 #include <so/private/ExternalFile.h>
+#include <so/private/GroupIndex.h>
+#include <so/private/ReadContext.h>
 
 /** \struct so_Table
 	 \brief A structure representing a table
@@ -50,27 +53,43 @@ so_Table *so_Table_new(void)
 }
 
 /** \memberof so_Table
- * Create a copy of a so_Table structure. 
+ * Create a copy of a so_Table structure. The column data buffers will be shared
+ * between the copy and the source until one of them changes a column. Then only
+ * the affected column will be copied. Copies of the same table can be made from different
+ * threads and the copies can be changed and freed from different threads, but the source
+ * must not be changed while it is being copied.
  * \return A pointer to the Table copy or NULL if memory allocation failed
- * \sa so_Table_new
+ * \sa so_Table_new, so_Table_get_writable_column
  */
 so_Table *so_Table_copy(so_Table *source)
 {
     so_Table *dest = so_Table_new();
     if (dest) {
         dest->numrows = source->numrows;
+        dest->write_external_file = source->write_external_file;
+        if (source->numcols > 0) {
+            dest->columns = malloc(source->numcols * sizeof(so_Column *));
+            if (!dest->columns) {
+                so_Table_free(dest);
+                return NULL;
+            }
+        }
         for (int i = 0; i < source->numcols; i++) {
-            int fail = so_Table_new_column(dest,
-                source->columns[i]->columnId,
-                source->columns[i]->columnType,
-                source->columns[i]->num_columnType,
-                source->columns[i]->valueType,
-                source->columns[i]->column);
-            if (fail) {
+            so_Column *column = so_Column_copy(source->columns[i]);
+            if (!column) {
+                so_Table_free(dest);
+                return NULL;
+            }
+            dest->columns[i] = column;
+            dest->numcols++;
+        }
+        if (source->ExternalFile) {
+            dest->ExternalFile = so_ExternalFile_copy(source->ExternalFile);
+            if (!dest->ExternalFile) {
                 so_Table_free(dest);
                 return NULL;
             }
-        } 
+        }
     }
 
     return dest;
@@ -85,9 +104,20 @@ so_Table *so_Table_copy(so_Table *source)
 void so_Table_free(so_Table *self)
 {
     if (self) {
+        for (int i = 0; i < self->staged_rows; i++) {
+            for (int j = 0; j < self->numcols; j++) {
+                if (self->columns[j]->valueType == PHARMML_VALUETYPE_STRING) {
+                    free(self->staging[i * self->numcols + j].string);
+                }
+            }
+        }
+        free(self->staging);
         for (int i = 0; i < self->numcols; i++) {
             so_Column_free(self->columns[i]);
         }
+        free(self->columns);
+        so_ExternalFile_unref(self->ExternalFile);
+        so_GroupIndex_free(self->group_index);
         free(self);
     }
 }
@@ -125,6 +155,7 @@ void so_Table_unref(so_Table *self)
  */
 void so_Table_set_number_of_rows(so_Table *self, int numrows)
 {
+    so_Table_clear_index(self);
    self->numrows = numrows; 
 }
 
@@ -199,6 +230,7 @@ void so_Table_add_columnType(so_Table *self, int index, pharmml_columnType colum
 {
     if (index < 0 || index >= self->numcols)
         return;
+    so_Table_clear_index(self);
     
     so_Column_add_columnType(self->columns[index], columnType);
 }
@@ -213,6 +245,7 @@ void so_Table_remove_columnType(so_Table *self, int index)
 {
     if (index < 0 || index >= self->numcols)
         return;
+    so_Table_clear_index(self);
     so_Column_remove_columnType(self->columns[index]);
 }
 
@@ -227,6 +260,7 @@ void so_Table_set_valueType(so_Table *self, int index, pharmml_valueType valueTy
 {
     if (index < 0 || index >= self->numcols)
         return;
+    so_Table_clear_index(self);
     
     so_Column_set_valueType(self->columns[index], valueType);
 }
@@ -241,6 +275,7 @@ void so_Table_remove_column(so_Table *self, int index)
     if (index < 0 || index >= self->numcols) {
         return;
     }
+    so_Table_clear_index(self);
 
     so_Column_free(self->columns[index]);
 
@@ -274,27 +309,43 @@ int so_Table_get_number_of_rows(so_Table *self)
 
 /** \memberof so_Table
  * Get pointer to column data from a table given the number of the column.
+ * The data could be shared with copies of the table and must not be changed.
+ * An encoded column is decoded in place. The table must therefore not be used from other
+ * threads during the call, but copies of it sharing the column can be.
  * \param self - pointer to an so_Table
- * \return pointer to the column data array or NULL if column was not found
+ * \return pointer to the column data array or NULL if column was not found or if
+ * memory ran out while decoding the column
+ * \sa so_Table_get_writable_column
  */
 void *so_Table_get_column_from_number(so_Table *self, int number)
 {
     if (number < 0 || number >= self->numcols) {
         return NULL;
     }
+    if (so_Column_decode(self->columns[number])) {
+        return NULL;
+    }
 
     return self->columns[number]->column;
 }
 
 /** \memberof so_Table
  * Get pointer to column data from a table given the columnId of the column.
+ * The data could be shared with copies of the table and must not be changed.
+ * An encoded column is decoded in place. The table must therefore not be used from other
+ * threads during the call, but copies of it sharing the column can be.
  * \param self - pointer to an so_Table
- * \return pointer to the column data array or NULL if column was not found.
+ * \return pointer to the column data array or NULL if column was not found or if
+ * memory ran out while decoding the column
+ * \sa so_Table_get_writable_column
  */
 void *so_Table_get_column_from_name(so_Table *self, char *name)
 {
     for (int i = 0; i < self->numcols; i++) {
         if (strcmp(name, self->columns[i]->columnId) == 0) {
+            if (so_Column_decode(self->columns[i])) {
+                return NULL;
+            }
             return self->columns[i]->column;
         }
     }
@@ -302,6 +353,97 @@ void *so_Table_get_column_from_name(so_Table *self, char *name)
     return NULL;
 }
 
+/** \memberof so_Table
+ * Get pointer to column data that can be changed. If the data is shared with
+ * a copy of the table it will first be copied.
+ * \param self - pointer to an so_Table
+ * \param number - the number of the column
+ * \return pointer to the column data array or NULL if column was not found or memory allocation failed
+ * \sa so_Table_get_column_from_number
+ */
+void *so_Table_get_writable_column(so_Table *self, int number)
+{
+    if (number < 0 || number >= self->numcols) {
+        return NULL;
+    }
+    so_Table_clear_index(self);
+
+    if (so_Column_decode(self->columns[number]) || so_Column_make_writable(self->columns[number])) {
+        return NULL;
+    }
+
+    return self->columns[number]->column;
+}
+
+/** \memberof so_Table
+ * Get the encoding of the data of a column. Encoded columns are decoded when their data is
+ * accessed with so_Table_get_column_from_number or so_Table_get_column_from_name.
+ * \param self - pointer to an so_Table
+ * \param number - the number of the column
+ * \return The encoding of the column. SO_COLUMN_PLAIN if the column does not exist.
+ * \sa so_Table_encode_columns, so_Table_next_run
+ */
+so_ColumnEncoding so_Table_get_encoding(so_Table *self, int number)
+{
+    if (number < 0 || number >= self->numcols) {
+        return SO_COLUMN_PLAIN;
+    }
+    return self->columns[number]->encoding;
+}
+
+/** \memberof so_Table
+ * Store columns with a constant or run-length encoding if this saves at least half of the memory.
+ * This is done automatically when a table is read.
+ * \param self - pointer to an so_Table
+ * \return 0 for success
+ * \sa so_Table_get_encoding
+ */
+int so_Table_encode_columns(so_Table *self)
+{
+    for (int i = 0; i < self->numcols; i++) {
+        if (so_Column_encode(self->columns[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** \memberof so_Table
+ * Store the plain real columns of a table with less precision. The columns are widened
+ * to double again when their data is accessed.
+ * \param self - pointer to an so_Table
+ * \param storage - SO_REAL_FLOAT32 or SO_REAL_SCALED_INT32
+ * \param decimals - the number of decimals to keep for SO_REAL_SCALED_INT32. Columns with large values keep fewer.
+ * \return 0 for success
+ * \sa so_ReadContext_set_real_storage, so_Table_get_encoding
+ */
+int so_Table_narrow_real_columns(so_Table *self, so_RealStorage storage, int decimals)
+{
+    for (int i = 0; i < self->numcols; i++) {
+        if (so_Column_narrow(self->columns[i], storage, decimals)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** \memberof so_Table
+ * Iterate over the runs of equal values of a column without decoding it. A plain column
+ * has one run per row. The iteration starts from a run initialized with SO_COLUMN_RUN_INIT.
+ * \param self - pointer to an so_Table
+ * \param number - the number of the column
+ * \param run - pointer to the previous run. Will be updated to the next run.
+ * \return 1 if run was updated or 0 if there were no more runs
+ * \sa so_Table_get_encoding
+ */
+int so_Table_next_run(so_Table *self, int number, so_ColumnRun *run)
+{
+    if (number < 0 || number >= self->numcols) {
+        return 0;
+    }
+    return so_Column_next_run(self->columns[number], run);
+}
+
 /** \memberof so_Table
  *  Get the index of a column from its columnId
  *  \param self - pointer to an so_Table
@@ -331,6 +473,8 @@ int so_Table_get_index_from_name(so_Table *self, char *name)
  */
 int so_Table_new_column(so_Table *self, char *columnId, pharmml_columnType *columnTypes, int num_columnTypes, pharmml_valueType valueType, void *data)
 {
+    so_Table_clear_index(self);
+
     int element_size = pharmml_valueType_to_size(valueType);
 
     void *buffer = malloc(element_size * self->numrows);
@@ -358,6 +502,9 @@ int so_Table_new_column(so_Table *self, char *columnId, pharmml_columnType *colu
     }
     so_Column_set_columnId(column, columnId);
     column->column = buffer;
+    column->len = self->numrows;
+    column->used_memory = element_size * self->numrows;
+    column->alloced_memory = column->used_memory;
 
     so_Column **column_array = realloc(self->columns, (self->numcols + 1) * sizeof(so_Column *)); 
     if (!column_array) {
@@ -374,6 +521,7 @@ int so_Table_new_column(so_Table *self, char *columnId, pharmml_columnType *colu
 
 /** \memberof so_Table
  * Create a new column and add to table. Only the pointer to the data will be copied
+ * and the table takes ownership of the data. If the call fails the data is not taken.
  * \param self - pointer to an so_Table
  * \param columnId - name of column
  * \param columnType - type of column
@@ -384,6 +532,8 @@ int so_Table_new_column(so_Table *self, char *columnId, pharmml_columnType *colu
  */
 int so_Table_new_column_no_copy(so_Table *self, char *columnId, pharmml_columnType *columnTypes, int num_columnTypes, pharmml_valueType valueType, void *data)
 {
+    so_Table_clear_index(self);
+
     so_Column *column = so_Column_new();
     if (!column) {
         return 1;
@@ -396,12 +546,17 @@ int so_Table_new_column_no_copy(so_Table *self, char *columnId, pharmml_columnTy
         so_Column_free(column);
         return 1;
     }
-    column->column = data;
     so_Column **new_columns = realloc(self->columns, (self->numcols + 1) * sizeof(so_Column *));
     if (!new_columns) {
         so_Column_free(column);
         return 1;
     }
+    column->column = data;
+    if (data) {
+        column->len = self->numrows;
+        column->used_memory = pharmml_valueType_to_size(valueType) * self->numrows;
+        column->alloced_memory = column->used_memory;
+    }
     self->columns = new_columns;
     self->columns[self->numcols] = column;
     self->numcols++;
@@ -442,6 +597,57 @@ char *so_Table_id_column_name(so_Table *self)
     }
 }
 
+/** \memberof so_Table
+ * Get an index of the rows of the table grouped by the ID column. The index is built
+ * the first time it is requested and is then kept by the table until the table is changed.
+ * It must not be freed by the caller.
+ * \param self - pointer to an so_Table
+ * \return A pointer to the so_GroupIndex or NULL if the table has no string or int ID column
+ * or memory allocation failed
+ * \sa so_Table_id_column
+ */
+so_GroupIndex *so_Table_group_index(so_Table *self)
+{
+    if (self->group_index) {
+        return self->group_index;
+    }
+
+    int id_column = so_Table_id_column(self);
+    if (id_column == -1) {
+        return NULL;
+    }
+    so_Column *column = self->columns[id_column];
+    if (so_Column_decode(column)) {
+        return NULL;
+    }
+
+    if (column->valueType == PHARMML_VALUETYPE_STRING) {
+        self->group_index = so_GroupIndex_new(self->numrows, (char **) column->column);
+    } else if (column->valueType == PHARMML_VALUETYPE_INT) {
+        char **ids = calloc(self->numrows + 1, sizeof(char *));
+        if (!ids) {
+            return NULL;
+        }
+        for (int i = 0; i < self->numrows; i++) {
+            ids[i] = pharmml_int_to_string(((int *) column->column)[i]);
+            if (!ids[i]) {
+                pharmml_free_string_array(ids, i);
+                return NULL;
+            }
+        }
+        self->group_index = so_GroupIndex_new(self->numrows, ids);
+        pharmml_free_string_array(ids, self->numrows);
+    }
+
+    return self->group_index;
+}
+
+void so_Table_clear_index(so_Table *self)
+{
+    so_GroupIndex_free(self->group_index);
+    self->group_index = NULL;
+}
+
 /** \memberof so_Table
  * Get column index of the idv column
  * \param self - pointer to an so_Table
@@ -533,25 +739,173 @@ void so_Table_set_write_external_file(so_Table *self, int write_external_file)
     self->write_external_file = write_external_file;
 }
 
-int so_Table_xml(so_Table *self, xmlTextWriterPtr writer, char *element_name)
+// Write the rows of a table as a ds:Table element
+// Write one cell. The value points to a double, int, char * or bool depending on the valueType
+int so_Table_xml_cell(xmlTextWriterPtr writer, pharmml_valueType valueType, void *value)
+{
+    int rc = 0;
+    char *value_string;
+
+    so_stats_count_cell(valueType);
+    if (valueType == PHARMML_VALUETYPE_REAL) {
+        double number = *(double *) value;
+        char *special_string = NULL;
+        if (pharmml_is_na(number)) {
+            special_string = "ct:NA";
+        } else if (isnan(number)) {
+            special_string = "ct:NaN";
+        } else if (isinf(number)) {
+            if (number > 0) {
+                special_string = "ct:plusInf";
+            } else {
+                special_string = "ct:minusInf";
+            }
+        }
+        if (special_string) {
+            rc = xmlTextWriterWriteElement(writer, BAD_CAST special_string, NULL);
+            so_stats_count_element(special_string);
+        } else {
+            value_string = so_stats_double_to_string(number);
+            if (!value_string) return 1;
+            rc = xmlTextWriterWriteElement(writer, BAD_CAST pharmml_valueType_to_element(valueType), BAD_CAST value_string);
+            so_stats_count_element(pharmml_valueType_to_element(valueType));
+            free(value_string);
+        }
+    } else if (valueType == PHARMML_VALUETYPE_INT) {
+        value_string = so_stats_int_to_string(*(int *) value);
+        if (!value_string) return 1;
+        rc = xmlTextWriterWriteElement(writer, BAD_CAST pharmml_valueType_to_element(valueType), BAD_CAST value_string);
+        so_stats_count_element(pharmml_valueType_to_element(valueType));
+        free(value_string);
+    } else if (valueType == PHARMML_VALUETYPE_STRING || valueType == PHARMML_VALUETYPE_ID) {
+        value_string = *(char **) value;
+        rc = xmlTextWriterWriteElement(writer, BAD_CAST pharmml_valueType_to_element(valueType), BAD_CAST value_string);
+        so_stats_count_element(pharmml_valueType_to_element(valueType));
+        so_stats_count_string(strlen(value_string));
+    } else if (valueType == PHARMML_VALUETYPE_BOOLEAN) {
+        if (*(bool *) value) {
+            rc = xmlTextWriterWriteElement(writer, BAD_CAST "ct:True", NULL);
+            so_stats_count_element("ct:True");
+        } else {
+            rc = xmlTextWriterWriteElement(writer, BAD_CAST "ct:False", NULL);
+            so_stats_count_element("ct:False");
+        }
+    }
+    if (rc < 0) return 1;
+
+    return 0;
+}
+
+static int so_Table_xml_rows(so_Table *self, xmlTextWriterPtr writer, so_ColumnRun *runs)
+{
+    int rc;
+
+    rc = xmlTextWriterStartElement(writer, BAD_CAST "ds:Table");
+    if (rc < 0) return 1;
+    so_stats_count_element("ds:Table");
+    for (int i = 0; i < self->numrows; i++) {
+        rc = xmlTextWriterStartElement(writer, BAD_CAST "ds:Row");
+        if (rc < 0) return 1;
+        so_stats_count_element("ds:Row");
+        for (int j = 0; j < self->numcols; j++) {
+            void *value = so_Column_run_cell(self->columns[j], &runs[j], i);
+            rc = so_Table_xml_cell(writer, self->columns[j]->valueType, value);
+            if (rc) return rc;
+        }
+        rc = xmlTextWriterEndElement(writer);
+        if (rc < 0) return 1;
+    }
+    rc = xmlTextWriterEndElement(writer);
+    if (rc < 0) return 1;
+
+    return 0;
+}
+
+// Write the rows of a table into its external file
+static int so_Table_write_external_rows(so_Table *self, so_ColumnRun *runs)
+{
+    char *delimiter_string = " ";
+    if (strcmp(self->ExternalFile->delimiter, "COMMA") == 0) {
+        delimiter_string = ",";
+    } else if (strcmp(self->ExternalFile->delimiter, "SPACE") == 0) {
+        delimiter_string = " ";
+    } else if (strcmp(self->ExternalFile->delimiter, "TAB")  == 0) {
+        delimiter_string = "\t";
+    } else if (strcmp(self->ExternalFile->delimiter, "SEMICOLON") == 0) {
+        delimiter_string = ";";
+    }
+    FILE *fp = fopen(self->ExternalFile->path, "w");
+
+    for (int i = 0; i < self->numrows; i++) {
+        for (int j = 0; j < self->numcols; j++) {
+            char *value_string = "";
+            if (self->columns[j]->valueType == PHARMML_VALUETYPE_REAL) {
+                double *ptr = (double *) so_Column_run_cell(self->columns[j], &runs[j], i);
+                value_string = pharmml_double_to_string(*ptr);
+                if (!value_string) return 1;
+            } else if (self->columns[j]->valueType == PHARMML_VALUETYPE_INT) {
+                int *ptr = (int *) so_Column_run_cell(self->columns[j], &runs[j], i);
+                value_string = pharmml_int_to_string(*ptr);
+                if (!value_string) return 1;
+            } else if (self->columns[j]->valueType == PHARMML_VALUETYPE_STRING || self->columns[j]->valueType == PHARMML_VALUETYPE_ID) {
+                char **ptr = (char **) so_Column_run_cell(self->columns[j], &runs[j], i);
+                value_string = *ptr;
+            } else if (self->columns[j]->valueType == PHARMML_VALUETYPE_BOOLEAN) {
+                bool *ptr = (bool *) so_Column_run_cell(self->columns[j], &runs[j], i);
+                if (*ptr) {
+                    value_string = "True";
+                } else {
+                    value_string = "False";
+                }
+            }
+
+            fprintf(fp, "%s", value_string);
+            if (j != self->numcols - 1) {
+                fprintf(fp, "%s", delimiter_string);
+            }
+
+            if (self->columns[j]->valueType == PHARMML_VALUETYPE_REAL || self->columns[j]->valueType == PHARMML_VALUETYPE_INT) {
+                free(value_string);
+            }
+        }
+        fprintf(fp, "\n");
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
+// Start the table element and write the attributes of the superclass
+int so_Table_xml_start(so_Table *self, xmlTextWriterPtr writer, char *element_name)
 {
     int rc;
     rc = xmlTextWriterStartElement(writer, BAD_CAST element_name);
     if (rc < 0) return 1;
+    so_stats_start_element(element_name);
 
     if (self->superclass_func) {
        rc = (*(self->superclass_func))(self->superclass, writer);
        if (rc != 0) return rc;
     }
 
+    return 0;
+}
+
+// Write the definition of the columns
+int so_Table_xml_definition(so_Table *self, xmlTextWriterPtr writer)
+{
+    int rc;
     char temp_colnum[12];
 
     if (self->numcols > 0) {
         rc = xmlTextWriterStartElement(writer, BAD_CAST "ds:Definition");
         if (rc < 0) return 1;
+        so_stats_count_element("ds:Definition");
         for (int i = 0; i < self->numcols; i++) {
             rc = xmlTextWriterStartElement(writer, BAD_CAST "ds:Column");
             if (rc < 0) return 1;
+            so_stats_count_element("ds:Column");
             rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "columnId", BAD_CAST self->columns[i]->columnId);
             if (rc < 0) return 1;
             char *columnType_string = pharmml_columnType_array_to_string(self->columns[i]->columnType, self->columns[i]->num_columnType);
@@ -571,124 +925,171 @@ int so_Table_xml(so_Table *self, xmlTextWriterPtr writer, char *element_name)
         if (rc < 0) return 1;
     }
 
+    return 0;
+}
+
+int so_Table_xml(so_Table *self, xmlTextWriterPtr writer, char *element_name)
+{
+    int rc = so_Table_xml_start(self, writer, element_name);
+    if (rc) return rc;
+    rc = so_Table_xml_definition(self, writer);
+    if (rc) return rc;
+
+    // The cells are visited through the runs of the columns so that encoded columns need not be decoded
+    so_ColumnRun *runs = malloc((self->numcols + 1) * sizeof(so_ColumnRun));
+    if (!runs) return 1;
+    so_ColumnRun first = SO_COLUMN_RUN_INIT;
+    for (int j = 0; j < self->numcols; j++) {
+        runs[j] = first;
+    }
+
     if (!self->ExternalFile) {
-        rc = xmlTextWriterStartElement(writer, BAD_CAST "ds:Table");
-        if (rc < 0) return 1;
-        for (int i = 0; i < self->numrows; i++) {
-            rc = xmlTextWriterStartElement(writer, BAD_CAST "ds:Row");
-            for (int j = 0; j < self->numcols; j++) {
-                char *value_string;
-                char *special_string = NULL;
-                if (self->columns[j]->valueType == PHARMML_VALUETYPE_REAL) {
-                    double *ptr = (double *) self->columns[j]->column;
-                    double number = ptr[i];
-                    if (pharmml_is_na(number)) {
-                        special_string = "ct:NA";
-                    } else if (isnan(number)) {
-                        special_string = "ct:NaN";
-                    } else if (isinf(number)) {
-                        if (number > 0) {
-                            special_string = "ct:plusInf";
-                        } else {
-                            special_string = "ct:minusInf";
+        rc = so_Table_xml_rows(self, writer, runs);
+    } else {
+        rc = so_ExternalFile_xml(self->ExternalFile, writer, "ds:ExternalFile");
+        if (!rc && self->write_external_file) {
+            rc = so_Table_write_external_rows(self, runs);
+        }
+    }
+    free(runs);
+    if (rc) return rc;
+
+    rc = xmlTextWriterEndElement(writer);
+    if (rc < 0) return 1;
+    so_stats_end_element();
+
+    return 0;
+}
+
+static int so_Table_stageable_valueType(pharmml_valueType valueType)
+{
+    return valueType == PHARMML_VALUETYPE_REAL || valueType == PHARMML_VALUETYPE_INT ||
+        valueType == PHARMML_VALUETYPE_STRING || valueType == PHARMML_VALUETYPE_BOOLEAN;
+}
+
+// Transpose all staged rows into the column buffers. The column buffers already
+// have room for the rows. The rows are handled in tiles so that the part of the staging
+// block being read stays in cache while each column is written. The staged strings are
+// owned by the staging block until all rows are in the columns so nothing is lost if
+// creating an empty string for a missing cell fails.
+static int so_Table_flush_staging(so_Table *table)
+{
+    int numcols = table->numcols;
+    int rows = table->staged_rows;
+
+    for (int tile_start = 0; tile_start < rows; tile_start += SO_TABLE_TRANSPOSE_TILE) {
+        int tile_end = tile_start + SO_TABLE_TRANSPOSE_TILE;
+        if (tile_end > rows) {
+            tile_end = rows;
+        }
+        for (int j = 0; j < numcols; j++) {
+            so_Column *column = table->columns[j];
+            so_TableCell *cells = table->staging + j;
+            if (column->valueType == PHARMML_VALUETYPE_REAL) {
+                double *dest = (double *) column->column + column->len;
+                for (int i = tile_start; i < tile_end; i++) {
+                    dest[i] = cells[i * numcols].real;
+                }
+            } else if (column->valueType == PHARMML_VALUETYPE_INT) {
+                int *dest = (int *) column->column + column->len;
+                for (int i = tile_start; i < tile_end; i++) {
+                    dest[i] = cells[i * numcols].integer;
+                }
+            } else if (column->valueType == PHARMML_VALUETYPE_STRING) {
+                char **dest = (char **) column->column + column->len;
+                for (int i = tile_start; i < tile_end; i++) {
+                    if (!cells[i * numcols].string) {
+                        cells[i * numcols].string = pharmml_strdup("");
+                        if (!cells[i * numcols].string) {
+                            return 1;
                         }
-                    } else {
-                        value_string = pharmml_double_to_string(number);
-                        if (!value_string) return 1;
-                    }
-                    if (special_string) {
-                        rc = xmlTextWriterWriteElement(writer, BAD_CAST special_string, NULL);
-                    } else {
-                        rc = xmlTextWriterWriteElement(writer, BAD_CAST pharmml_valueType_to_element(self->columns[j]->valueType), BAD_CAST value_string);
-                        free(value_string);
-                    }
-                } else if (self->columns[j]->valueType == PHARMML_VALUETYPE_INT) {
-                    int *ptr = (int *) self->columns[j]->column;
-                    value_string = pharmml_int_to_string(ptr[i]);
-                    if (!value_string) return 1;
-                    rc = xmlTextWriterWriteElement(writer, BAD_CAST pharmml_valueType_to_element(self->columns[j]->valueType), BAD_CAST value_string);
-                    free(value_string);
-                } else if (self->columns[j]->valueType == PHARMML_VALUETYPE_STRING || self->columns[j]->valueType == PHARMML_VALUETYPE_ID) {
-                    char **ptr = (char **) self->columns[j]->column;
-                    value_string = ptr[i];
-                    rc = xmlTextWriterWriteElement(writer, BAD_CAST pharmml_valueType_to_element(self->columns[j]->valueType), BAD_CAST value_string);
-                } else if (self->columns[j]->valueType == PHARMML_VALUETYPE_BOOLEAN) {
-                    bool *ptr = (bool *) self->columns[j]->column;
-                    if (ptr[i]) {
-                        rc = xmlTextWriterWriteElement(writer, BAD_CAST "ct:True", NULL);
-                    } else {
-                        rc = xmlTextWriterWriteElement(writer, BAD_CAST "ct:False", NULL);
                     }
+                    dest[i] = cells[i * numcols].string;
+                }
+            } else if (column->valueType == PHARMML_VALUETYPE_BOOLEAN) {
+                bool *dest = (bool *) column->column + column->len;
+                for (int i = tile_start; i < tile_end; i++) {
+                    dest[i] = cells[i * numcols].boolean;
                 }
-                if (rc < 0) return 1;
             }
-            rc = xmlTextWriterEndElement(writer);
-            if (rc < 0) return 1;
         }
-        rc = xmlTextWriterEndElement(writer);
-        if (rc < 0) return 1;
-    } else {
-        rc = so_ExternalFile_xml(self->ExternalFile, writer, "ds:ExternalFile");
-        if (rc) return rc;
-
-        if (self->write_external_file) {
-            char *delimiter_string = " ";
-            if (strcmp(self->ExternalFile->delimiter, "COMMA") == 0) {
-                delimiter_string = ",";
-            } else if (strcmp(self->ExternalFile->delimiter, "SPACE") == 0) {
-                delimiter_string = " ";
-            } else if (strcmp(self->ExternalFile->delimiter, "TAB")  == 0) {
-                delimiter_string = "\t";
-            } else if (strcmp(self->ExternalFile->delimiter, "SEMICOLON") == 0) {
-                delimiter_string = ";";
-            }
-            FILE *fp = fopen(self->ExternalFile->path, "w");
-
-            for (int i = 0; i < self->numrows; i++) {
-                for (int j = 0; j < self->numcols; j++) {
-                    char *value_string = "";
-                    if (self->columns[j]->valueType == PHARMML_VALUETYPE_REAL) {
-                        double *ptr = (double *) self->columns[j]->column;
-                        value_string = pharmml_double_to_string(ptr[i]);
-                        if (!value_string) return 1;
-                    } else if (self->columns[j]->valueType == PHARMML_VALUETYPE_INT) {
-                        int *ptr = (int *) self->columns[j]->column;
-                        value_string = pharmml_int_to_string(ptr[i]);
-                        if (!value_string) return 1;
-                    } else if (self->columns[j]->valueType == PHARMML_VALUETYPE_STRING || self->columns[j]->valueType == PHARMML_VALUETYPE_ID) {
-                        char **ptr = (char **) self->columns[j]->column;
-                        value_string = ptr[i];
-                    } else if (self->columns[j]->valueType == PHARMML_VALUETYPE_BOOLEAN) {
-                        bool *ptr = (bool *) self->columns[j]->column;
-                        if (ptr[i]) {
-                            value_string = "True";
-                        } else {
-                            value_string = "False";
-                        }
-                    }
+    }
 
-                    fprintf(fp, "%s", value_string);
-                    if (j != self->numcols - 1) {
-                        fprintf(fp, "%s", delimiter_string);
-                    }
+    for (int j = 0; j < numcols; j++) {
+        so_Column *column = table->columns[j];
+        if (so_Table_stageable_valueType(column->valueType)) {
+            column->len += rows;
+            column->used_memory = column->len * pharmml_valueType_to_size(column->valueType);
+        }
+    }
 
-                    if (self->columns[j]->valueType == PHARMML_VALUETYPE_REAL || self->columns[j]->valueType == PHARMML_VALUETYPE_INT) {
-                        free(value_string);
-                    }
+    table->staged_rows = 0;
+    so_Table_clear_index(table);
+    return 0;
+}
+
+// Start a new row in the staging block. Flush the block to the columns if it is full and
+// make room in the columns for a full new block when starting to fill it.
+static int so_Table_stage_row(so_Table *table)
+{
+    int numcols = table->numcols;
+
+    if (!table->staging && numcols > 0) {
+        table->staging = malloc(SO_TABLE_STAGING_ROWS * numcols * sizeof(so_TableCell));
+        if (!table->staging) {
+            return 1;
+        }
+    }
+
+    if (table->staged_rows == SO_TABLE_STAGING_ROWS && so_Table_flush_staging(table)) {
+        return 1;
+    }
+
+    if (table->staged_rows == 0) {
+        for (int j = 0; j < numcols; j++) {
+            if (so_Table_stageable_valueType(table->columns[j]->valueType)) {
+                if (so_Column_reserve(table->columns[j], SO_TABLE_STAGING_ROWS)) {
+                    return 1;
                 }
-                fprintf(fp, "\n");
             }
-
-            fclose(fp);
         }
     }
 
-    rc = xmlTextWriterEndElement(writer);
-    if (rc < 0) return 1;
+    // Cells that are missing in the row will get default values
+    for (int j = 0; j < numcols; j++) {
+        so_TableCell *row = table->staging + table->staged_rows * numcols;
+        pharmml_valueType valueType = table->columns[j]->valueType;
+        if (valueType == PHARMML_VALUETYPE_REAL) {
+            row[j].real = pharmml_na();
+        } else if (valueType == PHARMML_VALUETYPE_INT) {
+            row[j].integer = 0;
+        } else if (valueType == PHARMML_VALUETYPE_BOOLEAN) {
+            row[j].boolean = false;
+        } else {
+            row[j].string = NULL;
+        }
+    }
+    table->staged_rows++;
 
     return 0;
 }
 
+// Get the staging cell for the next column of the current row
+static so_TableCell *so_Table_next_cell(so_Table *table, pharmml_valueType valueType)
+{
+    if (table->current_column >= table->numcols || table->staged_rows == 0) {   // Too many columns in this SO
+        return NULL;
+    }
+    if (table->columns[table->current_column]->valueType != valueType) {
+        return NULL;
+    }
+    so_stats_count_cell(valueType);
+
+    so_TableCell *cell = table->staging + (table->staged_rows - 1) * table->numcols + table->current_column;
+    table->current_column++;
+    return cell;
+}
+
 int so_Table_start_element(so_Table *table, const char *localname, int nb_attributes, const char **attributes)
 {
     if (table->in_externalfile) {
@@ -754,85 +1155,98 @@ int so_Table_start_element(so_Table *table, const char *localname, int nb_attrib
         table->columns[table->numcols] = col;
         table->numcols++;
     } else if (table->in_table && strcmp("Row", localname) == 0) {
+        if (so_Table_stage_row(table)) {
+            return 1;
+        }
         table->numrows++;
         table->current_column = 0;
         table->in_row = 1;
     } else if (table->in_row && strcmp("Real", localname) == 0) {
         if (!table->defer_reading) {
+            if (!so_Table_next_cell(table, PHARMML_VALUETYPE_REAL)) {
+                return 1;
+            }
             table->in_real = 1;
-            table->current_column++;
         }
     } else if (table->in_row && strcmp("Int", localname) == 0) {
         if (!table->defer_reading) {
+            if (!so_Table_next_cell(table, PHARMML_VALUETYPE_INT)) {
+                return 1;
+            }
             table->in_int = 1;
-            table->current_column++;
         }
     } else if ((table->in_row && (strcmp("String", localname) == 0)) || (strcmp("Id", localname) == 0)) {
         if (!table->defer_reading) {
+            if (!so_Table_next_cell(table, PHARMML_VALUETYPE_STRING)) {
+                return 1;
+            }
             table->in_string = 1;
-            table->current_column++;
         }
     } else if (table->in_row && strcmp("True", localname) == 0) {
         if (!table->defer_reading) {
-            so_Column *column = table->columns[table->current_column];
-            int fail = so_Column_add_boolean(column, 1);
-            if (fail) {
+            so_TableCell *cell = so_Table_next_cell(table, PHARMML_VALUETYPE_BOOLEAN);
+            if (!cell) {
                 return 1;
             }
-            table->current_column++;
+            cell->boolean = true;
         }
     } else if (table->in_row && strcmp("False", localname) == 0) {
         if (!table->defer_reading) {
-            so_Column *column = table->columns[table->current_column];
-            int fail = so_Column_add_boolean(column, 0);
-            if (fail) {
+            so_TableCell *cell = so_Table_next_cell(table, PHARMML_VALUETYPE_BOOLEAN);
+            if (!cell) {
                 return 1;
             }
-            table->current_column++;
+            cell->boolean = false;
         }
     } else if (table->in_row && strcmp("plusInf", localname) == 0) {
-        so_Column *column = table->columns[table->current_column];
-        table->current_column++;
-        int fail = so_Column_add_real(column, INFINITY);
-        if (fail) {
+        so_TableCell *cell = so_Table_next_cell(table, PHARMML_VALUETYPE_REAL);
+        if (!cell) {
             return 1;
         }
+        cell->real = INFINITY;
     } else if (table->in_row && strcmp("minusInf", localname) == 0) {
-        so_Column *column = table->columns[table->current_column];
-        table->current_column++;
-        int fail = so_Column_add_real(column, -INFINITY);
-        if (fail) {
+        so_TableCell *cell = so_Table_next_cell(table, PHARMML_VALUETYPE_REAL);
+        if (!cell) {
             return 1;
         }
+        cell->real = -INFINITY;
     } else if (table->in_row && strcmp("NA", localname) == 0) {
-        so_Column *column = table->columns[table->current_column];
-        table->current_column++;
-        int fail = so_Column_add_real(column, pharmml_na());
-        if (fail) {
+        so_TableCell *cell = so_Table_next_cell(table, PHARMML_VALUETYPE_REAL);
+        if (!cell) {
             return 1;
         }
+        cell->real = pharmml_na();
     } else if (table->in_row && strcmp("NaN", localname) == 0) {
-        so_Column *column = table->columns[table->current_column];
-        table->current_column++;
-        int fail = so_Column_add_real(column, pharmml_nan());
-        if (fail) {
+        so_TableCell *cell = so_Table_next_cell(table, PHARMML_VALUETYPE_REAL);
+        if (!cell) {
             return 1;
         }
+        cell->real = pharmml_nan();
     }
 
     return 0;
 }
 
-void so_Table_end_element(so_Table *table, const char *localname)
+int so_Table_end_element(so_Table *table, const char *localname)
 {
     if (strcmp(localname, "ExternalFile") == 0 && table->in_externalfile) {
        table->in_externalfile = 0; 
     } else if (table->in_externalfile) {
-        so_ExternalFile_end_element(table->ExternalFile, localname);
+        return so_ExternalFile_end_element(table->ExternalFile, localname);
     } else if (strcmp("Definition", localname) == 0) {
         table->in_definition = 0;
     } else if (strcmp("Table", localname) == 0) {
         table->in_table = 0;
+        if (so_Table_flush_staging(table)) {
+            return 1;       // The staged rows are freed with the table
+        }
+        free(table->staging);
+        table->staging = NULL;
+        so_Table_encode_columns(table);     // The columns are left plain if encoding fails
+        so_ReadContext *context = so_ReadContext_current;
+        if (context && context->real_storage != SO_REAL_DOUBLE && table->numrows >= context->real_min_rows) {
+            so_Table_narrow_real_columns(table, context->real_storage, context->real_decimals);
+        }
     } else if (strcmp("Row", localname) == 0) {
         table->in_row = 0;
     } else if (strcmp("Real", localname) == 0) {
@@ -842,6 +1256,8 @@ void so_Table_end_element(so_Table *table, const char *localname)
     } else if ((strcmp("String", localname) == 0) || (strcmp("Id", localname) == 0)) {
         table->in_string = 0;
     }
+
+    return 0;
 }
 
 int so_Table_characters(so_Table *table, const char *ch, int len)
@@ -853,30 +1269,37 @@ int so_Table_characters(so_Table *table, const char *ch, int len)
 		if (fail) return 1;
     }
 
-    so_Column *column;
-
-    char *str = (char *) ch;
-    char saved = str[len];
-
     if (table->in_real || table->in_int || table->in_string) {
-        if (table->current_column - 1 >= table->numcols) {   // Too many columns in this SO
-            return 1;
-        }
-        column = table->columns[table->current_column - 1];
-        str[len] = '\0';
-
-        if (table->in_real) {
-            double real = pharmml_string_to_double(str);
-            fail = so_Column_add_real(column, real);
-        } else if (table->in_int) {
-            int integer = pharmml_string_to_int(str);
-            fail = so_Column_add_int(column, integer);
-        } else if (table->in_string) {
-            fail = so_Column_add_string(column, str);
+        so_TableCell *cell = table->staging + (table->staged_rows - 1) * table->numcols + table->current_column - 1;
+        char *str = (char *) ch;
+
+        if (table->in_string) {
+            // The characters of a string can come in more than one chunk
+            if (!cell->string) {
+                cell->string = pharmml_strndup(str, len);
+                fail = !cell->string;
+            } else {
+                size_t old_len = strlen(cell->string);
+                char *new_string = realloc(cell->string, old_len + len + 1);
+                if (new_string) {
+                    memcpy(new_string + old_len, str, len);
+                    new_string[old_len + len] = '\0';
+                    cell->string = new_string;
+                    so_stats_count_string(len);
+                } else {
+                    fail = 1;
+                }
+            }
+        } else {
+            char saved = str[len];
+            str[len] = '\0';
+            if (table->in_real) {
+                cell->real = so_stats_string_to_double(str);
+            } else {
+                cell->integer = so_stats_string_to_int(str);
+            }
+            str[len] = saved;
         }
-
-        str[len] = saved;
-
     }
 
     return fail;
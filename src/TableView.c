@@ -0,0 +1,221 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <so/Table.h>
+#include <so/TableView.h>
+#include <so/private/Table.h>
+#include <so/private/TableView.h>
+#include <pharmml/common_types.h>
+#include <pharmml/string.h>
+
+/** \struct so_TableView
+	 \brief A selection and ordering of the rows of an so_Table without copying the data
+
+    The view keeps a reference to the table so the table stays alive as long as the view.
+    Changing the number of rows of the table will invalidate the view.
+*/
+
+/** \memberof so_TableView
+ * Create a new view of a table
+ * \param table - pointer to the so_Table to view
+ * \param rows - array of the row numbers in the table of the rows of the view. Will be copied.
+ * \param numrows - number of rows in the view
+ * \return A pointer to the newly created struct or NULL if a row number is outside the table
+ * or memory allocation failed
+ * \sa so_TableView_free, so_Table_sorted_view
+ */
+so_TableView *so_TableView_new(so_Table *table, int *rows, int numrows)
+{
+    for (int i = 0; i < numrows; i++) {
+        if (rows[i] < 0 || rows[i] >= table->numrows) {
+            return NULL;
+        }
+    }
+
+    so_TableView *view = calloc(sizeof(so_TableView), 1);
+    if (!view) {
+        return NULL;
+    }
+    view->rows = malloc((numrows + 1) * sizeof(int));
+    if (!view->rows) {
+        free(view);
+        return NULL;
+    }
+    memcpy(view->rows, rows, numrows * sizeof(int));
+    view->numrows = numrows;
+    view->table = table;
+    so_Table_ref(table);
+
+    return view;
+}
+
+/** \memberof so_TableView
+ * Free all memory associated with an so_TableView and release its reference to the table
+ * \param self - a pointer to the structure to free
+ * \sa so_TableView_new
+ */
+void so_TableView_free(so_TableView *self)
+{
+    if (self) {
+        so_Table_unref(self->table);
+        free(self->rows);
+        free(self);
+    }
+}
+
+/** \memberof so_TableView
+ * Get the table of a view
+ * \param self - pointer to an so_TableView
+ * \return A pointer to the so_Table
+ */
+so_Table *so_TableView_get_table(so_TableView *self)
+{
+    return self->table;
+}
+
+/** \memberof so_TableView
+ * Get the number of rows in a view
+ * \param self - pointer to an so_TableView
+ * \return The number of rows
+ */
+int so_TableView_get_number_of_rows(so_TableView *self)
+{
+    return self->numrows;
+}
+
+/** \memberof so_TableView
+ * Get the row numbers in the table of the rows of the view
+ * \param self - pointer to an so_TableView
+ * \return Pointer to the array of row numbers
+ */
+int *so_TableView_get_rows(so_TableView *self)
+{
+    return self->rows;
+}
+
+/** \memberof so_TableView
+ * Copy the values of a column in view order into a buffer supplied by the caller.
+ * For string columns the pointers are copied and will point to the strings of the table.
+ * \param self - pointer to an so_TableView
+ * \param column - index of the column in the table
+ * \param dest - buffer with room for the number of rows of the view of the column valueType
+ * \return 0 for success
+ * \sa so_TableView_materialize
+ */
+int so_TableView_gather_column(so_TableView *self, int column, void *dest)
+{
+    so_Table *table = self->table;
+    if (column < 0 || column >= table->numcols) {
+        return 1;
+    }
+    so_Column *col = table->columns[column];
+    if (so_Column_decode(col)) {
+        return 1;
+    }
+
+    if (col->valueType == PHARMML_VALUETYPE_REAL) {
+        double *src = (double *) col->column;
+        for (int i = 0; i < self->numrows; i++) {
+            ((double *) dest)[i] = src[self->rows[i]];
+        }
+    } else if (col->valueType == PHARMML_VALUETYPE_INT) {
+        int *src = (int *) col->column;
+        for (int i = 0; i < self->numrows; i++) {
+            ((int *) dest)[i] = src[self->rows[i]];
+        }
+    } else if (col->valueType == PHARMML_VALUETYPE_BOOLEAN) {
+        bool *src = (bool *) col->column;
+        for (int i = 0; i < self->numrows; i++) {
+            ((bool *) dest)[i] = src[self->rows[i]];
+        }
+    } else {
+        char **src = (char **) col->column;
+        for (int i = 0; i < self->numrows; i++) {
+            ((char **) dest)[i] = src[self->rows[i]];
+        }
+    }
+
+    return 0;
+}
+
+// Create a new table with the rows of a view and the given columns (or all if columns is NULL)
+so_Table *so_TableView_project(so_TableView *self, int *columns, int num_columns)
+{
+    so_Table *source = self->table;
+    so_Table *table = so_Table_new();
+    if (!table) {
+        return NULL;
+    }
+    so_Table_set_number_of_rows(table, self->numrows);
+
+    for (int j = 0; j < num_columns; j++) {
+        int index = columns ? columns[j] : j;
+        so_Column *col = source->columns[index];
+        void *buffer = malloc((self->numrows + 1) * pharmml_valueType_to_size(col->valueType));
+        if (!buffer) {
+            so_Table_free(table);
+            return NULL;
+        }
+        if (so_TableView_gather_column(self, index, buffer)) {
+            free(buffer);
+            so_Table_free(table);
+            return NULL;
+        }
+        // so_Table_new_column copies the strings
+        int fail = so_Table_new_column(table, col->columnId, col->columnType, col->num_columnType, col->valueType, buffer);
+        free(buffer);
+        if (fail) {
+            so_Table_free(table);
+            return NULL;
+        }
+    }
+
+    return table;
+}
+
+/** \memberof so_TableView
+ * Create a new table with the rows of a view
+ * \param self - pointer to an so_TableView
+ * \return A pointer to the new so_Table or NULL if memory allocation failed
+ * \sa so_TableView_gather_column
+ */
+so_Table *so_TableView_materialize(so_TableView *self)
+{
+    return so_TableView_project(self, NULL, self->table->numcols);
+}
+
+/** \memberof so_Table
+ * Create a view of a table sorted by one or more key columns. No data is moved.
+ * \param self - pointer to an so_Table
+ * \param key_columns - array of column indices to sort by or NULL to sort by ID and IDV
+ * \param num_keys - number of key columns
+ * \return A new so_TableView or NULL if a key column was not found or memory allocation failed
+ * \sa so_Table_sort_permutation, so_TableView_free
+ */
+so_TableView *so_Table_sorted_view(so_Table *self, int *key_columns, int num_keys)
+{
+    int *perm = so_Table_sort_permutation(self, key_columns, num_keys);
+    if (!perm) {
+        return NULL;
+    }
+    so_TableView *view = so_TableView_new(self, perm, self->numrows);
+    free(perm);
+    return view;
+}
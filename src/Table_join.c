@@ -0,0 +1,396 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <so/Table.h>
+#include <so/private/Table.h>
+#include <so/private/hash.h>
+#include <pharmml/common_types.h>
+#include <pharmml/string.h>
+
+// The key columns of one side of a join
+typedef struct {
+    so_Table *table;
+    int *columns;
+} so_JoinKeys;
+
+static unsigned int so_join_hash(so_JoinKeys *keys, int num_keys, int row, int *valid)
+{
+    unsigned int hash = SO_HASH_FNV_OFFSET;
+    *valid = 1;
+    for (int k = 0; k < num_keys; k++) {
+        so_Column *col = keys->table->columns[keys->columns[k]];
+        if (col->valueType == PHARMML_VALUETYPE_REAL) {
+            double x = ((double *) col->column)[row];
+            if (x != x) {
+                *valid = 0;     // NA and NaN never match
+            }
+            if (x == 0) {
+                x = 0;          // -0.0 equals 0.0
+            }
+            hash = so_Hash_bytes(&x, sizeof(double), hash);
+        } else if (col->valueType == PHARMML_VALUETYPE_INT) {
+            hash = so_Hash_bytes(&((int *) col->column)[row], sizeof(int), hash);
+        } else if (col->valueType == PHARMML_VALUETYPE_BOOLEAN) {
+            hash = so_Hash_bytes(&((bool *) col->column)[row], sizeof(bool), hash);
+        } else {
+            char *str = ((char **) col->column)[row];
+            if (!str) {
+                *valid = 0;     // Missing strings never match
+                continue;
+            }
+            hash = so_Hash_bytes(str, strlen(str) + 1, hash);
+        }
+    }
+    return hash;
+}
+
+static int so_join_equal(so_JoinKeys *left, int left_row, so_JoinKeys *right, int right_row, int num_keys)
+{
+    for (int k = 0; k < num_keys; k++) {
+        so_Column *lcol = left->table->columns[left->columns[k]];
+        so_Column *rcol = right->table->columns[right->columns[k]];
+        if (lcol->valueType == PHARMML_VALUETYPE_REAL) {
+            if (((double *) lcol->column)[left_row] != ((double *) rcol->column)[right_row]) return 0;
+        } else if (lcol->valueType == PHARMML_VALUETYPE_INT) {
+            if (((int *) lcol->column)[left_row] != ((int *) rcol->column)[right_row]) return 0;
+        } else if (lcol->valueType == PHARMML_VALUETYPE_BOOLEAN) {
+            if (((bool *) lcol->column)[left_row] != ((bool *) rcol->column)[right_row]) return 0;
+        } else {
+            if (strcmp(((char **) lcol->column)[left_row], ((char **) rcol->column)[right_row]) != 0) return 0;
+        }
+    }
+    return 1;
+}
+
+// Find the index of the first column having a columnType
+static int so_Table_column_with_type(so_Table *self, pharmml_columnType type)
+{
+    for (int i = 0; i < self->numcols; i++) {
+        for (int j = 0; j < self->columns[i]->num_columnType; j++) {
+            if (self->columns[i]->columnType[j] == type) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+// Find the key columns in both tables. Return the number of keys or -1 for error
+static int so_join_find_keys(so_Table *left, so_Table *right, char **key_columns, int num_keys, int *left_keys, int *right_keys)
+{
+    if (key_columns) {
+        for (int k = 0; k < num_keys; k++) {
+            left_keys[k] = so_Table_get_index_from_name(left, key_columns[k]);
+            right_keys[k] = so_Table_get_index_from_name(right, key_columns[k]);
+            if (left_keys[k] == -1 || right_keys[k] == -1) {
+                return -1;
+            }
+        }
+    } else {
+        // Default to the ID and IDV columns of the tables
+        pharmml_columnType types[] = { PHARMML_COLTYPE_ID, PHARMML_COLTYPE_IDV };
+        num_keys = 0;
+        for (int t = 0; t < 2; t++) {
+            int l = so_Table_column_with_type(left, types[t]);
+            int r = so_Table_column_with_type(right, types[t]);
+            if (l != -1 && r != -1) {
+                left_keys[num_keys] = l;
+                right_keys[num_keys] = r;
+                num_keys++;
+            }
+        }
+        if (num_keys == 0) {
+            return -1;
+        }
+    }
+
+    for (int k = 0; k < num_keys; k++) {
+        pharmml_valueType type = left->columns[left_keys[k]]->valueType;
+        if (type != right->columns[right_keys[k]]->valueType || type == PHARMML_VALUETYPE_ID ||
+                type == PHARMML_VALUETYPE_ERROR) {
+            return -1;
+        }
+        if (so_Column_decode(left->columns[left_keys[k]]) || so_Column_decode(right->columns[right_keys[k]])) {
+            return -1;
+        }
+    }
+
+    return num_keys;
+}
+
+// Growing list of matched row pairs
+typedef struct {
+    int *left_rows;
+    int *right_rows;
+    int n;
+    int capacity;
+} so_JoinPairs;
+
+static int so_join_append(so_JoinPairs *pairs, int left_row, int right_row)
+{
+    if (pairs->n == pairs->capacity) {
+        int capacity = pairs->capacity * 2;
+        int *left_rows = realloc(pairs->left_rows, capacity * sizeof(int));
+        if (!left_rows) {
+            return 1;
+        }
+        pairs->left_rows = left_rows;
+        int *right_rows = realloc(pairs->right_rows, capacity * sizeof(int));
+        if (!right_rows) {
+            return 1;
+        }
+        pairs->right_rows = right_rows;
+        pairs->capacity = capacity;
+    }
+    pairs->left_rows[pairs->n] = left_row;
+    pairs->right_rows[pairs->n] = right_row;
+    pairs->n++;
+    return 0;
+}
+
+static int so_is_key(int *keys, int num_keys, int column)
+{
+    for (int k = 0; k < num_keys; k++) {
+        if (keys[k] == column) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Add a column to the result taking values from the source rows. A row of -1 gives a missing value.
+// If alternative is given it is used for the rows missing in source.
+static int so_join_add_column(so_Table *result, so_Column *col, char *name, int *rows, so_Column *alternative, int *alternative_rows, int n)
+{
+    pharmml_valueType type = col->valueType;
+    if (so_Column_decode(col) || (alternative && so_Column_decode(alternative))) {
+        return 1;
+    }
+    void *buffer = malloc((n + 1) * pharmml_valueType_to_size(type));
+    if (!buffer) {
+        return 1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        so_Column *src = col;
+        int row = rows[i];
+        if (row == -1 && alternative) {
+            src = alternative;
+            row = alternative_rows[i];
+        }
+        if (type == PHARMML_VALUETYPE_REAL) {
+            ((double *) buffer)[i] = row == -1 ? pharmml_na() : ((double *) src->column)[row];
+        } else if (type == PHARMML_VALUETYPE_INT) {
+            ((int *) buffer)[i] = row == -1 ? 0 : ((int *) src->column)[row];
+        } else if (type == PHARMML_VALUETYPE_BOOLEAN) {
+            ((bool *) buffer)[i] = row == -1 ? false : ((bool *) src->column)[row];
+        } else {
+            char *value = row == -1 ? NULL : ((char **) src->column)[row];
+            char *str = pharmml_strdup(value ? value : "");
+            if (!str) {
+                pharmml_free_string_array(buffer, i);
+                return 1;
+            }
+            ((char **) buffer)[i] = str;
+        }
+    }
+
+    if (so_Table_new_column_no_copy(result, name, col->columnType, col->num_columnType, type, buffer)) {
+        if (type == PHARMML_VALUETYPE_STRING) {
+            pharmml_free_string_array(buffer, n);
+        } else {
+            free(buffer);
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+/** \memberof so_Table
+ * Join two tables on key columns. The rows of the right table are put into a hash table on the
+ * keys that is then probed with each row of the left table. The result has the key columns
+ * first followed by the other columns of the left table and then the other columns of the right
+ * table. The columnType and valueType of all columns are kept. A column of the right table with
+ * the same name as a column of the left table will get the suffix _right, repeated until the name
+ * is unique. Rows are ordered as the left table, with rows having the same key in the order of the
+ * right table and for SO_JOIN_FULL followed by the unmatched rows of the right table. Values missing for unmatched
+ * rows are NA for real, 0 for int, false for boolean and the empty string for string columns.
+ * Rows with NA or NaN in a real key column or a missing string in a string key column never match.
+ * \param left - pointer to the left so_Table
+ * \param right - pointer to the right so_Table
+ * \param key_columns - array of columnIds of the keys that must be present in both tables or NULL
+ * to use the ID column and the IDV column found through their columnType in both tables
+ * \param num_keys - number of key columns
+ * \param join_type - SO_JOIN_INNER to only keep matching rows, SO_JOIN_LEFT to keep all rows of the
+ * left table or SO_JOIN_FULL to keep all rows of both tables
+ * \return A new so_Table or NULL if key columns were not found, have different valueTypes in
+ * the two tables, are of valueType id or error or memory allocation failed
+ */
+so_Table *so_Table_join(so_Table *left, so_Table *right, char **key_columns, int num_keys, so_JoinType join_type)
+{
+    int max_keys = key_columns ? num_keys : 2;
+    int *left_key_columns = malloc((max_keys + 1) * sizeof(int));
+    int *right_key_columns = malloc((max_keys + 1) * sizeof(int));
+    if (!left_key_columns || !right_key_columns) {
+        free(left_key_columns);
+        free(right_key_columns);
+        return NULL;
+    }
+    num_keys = so_join_find_keys(left, right, key_columns, num_keys, left_key_columns, right_key_columns);
+    if (num_keys < 1) {
+        free(left_key_columns);
+        free(right_key_columns);
+        return NULL;
+    }
+    so_JoinKeys left_keys = { left, left_key_columns };
+    so_JoinKeys right_keys = { right, right_key_columns };
+
+    // Build the hash table on the right table. Each bucket is a chain of rows through next.
+    // The full hash of each row is kept so that most mismatches never touch the key data.
+    int num_buckets = 16;
+    while (num_buckets < right->numrows) {
+        num_buckets *= 2;
+    }
+    int *buckets = malloc(num_buckets * sizeof(int));
+    int *next = malloc((right->numrows + 1) * sizeof(int));
+    unsigned int *hashes = malloc((right->numrows + 1) * sizeof(unsigned int));
+    char *matched = calloc(right->numrows + 1, 1);
+    so_JoinPairs pairs;
+    pairs.n = 0;
+    pairs.capacity = left->numrows + right->numrows + 16;
+    pairs.left_rows = malloc(pairs.capacity * sizeof(int));
+    pairs.right_rows = malloc(pairs.capacity * sizeof(int));
+    so_Table *result = NULL;
+
+    if (!buckets || !next || !hashes || !matched || !pairs.left_rows || !pairs.right_rows) {
+        goto cleanup;
+    }
+
+    for (int b = 0; b < num_buckets; b++) {
+        buckets[b] = -1;
+    }
+    // Insert in reverse so that the chains are in row order
+    for (int row = right->numrows - 1; row >= 0; row--) {
+        int valid;
+        unsigned int hash = so_join_hash(&right_keys, num_keys, row, &valid);
+        hashes[row] = hash;
+        if (valid) {
+            int b = hash & (num_buckets - 1);
+            next[row] = buckets[b];
+            buckets[b] = row;
+        }
+    }
+
+    // Probe with the left table
+    for (int row = 0; row < left->numrows; row++) {
+        int valid;
+        unsigned int hash = so_join_hash(&left_keys, num_keys, row, &valid);
+        int found = 0;
+        if (valid) {
+            for (int r = buckets[hash & (num_buckets - 1)]; r != -1; r = next[r]) {
+                if (hashes[r] == hash && so_join_equal(&left_keys, row, &right_keys, r, num_keys)) {
+                    if (so_join_append(&pairs, row, r)) {
+                        goto cleanup;
+                    }
+                    matched[r] = 1;
+                    found = 1;
+                }
+            }
+        }
+        if (!found && join_type != SO_JOIN_INNER) {
+            if (so_join_append(&pairs, row, -1)) {
+                goto cleanup;
+            }
+        }
+    }
+
+    if (join_type == SO_JOIN_FULL) {
+        for (int r = 0; r < right->numrows; r++) {
+            if (!matched[r]) {
+                if (so_join_append(&pairs, -1, r)) {
+                    goto cleanup;
+                }
+            }
+        }
+    }
+
+    result = so_Table_new();
+    if (!result) {
+        goto cleanup;
+    }
+    int n = pairs.n;
+    int *left_rows = pairs.left_rows;
+    int *right_rows = pairs.right_rows;
+    so_Table_set_number_of_rows(result, n);
+
+    int fail = 0;
+    for (int k = 0; k < num_keys && !fail; k++) {
+        so_Column *col = left->columns[left_key_columns[k]];
+        fail = so_join_add_column(result, col, col->columnId, left_rows, right->columns[right_key_columns[k]], right_rows, n);
+    }
+    for (int j = 0; j < left->numcols && !fail; j++) {
+        if (!so_is_key(left_key_columns, num_keys, j)) {
+            so_Column *col = left->columns[j];
+            fail = so_join_add_column(result, col, col->columnId, left_rows, NULL, NULL, n);
+        }
+    }
+    for (int j = 0; j < right->numcols && !fail; j++) {
+        if (!so_is_key(right_key_columns, num_keys, j)) {
+            so_Column *col = right->columns[j];
+            char *name = col->columnId;
+            char *new_name = NULL;
+            // Add suffixes until the name is unique
+            while (so_Table_get_index_from_name(result, name) != -1) {
+                char *suffixed = malloc(strlen(name) + 7);
+                if (!suffixed) {
+                    fail = 1;
+                    break;
+                }
+                sprintf(suffixed, "%s_right", name);
+                free(new_name);
+                new_name = suffixed;
+                name = new_name;
+            }
+            if (fail) {
+                free(new_name);
+                break;
+            }
+            fail = so_join_add_column(result, col, name, right_rows, NULL, NULL, n);
+            free(new_name);
+        }
+    }
+    if (fail) {
+        so_Table_free(result);
+        result = NULL;
+    }
+
+cleanup:
+    free(buckets);
+    free(next);
+    free(hashes);
+    free(matched);
+    free(pairs.left_rows);
+    free(pairs.right_rows);
+    free(left_key_columns);
+    free(right_key_columns);
+    return result;
+}
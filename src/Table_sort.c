@@ -0,0 +1,411 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <so/Table.h>
+#include <so/private/Table.h>
+#include <so/private/hash.h>
+#include <pharmml/common_types.h>
+#include <pharmml/string.h>
+
+// LSD radix sort of the permutation perm by 32 bit unsigned keys aligned with perm.
+// One pass per byte. Passes where all keys have the same byte are skipped.
+static int so_radix_sort(uint32_t *keys, int *perm, int n)
+{
+    uint32_t *keys_tmp = malloc((n + 1) * sizeof(uint32_t));
+    int *perm_tmp = malloc((n + 1) * sizeof(int));
+    if (!keys_tmp || !perm_tmp) {
+        free(keys_tmp);
+        free(perm_tmp);
+        return 1;
+    }
+
+    uint32_t *src_keys = keys, *dst_keys = keys_tmp;
+    int *src_perm = perm, *dst_perm = perm_tmp;
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        int count[257] = { 0 };
+        for (int i = 0; i < n; i++) {
+            count[((src_keys[i] >> shift) & 0xFF) + 1]++;
+        }
+        int trivial = 0;
+        for (int b = 1; b <= 256; b++) {
+            trivial |= (count[b] == n);
+        }
+        if (trivial) {
+            continue;
+        }
+        for (int b = 0; b < 256; b++) {
+            count[b + 1] += count[b];
+        }
+        for (int i = 0; i < n; i++) {
+            int pos = count[(src_keys[i] >> shift) & 0xFF]++;
+            dst_keys[pos] = src_keys[i];
+            dst_perm[pos] = src_perm[i];
+        }
+        uint32_t *tk = src_keys; src_keys = dst_keys; dst_keys = tk;
+        int *tp = src_perm; src_perm = dst_perm; dst_perm = tp;
+    }
+
+    if (src_perm != perm) {
+        memcpy(perm, src_perm, n * sizeof(int));
+    }
+
+    free(keys_tmp);
+    free(perm_tmp);
+    return 0;
+}
+
+// Order of doubles used for sorting. NA and NaN are placed last
+static int so_real_less(double a, double b)
+{
+    if (isnan(b)) {
+        return !isnan(a);
+    }
+    return a < b;
+}
+
+// Stable bottom up merge sort of the permutation by real keys aligned with perm
+static int so_merge_sort(double *keys, int *perm, int n)
+{
+    double *keys_tmp = malloc((n + 1) * sizeof(double));
+    int *perm_tmp = malloc((n + 1) * sizeof(int));
+    if (!keys_tmp || !perm_tmp) {
+        free(keys_tmp);
+        free(perm_tmp);
+        return 1;
+    }
+
+    double *src_keys = keys, *dst_keys = keys_tmp;
+    int *src_perm = perm, *dst_perm = perm_tmp;
+
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = lo + width < n ? lo + width : n;
+            int hi = lo + 2 * width < n ? lo + 2 * width : n;
+            int i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                // Take from the right run only if strictly less to keep the sort stable
+                if (so_real_less(src_keys[j], src_keys[i])) {
+                    dst_keys[k] = src_keys[j];
+                    dst_perm[k++] = src_perm[j++];
+                } else {
+                    dst_keys[k] = src_keys[i];
+                    dst_perm[k++] = src_perm[i++];
+                }
+            }
+            while (i < mid) {
+                dst_keys[k] = src_keys[i];
+                dst_perm[k++] = src_perm[i++];
+            }
+            while (j < hi) {
+                dst_keys[k] = src_keys[j];
+                dst_perm[k++] = src_perm[j++];
+            }
+        }
+        double *tk = src_keys; src_keys = dst_keys; dst_keys = tk;
+        int *tp = src_perm; src_perm = dst_perm; dst_perm = tp;
+    }
+
+    if (src_perm != perm) {
+        memcpy(perm, src_perm, n * sizeof(int));
+    }
+
+    free(keys_tmp);
+    free(perm_tmp);
+    return 0;
+}
+
+static int so_compare_strings(const void *a, const void *b)
+{
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+// Replace strings by dictionary codes that have the same order as the strings
+static int so_dictionary_codes(char **strings, int n, uint32_t *codes)
+{
+    so_Hash *hash = so_Hash_new(n);
+    char **distinct = malloc((n + 1) * sizeof(char *));
+    if (!hash || !distinct) {
+        so_Hash_free(hash);
+        free(distinct);
+        return 1;
+    }
+
+    int num_distinct = 0;
+    for (int i = 0; i < n; i++) {
+        if (so_Hash_get(hash, strings[i]) == -1) {
+            if (so_Hash_put(hash, strings[i], num_distinct)) {
+                so_Hash_free(hash);
+                free(distinct);
+                return 1;
+            }
+            distinct[num_distinct++] = strings[i];
+        }
+    }
+
+    qsort(distinct, num_distinct, sizeof(char *), so_compare_strings);
+    for (int i = 0; i < num_distinct; i++) {
+        so_Hash_put(hash, distinct[i], i);
+    }
+    for (int i = 0; i < n; i++) {
+        codes[i] = so_Hash_get(hash, strings[i]);
+    }
+
+    so_Hash_free(hash);
+    free(distinct);
+    return 0;
+}
+
+// Stable sort of perm by one key column
+static int so_Table_sort_by_column(so_Table *self, int column, int *perm)
+{
+    int n = self->numrows;
+    so_Column *col = self->columns[column];
+    if (so_Column_decode(col)) {
+        return 1;
+    }
+
+    if (col->valueType == PHARMML_VALUETYPE_REAL) {
+        double *data = (double *) col->column;
+        double *keys = malloc((n + 1) * sizeof(double));
+        if (!keys) {
+            return 1;
+        }
+        for (int i = 0; i < n; i++) {
+            keys[i] = data[perm[i]];
+        }
+        int fail = so_merge_sort(keys, perm, n);
+        free(keys);
+        return fail;
+    }
+
+    uint32_t *keys = malloc((n + 1) * sizeof(uint32_t));
+    if (!keys) {
+        return 1;
+    }
+
+    if (col->valueType == PHARMML_VALUETYPE_INT) {
+        int *data = (int *) col->column;
+        for (int i = 0; i < n; i++) {
+            keys[i] = (uint32_t) data[perm[i]] ^ 0x80000000u;     // Flip the sign bit for unsigned order
+        }
+    } else if (col->valueType == PHARMML_VALUETYPE_BOOLEAN) {
+        bool *data = (bool *) col->column;
+        for (int i = 0; i < n; i++) {
+            keys[i] = data[perm[i]];
+        }
+    } else if (col->valueType == PHARMML_VALUETYPE_STRING) {
+        char **strings = malloc((n + 1) * sizeof(char *));
+        if (!strings) {
+            free(keys);
+            return 1;
+        }
+        for (int i = 0; i < n; i++) {
+            strings[i] = ((char **) col->column)[perm[i]];
+        }
+        int fail = so_dictionary_codes(strings, n, keys);
+        free(strings);
+        if (fail) {
+            free(keys);
+            return 1;
+        }
+    } else {
+        free(keys);
+        return 1;
+    }
+
+    int fail = so_radix_sort(keys, perm, n);
+    free(keys);
+    return fail;
+}
+
+/** \memberof so_Table
+ * Calculate the permutation of the rows that would sort the table by one or more key columns.
+ * The sort is stable and the first key is the most significant. Int, boolean and string columns
+ * (through dictionary codes) are sorted with radix sort and real columns with merge sort.
+ * Strings are sorted in byte order and NA and NaN are sorted last. No data in the table is moved.
+ * \param self - pointer to an so_Table
+ * \param key_columns - array of column indices to sort by or NULL to sort by the ID column
+ * and then by the IDV column
+ * \param num_keys - number of key columns
+ * \return A newly allocated array of row numbers in sorted order to be freed by the caller or NULL
+ * if a key column was not found or memory allocation failed
+ * \sa so_Table_apply_permutation, so_Table_sorted_view
+ */
+int *so_Table_sort_permutation(so_Table *self, int *key_columns, int num_keys)
+{
+    int default_keys[2];
+    if (!key_columns) {
+        num_keys = 0;
+        int id = so_Table_id_column(self);
+        int idv = so_Table_idv_column(self);
+        if (id != -1) {
+            default_keys[num_keys++] = id;
+        }
+        if (idv != -1) {
+            default_keys[num_keys++] = idv;
+        }
+        key_columns = default_keys;
+    }
+
+    for (int i = 0; i < num_keys; i++) {
+        if (key_columns[i] < 0 || key_columns[i] >= self->numcols) {
+            return NULL;
+        }
+    }
+
+    int *perm = malloc((self->numrows + 1) * sizeof(int));
+    if (!perm) {
+        return NULL;
+    }
+    for (int i = 0; i < self->numrows; i++) {
+        perm[i] = i;
+    }
+
+    // Least significant key first
+    for (int k = num_keys - 1; k >= 0; k--) {
+        if (so_Table_sort_by_column(self, key_columns[k], perm)) {
+            free(perm);
+            return NULL;
+        }
+    }
+
+    return perm;
+}
+
+/** \memberof so_Table
+ * Reorder the rows of all columns of a table in place
+ * \param self - pointer to an so_Table
+ * \param permutation - array with the old row number of each new row, for example from
+ * so_Table_sort_permutation
+ * \return 0 for success
+ * \sa so_Table_sort_permutation
+ */
+int so_Table_apply_permutation(so_Table *self, int *permutation)
+{
+    int n = self->numrows;
+
+    // Every row must be used exactly once or strings would be lost or freed twice
+    char *seen = calloc(n + 1, 1);
+    if (!seen) {
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (permutation[i] < 0 || permutation[i] >= n || seen[permutation[i]]) {
+            free(seen);
+            return 1;
+        }
+        seen[permutation[i]] = 1;
+    }
+    free(seen);
+
+    // All columns are decoded and permuted into new buffers before any column is changed so that
+    // a failure leaves the table as it was. Decoding does not change the content of a column.
+    for (int j = 0; j < self->numcols; j++) {
+        if (so_Column_decode(self->columns[j])) {
+            return 1;
+        }
+    }
+    char **buffers = calloc(self->numcols + 1, sizeof(char *));
+    int *copied_strings = calloc(self->numcols + 1, sizeof(int));     // The buffer holds copies of the strings
+    if (!buffers || !copied_strings) {
+        free(buffers);
+        free(copied_strings);
+        return 1;
+    }
+
+    int fail = 0;
+    for (int j = 0; j < self->numcols && !fail; j++) {
+        so_Column *col = self->columns[j];
+        int size = pharmml_valueType_to_size(col->valueType);
+        char *buffer = malloc(n * size + 1);
+        if (!buffer) {
+            fail = 1;
+            break;
+        }
+        buffers[j] = buffer;
+        // The column gets its own copies of the strings if the buffer has been shared. Copies can let
+        // go of the buffer at any time so whether this is the last reference is only known when
+        // letting go of it below. Otherwise the string pointers are moved.
+        if (col->shared && col->valueType == PHARMML_VALUETYPE_STRING) {
+            char **src = (char **) col->column;
+            char **dest = (char **) buffer;
+            for (int i = 0; i < n; i++) {
+                dest[i] = pharmml_strdup(src[permutation[i]]);
+                if (!dest[i]) {
+                    pharmml_free_string_array(dest, i);
+                    buffers[j] = NULL;
+                    fail = 1;
+                    break;
+                }
+            }
+            copied_strings[j] = !fail;
+        } else {
+            char *src = (char *) col->column;
+            for (int i = 0; i < n; i++) {
+                memcpy(buffer + i * size, src + permutation[i] * size, size);
+            }
+        }
+    }
+
+    if (fail) {
+        for (int j = 0; j < self->numcols; j++) {
+            if (copied_strings[j]) {
+                pharmml_free_string_array((char **) buffers[j], n);
+            } else {
+                free(buffers[j]);
+            }
+        }
+        free(buffers);
+        free(copied_strings);
+        return 1;
+    }
+
+    so_Table_clear_index(self);
+
+    for (int j = 0; j < self->numcols; j++) {
+        so_Column *col = self->columns[j];
+        int size = pharmml_valueType_to_size(col->valueType);
+        if (col->shared) {
+            // The old buffer and its strings are freed if no copy is using them anymore
+            if (so_Column_unref_shared(col->shared) == 0) {
+                free(col->shared);
+                if (col->valueType == PHARMML_VALUETYPE_STRING) {
+                    pharmml_free_string_array((char **) col->column, n);
+                } else {
+                    free(col->column);
+                }
+            }
+            col->shared = NULL;
+        } else {
+            free(col->column);
+        }
+        col->column = buffers[j];
+        col->len = n;
+        col->used_memory = n * size;
+        col->alloced_memory = n * size;
+    }
+    free(buffers);
+    free(copied_strings);
+
+    return 0;
+}
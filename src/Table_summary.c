@@ -0,0 +1,741 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <so/Table.h>
+#include <so/private/Table.h>
+#include <so/GroupIndex.h>
+#include <pharmml/common_types.h>
+#include <pharmml/string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Number of independent accumulators in the reductions. The loops are written
+// so that the compiler can map the lanes onto SIMD registers.
+#define SO_SUMMARY_LANES 8
+
+// Partitions below this size are sorted with insertion sort during selection
+#define SO_SELECT_SMALL 16
+
+// Copy the non-missing values of the rows (or all rows if rows is NULL) as doubles into dest.
+// Return the number of values copied.
+static int so_Table_gather_values(so_Table *table, int column, int *rows, int numrows, double *dest)
+{
+    so_Column *col = table->columns[column];
+    int n = 0;
+
+    if (!rows && col->encoding != SO_COLUMN_PLAIN) {
+        // Expand the runs so that the column itself stays encoded
+        so_ColumnRun run = SO_COLUMN_RUN_INIT;
+        while (so_Column_next_run(col, &run)) {
+            double x = col->valueType == PHARMML_VALUETYPE_REAL ? *(double *) run.value : *(int *) run.value;
+            if (x == x) {
+                for (int i = 0; i < run.length; i++) {
+                    dest[n + i] = x;
+                }
+                n += run.length;
+            }
+        }
+    } else if (col->valueType == PHARMML_VALUETYPE_REAL) {
+        double *data = (double *) col->column;
+        if (rows) {
+            for (int i = 0; i < numrows; i++) {
+                double x = data[rows[i]];
+                dest[n] = x;
+                n += (x == x);
+            }
+        } else {
+            for (int i = 0; i < numrows; i++) {
+                dest[n] = data[i];
+                n += (data[i] == data[i]);      // NA and NaN are the only values not equal to themselves
+            }
+        }
+    } else {
+        int *data = (int *) col->column;
+        if (rows) {
+            for (int i = 0; i < numrows; i++) {
+                dest[i] = data[rows[i]];
+            }
+        } else {
+            for (int i = 0; i < numrows; i++) {
+                dest[i] = data[i];
+            }
+        }
+        n = numrows;
+    }
+
+    return n;
+}
+
+// Gather the values of one group or of the whole column if index is NULL
+static int so_Table_gather_group(so_Table *table, int column, so_GroupIndex *index, int group, double *dest, int *numrows)
+{
+    if (index) {
+        *numrows = so_GroupIndex_get_number_of_rows(index, group);
+        return so_Table_gather_values(table, column, so_GroupIndex_get_rows(index, group), *numrows, dest);
+    } else {
+        *numrows = table->numrows;
+        return so_Table_gather_values(table, column, NULL, *numrows, dest);
+    }
+}
+
+static double so_summary_sum(double *x, int n)
+{
+    double acc[SO_SUMMARY_LANES] = { 0 };
+    int i;
+    for (i = 0; i + SO_SUMMARY_LANES <= n; i += SO_SUMMARY_LANES) {
+        for (int j = 0; j < SO_SUMMARY_LANES; j++) {
+            acc[j] += x[i + j];
+        }
+    }
+    double sum = 0;
+    for (int j = 0; j < SO_SUMMARY_LANES; j++) {
+        sum += acc[j];
+    }
+    for (; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+static double so_summary_sum_of_squares(double *x, int n, double mean)
+{
+    double acc[SO_SUMMARY_LANES] = { 0 };
+    int i;
+    for (i = 0; i + SO_SUMMARY_LANES <= n; i += SO_SUMMARY_LANES) {
+        for (int j = 0; j < SO_SUMMARY_LANES; j++) {
+            double d = x[i + j] - mean;
+            acc[j] += d * d;
+        }
+    }
+    double sum = 0;
+    for (int j = 0; j < SO_SUMMARY_LANES; j++) {
+        sum += acc[j];
+    }
+    for (; i < n; i++) {
+        double d = x[i] - mean;
+        sum += d * d;
+    }
+    return sum;
+}
+
+static void so_summary_min_max(double *x, int n, double *min, double *max)
+{
+    double lane_min[SO_SUMMARY_LANES];
+    double lane_max[SO_SUMMARY_LANES];
+    for (int j = 0; j < SO_SUMMARY_LANES; j++) {
+        lane_min[j] = INFINITY;
+        lane_max[j] = -INFINITY;
+    }
+    int i;
+    for (i = 0; i + SO_SUMMARY_LANES <= n; i += SO_SUMMARY_LANES) {
+        for (int j = 0; j < SO_SUMMARY_LANES; j++) {
+            lane_min[j] = x[i + j] < lane_min[j] ? x[i + j] : lane_min[j];
+            lane_max[j] = x[i + j] > lane_max[j] ? x[i + j] : lane_max[j];
+        }
+    }
+    for (; i < n; i++) {
+        lane_min[0] = x[i] < lane_min[0] ? x[i] : lane_min[0];
+        lane_max[0] = x[i] > lane_max[0] ? x[i] : lane_max[0];
+    }
+    *min = lane_min[0];
+    *max = lane_max[0];
+    for (int j = 1; j < SO_SUMMARY_LANES; j++) {
+        *min = lane_min[j] < *min ? lane_min[j] : *min;
+        *max = lane_max[j] > *max ? lane_max[j] : *max;
+    }
+}
+
+// Reduce the non-missing values of a real or int column to their number, sum, minimum and maximum.
+// The minimum and maximum are NA if there are no values. The table is only read. Return 0 for success.
+int so_Table_reduce_column(so_Table *self, int column, int *n, double *sum, double *min, double *max)
+{
+    so_Column *col = self->columns[column];
+    *n = 0;
+    *sum = 0;
+    *min = INFINITY;
+    *max = -INFINITY;
+
+    if (col->encoding == SO_COLUMN_RLE || col->encoding == SO_COLUMN_CONSTANT) {
+        // Each run is reduced as a whole without expanding it
+        so_ColumnRun run = SO_COLUMN_RUN_INIT;
+        while (so_Column_next_run(col, &run)) {
+            double x = col->valueType == PHARMML_VALUETYPE_REAL ? *(double *) run.value : *(int *) run.value;
+            if (x == x) {
+                *n += run.length;
+                *sum += x * run.length;
+                *min = x < *min ? x : *min;
+                *max = x > *max ? x : *max;
+            }
+        }
+    } else if (self->numrows > 0) {
+        double *x = malloc(self->numrows * sizeof(double));
+        if (!x) {
+            return 1;
+        }
+        *n = so_Table_gather_values(self, column, NULL, self->numrows, x);
+        *sum = so_summary_sum(x, *n);
+        so_summary_min_max(x, *n, min, max);
+        free(x);
+    }
+
+    if (*n == 0) {
+        *min = pharmml_na();
+        *max = pharmml_na();
+    }
+    return 0;
+}
+
+static int so_compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void so_insertion_sort(double *x, int lo, int hi)
+{
+    for (int i = lo + 1; i <= hi; i++) {
+        double value = x[i];
+        int j = i - 1;
+        while (j >= lo && x[j] > value) {
+            x[j + 1] = x[j];
+            j--;
+        }
+        x[j + 1] = value;
+    }
+}
+
+// Introselect: Rearrange x[lo..hi] so that x[k] is the value it would have if x was sorted,
+// with no larger values before it and no smaller values after it. Quickselect with
+// median of three pivots that falls back to sorting if the partitioning goes bad.
+static void so_select(double *x, int lo, int hi, int k)
+{
+    int depth_limit = 2;
+    for (int n = hi - lo + 1; n > 1; n >>= 1) {
+        depth_limit += 2;
+    }
+
+    while (hi - lo >= SO_SELECT_SMALL) {
+        if (depth_limit-- == 0) {
+            qsort(x + lo, hi - lo + 1, sizeof(double), so_compare_doubles);
+            return;
+        }
+
+        int mid = lo + (hi - lo) / 2;
+        if (x[mid] < x[lo]) { double t = x[mid]; x[mid] = x[lo]; x[lo] = t; }
+        if (x[hi] < x[lo]) { double t = x[hi]; x[hi] = x[lo]; x[lo] = t; }
+        if (x[hi] < x[mid]) { double t = x[hi]; x[hi] = x[mid]; x[mid] = t; }
+        double pivot = x[mid];
+
+        int i = lo;
+        int j = hi;
+        while (i <= j) {
+            while (x[i] < pivot) i++;
+            while (x[j] > pivot) j--;
+            if (i <= j) {
+                double t = x[i];
+                x[i] = x[j];
+                x[j] = t;
+                i++;
+                j--;
+            }
+        }
+
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            return;     // x[k] equals the pivot
+        }
+    }
+
+    so_insertion_sort(x, lo, hi);
+}
+
+// Calculate quantiles of x (which will be reordered) with linear interpolation between
+// the closest order statistics, i.e. type 7 in Hyndman and Fan. The probabilities are
+// handled in increasing order so that each selection only needs to look above the previous.
+static void so_quantiles(double *x, int n, double *probs, int *order, int num_probs, double *result)
+{
+    if (n == 0) {
+        for (int i = 0; i < num_probs; i++) {
+            result[i] = pharmml_na();
+        }
+        return;
+    }
+
+    int lo = 0;
+    for (int i = 0; i < num_probs; i++) {
+        double h = (n - 1) * probs[order[i]];
+        int k = (int) floor(h);
+        if (k >= lo) {
+            so_select(x, lo, n - 1, k);
+            lo = k;
+        }
+        double value = x[k];
+        if (h > k) {
+            // The next order statistic is the smallest value above k
+            double next = x[k + 1];
+            for (int j = k + 2; j < n; j++) {
+                next = x[j] < next ? x[j] : next;
+            }
+            value += (h - k) * (next - value);
+        }
+        result[order[i]] = value;
+    }
+}
+
+// Get the order of the probabilities with an insertion sort
+static void so_order_probabilities(double *probs, int num_probs, int *order)
+{
+    for (int i = 0; i < num_probs; i++) {
+        int j = i - 1;
+        while (j >= 0 && probs[order[j]] > probs[i]) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = i;
+    }
+}
+
+// Names of quantile columns, e.g. P5 for 0.05. Returns NULL if out of memory.
+static char *so_quantile_name(double prob)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "P%g", prob * 100);
+    return pharmml_strdup(buffer);
+}
+
+// Create a table with one row per group and an ID column copied from the source table
+static so_Table *so_Table_new_grouped_table(so_Table *source, int id_column, so_GroupIndex *index)
+{
+    so_Table *table = so_Table_new();
+    if (!table) {
+        return NULL;
+    }
+
+    int numrows = index ? so_GroupIndex_get_number_of_groups(index) : 1;
+    so_Table_set_number_of_rows(table, numrows);
+
+    if (index) {
+        so_Column *column = source->columns[id_column];
+        pharmml_columnType id_type = PHARMML_COLTYPE_ID;
+        void *ids;
+        if (column->valueType == PHARMML_VALUETYPE_INT) {
+            ids = malloc((numrows + 1) * sizeof(int));
+            if (ids) {
+                for (int i = 0; i < numrows; i++) {
+                    ((int *) ids)[i] = ((int *) column->column)[so_GroupIndex_get_rows(index, i)[0]];
+                }
+            }
+        } else {
+            ids = calloc(numrows + 1, sizeof(char *));
+            if (ids) {
+                for (int i = 0; i < numrows; i++) {
+                    char *group_id = so_GroupIndex_get_id(index, i);
+                    char *id = pharmml_strdup(group_id ? group_id : "");     // Missing IDs are empty
+                    if (!id) {
+                        pharmml_free_string_array(ids, i);
+                        ids = NULL;
+                        break;
+                    }
+                    ((char **) ids)[i] = id;
+                }
+            }
+        }
+        if (!ids || so_Table_new_column_no_copy(table, column->columnId, &id_type, 1, column->valueType, ids)) {
+            if (ids && column->valueType == PHARMML_VALUETYPE_STRING) {
+                pharmml_free_string_array(ids, numrows);
+            } else {
+                free(ids);
+            }
+            so_Table_free(table);
+            return NULL;
+        }
+    }
+
+    return table;
+}
+
+// Add result columns to a table taking ownership of the data arrays. All arrays are freed on failure
+static int so_Table_add_result_columns(so_Table *table, int num_columns, char **names, pharmml_valueType *valueTypes, void **data)
+{
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    int fail = !table;
+    for (int i = 0; i < num_columns; i++) {
+        if (!fail && data[i] && so_Table_new_column_no_copy(table, names[i], &undefined, 1, valueTypes[i], data[i]) == 0) {
+            continue;
+        }
+        fail = 1;
+        free(data[i]);
+    }
+    return fail;
+}
+
+static int so_Table_check_summary_arguments(so_Table *self, int column, int by_id, int *id_column)
+{
+    if (column < 0 || column >= self->numcols) {
+        return 1;
+    }
+    pharmml_valueType valueType = self->columns[column]->valueType;
+    if (valueType != PHARMML_VALUETYPE_REAL && valueType != PHARMML_VALUETYPE_INT) {
+        return 1;
+    }
+    *id_column = -1;
+    if (by_id) {
+        *id_column = so_Table_id_column(self);
+        if (*id_column == -1) {
+            return 1;
+        }
+        pharmml_valueType id_type = self->columns[*id_column]->valueType;
+        if (id_type != PHARMML_VALUETYPE_STRING && id_type != PHARMML_VALUETYPE_INT) {
+            return 1;
+        }
+        // The rows of the groups are accessed directly
+        if (so_Column_decode(self->columns[column])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** \memberof so_Table
+ * Calculate summary statistics of a real or int column. NA and NaN values are not included
+ * in the statistics but are counted in NMISSING. The result is a new table with the columns
+ * N, NMISSING, MIN, MAX, MEAN and SD (sample standard deviation). If by_id is set the result
+ * will have one row per ID in order of first appearance and the ID column as the first column,
+ * otherwise it will have one row for the whole column. Rows with a missing string ID are
+ * summarized together in a row with an empty ID. Statistics that cannot be calculated
+ * because of too few values are NA.
+ * \param self - pointer to an so_Table
+ * \param column - index of the column
+ * \param by_id - 1 to group by the ID column or 0 to summarize the whole column
+ * \return A new so_Table or NULL if the column is not real or int, by_id is set but there
+ * is no ID column or memory allocation failed
+ * \sa so_Table_column_quantiles, so_Table_id_column
+ */
+so_Table *so_Table_column_summary(so_Table *self, int column, int by_id)
+{
+    int id_column;
+    if (so_Table_check_summary_arguments(self, column, by_id, &id_column)) {
+        return NULL;
+    }
+
+    so_GroupIndex *index = NULL;
+    if (by_id) {
+        index = so_Table_group_index(self);
+        if (!index) {
+            return NULL;
+        }
+    }
+    int num_groups = index ? so_GroupIndex_get_number_of_groups(index) : 1;
+
+    so_Table *table = so_Table_new_grouped_table(self, id_column, index);
+    double *values = malloc((self->numrows + 1) * sizeof(double));
+    int *n = malloc(num_groups * sizeof(int));
+    int *nmissing = malloc(num_groups * sizeof(int));
+    double *min = malloc(num_groups * sizeof(double));
+    double *max = malloc(num_groups * sizeof(double));
+    double *mean = malloc(num_groups * sizeof(double));
+    double *sd = malloc(num_groups * sizeof(double));
+
+    if (table && values && n && nmissing && min && max && mean && sd) {
+        for (int g = 0; g < num_groups; g++) {
+            int numrows;
+            int count = so_Table_gather_group(self, column, index, g, values, &numrows);
+            n[g] = count;
+            nmissing[g] = numrows - count;
+            if (count > 0) {
+                so_summary_min_max(values, count, &min[g], &max[g]);
+                mean[g] = so_summary_sum(values, count) / count;
+            } else {
+                min[g] = pharmml_na();
+                max[g] = pharmml_na();
+                mean[g] = pharmml_na();
+            }
+            if (count > 1) {
+                sd[g] = sqrt(so_summary_sum_of_squares(values, count, mean[g]) / (count - 1));
+            } else {
+                sd[g] = pharmml_na();
+            }
+        }
+    }
+    free(values);
+
+    char *names[] = { "N", "NMISSING", "MIN", "MAX", "MEAN", "SD" };
+    pharmml_valueType valueTypes[] = { PHARMML_VALUETYPE_INT, PHARMML_VALUETYPE_INT, PHARMML_VALUETYPE_REAL,
+        PHARMML_VALUETYPE_REAL, PHARMML_VALUETYPE_REAL, PHARMML_VALUETYPE_REAL };
+    void *data[] = { n, nmissing, min, max, mean, sd };
+    if (so_Table_add_result_columns(table, 6, names, valueTypes, data)) {
+        so_Table_free(table);
+        return NULL;
+    }
+
+    return table;
+}
+
+/** \memberof so_Table
+ * Calculate quantiles of a real or int column. NA and NaN values are excluded. The quantiles
+ * are interpolated linearly between the closest order statistics (the default method of R and
+ * numpy) and are found by selection instead of sorting the column. The result is a new table
+ * with one real column per probability named P followed by the probability in percent,
+ * e.g. P5, P50 and P95. If by_id is set the result will have one row per ID in order of
+ * first appearance and the ID column as the first column, otherwise it will have one row
+ * for the whole column. Quantiles of groups without values are NA.
+ * \param self - pointer to an so_Table
+ * \param column - index of the column
+ * \param probs - array of probabilities between 0 and 1
+ * \param num_probs - number of probabilities
+ * \param by_id - 1 to group by the ID column or 0 to use the whole column
+ * \return A new so_Table or NULL if the column is not real or int, a probability is outside
+ * of [0, 1], by_id is set but there is no ID column or memory allocation failed
+ * \sa so_Table_column_summary
+ */
+so_Table *so_Table_column_quantiles(so_Table *self, int column, double *probs, int num_probs, int by_id)
+{
+    int id_column;
+    if (so_Table_check_summary_arguments(self, column, by_id, &id_column) || num_probs < 1) {
+        return NULL;
+    }
+    for (int i = 0; i < num_probs; i++) {
+        if (!(probs[i] >= 0 && probs[i] <= 1)) {
+            return NULL;
+        }
+    }
+
+    so_GroupIndex *index = NULL;
+    if (by_id) {
+        index = so_Table_group_index(self);
+        if (!index) {
+            return NULL;
+        }
+    }
+    int num_groups = index ? so_GroupIndex_get_number_of_groups(index) : 1;
+
+    so_Table *table = so_Table_new_grouped_table(self, id_column, index);
+    double *values = malloc((self->numrows + 1) * sizeof(double));
+    double *result = malloc(num_probs * sizeof(double));
+    int *order = malloc(num_probs * sizeof(int));
+    char **names = calloc(num_probs, sizeof(char *));
+    pharmml_valueType *valueTypes = malloc(num_probs * sizeof(pharmml_valueType));
+    void **data = calloc(num_probs, sizeof(void *));
+
+    int fail = !(table && values && result && order && names && valueTypes && data);
+    for (int i = 0; !fail && i < num_probs; i++) {
+        names[i] = so_quantile_name(probs[i]);
+        valueTypes[i] = PHARMML_VALUETYPE_REAL;
+        data[i] = malloc(num_groups * sizeof(double));
+        fail = !names[i] || !data[i];
+    }
+
+    if (!fail) {
+        so_order_probabilities(probs, num_probs, order);
+
+        for (int g = 0; g < num_groups; g++) {
+            int numrows;
+            int count = so_Table_gather_group(self, column, index, g, values, &numrows);
+            so_quantiles(values, count, probs, order, num_probs, result);
+            for (int i = 0; i < num_probs; i++) {
+                ((double *) data[i])[g] = result[i];
+            }
+        }
+        fail = so_Table_add_result_columns(table, num_probs, names, valueTypes, data);
+    } else if (data) {
+        for (int i = 0; i < num_probs; i++) {
+            free(data[i]);
+        }
+    }
+
+    if (names) {
+        pharmml_free_string_array(names, num_probs);
+    }
+    free(valueTypes);
+    free(data);
+    free(order);
+    free(result);
+    free(values);
+
+    if (fail) {
+        so_Table_free(table);
+        return NULL;
+    }
+
+    return table;
+}
+
+/** \memberof so_Table
+ * Summarize the replicates of a bootstrap or stochastic simulation and estimation. The table should have one row
+ * per replicate and one column per parameter as given by so_SO_all_population_estimates. All statistics are
+ * calculated in one pass per parameter and the parameters are summarized in parallel if built with OpenMP.
+ * NA and NaN values are excluded. The result has one row per real or int column and the columns parameter, N,
+ * ORIGINAL, MEAN, SD, BIAS (MEAN - ORIGINAL) followed by one column per probability named as by so_Table_column_quantiles.
+ * \param self - pointer to an so_Table
+ * \param original_row - the row having the estimates for the original data or -1 if there is none. This row is not
+ * included in the statistics. If there is no original row ORIGINAL and BIAS will be NA.
+ * \param probs - array of probabilities between 0 and 1 for the percentiles
+ * \param num_probs - number of probabilities
+ * \return A new so_Table or NULL if original_row or a probability is out of range or memory allocation failed
+ * \sa so_SO_all_population_estimates, so_Table_column_summary, so_Table_column_quantiles
+ */
+so_Table *so_Table_bootstrap_summary(so_Table *self, int original_row, double *probs, int num_probs)
+{
+    if (original_row < -1 || original_row >= self->numrows || num_probs < 0) {
+        return NULL;
+    }
+    for (int i = 0; i < num_probs; i++) {
+        if (!(probs[i] >= 0 && probs[i] <= 1)) {
+            return NULL;
+        }
+    }
+
+    int numparams = 0;
+    for (int col = 0; col < self->numcols; col++) {
+        pharmml_valueType valueType = self->columns[col]->valueType;
+        numparams += (valueType == PHARMML_VALUETYPE_REAL || valueType == PHARMML_VALUETYPE_INT);
+    }
+
+    // The replicates are all rows except the original
+    int numrows = self->numrows - (original_row >= 0);
+    int *rows = NULL;
+    if (original_row >= 0) {
+        rows = malloc((numrows + 1) * sizeof(int));
+        if (!rows) {
+            return NULL;
+        }
+        for (int i = 0; i < numrows; i++) {
+            rows[i] = i < original_row ? i : i + 1;
+        }
+    }
+
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+    int num_columns = 6 + num_probs;
+    int *columns = malloc((numparams + 1) * sizeof(int));
+    int *order = malloc((num_probs + 1) * sizeof(int));
+    double *values = malloc((size_t) num_threads * (numrows + num_probs + 1) * sizeof(double));
+    char **parameter_names = calloc(numparams + 1, sizeof(char *));
+    char **names = calloc(num_columns, sizeof(char *));
+    pharmml_valueType *valueTypes = malloc(num_columns * sizeof(pharmml_valueType));
+    void **data = calloc(num_columns, sizeof(void *));
+    so_Table *table = so_Table_new();
+
+    int fail = !(columns && order && values && parameter_names && names && valueTypes && data && table);
+    for (int i = 0; !fail && i < num_columns; i++) {
+        char *fixed_names[] = { "parameter", "N", "ORIGINAL", "MEAN", "SD", "BIAS" };
+        if (i < 6) {
+            names[i] = pharmml_strdup(fixed_names[i]);
+            valueTypes[i] = i == 0 ? PHARMML_VALUETYPE_STRING : i == 1 ? PHARMML_VALUETYPE_INT : PHARMML_VALUETYPE_REAL;
+        } else {
+            names[i] = so_quantile_name(probs[i - 6]);
+            valueTypes[i] = PHARMML_VALUETYPE_REAL;
+        }
+        data[i] = i == 0 ? (void *) parameter_names : malloc((numparams + 1) * pharmml_valueType_to_size(valueTypes[i]));
+        fail = !names[i] || !data[i];
+    }
+
+    if (!fail) {
+        int p = 0;
+        for (int col = 0; !fail && col < self->numcols; col++) {
+            pharmml_valueType valueType = self->columns[col]->valueType;
+            if (valueType == PHARMML_VALUETYPE_REAL || valueType == PHARMML_VALUETYPE_INT) {
+                columns[p] = col;
+                parameter_names[p] = pharmml_strdup(self->columns[col]->columnId);
+                // Rows of the replicates are accessed directly
+                fail = !parameter_names[p] || (rows && so_Column_decode(self->columns[col]));
+                p++;
+            }
+        }
+        so_order_probabilities(probs, num_probs, order);
+    }
+
+    if (!fail) {
+        int *n = data[1];
+        double *original = data[2];
+        double *mean = data[3];
+        double *sd = data[4];
+        double *bias = data[5];
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for (int p = 0; p < numparams; p++) {
+            int thread = 0;
+#ifdef _OPENMP
+            thread = omp_get_thread_num();
+#endif
+            double *x = values + (size_t) thread * (numrows + num_probs + 1);
+            double *result = x + numrows;
+            so_Column *column = self->columns[columns[p]];
+            int count = so_Table_gather_values(self, columns[p], rows, numrows, x);
+            n[p] = count;
+            original[p] = pharmml_na();
+            if (original_row >= 0) {
+                original[p] = column->valueType == PHARMML_VALUETYPE_REAL ?
+                    ((double *) column->column)[original_row] : ((int *) column->column)[original_row];
+            }
+            mean[p] = count > 0 ? so_summary_sum(x, count) / count : pharmml_na();
+            sd[p] = count > 1 ? sqrt(so_summary_sum_of_squares(x, count, mean[p]) / (count - 1)) : pharmml_na();
+            bias[p] = count > 0 && original[p] == original[p] ? mean[p] - original[p] : pharmml_na();
+            so_quantiles(x, count, probs, order, num_probs, result);
+            for (int i = 0; i < num_probs; i++) {
+                ((double *) data[6 + i])[p] = result[i];
+            }
+        }
+
+        so_Table_set_number_of_rows(table, numparams);
+        pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+        fail = so_Table_new_column_no_copy(table, names[0], &undefined, 1, PHARMML_VALUETYPE_STRING, parameter_names);
+        if (!fail) {
+            parameter_names = NULL;
+        }
+        data[0] = NULL;
+        fail = so_Table_add_result_columns(fail ? NULL : table, num_columns - 1, names + 1, valueTypes + 1, data + 1) || fail;
+    } else if (data) {
+        for (int i = 1; i < num_columns; i++) {
+            free(data[i]);
+        }
+    }
+
+    if (parameter_names) {
+        pharmml_free_string_array(parameter_names, numparams);
+    }
+    if (names) {
+        pharmml_free_string_array(names, num_columns);
+    }
+    free(valueTypes);
+    free(data);
+    free(values);
+    free(order);
+    free(columns);
+    free(rows);
+
+    if (fail) {
+        so_Table_free(table);
+        return NULL;
+    }
+
+    return table;
+}
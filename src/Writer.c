@@ -0,0 +1,543 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <libxml/xmlwriter.h>
+
+#include <so/Writer.h>
+#include <so/private/Writer.h>
+#include <so/private/SO.h>
+#include <so/private/SOBlock.h>
+#include <so/private/Table.h>
+#include <so/private/compression.h>
+
+/** \struct so_Writer
+	 \brief Incremental writer of an SO document
+
+    An so_Writer writes an SO document piece by piece so that the whole SO never
+    has to be kept in memory. Complete SOBlocks can be written one at a time and
+    the rows of tables can be written one row at a time. The output is flushed after
+    each SOBlock, each table and regularly while writing rows so that a partially
+    written document can be recovered if the writing process dies.
+*/
+
+static so_Writer *so_Writer_create(xmlOutputBufferPtr out, int pretty)
+{
+    so_Writer *writer = calloc(sizeof(so_Writer), 1);
+    if (!writer) {
+        xmlOutputBufferClose(out);
+        return NULL;
+    }
+
+    writer->writer = xmlNewTextWriter(out);
+    if (!writer->writer) {
+        xmlOutputBufferClose(out);
+        free(writer);
+        return NULL;
+    }
+    writer->out = out;
+    if (pretty) {
+        if (xmlTextWriterSetIndent(writer->writer, 1) < 0 ||
+                xmlTextWriterSetIndentString(writer->writer, BAD_CAST "  ") < 0) {
+            xmlFreeTextWriter(writer->writer);
+            free(writer);
+            return NULL;
+        }
+    }
+    writer->current_column = -1;
+
+    return writer;
+}
+
+/** \memberof so_Writer
+ * Create a new so_Writer that writes to a file. Files with names ending with .gz or .zst
+ * will be compressed with gzip or zstd.
+ * \param filename - the file to write to
+ * \param pretty - 1 for nice indentation, 0 for compact
+ * \return A pointer to the new so_Writer or NULL for error
+ * \sa so_Writer_start, so_Writer_close
+ */
+so_Writer *so_Writer_new(char *filename, int pretty)
+{
+    so_Compression compression = so_compression_from_filename(filename);
+    if (!so_compression_is_available(compression)) {
+        return NULL;
+    }
+    xmlOutputBufferPtr out = so_compression_create_output_buffer(filename, compression, -1);
+    if (!out) {
+        return NULL;
+    }
+
+    return so_Writer_create(out, pretty);
+}
+
+/** \memberof so_Writer
+ * Create a new so_Writer that uses a callback to output the data
+ * \param write - function to write len bytes from buffer. Returns len or -1 for error.
+ * \param close - function called when writing is done or NULL
+ * \param callback_context - pointer that will be passed to the callbacks
+ * \param pretty - 1 for nice indentation, 0 for compact
+ * \return A pointer to the new so_Writer or NULL for error
+ * \sa so_Writer_new
+ */
+so_Writer *so_Writer_new_callback(so_write_callback write, so_close_callback close, void *callback_context, int pretty)
+{
+    xmlOutputBufferPtr out = xmlOutputBufferCreateIO(write, close, callback_context, NULL);
+    if (!out) {
+        if (close) {
+            close(callback_context);
+        }
+        return NULL;
+    }
+
+    return so_Writer_create(out, pretty);
+}
+
+// Check that the writer can accept content outside of a table
+static int so_Writer_check(so_Writer *self)
+{
+    if (self->failed || !self->started || self->valueTypes) {
+        self->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+// Write the column definitions of the table being written if not already done
+static int so_Writer_write_definition(so_Writer *self)
+{
+    if (self->definition) {
+        int fail = so_Table_xml_definition(self->definition, self->writer) ||
+            xmlTextWriterStartElement(self->writer, BAD_CAST "ds:Table") < 0;
+        so_Table_unref(self->definition);
+        self->definition = NULL;
+        if (fail) {
+            self->failed = 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Mark the writer as failed if rc is an error from libxml
+static int so_Writer_result(so_Writer *self, int rc)
+{
+    if (rc < 0) {
+        self->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/** \memberof so_Writer
+ * Start the document. This writes the SO element with its attributes, Description and PharmMLRef.
+ * \param self - pointer to an so_Writer
+ * \param header - an so_SO from which the id, metadataFile, Description and PharmMLRef will be written
+ * or NULL. SOBlocks in the header will not be written.
+ * \return 0 for success
+ * \sa so_Writer_add_SOBlock, so_Writer_start_SOBlock
+ */
+int so_Writer_start(so_Writer *self, so_SO *header)
+{
+    xmlTextWriterPtr writer = self->writer;
+    int rc;
+
+    if (self->failed || self->started) {
+        self->failed = 1;
+        return 1;
+    }
+    self->started = 1;
+
+    rc = xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL);
+    if (rc < 0) goto fail;
+
+    // Same attributes as written by so_SO_xml
+    rc = xmlTextWriterStartElement(writer, BAD_CAST "SO");
+    if (rc < 0) goto fail;
+    rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "xmlns", BAD_CAST "http://www.pharmml.org/so/0.3/StandardisedOutput");
+    if (rc < 0) goto fail;
+    rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "xmlns:xsi", BAD_CAST "http://www.w3.org/2001/XMLSchema-instance");
+    if (rc < 0) goto fail;
+    rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "xmlns:ds", BAD_CAST "http://www.pharmml.org/pharmml/0.8/Dataset");
+    if (rc < 0) goto fail;
+    rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "xmlns:ct", BAD_CAST "http://www.pharmml.org/pharmml/0.8/CommonTypes");
+    if (rc < 0) goto fail;
+    rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "xmlns:po", BAD_CAST "http://www.pharmml.org/probonto/ProbOnto");
+    if (rc < 0) goto fail;
+    rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "xsi:schemaLocation", BAD_CAST "http://www.pharmml.org/so/0.3/StandardisedOutput");
+    if (rc < 0) goto fail;
+    rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "implementedBy", BAD_CAST "MJS");
+    if (rc < 0) goto fail;
+    rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "writtenVersion", BAD_CAST "0.3.1");
+    if (rc < 0) goto fail;
+
+    if (header) {
+        if (header->id) {
+            rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "id", BAD_CAST header->id);
+            if (rc < 0) goto fail;
+        }
+        if (header->metadataFile) {
+            rc = xmlTextWriterWriteAttribute(writer, BAD_CAST "metadataFile", BAD_CAST header->metadataFile);
+            if (rc < 0) goto fail;
+        }
+        if (header->Description) {
+            rc = xmlTextWriterWriteElement(writer, BAD_CAST "ct:Description", BAD_CAST header->Description);
+            if (rc < 0) goto fail;
+        }
+        if (header->PharmMLRef) {
+            if (so_PharmMLRef_xml(header->PharmMLRef, writer)) goto fail;
+        }
+    }
+
+    return so_Writer_flush(self);
+
+fail:
+    self->failed = 1;
+    return 1;
+}
+
+/** \memberof so_Writer
+ * Write a complete SOBlock. The writer takes over the reference to the SOBlock
+ * and it will be freed after being written, also if writing failed.
+ * \param self - pointer to an so_Writer
+ * \param block - the SOBlock to write
+ * \return 0 for success
+ * \sa so_Writer_start_SOBlock
+ */
+int so_Writer_add_SOBlock(so_Writer *self, so_SOBlock *block)
+{
+    if (so_Writer_check(self)) {
+        so_SOBlock_unref(block);
+        return 1;
+    }
+
+    int fail = so_SOBlock_xml(block, self->writer);
+    so_SOBlock_unref(block);
+    if (fail) {
+        self->failed = 1;
+        return 1;
+    }
+
+    return so_Writer_flush(self);
+}
+
+/** \memberof so_Writer
+ * Start writing an SOBlock piece by piece. End it with so_Writer_end_element.
+ * \param self - pointer to an so_Writer
+ * \param blkId - the blkId of the SOBlock or NULL
+ * \return 0 for success
+ * \sa so_Writer_start_element, so_Writer_end_element, so_Writer_add_SOBlock
+ */
+int so_Writer_start_SOBlock(so_Writer *self, char *blkId)
+{
+    if (so_Writer_start_element(self, "SOBlock")) {
+        return 1;
+    }
+    if (blkId) {
+        return so_Writer_write_attribute(self, "blkId", blkId);
+    }
+    return 0;
+}
+
+/** \memberof so_Writer
+ * Start an element, for example "Simulation" or "SimulationBlock". The elements must be
+ * started in the order given by the SO schema. End it with so_Writer_end_element.
+ * \param self - pointer to an so_Writer
+ * \param name - the name of the element including a namespace prefix if needed
+ * \return 0 for success
+ * \sa so_Writer_write_attribute, so_Writer_end_element
+ */
+int so_Writer_start_element(so_Writer *self, char *name)
+{
+    if (so_Writer_check(self)) {
+        return 1;
+    }
+    if (so_Writer_result(self, xmlTextWriterStartElement(self->writer, BAD_CAST name))) {
+        return 1;
+    }
+    self->depth++;
+    return 0;
+}
+
+/** \memberof so_Writer
+ * Write an attribute of the most recently started element or of a table element started with
+ * so_Writer_start_table. Must be called before any content of the element is written.
+ * \param self - pointer to an so_Writer
+ * \param name - the name of the attribute
+ * \param value - the value of the attribute
+ * \return 0 for success
+ * \sa so_Writer_start_element
+ */
+int so_Writer_write_attribute(so_Writer *self, char *name, char *value)
+{
+    // Attributes of the table element are allowed until the first row
+    if (self->failed || !self->started || (self->valueTypes && !self->definition)) {
+        self->failed = 1;
+        return 1;
+    }
+    return so_Writer_result(self, xmlTextWriterWriteAttribute(self->writer, BAD_CAST name, BAD_CAST value));
+}
+
+/** \memberof so_Writer
+ * End the most recently started element. Output is flushed when an SOBlock is ended.
+ * \param self - pointer to an so_Writer
+ * \return 0 for success
+ * \sa so_Writer_start_element, so_Writer_start_SOBlock
+ */
+int so_Writer_end_element(so_Writer *self)
+{
+    if (so_Writer_check(self) || self->depth == 0) {
+        self->failed = 1;
+        return 1;
+    }
+    if (so_Writer_result(self, xmlTextWriterEndElement(self->writer))) {
+        return 1;
+    }
+    self->depth--;
+    if (self->depth == 0) {
+        return so_Writer_flush(self);
+    }
+    return 0;
+}
+
+/** \memberof so_Writer
+ * Start writing a table. The columns are taken from a definition table that could be empty.
+ * Rows in the definition table will not be written. Attributes of the table element can
+ * be written with so_Writer_write_attribute before the first row. Add rows with so_Writer_start_row
+ * and end the table with so_Writer_end_table.
+ * \param self - pointer to an so_Writer
+ * \param element_name - the name of the table element, for example "SimulatedProfiles"
+ * \param definition - a table having the columns of the table to write
+ * \return 0 for success
+ * \sa so_Writer_start_row, so_Writer_end_table
+ */
+int so_Writer_start_table(so_Writer *self, char *element_name, so_Table *definition)
+{
+    if (so_Writer_check(self) || definition->numcols == 0 || definition->ExternalFile) {
+        self->failed = 1;
+        return 1;
+    }
+
+    pharmml_valueType *valueTypes = malloc(definition->numcols * sizeof(pharmml_valueType));
+    if (!valueTypes) {
+        self->failed = 1;
+        return 1;
+    }
+    for (int i = 0; i < definition->numcols; i++) {
+        valueTypes[i] = definition->columns[i]->valueType;
+    }
+
+    if (so_Table_xml_start(definition, self->writer, element_name)) {
+        free(valueTypes);
+        self->failed = 1;
+        return 1;
+    }
+
+    // The columns are written when the first row is started to allow attributes to be added to the table element
+    so_Table_ref(definition);
+    self->definition = definition;
+    self->valueTypes = valueTypes;
+    self->numcols = definition->numcols;
+    self->depth += 2;
+    self->table_depth = self->depth;
+    self->rows_since_flush = 0;
+    return 0;
+}
+
+/** \memberof so_Writer
+ * Start a new row of the table being written. Add one value per column in order
+ * with the so_Writer_add_* functions and end the row with so_Writer_end_row.
+ * \param self - pointer to an so_Writer
+ * \return 0 for success
+ * \sa so_Writer_add_real, so_Writer_add_int, so_Writer_add_string, so_Writer_add_bool, so_Writer_end_row
+ */
+int so_Writer_start_row(so_Writer *self)
+{
+    if (self->failed || !self->valueTypes || self->current_column != -1) {
+        self->failed = 1;
+        return 1;
+    }
+    if (so_Writer_write_definition(self)) {
+        return 1;
+    }
+    if (so_Writer_result(self, xmlTextWriterStartElement(self->writer, BAD_CAST "ds:Row"))) {
+        return 1;
+    }
+    self->current_column = 0;
+    return 0;
+}
+
+// Add the value of the next cell of the current row
+static int so_Writer_add_cell(so_Writer *self, void *value, pharmml_valueType valueType)
+{
+    if (self->failed || !self->valueTypes || self->current_column < 0 || self->current_column >= self->numcols) {
+        self->failed = 1;
+        return 1;
+    }
+    pharmml_valueType column_valueType = self->valueTypes[self->current_column];
+    if (column_valueType != valueType && !(column_valueType == PHARMML_VALUETYPE_ID && valueType == PHARMML_VALUETYPE_STRING)) {
+        self->failed = 1;
+        return 1;
+    }
+    if (so_Table_xml_cell(self->writer, column_valueType, value)) {
+        self->failed = 1;
+        return 1;
+    }
+    self->current_column++;
+    return 0;
+}
+
+/** \memberof so_Writer
+ * Add the value of the next cell in a real column
+ * \param self - pointer to an so_Writer
+ * \param value - the value. NA, NaN and infinities are allowed.
+ * \return 0 for success
+ * \sa so_Writer_start_row
+ */
+int so_Writer_add_real(so_Writer *self, double value)
+{
+    return so_Writer_add_cell(self, &value, PHARMML_VALUETYPE_REAL);
+}
+
+/** \memberof so_Writer
+ * Add the value of the next cell in an int column
+ * \param self - pointer to an so_Writer
+ * \param value - the value
+ * \return 0 for success
+ * \sa so_Writer_start_row
+ */
+int so_Writer_add_int(so_Writer *self, int value)
+{
+    return so_Writer_add_cell(self, &value, PHARMML_VALUETYPE_INT);
+}
+
+/** \memberof so_Writer
+ * Add the value of the next cell in a string or id column
+ * \param self - pointer to an so_Writer
+ * \param value - the value. It will not be kept by the writer.
+ * \return 0 for success
+ * \sa so_Writer_start_row
+ */
+int so_Writer_add_string(so_Writer *self, char *value)
+{
+    return so_Writer_add_cell(self, &value, PHARMML_VALUETYPE_STRING);
+}
+
+/** \memberof so_Writer
+ * Add the value of the next cell in a boolean column
+ * \param self - pointer to an so_Writer
+ * \param value - the value
+ * \return 0 for success
+ * \sa so_Writer_start_row
+ */
+int so_Writer_add_bool(so_Writer *self, bool value)
+{
+    return so_Writer_add_cell(self, &value, PHARMML_VALUETYPE_BOOLEAN);
+}
+
+/** \memberof so_Writer
+ * End the current row. All columns must have been given a value.
+ * \param self - pointer to an so_Writer
+ * \return 0 for success
+ * \sa so_Writer_start_row
+ */
+int so_Writer_end_row(so_Writer *self)
+{
+    if (self->failed || !self->valueTypes || self->current_column != self->numcols) {
+        self->failed = 1;
+        return 1;
+    }
+    if (so_Writer_result(self, xmlTextWriterEndElement(self->writer))) {
+        return 1;
+    }
+    self->current_column = -1;
+
+    self->rows_since_flush++;
+    if (self->rows_since_flush == SO_WRITER_FLUSH_ROWS) {
+        self->rows_since_flush = 0;
+        return so_Writer_flush(self);
+    }
+    return 0;
+}
+
+/** \memberof so_Writer
+ * End the table being written
+ * \param self - pointer to an so_Writer
+ * \return 0 for success
+ * \sa so_Writer_start_table
+ */
+int so_Writer_end_table(so_Writer *self)
+{
+    if (self->failed || !self->valueTypes || self->current_column != -1 || self->depth != self->table_depth) {
+        self->failed = 1;
+        return 1;
+    }
+    if (so_Writer_write_definition(self)) {
+        return 1;
+    }
+    free(self->valueTypes);
+    self->valueTypes = NULL;
+    self->numcols = 0;
+
+    // The ds:Table and the table element
+    if (so_Writer_result(self, xmlTextWriterEndElement(self->writer)) ||
+            so_Writer_result(self, xmlTextWriterEndElement(self->writer))) {
+        return 1;
+    }
+    self->depth -= 2;
+
+    return so_Writer_flush(self);
+}
+
+/** \memberof so_Writer
+ * Write everything buffered so far to the output
+ * \param self - pointer to an so_Writer
+ * \return 0 for success
+ */
+int so_Writer_flush(so_Writer *self)
+{
+    if (self->failed) {
+        return 1;
+    }
+    return so_Writer_result(self, xmlTextWriterFlush(self->writer));
+}
+
+/** \memberof so_Writer
+ * End all open elements and the document, close the output and free the so_Writer
+ * \param self - pointer to an so_Writer
+ * \return 0 if the whole document was written successfully
+ */
+int so_Writer_close(so_Writer *self)
+{
+    int fail = self->failed || !self->started || self->valueTypes;
+
+    if (self->started && !self->failed) {
+        // Ends all open elements
+        if (xmlTextWriterEndDocument(self->writer) < 0 || xmlTextWriterFlush(self->writer) < 0) {
+            fail = 1;
+        }
+    }
+    // xmlFreeTextWriter would ignore errors when closing the output
+    fail = so_compression_close_output(self->out) || fail;
+    xmlFreeTextWriter(self->writer);
+    so_Table_unref(self->definition);
+    free(self->valueTypes);
+    free(self);
+
+    return fail;
+}
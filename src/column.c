@@ -17,8 +17,13 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
 #include <so/private/column.h>
+#include <so/private/stats.h>
 #include <pharmml/string.h>
 
 so_Column *so_Column_new(void)
@@ -28,22 +33,607 @@ so_Column *so_Column_new(void)
     return col;
 }
 
-void so_Column_free(so_Column *col)
+// Special values of scaled int columns. Values in between are stored as value * 10^decimals
+#define SO_SCALED_NA INT_MIN
+#define SO_SCALED_NAN (INT_MIN + 1)
+#define SO_SCALED_MINUSINF (INT_MIN + 2)
+#define SO_SCALED_PLUSINF INT_MAX
+#define SO_SCALED_MAX (INT_MAX - 3)      // Largest magnitude of a scaled value so that no value clashes with the special values
+
+// Bit pattern of a float NA. A NaN with the payload of the double NA in the low bits.
+#define SO_FLOAT_NA 0x7FC007A2U
+
+// Number of values actually stored in the data buffer
+static int so_Column_stored_elements(so_Column *col)
 {
-    free(col->columnId);
-    free(col->columnType);
+    if (col->encoding == SO_COLUMN_RLE || col->encoding == SO_COLUMN_CONSTANT) {
+        return col->num_runs;
+    }
+    return col->len;
+}
+
+// Size of each value stored in the data buffer
+static int so_Column_element_size(so_Column *col)
+{
+    if (col->encoding == SO_COLUMN_FLOAT32) {
+        return sizeof(float);
+    } else if (col->encoding == SO_COLUMN_SCALED_INT32) {
+        return sizeof(int);
+    }
+    return pharmml_valueType_to_size(col->valueType);
+}
+
+static float so_Column_double_to_float(double x)
+{
+    if (pharmml_is_na(x)) {
+        uint32_t bits = SO_FLOAT_NA;
+        float na;
+        memcpy(&na, &bits, sizeof(float));
+        return na;
+    }
+    return (float) x;
+}
+
+static double so_Column_float_to_double(float x)
+{
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(float));
+    if (bits == SO_FLOAT_NA) {
+        return pharmml_na();
+    }
+    return x;
+}
+
+static int so_Column_double_to_scaled(double x, double scale)
+{
+    if (pharmml_is_na(x)) {
+        return SO_SCALED_NA;
+    } else if (isnan(x)) {
+        return SO_SCALED_NAN;
+    } else if (isinf(x)) {
+        return x > 0 ? SO_SCALED_PLUSINF : SO_SCALED_MINUSINF;
+    }
+    return (int) lround(x * scale);
+}
+
+static double so_Column_scaled_to_double(int x, int decimals, double scale)
+{
+    if (x == SO_SCALED_NA) {
+        return pharmml_na();
+    } else if (x == SO_SCALED_NAN) {
+        return NAN;
+    } else if (x == SO_SCALED_PLUSINF) {
+        return INFINITY;
+    } else if (x == SO_SCALED_MINUSINF) {
+        return -INFINITY;
+    }
+    // Divide by the exact power of ten instead of multiplying with its inexact inverse
+    return decimals >= 0 ? x / scale : x * scale;
+}
+
+
+// Row after the last row of a run of an encoded column
+static int so_Column_run_end(so_Column *col, int run)
+{
+    if (col->encoding == SO_COLUMN_CONSTANT) {
+        return col->len;
+    }
+    return col->run_ends[run];
+}
+
+// Check if two values of the column are equal. Reals are compared bitwise to keep NA, NaN and -0
+static int so_Column_values_equal(so_Column *col, void *a, void *b)
+{
+    if (col->valueType == PHARMML_VALUETYPE_STRING) {
+        return strcmp(*(char **) a, *(char **) b) == 0;
+    }
+    return memcmp(a, b, pharmml_valueType_to_size(col->valueType)) == 0;
+}
+
+// Take a reference to a shared data buffer. The reference count is changed atomically so that
+// copies of a column can be changed or freed from different threads.
+static void so_Column_ref_shared(int *shared)
+{
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    (*shared)++;
+}
+
+// Let go of a reference to a shared data buffer. Return the number of references left.
+int so_Column_unref_shared(int *shared)
+{
+    int count;
+#ifdef _OPENMP
+#pragma omp atomic capture
+#endif
+    count = --(*shared);
+    return count;
+}
+
+// Create a copy of a column. The data buffer will be shared until one of the columns is changed
+so_Column *so_Column_copy(so_Column *col)
+{
+    so_Column *dest = so_Column_new();
+    if (!dest) {
+        return NULL;
+    }
+
+    // The reference count is created by the first copy. Copies of the same column can be made from
+    // different threads but the column itself must not be changed meanwhile.
+    int fail = 0;
+#ifdef _OPENMP
+#pragma omp critical(so_Column_shared)
+#endif
+    {
+        if (!col->shared) {
+            col->shared = malloc(sizeof(int));
+            if (col->shared) {
+                *col->shared = 1;
+            } else {
+                fail = 1;
+            }
+        }
+    }
+    if (fail) {
+        free(dest);
+        return NULL;
+    }
+
+    dest->valueType = col->valueType;
+    dest->len = col->len;
+    dest->used_memory = col->used_memory;
+    dest->alloced_memory = col->used_memory;
+    dest->column = col->column;
+    dest->encoding = col->encoding;
+    dest->num_runs = col->num_runs;
+    dest->run_ends = col->run_ends;
+    dest->decimals = col->decimals;
+    dest->shared = col->shared;
+    so_Column_ref_shared(col->shared);
+
+    if (col->columnId && so_Column_set_columnId(dest, col->columnId)) {
+        so_Column_free(dest);
+        return NULL;
+    }
+    for (int i = 0; i < col->num_columnType; i++) {
+        if (so_Column_add_columnType(dest, col->columnType[i])) {
+            so_Column_free(dest);
+            return NULL;
+        }
+    }
+
+    return dest;
+}
+
+// Let go of the data buffer. It will only be freed if no copy is using it
+static void so_Column_release_data(so_Column *col)
+{
+    if (col->shared) {
+        if (so_Column_unref_shared(col->shared) > 0) {
+            col->shared = NULL;
+            return;
+        }
+        free(col->shared);
+        col->shared = NULL;
+    }
 
     // If the data is allocated strings free them.
     if (col->valueType == PHARMML_VALUETYPE_STRING) {
-        for (int i = 0; i < col->len; i++) {
-            char **column = (char **) col->column;
+        char **column = (char **) col->column;
+        int n = so_Column_stored_elements(col);
+        for (int i = 0; i < n; i++) {
             free(column[i]);
         }
     }
     free(col->column);
+    free(col->run_ends);
+}
+
+void so_Column_free(so_Column *col)
+{
+    free(col->columnId);
+    free(col->columnType);
+    so_Column_release_data(col);
     free(col);
 }
 
+// Make sure that the data buffer of the column is not shared with any copy
+// so that it can be changed. Will clone the buffer if it has been shared. Other copies can
+// let go of the buffer at any time so it is cloned even if this could be the last reference.
+// Releasing the old buffer then frees it if no copy is using it anymore.
+int so_Column_make_writable(so_Column *col)
+{
+    if (!col->shared) {
+        return 0;
+    }
+
+    int n = so_Column_stored_elements(col);
+    int size = n * so_Column_element_size(col);
+    int *run_ends = NULL;
+    if (col->encoding == SO_COLUMN_RLE && n > 0) {
+        run_ends = malloc(n * sizeof(int));
+        if (!run_ends) {
+            return 1;
+        }
+        memcpy(run_ends, col->run_ends, n * sizeof(int));
+    }
+    void *buffer = NULL;
+    if (size > 0) {
+        buffer = malloc(size);
+        if (!buffer) {
+            free(run_ends);
+            return 1;
+        }
+        if (col->valueType == PHARMML_VALUETYPE_STRING) {
+            if (pharmml_copy_string_array((char **) col->column, (char **) buffer, n)) {
+                free(buffer);
+                free(run_ends);
+                return 1;
+            }
+        } else {
+            memcpy(buffer, col->column, size);
+        }
+    }
+
+    so_Column_release_data(col);
+    col->column = buffer;
+    col->run_ends = run_ends;
+    col->used_memory = size;
+    col->alloced_memory = size;
+
+    return 0;
+}
+
+// Expand an encoded column into one value per row. A shared encoded buffer is left to the copies.
+int so_Column_decode(so_Column *col)
+{
+    if (col->encoding == SO_COLUMN_PLAIN) {
+        return 0;
+    }
+
+    int size = pharmml_valueType_to_size(col->valueType);
+    void *buffer = NULL;
+    if (col->len > 0) {
+        buffer = malloc(col->len * size);
+        if (!buffer) {
+            return 1;
+        }
+    }
+
+    if (col->encoding == SO_COLUMN_FLOAT32) {
+        float *src = (float *) col->column;
+        for (int i = 0; i < col->len; i++) {
+            ((double *) buffer)[i] = so_Column_float_to_double(src[i]);
+        }
+    } else if (col->encoding == SO_COLUMN_SCALED_INT32) {
+        int *src = (int *) col->column;
+        double scale = pow(10, abs(col->decimals));
+        for (int i = 0; i < col->len; i++) {
+            ((double *) buffer)[i] = so_Column_scaled_to_double(src[i], col->decimals, scale);
+        }
+    }
+
+    int start = 0;
+    for (int r = 0; r < col->num_runs; r++) {
+        int end = so_Column_run_end(col, r);
+        if (col->valueType == PHARMML_VALUETYPE_REAL) {
+            double value = ((double *) col->column)[r];
+            double *dest = (double *) buffer;
+            for (int i = start; i < end; i++) {
+                dest[i] = value;
+            }
+        } else if (col->valueType == PHARMML_VALUETYPE_INT) {
+            int value = ((int *) col->column)[r];
+            int *dest = (int *) buffer;
+            for (int i = start; i < end; i++) {
+                dest[i] = value;
+            }
+        } else if (col->valueType == PHARMML_VALUETYPE_BOOLEAN) {
+            bool value = ((bool *) col->column)[r];
+            bool *dest = (bool *) buffer;
+            for (int i = start; i < end; i++) {
+                dest[i] = value;
+            }
+        } else {
+            char *value = ((char **) col->column)[r];
+            char **dest = (char **) buffer;
+            for (int i = start; i < end; i++) {
+                if (col->valueType == PHARMML_VALUETYPE_STRING) {
+                    dest[i] = pharmml_strdup(value);
+                    if (!dest[i]) {
+                        pharmml_free_string_array(dest, i);
+                        return 1;
+                    }
+                } else {
+                    dest[i] = value;
+                }
+            }
+        }
+        start = end;
+    }
+
+    so_Column_release_data(col);
+    col->column = buffer;
+    col->encoding = SO_COLUMN_PLAIN;
+    col->num_runs = 0;
+    col->run_ends = NULL;
+    col->decimals = 0;
+    col->used_memory = col->len * size;
+    col->alloced_memory = col->used_memory;
+
+    return 0;
+}
+
+// Make sure that there is room for at least n more elements in the column without reallocation
+int so_Column_reserve(so_Column *col, int n)
+{
+    if (so_Column_decode(col) || so_Column_make_writable(col)) {
+        return 1;
+    }
+    int needed_memory = (col->len + n) * pharmml_valueType_to_size(col->valueType);
+    if (col->alloced_memory < needed_memory) {
+        int new_alloced_memory = 2 * col->alloced_memory;
+        if (new_alloced_memory < needed_memory) {
+            new_alloced_memory = needed_memory;
+        }
+        void *new_column = realloc(col->column, new_alloced_memory);
+        if (!new_column) {
+            return 1;
+        }
+        col->alloced_memory = new_alloced_memory;
+        col->column = new_column;
+        so_stats_count_realloc(new_alloced_memory);
+    }
+    return 0;
+}
+
+// Append count rows all having the value pointed to by value. An empty column will be run-length
+// encoded and stays so as long as only runs are added.
+int so_Column_add_run(so_Column *col, void *value, int count)
+{
+    if (count <= 0) {
+        return 0;
+    }
+    int size = pharmml_valueType_to_size(col->valueType);
+    int is_string = col->valueType == PHARMML_VALUETYPE_STRING;
+
+    if (col->encoding != SO_COLUMN_RLE && col->encoding != SO_COLUMN_CONSTANT && col->len > 0) {
+        if (so_Column_reserve(col, count)) {
+            return 1;
+        }
+        for (int i = 0; i < count; i++) {
+            void *dest = (char *) col->column + (col->len + i) * size;
+            if (is_string) {
+                char *copy = pharmml_strdup(*(char **) value);
+                if (!copy) {
+                    col->len += i;
+                    col->used_memory = col->len * size;
+                    return 1;
+                }
+                *(char **) dest = copy;
+            } else {
+                memcpy(dest, value, size);
+            }
+        }
+        col->len += count;
+        col->used_memory = col->len * size;
+        return 0;
+    }
+
+    if (so_Column_make_writable(col)) {
+        return 1;
+    }
+
+    if (col->num_runs > 0) {
+        void *last = (char *) col->column + (col->num_runs - 1) * size;
+        if (so_Column_values_equal(col, last, value)) {
+            if (col->encoding == SO_COLUMN_RLE) {
+                col->run_ends[col->num_runs - 1] += count;
+            }
+            col->len += count;
+            return 0;
+        }
+    }
+
+    if (col->encoding == SO_COLUMN_CONSTANT) {     // A constant column is a column with one run
+        col->run_ends = malloc(sizeof(int));
+        if (!col->run_ends) {
+            return 1;
+        }
+        col->run_ends[0] = col->len;
+        col->encoding = SO_COLUMN_RLE;
+    }
+
+    int *new_run_ends = realloc(col->run_ends, (col->num_runs + 1) * sizeof(int));
+    if (!new_run_ends) {
+        return 1;
+    }
+    col->run_ends = new_run_ends;
+    void *new_column = realloc(col->column, (col->num_runs + 1) * size);
+    if (!new_column) {
+        return 1;
+    }
+    col->column = new_column;
+
+    void *dest = (char *) col->column + col->num_runs * size;
+    if (is_string) {
+        char *copy = pharmml_strdup(*(char **) value);
+        if (!copy) {
+            return 1;
+        }
+        *(char **) dest = copy;
+    } else {
+        memcpy(dest, value, size);
+    }
+
+    col->encoding = SO_COLUMN_RLE;
+    col->len += count;
+    col->run_ends[col->num_runs] = col->len;
+    col->num_runs++;
+    col->used_memory = col->num_runs * size;
+    col->alloced_memory = col->used_memory;
+
+    return 0;
+}
+
+// Change a plain column into a constant or run-length encoded column if this saves at least half of the memory.
+// Columns shared with copies are left as is.
+int so_Column_encode(so_Column *col)
+{
+    pharmml_valueType type = col->valueType;
+    if (col->encoding != SO_COLUMN_PLAIN || col->shared || col->len < 2 ||
+            (type != PHARMML_VALUETYPE_REAL && type != PHARMML_VALUETYPE_INT &&
+             type != PHARMML_VALUETYPE_BOOLEAN && type != PHARMML_VALUETYPE_STRING)) {
+        return 0;
+    }
+
+    int n = col->len;
+    int size = pharmml_valueType_to_size(type);
+    char *data = (char *) col->column;
+
+    int num_runs = 1;
+    for (int i = 1; i < n; i++) {
+        num_runs += !so_Column_values_equal(col, data + (i - 1) * size, data + i * size);
+    }
+    if (num_runs > 1 && 2 * num_runs * (size + (int) sizeof(int)) > n * size) {
+        return 0;
+    }
+
+    char *values = malloc(num_runs * size);
+    if (!values) {
+        return 1;
+    }
+    int *run_ends = NULL;
+    if (num_runs > 1) {
+        run_ends = malloc(num_runs * sizeof(int));
+        if (!run_ends) {
+            free(values);
+            return 1;
+        }
+    }
+
+    // The strings of the first row of each run are kept and the rest are freed
+    int run = 0;
+    memcpy(values, data, size);
+    for (int i = 1; i < n; i++) {
+        void *current = data + i * size;
+        if (so_Column_values_equal(col, values + run * size, current)) {
+            if (type == PHARMML_VALUETYPE_STRING) {
+                free(*(char **) current);
+            }
+        } else {
+            run_ends[run] = i;
+            run++;
+            memcpy(values + run * size, current, size);
+        }
+    }
+    if (run_ends) {
+        run_ends[run] = n;
+    }
+
+    free(col->column);
+    col->column = values;
+    col->encoding = num_runs == 1 ? SO_COLUMN_CONSTANT : SO_COLUMN_RLE;
+    col->num_runs = num_runs;
+    col->run_ends = run_ends;
+    col->used_memory = num_runs * size;
+    col->alloced_memory = col->used_memory;
+
+    return 0;
+}
+
+// Store a plain real column as float or as int scaled with a power of ten keeping at most decimals decimals.
+// Scaled columns will keep fewer decimals if needed for the largest value to fit.
+int so_Column_narrow(so_Column *col, so_RealStorage storage, int decimals)
+{
+    if (col->encoding != SO_COLUMN_PLAIN || col->valueType != PHARMML_VALUETYPE_REAL || storage == SO_REAL_DOUBLE) {
+        return 0;
+    }
+    if (so_Column_make_writable(col)) {
+        return 1;
+    }
+
+    double *data = (double *) col->column;
+    void *buffer = malloc((col->len + 1) * 4);
+    if (!buffer) {
+        return 1;
+    }
+
+    if (storage == SO_REAL_FLOAT32) {
+        for (int i = 0; i < col->len; i++) {
+            ((float *) buffer)[i] = so_Column_double_to_float(data[i]);
+        }
+        col->encoding = SO_COLUMN_FLOAT32;
+    } else {
+        double max = 0;
+        for (int i = 0; i < col->len; i++) {
+            double x = fabs(data[i]);
+            if (isfinite(x) && x > max) {
+                max = x;
+            }
+        }
+        while (max * pow(10, decimals) > SO_SCALED_MAX) {
+            decimals--;
+        }
+        double scale = pow(10, decimals);
+        for (int i = 0; i < col->len; i++) {
+            ((int *) buffer)[i] = so_Column_double_to_scaled(data[i], scale);
+        }
+        col->encoding = SO_COLUMN_SCALED_INT32;
+        col->decimals = decimals;
+    }
+
+    free(col->column);
+    col->column = buffer;
+    col->used_memory = col->len * 4;
+    col->alloced_memory = col->used_memory;
+
+    return 0;
+}
+
+// Advance run to the next run of the column. A plain or narrowed column has one run per row.
+// Return 0 when there are no more runs.
+int so_Column_next_run(so_Column *col, so_ColumnRun *run)
+{
+    int index = run->index + 1;
+    int start = run->start + run->length;
+    if (start >= col->len) {
+        return 0;
+    }
+
+    int size = pharmml_valueType_to_size(col->valueType);
+    run->index = index;
+    run->start = start;
+    if (col->encoding == SO_COLUMN_FLOAT32) {
+        run->real = so_Column_float_to_double(((float *) col->column)[index]);
+        run->value = &run->real;
+    } else if (col->encoding == SO_COLUMN_SCALED_INT32) {
+        int x = ((int *) col->column)[index];
+        run->real = so_Column_scaled_to_double(x, col->decimals, pow(10, abs(col->decimals)));
+        run->value = &run->real;
+    } else {
+        run->value = (char *) col->column + index * size;
+    }
+    if (col->encoding == SO_COLUMN_RLE || col->encoding == SO_COLUMN_CONSTANT) {
+        run->length = so_Column_run_end(col, index) - start;
+    } else {
+        run->length = 1;
+    }
+
+    return 1;
+}
+
+// Pointer to the value of a row of a column when the rows are visited in order.
+// Initialize run with SO_COLUMN_RUN_INIT. The column is only read.
+void *so_Column_run_cell(so_Column *col, so_ColumnRun *run, int row)
+{
+    if (row >= run->start + run->length) {
+        so_Column_next_run(col, run);
+    }
+    return run->value;
+}
+
 int so_Column_set_columnId(so_Column *col, char *columnId)
 {
     char *new_columnId = pharmml_strdup(columnId);
@@ -113,6 +703,9 @@ int so_Column_add_columnType(so_Column *col, pharmml_columnType columnType)
 
 void so_Column_set_valueType(so_Column *col, pharmml_valueType valueType)
 {
+    if (col->valueType != valueType && (so_Column_decode(col) || so_Column_make_writable(col))) {
+        return;
+    }
     col->valueType = valueType;
 }
 
@@ -122,6 +715,9 @@ int so_Column_add_real(so_Column *col, double real)
     if (col->valueType != PHARMML_VALUETYPE_REAL) {
         return 1;
     }
+    if (so_Column_decode(col) || so_Column_make_writable(col)) {
+        return 1;
+    }
     int new_used_memory = col->used_memory + sizeof(double);
     if (col->alloced_memory < new_used_memory) {
         int new_alloced_memory = col->alloced_memory + 256;
@@ -131,6 +727,7 @@ int so_Column_add_real(so_Column *col, double real)
         }
         col->alloced_memory = new_alloced_memory;
         col->column = new_column;
+        so_stats_count_realloc(new_alloced_memory);
     }
     col->used_memory = new_used_memory;
     double *ptr = (double *) col->column;
@@ -144,6 +741,9 @@ int so_Column_add_int(so_Column *col, int integer)
     if (col->valueType != PHARMML_VALUETYPE_INT) {
         return 1;
     }
+    if (so_Column_decode(col) || so_Column_make_writable(col)) {
+        return 1;
+    }
     int new_used_memory = col->used_memory + sizeof(int);
     if (col->alloced_memory < new_used_memory) {
         int new_alloced_memory = col->alloced_memory + 256;
@@ -153,6 +753,7 @@ int so_Column_add_int(so_Column *col, int integer)
         }
         col->alloced_memory = new_alloced_memory;
         col->column = new_column;
+        so_stats_count_realloc(new_alloced_memory);
     }
     col->used_memory = new_used_memory;
     int *ptr = (int *) col->column;
@@ -166,6 +767,9 @@ int so_Column_add_string(so_Column *col, char *str)
     if (col->valueType != PHARMML_VALUETYPE_STRING) {
         return 1;
     }
+    if (so_Column_decode(col) || so_Column_make_writable(col)) {
+        return 1;
+    }
     char *copy = pharmml_strdup(str);
     if (!copy) {
         return 1;
@@ -180,6 +784,7 @@ int so_Column_add_string(so_Column *col, char *str)
         }
         col->alloced_memory = new_alloced_memory;
         col->column = new_column;
+        so_stats_count_realloc(new_alloced_memory);
     }
     col->used_memory = new_used_memory;
     char **ptr = (char **) col->column;
@@ -190,6 +795,9 @@ int so_Column_add_string(so_Column *col, char *str)
 
 int so_Column_add_boolean(so_Column *col, bool b)
 {
+    if (so_Column_decode(col) || so_Column_make_writable(col)) {
+        return 1;
+    }
     int new_used_memory = col->used_memory + sizeof(bool);
     if (col->alloced_memory < new_used_memory) {
         int new_alloced_memory = col->alloced_memory + 256;
@@ -199,6 +807,7 @@ int so_Column_add_boolean(so_Column *col, bool b)
         }
         col->alloced_memory = new_alloced_memory;
         col->column = new_column;
+        so_stats_count_realloc(new_alloced_memory);
     }
     col->used_memory = new_used_memory;
     bool *ptr = (bool *) col->column;
@@ -0,0 +1,329 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libxml/parser.h>
+#include <libxml/xmlIO.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <so/compression.h>
+#include <so/private/compression.h>
+
+/**
+ * Check if reading and writing with a compression method is supported by this build.
+ * gzip needs libxml2 built with zlib and zstd needs libsoc built with HAVE_ZSTD.
+ * \param compression - the compression method
+ * \return 1 if available, 0 otherwise
+ */
+int so_compression_is_available(so_Compression compression)
+{
+    if (compression == SO_COMPRESSION_GZIP) {
+        return xmlHasFeature(XML_WITH_ZLIB);
+    } else if (compression == SO_COMPRESSION_ZSTD) {
+#ifdef HAVE_ZSTD
+        return 1;
+#else
+        return 0;
+#endif
+    }
+    return 1;
+}
+
+/**
+ * Get the compression method to use for a file from its extension. Files ending with .gz
+ * will use gzip and files ending with .zst will use zstd.
+ * \param filename - name of the file
+ * \return The compression method
+ */
+so_Compression so_compression_from_filename(const char *filename)
+{
+    size_t len = strlen(filename);
+    if (len > 3 && strcmp(filename + len - 3, ".gz") == 0) {
+        return SO_COMPRESSION_GZIP;
+    } else if (len > 4 && strcmp(filename + len - 4, ".zst") == 0) {
+        return SO_COMPRESSION_ZSTD;
+    }
+    return SO_COMPRESSION_NONE;
+}
+
+// Find the compression of an existing file from its magic number
+so_Compression so_compression_of_file(const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        return SO_COMPRESSION_NONE;
+    }
+    unsigned char magic[4] = { 0 };
+    size_t n = fread(magic, 1, 4, fp);
+    fclose(fp);
+
+    if (n >= 2 && magic[0] == 0x1F && magic[1] == 0x8B) {
+        return SO_COMPRESSION_GZIP;
+    } else if (n == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD) {
+        return SO_COMPRESSION_ZSTD;
+    }
+    return SO_COMPRESSION_NONE;
+}
+
+#ifdef HAVE_ZSTD
+
+// State of a zstd file being decompressed while it is parsed
+typedef struct {
+    FILE *fp;
+    ZSTD_DStream *stream;
+    ZSTD_inBuffer input;
+    void *input_buffer;
+    size_t input_size;
+    int eof;
+} so_ZstdReader;
+
+static int so_zstd_read_close(void *context)
+{
+    so_ZstdReader *reader = (so_ZstdReader *) context;
+    ZSTD_freeDStream(reader->stream);
+    if (reader->fp) {
+        fclose(reader->fp);
+    }
+    free(reader->input_buffer);
+    free(reader);
+    return 0;
+}
+
+// Read callback for libxml. Fill buffer with decompressed data and return its size or -1 for error.
+static int so_zstd_read(void *context, char *buffer, int len)
+{
+    so_ZstdReader *reader = (so_ZstdReader *) context;
+    ZSTD_outBuffer output = { buffer, len, 0 };
+
+    while (output.pos == 0) {
+        if (reader->input.pos == reader->input.size && !reader->eof) {
+            size_t n = fread(reader->input_buffer, 1, reader->input_size, reader->fp);
+            if (n == 0) {
+                if (ferror(reader->fp)) {
+                    return -1;
+                }
+                reader->eof = 1;
+            }
+            reader->input.src = reader->input_buffer;
+            reader->input.size = n;
+            reader->input.pos = 0;
+        }
+        size_t ret = ZSTD_decompressStream(reader->stream, &output, &reader->input);
+        if (ZSTD_isError(ret)) {
+            return -1;
+        }
+        if (reader->eof && output.pos == 0) {   // Nothing more buffered in the stream
+            break;
+        }
+    }
+
+    return (int) output.pos;
+}
+
+static so_ZstdReader *so_zstd_reader_open(const char *filename)
+{
+    so_ZstdReader *reader = calloc(sizeof(so_ZstdReader), 1);
+    if (!reader) {
+        return NULL;
+    }
+    reader->fp = fopen(filename, "rb");
+    reader->stream = ZSTD_createDStream();
+    reader->input_size = ZSTD_DStreamInSize();
+    reader->input_buffer = malloc(reader->input_size);
+    if (!reader->fp || !reader->stream || !reader->input_buffer || ZSTD_isError(ZSTD_initDStream(reader->stream))) {
+        so_zstd_read_close(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+// Create a parser context that reads a zstd compressed file
+xmlParserCtxtPtr so_zstd_create_parser_context(const char *filename)
+{
+    so_ZstdReader *reader = so_zstd_reader_open(filename);
+    if (!reader) {
+        return NULL;
+    }
+
+    // The reader will be closed by libxml also if the creation fails
+    return xmlCreateIOParserCtxt(NULL, NULL, so_zstd_read, so_zstd_read_close, reader, XML_CHAR_ENCODING_NONE);
+}
+
+// Create an input buffer that gives the decompressed bytes of a zstd compressed file
+xmlParserInputBufferPtr so_zstd_create_input_buffer(const char *filename)
+{
+    so_ZstdReader *reader = so_zstd_reader_open(filename);
+    if (!reader) {
+        return NULL;
+    }
+
+    xmlParserInputBufferPtr input = xmlParserInputBufferCreateIO(so_zstd_read, so_zstd_read_close, reader, XML_CHAR_ENCODING_NONE);
+    if (!input) {
+        so_zstd_read_close(reader);
+    }
+    return input;
+}
+
+// State of a zstd file being compressed while it is written
+typedef struct {
+    FILE *fp;
+    ZSTD_CStream *stream;
+    void *output_buffer;
+    size_t output_size;
+} so_ZstdWriter;
+
+// Write callback for libxml. Return len or -1 for error.
+static int so_zstd_write(void *context, const char *buffer, int len)
+{
+    so_ZstdWriter *writer = (so_ZstdWriter *) context;
+    ZSTD_inBuffer input = { buffer, len, 0 };
+
+    while (input.pos < input.size) {
+        ZSTD_outBuffer output = { writer->output_buffer, writer->output_size, 0 };
+        size_t ret = ZSTD_compressStream(writer->stream, &output, &input);
+        if (ZSTD_isError(ret)) {
+            return -1;
+        }
+        if (fwrite(writer->output_buffer, 1, output.pos, writer->fp) != output.pos) {
+            return -1;
+        }
+    }
+
+    return len;
+}
+
+static void so_zstd_writer_free(so_ZstdWriter *writer)
+{
+    ZSTD_freeCStream(writer->stream);
+    free(writer->output_buffer);
+    free(writer);
+}
+
+// Close callback for libxml. Flush the end of the zstd frame and close the file.
+static int so_zstd_write_close(void *context)
+{
+    so_ZstdWriter *writer = (so_ZstdWriter *) context;
+    int fail = 0;
+    size_t remaining;
+
+    do {
+        ZSTD_outBuffer output = { writer->output_buffer, writer->output_size, 0 };
+        remaining = ZSTD_endStream(writer->stream, &output);
+        if (ZSTD_isError(remaining)) {
+            fail = 1;
+            break;
+        }
+        if (fwrite(writer->output_buffer, 1, output.pos, writer->fp) != output.pos) {
+            fail = 1;
+            break;
+        }
+    } while (remaining > 0);
+
+    if (fclose(writer->fp)) {
+        fail = 1;
+    }
+    so_zstd_writer_free(writer);
+
+    return fail ? -1 : 0;
+}
+
+// Create an output buffer that writes a zstd compressed file
+xmlOutputBufferPtr so_zstd_create_output_buffer(const char *filename, int level)
+{
+    so_ZstdWriter *writer = calloc(sizeof(so_ZstdWriter), 1);
+    if (!writer) {
+        return NULL;
+    }
+    writer->stream = ZSTD_createCStream();
+    writer->output_size = ZSTD_CStreamOutSize();
+    writer->output_buffer = malloc(writer->output_size);
+    if (!writer->stream || !writer->output_buffer || ZSTD_isError(ZSTD_initCStream(writer->stream, level))) {
+        so_zstd_writer_free(writer);
+        return NULL;
+    }
+    writer->fp = fopen(filename, "wb");
+    if (!writer->fp) {
+        so_zstd_writer_free(writer);
+        return NULL;
+    }
+
+    xmlOutputBufferPtr out = xmlOutputBufferCreateIO(so_zstd_write, so_zstd_write_close, writer, NULL);
+    if (!out) {
+        so_zstd_write_close(writer);
+    }
+    return out;
+}
+
+#else
+
+xmlParserCtxtPtr so_zstd_create_parser_context(const char *filename)
+{
+    return NULL;
+}
+
+xmlParserInputBufferPtr so_zstd_create_input_buffer(const char *filename)
+{
+    return NULL;
+}
+
+xmlOutputBufferPtr so_zstd_create_output_buffer(const char *filename, int level)
+{
+    return NULL;
+}
+
+#endif
+
+// Create an output buffer that writes a file with the given compression. A negative level gives the default level.
+xmlOutputBufferPtr so_compression_create_output_buffer(const char *filename, so_Compression compression, int level)
+{
+    if (compression == SO_COMPRESSION_ZSTD) {
+        return so_zstd_create_output_buffer(filename, level < 0 ? SO_ZSTD_DEFAULT_LEVEL : level);
+    } else if (compression == SO_COMPRESSION_GZIP) {
+        return xmlOutputBufferCreateFilename(filename, NULL, level < 0 ? SO_GZIP_DEFAULT_LEVEL : level);
+    } else {
+        return xmlOutputBufferCreateFilename(filename, NULL, 0);
+    }
+}
+
+// Create an input buffer that gives the bytes of a file decompressing it if needed.
+// gzip is handled by the file loader of libxml.
+xmlParserInputBufferPtr so_compression_create_input_buffer(const char *filename)
+{
+    if (so_compression_of_file(filename) == SO_COMPRESSION_ZSTD) {
+        return so_zstd_create_input_buffer(filename);
+    }
+    return xmlParserInputBufferCreateFilename(filename, XML_CHAR_ENCODING_NONE);
+}
+
+/* Close the file or stream of an output buffer that is owned by a text writer. xmlFreeTextWriter ignores
+ * errors when it closes the output, e.g. when the end of a zstd frame or the last buffered data cannot be
+ * written, so the output is closed here first. The buffer itself is still freed by the text writer. */
+int so_compression_close_output(xmlOutputBufferPtr out)
+{
+    int fail = xmlOutputBufferFlush(out) < 0 || out->error;
+    if (out->closecallback) {
+        fail = out->closecallback(out->context) < 0 || fail;
+    }
+    out->writecallback = NULL;
+    out->closecallback = NULL;
+    out->context = NULL;
+    return fail;
+}
@@ -0,0 +1,152 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <so/private/hash.h>
+#include <pharmml/string.h>
+
+unsigned int so_Hash_bytes(const void *data, size_t length, unsigned int hash)
+{
+    const unsigned char *p = (const unsigned char *) data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= p[i];
+        hash *= SO_HASH_FNV_PRIME;
+    }
+    return hash;
+}
+
+unsigned int so_Hash_string(const char *key)
+{
+    unsigned int hash = SO_HASH_FNV_OFFSET;
+    for (const unsigned char *p = (const unsigned char *) key; *p; p++) {
+        hash ^= *p;
+        hash *= SO_HASH_FNV_PRIME;
+    }
+    return hash;
+}
+
+so_Hash *so_Hash_new(int expected_count)
+{
+    so_Hash *hash = calloc(sizeof(so_Hash), 1);
+    if (!hash) {
+        return NULL;
+    }
+
+    // Keep the load factor below 0.5
+    int size = 16;
+    while (size < 2 * expected_count) {
+        size *= 2;
+    }
+
+    hash->keys = calloc(size, sizeof(char *));
+    hash->values = malloc(size * sizeof(int));
+    if (!hash->keys || !hash->values) {
+        so_Hash_free(hash);
+        return NULL;
+    }
+    hash->size = size;
+
+    return hash;
+}
+
+void so_Hash_free(so_Hash *self)
+{
+    if (self) {
+        if (self->keys) {
+            for (int i = 0; i < self->size; i++) {
+                free(self->keys[i]);
+            }
+        }
+        free(self->keys);
+        free(self->values);
+        free(self);
+    }
+}
+
+static int so_Hash_find_slot(char **keys, int size, const char *key)
+{
+    unsigned int mask = size - 1;
+    unsigned int slot = so_Hash_string(key) & mask;
+    while (keys[slot] && strcmp(keys[slot], key) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/* Get the value of a key or -1 if the key is not in the hash */
+int so_Hash_get(so_Hash *self, const char *key)
+{
+    int slot = so_Hash_find_slot(self->keys, self->size, key);
+    if (self->keys[slot]) {
+        return self->values[slot];
+    } else {
+        return -1;
+    }
+}
+
+static int so_Hash_grow(so_Hash *self)
+{
+    int new_size = self->size * 2;
+    char **new_keys = calloc(new_size, sizeof(char *));
+    int *new_values = malloc(new_size * sizeof(int));
+    if (!new_keys || !new_values) {
+        free(new_keys);
+        free(new_values);
+        return 1;
+    }
+
+    for (int i = 0; i < self->size; i++) {
+        if (self->keys[i]) {
+            int slot = so_Hash_find_slot(new_keys, new_size, self->keys[i]);
+            new_keys[slot] = self->keys[i];
+            new_values[slot] = self->values[i];
+        }
+    }
+
+    free(self->keys);
+    free(self->values);
+    self->keys = new_keys;
+    self->values = new_values;
+    self->size = new_size;
+
+    return 0;
+}
+
+/* Insert or update a key. The key will be copied */
+int so_Hash_put(so_Hash *self, const char *key, int value)
+{
+    if (2 * (self->count + 1) > self->size) {
+        if (so_Hash_grow(self)) {
+            return 1;
+        }
+    }
+
+    int slot = so_Hash_find_slot(self->keys, self->size, key);
+    if (!self->keys[slot]) {
+        char *key_copy = pharmml_strdup(key);
+        if (!key_copy) {
+            return 1;
+        }
+        self->keys[slot] = key_copy;
+        self->count++;
+    }
+    self->values[slot] = value;
+
+    return 0;
+}
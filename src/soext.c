@@ -17,7 +17,10 @@
 
 #include <stdlib.h>
 #include <memory.h>
+#include <errno.h>
+#include <unistd.h>
 #include <libxml/SAX.h>
+#include <libxml/parserInternals.h>
 #include <libxml/xmlwriter.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
@@ -25,8 +28,21 @@
 #include <so.h>
 #include <so/private/SO.h>
 #include <so/private/SOBlock.h>
+#include <so/private/ReadContext.h>
+#include <so/private/compression.h>
+#include <so/private/stats.h>
+#include <so/private/Aggregate.h>
+#include <so/private/MessageIndex.h>
+#include <so/private/Scan.h>
 #include <pharmml/common_types.h>
 #include <so/Table.h>
+#include <so/private/Table.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Number of SOBlocks per thread that are serialized in memory before being written out
+#define SO_WRITE_BATCH_PER_THREAD 4
 
 static char *last_error;
 
@@ -40,6 +56,7 @@ void so_SO_on_start_element(void *ctx, const xmlChar *localname, const xmlChar *
 {
     char *name = (char *) localname;
     so_SO *so = (so_SO *) ctx;
+    so_stats_start_element(name);
     if (strcmp("SO", name) == 0) {
         so_SO_init_attributes(so, nb_attributes, (const char **) attributes);
     } else {
@@ -50,11 +67,34 @@ void so_SO_on_start_element(void *ctx, const xmlChar *localname, const xmlChar *
     }
 }
 
+// Index the messages of the SOBlocks not yet in the message index
+static int so_SO_extend_message_index(so_SO *self)
+{
+    if (!self->message_index) {
+        self->message_index = so_MessageIndex_new(&self->message_index);
+        if (!self->message_index) {
+            return 1;
+        }
+    }
+    for (int i = self->message_index->num_blocks; i < self->num_SOBlock; i++) {
+        if (so_MessageIndex_add_SOBlock(self->message_index, self->SOBlock[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 void so_SO_on_end_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI)
 {
     char *name = (char *) localname;
     so_SO *so = (so_SO *) ctx;
-    so_SO_end_element(so, name);
+    if (so_SO_end_element(so, name)) {
+        so->error = 1;
+    }
+    if (strcmp(name, "TaskInformation") == 0 && so_SO_extend_message_index(so)) {
+        so->error = 1;
+    }
+    so_stats_end_element();
 }
 
 void so_SO_on_characters(void *ctx, const xmlChar *ch, int len)
@@ -71,15 +111,15 @@ void error_func(void *ctx, const char *msg, ...)
 
 }
 
-/** \memberof so_SO
- * Read an SO from file
- * \param filename - the file to read
- * \return A pointer to an so_SO structure containing the read file
- * \sa so_SO_write
- */
-so_SO *so_SO_read(char *filename)
+/* Parse an SO from an already created parser context */
+static so_SO *so_SO_parse(xmlParserCtxtPtr ctxt, so_ReadContext *context)
 {
     so_SO *so = so_SO_new();
+    if (!so) {
+        xmlFreeParserCtxt(ctxt);
+        last_error = "Out of memory";
+        return NULL;
+    }
 
     xmlSAXHandler sax_handler;
 
@@ -93,7 +133,28 @@ so_SO *so_SO_read(char *filename)
     xmlGenericErrorFunc handler = (xmlGenericErrorFunc) error_func;
     initGenericErrorDefaultFunc(&handler);
 
-    int err = xmlSAXUserParseFile(&sax_handler, so, filename); 
+    so_stats *stats = context ? context->stats : NULL;
+    so_stats_begin(stats, SO_STATS_READ);
+    so_ReadContext *previous_context = so_ReadContext_current;
+    so_ReadContext_current = context;
+
+    xmlSAXHandlerPtr old_sax = ctxt->sax;
+    ctxt->sax = &sax_handler;
+    ctxt->userData = so;
+
+    xmlParseDocument(ctxt);
+
+    int err = 0;
+    if (!ctxt->wellFormed) {
+        err = ctxt->errNo ? ctxt->errNo : -1;
+    }
+    so_stats_add_bytes(xmlByteConsumed(ctxt));
+    so_stats_end();
+    so_ReadContext_current = previous_context;
+
+    ctxt->sax = old_sax;
+    ctxt->userData = NULL;
+    xmlFreeParserCtxt(ctxt);
 
     if (so->error) {
         so_SO_free(so);
@@ -103,8 +164,57 @@ so_SO *so_SO_read(char *filename)
 
     if (err) { 
         so_SO_free(so);
-        xmlError *error = xmlGetLastError();
-        last_error = error->message;
+        const xmlError *error = xmlGetLastError();
+        last_error = error ? error->message : "SO read error";
+        return NULL;
+    }
+
+    so->stats = stats;
+
+    return so;
+}
+
+/** \memberof so_SO
+ * Read an SO from file
+ * \param filename - the file to read
+ * \return A pointer to an so_SO structure containing the read file
+ * \sa so_SO_write, so_SO_read_with_context
+ */
+so_SO *so_SO_read(char *filename)
+{
+    return so_SO_read_with_context(filename, NULL);
+}
+
+/** \memberof so_SO
+ * Read an SO from file using the options of a read context. Files compressed with gzip
+ * or zstd are decompressed while read.
+ * \param filename - the file to read
+ * \param context - pointer to an so_ReadContext or NULL for default options
+ * \return A pointer to an so_SO structure containing the read file
+ * \sa so_SO_read
+ */
+so_SO *so_SO_read_with_context(char *filename, so_ReadContext *context)
+{
+    // gzip is handled by the file loader of libxml
+    xmlParserCtxtPtr ctxt;
+    so_Compression compression = so_compression_of_file(filename);
+    if (!so_compression_is_available(compression)) {
+        last_error = "Compression method of file not supported by this build";
+        return NULL;
+    }
+    if (compression == SO_COMPRESSION_ZSTD) {
+        ctxt = so_zstd_create_parser_context(filename);
+    } else {
+        ctxt = xmlCreateFileParserCtxt(filename);
+    }
+    if (!ctxt) {
+        const xmlError *error = xmlGetLastError();
+        last_error = error ? error->message : "Could not open file";
+        return NULL;
+    }
+
+    so_SO *so = so_SO_parse(ctxt, context);
+    if (!so) {
         return NULL;
     }
 
@@ -119,50 +229,542 @@ so_SO *so_SO_read(char *filename)
 }
 
 /** \memberof so_SO
- * Write an SO structure to file
- * \param self - The SO to write
- * \param filename - the file to write to
- * \param pretty - 1 for nice indentation, 0 for compact
- * \return - 0 if no error
+ * Scan an SO file for its metadata without loading it. The id, metadataFile and PharmMLRef of the SO, the blkId,
+ * ToolSettings files and a summary of the TaskInformation of each SOBlock and the path, column definitions, number
+ * of rows and byte range of each table are collected. The rows of the tables are skipped without being parsed and
+ * the memory used does not depend on the number of rows. Files compressed with gzip or zstd are decompressed while read.
+ * \param filename - the file to scan
+ * \return A pointer to a new so_Scan or NULL for error
  * \sa so_SO_read
  */
-int so_SO_write(so_SO *self, char *filename, int pretty)
+so_Scan *so_SO_scan(char *filename)
+{
+    so_Compression compression = so_compression_of_file(filename);
+    if (!so_compression_is_available(compression)) {
+        last_error = "Compression method of file not supported by this build";
+        return NULL;
+    }
+    xmlParserInputBufferPtr input = so_compression_create_input_buffer(filename);
+    if (!input) {
+        last_error = "Could not open file";
+        return NULL;
+    }
+
+    so_Scan *scan = so_Scan_read(input);
+    xmlFreeParserInputBuffer(input);
+    if (!scan) {
+        last_error = "SO scan error";
+    }
+
+    return scan;
+}
+
+/** \memberof so_SO
+ * Load a single table of an SO file without reading the rest of the file. The byte range of the table
+ * is taken from a scan of the file, either from so_SO_scan or from an index file read by so_Scan_read_index.
+ * Only the part of the file holding the table is mapped into memory and parsed. Random access is not
+ * possible in compressed files.
+ * \param filename - the SO file that was scanned
+ * \param scan - pointer to an so_Scan of the file
+ * \param table - the number of the table in the scan
+ * \return A pointer to a new so_Table or NULL for error
+ * \sa so_SO_scan, so_Scan_find_table
+ */
+so_Table *so_SO_load_table_at(char *filename, so_Scan *scan, int table)
+{
+    if (table < 0 || table >= so_Scan_get_number_of_tables(scan)) {
+        last_error = "Table not available in scan";
+        return NULL;
+    }
+    if (so_compression_of_file(filename) != SO_COMPRESSION_NONE) {
+        last_error = "Tables cannot be loaded by offset from compressed files";
+        return NULL;
+    }
+
+    so_Table *result = so_Scan_load_table(scan, filename, table);
+    if (!result) {
+        last_error = "Table could not be loaded. The file could have changed since it was scanned.";
+    }
+
+    return result;
+}
+
+// A memory buffer being read by libxml
+typedef struct {
+    const char *buffer;
+    size_t size;
+    size_t pos;
+} so_MemoryInput;
+
+static int so_memory_read(void *context, char *buffer, int len)
+{
+    so_MemoryInput *input = (so_MemoryInput *) context;
+    size_t n = input->size - input->pos;
+    if (n > (size_t) len) {
+        n = len;
+    }
+    memcpy(buffer, input->buffer + input->pos, n);
+    input->pos += n;
+    return (int) n;
+}
+
+static int so_fd_read(void *context, char *buffer, int len)
+{
+    int fd = *(int *) context;
+    ssize_t n;
+    do {
+        n = read(fd, buffer, len);
+    } while (n < 0 && errno == EINTR);
+    return (int) n;
+}
+
+/** \memberof so_SO
+ * Read an SO using a callback to get the data. Compressed data is not supported.
+ * The path of the SO will not be set. Use so_SO_set_path if relative paths need to be resolved.
+ * \param read - function to put up to len bytes of the document into buffer. Returns number of bytes read, 0 at end and -1 for error.
+ * \param close - function called when reading is done or NULL
+ * \param callback_context - pointer that will be passed to the callbacks
+ * \param context - pointer to an so_ReadContext or NULL for default options
+ * \return A pointer to the read so_SO or NULL for error
+ * \sa so_SO_read_memory, so_SO_read_fd, so_SO_set_path
+ */
+so_SO *so_SO_read_callback(so_read_callback read, so_close_callback close, void *callback_context, so_ReadContext *context)
+{
+    // The close callback will be called by libxml also if creation fails
+    xmlParserCtxtPtr ctxt = xmlCreateIOParserCtxt(NULL, NULL, read, close, callback_context, XML_CHAR_ENCODING_NONE);
+    if (!ctxt) {
+        const xmlError *error = xmlGetLastError();
+        last_error = error ? error->message : "Could not create parser";
+        return NULL;
+    }
+
+    return so_SO_parse(ctxt, context);
+}
+
+/** \memberof so_SO
+ * Read an SO from a buffer in memory. Compressed data is not supported.
+ * \param buffer - the SO document
+ * \param size - the size of the buffer in bytes
+ * \param context - pointer to an so_ReadContext or NULL for default options
+ * \return A pointer to the read so_SO or NULL for error
+ * \sa so_SO_read_callback, so_SO_write_memory
+ */
+so_SO *so_SO_read_memory(const char *buffer, size_t size, so_ReadContext *context)
+{
+    so_MemoryInput input = { buffer, size, 0 };
+    return so_SO_read_callback(so_memory_read, NULL, &input, context);
+}
+
+/** \memberof so_SO
+ * Read an SO from an open file descriptor, for example a pipe. Compressed data is not supported.
+ * The file descriptor will not be closed.
+ * \param fd - the file descriptor to read from
+ * \param context - pointer to an so_ReadContext or NULL for default options
+ * \return A pointer to the read so_SO or NULL for error
+ * \sa so_SO_read_callback, so_SO_write_fd
+ */
+so_SO *so_SO_read_fd(int fd, so_ReadContext *context)
+{
+    return so_SO_read_callback(so_fd_read, NULL, &fd, context);
+}
+
+/* Write an SO to an output buffer. The buffer will be closed */
+#ifdef _OPENMP
+// Create a text writer into a memory buffer with the same settings as used when writing a file
+static xmlTextWriterPtr so_memory_writer(xmlBufferPtr buffer, int pretty)
+{
+    xmlTextWriterPtr writer = xmlNewTextWriterMemory(buffer, 0);
+    if (!writer) {
+        return NULL;
+    }
+    if (pretty) {
+        if (xmlTextWriterSetIndent(writer, 1) < 0 || xmlTextWriterSetIndentString(writer, BAD_CAST "  ") < 0) {
+            xmlFreeTextWriter(writer);
+            return NULL;
+        }
+    }
+    return writer;
+}
+
+// A serialized SOBlock. The bytes of the SOBlock start at offset in the buffer.
+typedef struct {
+    xmlBufferPtr buffer;
+    int offset;
+    int length;
+    so_stats *stats;
+} so_SOBlockChunk;
+
+// Serialize an SOBlock into a memory buffer giving the same bytes as it would get after another
+// SOBlock inside of a document. The SOBlock is written inside of a dummy SO element after an
+// empty dummy SOBlock to get the writer into the same state and the dummy output is then skipped.
+static int so_SOBlock_serialize(so_SOBlock *block, int pretty, so_SOBlockChunk *chunk)
+{
+    chunk->buffer = xmlBufferCreate();
+    if (!chunk->buffer) {
+        return 1;
+    }
+    xmlTextWriterPtr writer = so_memory_writer(chunk->buffer, pretty);
+    if (!writer) {
+        return 1;
+    }
+
+    int fail = xmlTextWriterStartElement(writer, BAD_CAST "SO") < 0 ||
+        xmlTextWriterStartElement(writer, BAD_CAST "SOBlock") < 0 ||
+        xmlTextWriterEndElement(writer) < 0 ||
+        xmlTextWriterFlush(writer) < 0;
+    if (!fail) {
+        chunk->offset = xmlBufferLength(chunk->buffer);
+        so_stats_begin(chunk->stats, SO_STATS_WRITE);
+        if (chunk->stats) {
+            chunk->stats->depth = 1;    // Inside of the SO element
+        }
+        fail = so_SOBlock_xml(block, writer);
+        so_stats_end();
+    }
+    fail = fail || xmlTextWriterFlush(writer) < 0;
+    xmlFreeTextWriter(writer);
+    if (fail) {
+        return 1;
+    }
+
+    chunk->length = xmlBufferLength(chunk->buffer) - chunk->offset;
+    return 0;
+}
+
+// Write an SO serializing its SOBlocks in parallel. Gives exactly the same bytes as the sequential
+// writer. The start of the SO and the first SOBlock are written with a text writer on the output. The
+// other SOBlocks are serialized in batches to limit the memory needed and written directly to the output
+// after which the text writer ends the SO. The text writer is in the same state after each SOBlock so
+// it does not need to know about the SOBlocks that it did not write. The buffer will be closed.
+static int so_SO_write_output_parallel(so_SO *self, xmlOutputBufferPtr out, int pretty)
+{
+    xmlTextWriterPtr writer = xmlNewTextWriter(out);
+    if (!writer) {
+        xmlOutputBufferClose(out);
+        return 1;
+    }
+
+    xmlInitParser();    // Initialize libxml before using it from multiple threads
+    int batch_size = omp_get_max_threads() * SO_WRITE_BATCH_PER_THREAD;
+    so_SOBlockChunk *chunks = calloc(batch_size, sizeof(so_SOBlockChunk));
+    if (!chunks) goto fail;
+
+    if (pretty) {
+        if (xmlTextWriterSetIndent(writer, 1) < 0 || xmlTextWriterSetIndentString(writer, BAD_CAST "  ") < 0) goto fail;
+    }
+    if (xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL) < 0) goto fail;
+    so_stats_begin(self->stats, SO_STATS_WRITE);
+    int failed = so_SO_xml_start(self, writer) || so_SOBlock_xml(self->SOBlock[0], writer);
+    so_stats_end();
+    if (failed || xmlTextWriterFlush(writer) < 0) goto fail;
+
+    for (int first = 1; first < self->num_SOBlock; first += batch_size) {
+        int size = self->num_SOBlock - first < batch_size ? self->num_SOBlock - first : batch_size;
+        for (int i = 0; i < size; i++) {
+            if (self->stats) {
+                chunks[i].stats = so_stats_new();
+                failed |= !chunks[i].stats;
+            }
+        }
+
+        if (!failed) {
+            #pragma omp parallel for schedule(dynamic) reduction(|:failed)
+            for (int i = 0; i < size; i++) {
+                failed |= so_SOBlock_serialize(self->SOBlock[first + i], pretty, &chunks[i]);
+            }
+        }
+
+        for (int i = 0; i < size; i++) {
+            if (!failed) {
+                const char *content = (const char *) xmlBufferContent(chunks[i].buffer);
+                failed = xmlOutputBufferWrite(out, chunks[i].length, content + chunks[i].offset) < 0;
+                if (self->stats) {
+                    so_stats_merge(self->stats, chunks[i].stats);
+                }
+            }
+            xmlBufferFree(chunks[i].buffer);
+            so_stats_free(chunks[i].stats);
+            memset(&chunks[i], 0, sizeof(so_SOBlockChunk));
+        }
+        if (failed) goto fail;
+    }
+
+    so_stats_begin(self->stats, SO_STATS_WRITE);
+    if (self->stats) {
+        self->stats->depth = 1;     // Inside of the SO element
+    }
+    failed = so_SO_xml_end(self, writer);
+    so_stats_end();
+    if (failed || xmlTextWriterEndDocument(writer) < 0 || xmlTextWriterFlush(writer) < 0) goto fail;
+    if (self->stats) {
+        self->stats->write.bytes += out->written;
+    }
+
+    free(chunks);
+    failed = so_compression_close_output(out);
+    xmlFreeTextWriter(writer);
+    return failed;
+
+fail:
+    free(chunks);
+    xmlFreeTextWriter(writer);
+    return 1;
+}
+#endif
+
+static int so_SO_write_output(so_SO *self, xmlOutputBufferPtr out, int pretty)
 {
     int rc;
     xmlTextWriterPtr writer;
 
-    writer = xmlNewTextWriterFilename(filename, 0);
-    if (!writer) return 1;
+#ifdef _OPENMP
+    if (self->num_SOBlock > 1 && omp_get_max_threads() > 1) {
+        return so_SO_write_output_parallel(self, out, pretty);
+    }
+#endif
+
+    writer = xmlNewTextWriter(out);
+    if (!writer) {
+        xmlOutputBufferClose(out);
+        return 1;
+    }
     if (pretty) {
         rc = xmlTextWriterSetIndent(writer, 1);
-        if (rc < 0) return 1;
+        if (rc < 0) goto fail;
         rc = xmlTextWriterSetIndentString(writer, BAD_CAST "  ");
-        if (rc < 0) return 1;
+        if (rc < 0) goto fail;
     }
 
     rc = xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL);
-    if (rc < 0) return 1;
+    if (rc < 0) goto fail;
 
+    so_stats_begin(self->stats, SO_STATS_WRITE);
     rc = so_SO_xml(self, writer);
-    if (rc != 0) return 1;
+    so_stats_end();
+    if (rc != 0) goto fail;
    
     // Properties must be set AFTER the Element was written. 
 
     rc = xmlTextWriterEndDocument(writer);
-    if (rc < 0) return 1;
+    if (rc < 0) goto fail;
 
+    rc = xmlTextWriterFlush(writer);
+    if (rc < 0) goto fail;
+    if (self->stats) {
+        self->stats->write.bytes += out->written;
+    }
+
+    int fail = so_compression_close_output(out);
+    xmlFreeTextWriter(writer);
+    return fail;
+
+fail:
     xmlFreeTextWriter(writer);
+    return 1;
+}
+
+/** \memberof so_SO
+ * Write an SO structure to file. Files with names ending with .gz or .zst will be
+ * compressed with gzip or zstd using the default compression level.
+ * \param self - The SO to write
+ * \param filename - the file to write to
+ * \param pretty - 1 for nice indentation, 0 for compact
+ * \return - 0 if no error
+ * \sa so_SO_read, so_SO_write_compressed
+ */
+int so_SO_write(so_SO *self, char *filename, int pretty)
+{
+    return so_SO_write_compressed(self, filename, pretty, so_compression_from_filename(filename), -1);
+}
+
+/** \memberof so_SO
+ * Write an SO structure to a compressed file
+ * \param self - The SO to write
+ * \param filename - the file to write to
+ * \param pretty - 1 for nice indentation, 0 for compact
+ * \param compression - the compression method
+ * \param level - compression level (1-9 for gzip and 1-22 for zstd) or -1 for the default level
+ * \return - 0 if no error
+ * \sa so_SO_write, so_compression_is_available
+ */
+int so_SO_write_compressed(so_SO *self, char *filename, int pretty, so_Compression compression, int level)
+{
+    if (!so_compression_is_available(compression)) {
+        last_error = "Compression method not supported by this build";
+        return 1;
+    }
+
+    xmlOutputBufferPtr out = so_compression_create_output_buffer(filename, compression, level);
+    if (!out) return 1;
+
+    if (so_SO_write_output(self, out, pretty)) {
+        return 1;
+    }
 
     int path_length = so_string_path_length(filename);
     char *path = NULL;
     if (path_length) {
         path = pharmml_strndup(filename, path_length);
     }
+    free(self->path);
     self->path = path;
 
     return 0;
 }
 
+// A growing memory buffer being written by libxml
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t alloced;
+} so_MemoryOutput;
+
+static int so_memory_write(void *context, const char *buffer, int len)
+{
+    so_MemoryOutput *output = (so_MemoryOutput *) context;
+    if (output->size + len + 1 > output->alloced) {
+        size_t new_alloced = 2 * output->alloced;
+        if (new_alloced < output->size + len + 1) {
+            new_alloced = output->size + len + 1;
+        }
+        char *new_buffer = realloc(output->buffer, new_alloced);
+        if (!new_buffer) {
+            return -1;
+        }
+        output->buffer = new_buffer;
+        output->alloced = new_alloced;
+    }
+    memcpy(output->buffer + output->size, buffer, len);
+    output->size += len;
+    output->buffer[output->size] = '\0';
+    return len;
+}
+
+/** \memberof so_SO
+ * Write an SO using a callback to output the data
+ * \param self - The SO to write
+ * \param write - function to write len bytes from buffer. Returns len or -1 for error.
+ * \param close - function called when writing is done or NULL
+ * \param callback_context - pointer that will be passed to the callbacks
+ * \param pretty - 1 for nice indentation, 0 for compact
+ * \return - 0 if no error
+ * \sa so_SO_write_memory, so_SO_write_fd
+ */
+int so_SO_write_callback(so_SO *self, so_write_callback write, so_close_callback close, void *callback_context, int pretty)
+{
+    xmlOutputBufferPtr out = xmlOutputBufferCreateIO(write, close, callback_context, NULL);
+    if (!out) {
+        if (close) {
+            close(callback_context);
+        }
+        return 1;
+    }
+
+    return so_SO_write_output(self, out, pretty);
+}
+
+/** \memberof so_SO
+ * Write an SO into a newly allocated buffer in memory
+ * \param self - The SO to write
+ * \param buffer - pointer to a pointer that will be set to the NUL-terminated document. Free with free().
+ * \param size - pointer to a size that will be set to the size of the document in bytes or NULL
+ * \param pretty - 1 for nice indentation, 0 for compact
+ * \return - 0 if no error
+ * \sa so_SO_read_memory
+ */
+int so_SO_write_memory(so_SO *self, char **buffer, size_t *size, int pretty)
+{
+    so_MemoryOutput output = { NULL, 0, 0 };
+    if (so_SO_write_callback(self, so_memory_write, NULL, &output, pretty)) {
+        free(output.buffer);
+        return 1;
+    }
+
+    *buffer = output.buffer;
+    if (size) {
+        *size = output.size;
+    }
+    return 0;
+}
+
+/** \memberof so_SO
+ * Write an SO to an open file descriptor, for example a pipe. The file descriptor will not be closed.
+ * \param self - The SO to write
+ * \param fd - the file descriptor to write to
+ * \param pretty - 1 for nice indentation, 0 for compact
+ * \return - 0 if no error
+ * \sa so_SO_read_fd
+ */
+int so_SO_write_fd(so_SO *self, int fd, int pretty)
+{
+    xmlOutputBufferPtr out = xmlOutputBufferCreateFd(fd, NULL);
+    if (!out) return 1;
+
+    return so_SO_write_output(self, out, pretty);
+}
+
+/** \memberof so_SO
+ * Set the directory used to resolve relative paths, for example to the PharmML file.
+ * It is set automatically when reading or writing an SO file.
+ * \param self - The SO structure
+ * \param path - the directory or NULL to resolve paths relative to the current working directory
+ * \return - 0 if no error
+ * \sa so_SO_get_path, so_SO_pharmml_dom
+ */
+int so_SO_set_path(so_SO *self, char *path)
+{
+    char *new_path = NULL;
+    if (path && path[0] != '\0') {
+        int len = strlen(path);
+        int add_separator = path[len - 1] != '/' && path[len - 1] != '\\';
+        new_path = malloc(len + add_separator + 1);
+        if (!new_path) {
+            return 1;
+        }
+        strcpy(new_path, path);
+        if (add_separator) {
+            strcat(new_path, "/");
+        }
+    }
+    free(self->path);
+    self->path = new_path;
+    return 0;
+}
+
+/** \memberof so_SO
+ * Get the directory used to resolve relative paths
+ * \param self - The SO structure
+ * \return The directory including a trailing separator or NULL if not set
+ * \sa so_SO_set_path
+ */
+char *so_SO_get_path(so_SO *self)
+{
+    return self->path;
+}
+
+/** \memberof so_SO
+ * Attach an so_stats structure to an SO to collect statistics on subsequent writes.
+ * The so_stats will not be freed together with the SO.
+ * \param self - The SO structure
+ * \param stats - pointer to an so_stats or NULL to stop collecting statistics
+ * \sa so_SO_get_stats, so_ReadContext_set_stats
+ */
+void so_SO_set_stats(so_SO *self, so_stats *stats)
+{
+    self->stats = stats;
+}
+
+/** \memberof so_SO
+ * Get the so_stats structure attached to an SO
+ * \param self - The SO structure
+ * \return A pointer to the so_stats or NULL if none was attached
+ * \sa so_SO_set_stats
+ */
+so_stats *so_SO_get_stats(so_SO *self)
+{
+    return self->stats;
+}
+
 /** \memberof so_SO
  * Get a specific SOBlock given its name
  * \param self - The SO structure
@@ -181,173 +783,391 @@ so_SOBlock *so_SO_get_SOBlock_from_name(so_SO *self, char *name)
     return NULL;
 }
 
-/** \memberof so_SO
- * Gather all mle population estimates over all SOBlocks
- * \param self - The SO structure
- * \return - A pointer to a newly created table with the results
- */
-so_Table *so_SO_all_population_estimates(so_SO *self)
+// Set the parameters of a table in the rows added last to an aggregation. The parameters are either the
+// columns of a one row table (e.g. PopulationEstimates/MLE) or the rows of a table with the names in the
+// first column and the values in the second (e.g. StandardError). The table is only read.
+static int so_aggregate_parameters(so_AggregateSegment *segment, so_Table *table, int by_column)
 {
-    so_Table *table = so_Table_new();
-
-    if (!table) {
-        return table;
-    }
-
-    int numcols = 0;
-
-    // Find all parameters and create an empty column for each
-    for (int i = 0; i < so_SO_get_number_of_SOBlock(self); i++) {
-        so_SOBlock *block = so_SO_get_SOBlock(self, i);
-        so_Estimation *est = so_SOBlock_get_Estimation(block);
-        if (!est)
-            continue;
-        so_PopulationEstimates *pe = so_Estimation_get_PopulationEstimates(est);
-        if (!pe)
-            continue;
-        so_Table *mle = so_PopulationEstimates_get_MLE(pe);
-        if (!mle)
-            continue;
-        int numcols_mle = so_Table_get_number_of_columns(mle);
-        for (int col = 0; col < numcols_mle; col++) {
-            pharmml_valueType value_type = so_Table_get_valueType(mle, col);
-            pharmml_columnType *column_type = so_Table_get_columnType(mle, col);
-            int number_of_columnTypes = so_Table_get_num_columnTypes(mle, col);
-            char *columnId = so_Table_get_columnId(mle, col);
-            if (so_Table_get_index_from_name(table, columnId) == -1) {    // Do we not yet have this parameter?
-                so_Table_new_column_no_copy(table, columnId, column_type, number_of_columnTypes, value_type, NULL);
-                numcols++;
+    if (!table || table->numrows == 0) {
+        return 0;
+    }
+
+    if (!by_column) {
+        if (table->numcols < 2 || so_aggregate_valueType(table->columns[0]->valueType) != PHARMML_VALUETYPE_STRING ||
+                table->columns[1]->valueType != PHARMML_VALUETYPE_REAL) {
+            return 0;
+        }
+        so_ColumnRun names = SO_COLUMN_RUN_INIT;
+        so_ColumnRun values = SO_COLUMN_RUN_INIT;
+        for (int row = 0; row < table->numrows; row++) {
+            char *name = *(char **) so_Column_run_cell(table->columns[0], &names, row);
+            double value = *(double *) so_Column_run_cell(table->columns[1], &values, row);
+            if (name && so_AggregateSegment_set_real(segment, name, value)) {
+                return 1;
             }
         }
+        return 0;
     }
 
-    // Add one row per SOBlock
-    for (int i = 0; i < so_SO_get_number_of_SOBlock(self); i++) {
-        so_SOBlock *block = so_SO_get_SOBlock(self, i);
-        so_Estimation *est = so_SOBlock_get_Estimation(block);
-        so_Table *mle = NULL;
-        if (est) {
-            so_PopulationEstimates *pe = so_Estimation_get_PopulationEstimates(est);
-            if (pe) {
-                mle = so_PopulationEstimates_get_MLE(pe);
+    for (int col = 0; col < table->numcols; col++) {
+        so_Column *column = table->columns[col];
+        if (column->valueType == PHARMML_VALUETYPE_REAL || column->valueType == PHARMML_VALUETYPE_INT) {
+            so_ColumnRun run = SO_COLUMN_RUN_INIT;
+            void *cell = so_Column_run_cell(column, &run, 0);
+            double value = column->valueType == PHARMML_VALUETYPE_REAL ? *(double *) cell : *(int *) cell;
+            if (so_AggregateSegment_set_value(segment, column->columnId, column->columnType, column->num_columnType, PHARMML_VALUETYPE_REAL, &value)) {
+                return 1;
             }
         }
+    }
+    return 0;
+}
 
-        table->numrows++;
-
-        for (int col = 0; col < numcols; col++) {
-            so_Column *new_column = table->columns[col];
-            if (mle) {
-                char *id = so_Table_get_columnId(table, col);
-                void *data = so_Table_get_column_from_name(mle, id);
-                if (data) {
-                    double *real = (double *) data;     // Must probably be real
-                    so_Column_add_real(new_column, real[0]);
-                } else {
-                    so_Column_add_real(new_column, pharmml_na());
-                }
-            } else {        // No table set all to NA
-                so_Column_add_real(new_column, pharmml_na()); 
-            }
+static so_Table *so_SOBlock_population_estimates_table(so_SOBlock *block)
+{
+    so_Estimation *est = so_SOBlock_get_Estimation(block);
+    so_PopulationEstimates *pe = est ? so_Estimation_get_PopulationEstimates(est) : NULL;
+    return pe ? so_PopulationEstimates_get_MLE(pe) : NULL;
+}
+
+static so_MLE *so_SOBlock_precision_mle(so_SOBlock *block)
+{
+    so_Estimation *est = so_SOBlock_get_Estimation(block);
+    so_PrecisionPopulationEstimates *ppe = est ? so_Estimation_get_PrecisionPopulationEstimates(est) : NULL;
+    return ppe ? so_PrecisionPopulationEstimates_get_MLE(ppe) : NULL;
+}
+
+static int so_SO_map_population_estimates(so_AggregateSegment *segment, int item, void *context)
+{
+    so_SOBlock *block = ((so_SO *) context)->SOBlock[item];
+    if (so_AggregateSegment_new_rows(segment, 1)) {
+        return 1;
+    }
+    return so_aggregate_parameters(segment, so_SOBlock_population_estimates_table(block), 1);
+}
+
+static int so_SO_map_standard_errors(so_AggregateSegment *segment, int item, void *context)
+{
+    so_SOBlock *block = ((so_SO *) context)->SOBlock[item];
+    if (so_AggregateSegment_new_rows(segment, 1) || so_SOBlock_derive_standard_errors(block)) {
+        return 1;
+    }
+    so_MLE *mle = so_SOBlock_precision_mle(block);
+    return so_aggregate_parameters(segment, mle ? so_MLE_get_StandardError(mle) : NULL, 0);
+}
+
+static int so_SO_map_relative_standard_errors(so_AggregateSegment *segment, int item, void *context)
+{
+    so_SOBlock *block = ((so_SO *) context)->SOBlock[item];
+    if (so_AggregateSegment_new_rows(segment, 1) || so_SOBlock_derive_standard_errors(block)) {
+        return 1;
+    }
+    so_MLE *mle = so_SOBlock_precision_mle(block);
+    return so_aggregate_parameters(segment, mle ? so_MLE_get_RelativeStandardError(mle) : NULL, 0);
+}
+
+// Shrinkage tables have one column per random variable or one row per random variable with the name first
+static int so_aggregate_shrinkage(so_AggregateSegment *segment, so_Table *table)
+{
+    int by_column = !table || table->numcols < 2 || so_aggregate_valueType(table->columns[0]->valueType) != PHARMML_VALUETYPE_STRING;
+    return so_aggregate_parameters(segment, table, by_column);
+}
+
+static int so_SO_map_shrinkage(so_AggregateSegment *segment, int item, void *context)
+{
+    so_SOBlock *block = ((so_SO *) context)->SOBlock[item];
+    if (so_AggregateSegment_new_rows(segment, 1)) {
+        return 1;
+    }
+    so_Estimation *est = so_SOBlock_get_Estimation(block);
+    if (!est) {
+        return 0;
+    }
+    so_IndividualEstimates *ie = so_Estimation_get_IndividualEstimates(est);
+    so_Residuals *residuals = so_Estimation_get_Residuals(est);
+    return so_aggregate_shrinkage(segment, ie ? so_IndividualEstimates_get_EtaShrinkage(ie) : NULL) ||
+        so_aggregate_shrinkage(segment, residuals ? so_Residuals_get_EpsShrinkage(residuals) : NULL);
+}
+
+static int so_SO_map_ofv(so_AggregateSegment *segment, int item, void *context)
+{
+    so_SOBlock *block = ((so_SO *) context)->SOBlock[item];
+    if (so_AggregateSegment_new_rows(segment, 1)) {
+        return 1;
+    }
+    so_Estimation *est = so_SOBlock_get_Estimation(block);
+    so_OFMeasures *of = est ? so_Estimation_get_OFMeasures(est) : NULL;
+    double ofv = pharmml_na();
+    if (of) {
+        if (so_OFMeasures_get_ToolObjFunction(of)) {
+            ofv = *so_OFMeasures_get_ToolObjFunction(of);
+        } else if (so_OFMeasures_get_Deviance(of)) {
+            ofv = *so_OFMeasures_get_Deviance(of);
+        } else if (so_OFMeasures_get_LogLikelihood(of)) {
+            ofv = -2 * *so_OFMeasures_get_LogLikelihood(of);
+        }
+    }
+    return so_AggregateSegment_set_real(segment, "OFV", ofv);
+}
+
+static int so_aggregate_optional_real(so_AggregateSegment *segment, char *columnId, double *value)
+{
+    return so_AggregateSegment_set_real(segment, columnId, value ? *value : pharmml_na());
+}
+
+// The contributions are the first numeric column that is not an id column
+static int so_aggregate_contributions(so_AggregateSegment *segment, so_Table *table)
+{
+    int column = -1;
+    for (int i = 0; table && i < table->numcols && column < 0; i++) {
+        so_Column *col = table->columns[i];
+        int is_id = 0;
+        for (int j = 0; j < col->num_columnType; j++) {
+            is_id |= col->columnType[j] == PHARMML_COLTYPE_ID;
+        }
+        if (!is_id && (col->valueType == PHARMML_VALUETYPE_REAL || col->valueType == PHARMML_VALUETYPE_INT)) {
+            column = i;
+        }
+    }
+
+    int n = 0;
+    double sum = pharmml_na();
+    double min = pharmml_na();
+    double max = pharmml_na();
+    if (column >= 0 && so_Table_reduce_column(table, column, &n, &sum, &min, &max)) {
+        return 1;
+    }
+
+    return so_AggregateSegment_set_int(segment, "IndividualContribToLL_N", n) ||
+        so_AggregateSegment_set_real(segment, "IndividualContribToLL_SUM", n > 0 ? sum : pharmml_na()) ||
+        so_AggregateSegment_set_real(segment, "IndividualContribToLL_MIN", min) ||
+        so_AggregateSegment_set_real(segment, "IndividualContribToLL_MAX", max);
+}
+
+// All columns are set for every SOBlock to keep their order fixed
+static int so_SO_map_objective_measures(so_AggregateSegment *segment, int item, void *context)
+{
+    so_SOBlock *block = ((so_SO *) context)->SOBlock[item];
+    if (so_AggregateSegment_new_rows(segment, 1)) {
+        return 1;
+    }
+    so_Estimation *est = so_SOBlock_get_Estimation(block);
+    so_OFMeasures *of = est ? so_Estimation_get_OFMeasures(est) : NULL;
+    so_InformationCriteria *ic = of ? so_OFMeasures_get_InformationCriteria(of) : NULL;
+
+    return so_AggregateSegment_set_string(segment, "blkId", so_SOBlock_get_blkId(block)) ||
+        so_aggregate_optional_real(segment, "Likelihood", of ? so_OFMeasures_get_Likelihood(of) : NULL) ||
+        so_aggregate_optional_real(segment, "LogLikelihood", of ? so_OFMeasures_get_LogLikelihood(of) : NULL) ||
+        so_aggregate_optional_real(segment, "Deviance", of ? so_OFMeasures_get_Deviance(of) : NULL) ||
+        so_aggregate_optional_real(segment, "ToolObjFunction", of ? so_OFMeasures_get_ToolObjFunction(of) : NULL) ||
+        so_aggregate_optional_real(segment, "AIC", ic ? so_InformationCriteria_get_AIC(ic) : NULL) ||
+        so_aggregate_optional_real(segment, "BIC", ic ? so_InformationCriteria_get_BIC(ic) : NULL) ||
+        so_aggregate_optional_real(segment, "DIC", ic ? so_InformationCriteria_get_DIC(ic) : NULL) ||
+        so_aggregate_contributions(segment, of ? so_OFMeasures_get_IndividualContribToLL(of) : NULL);
+}
+
+static int so_SO_map_messages(so_AggregateSegment *segment, int item, void *context)
+{
+    so_SOBlock *block = ((so_SO *) context)->SOBlock[item];
+    so_TaskInformation *ti = so_SOBlock_get_TaskInformation(block);
+    if (!ti) {
+        return 0;
+    }
+    for (int i = 0; i < so_TaskInformation_get_number_of_Message(ti); i++) {
+        so_Message *message = so_TaskInformation_get_Message(ti, i);
+        int *severity = so_Message_get_Severity(message);
+        if (so_AggregateSegment_new_rows(segment, 1) ||
+                so_AggregateSegment_set_string(segment, "blkId", so_SOBlock_get_blkId(block)) ||
+                so_AggregateSegment_set_string(segment, "type", so_Message_get_type(message)) ||
+                so_AggregateSegment_set_string(segment, "toolname", so_Message_get_Toolname(message)) ||
+                so_AggregateSegment_set_string(segment, "name", so_Message_get_Name(message)) ||
+                so_AggregateSegment_set_string(segment, "content", so_Message_get_Content(message)) ||
+                so_AggregateSegment_set_int(segment, "severity", severity ? *severity : 0)) {
+            return 1;
         }
     }
+    return 0;
+}
 
-    return table;
+/** \memberof so_SO
+ * Gather all mle population estimates over all SOBlocks. The result has one real column per parameter
+ * and one row per SOBlock, e.g. for bootstrap or SSE runs. Parameters missing from an SOBlock are NA.
+ * The SOBlocks are gathered in parallel if libsoc was built with OpenMP.
+ * \param self - The SO structure
+ * \return - A pointer to a newly created table with the results or NULL if out of memory
+ * \sa so_Table_bootstrap_summary
+ */
+so_Table *so_SO_all_population_estimates(so_SO *self)
+{
+    return so_aggregate(self->num_SOBlock, so_SO_map_population_estimates, self);
 }
 
 /** \memberof so_SO
- * Gather all mle standard errors for all parameters over all SOBlocks
+ * Gather all mle standard errors for all parameters over all SOBlocks. SOBlocks having a CovarianceMatrix but
+ * no StandardError table will get one derived from the covariance matrix.
  * \param self - The SO structure
- * \return - A pointer to a newly created table with the results
+ * \return - A pointer to a newly created table with the results or NULL if out of memory
+ * \sa so_SOBlock_derive_standard_errors
  */
 so_Table *so_SO_all_standard_errors(so_SO *self)
 {
-    so_Table *table = so_Table_new();
-
-    if (!table) {
-        return table;
-    }
-
-    int numcols = 0;
-
-    // Find all parameters and create an empty column for each
-    for (int i = 0; i < so_SO_get_number_of_SOBlock(self); i++) {
-        so_SOBlock *block = so_SO_get_SOBlock(self, i);
-        so_Estimation *est = so_SOBlock_get_Estimation(block);
-        if (!est)
-            continue;
-        so_PrecisionPopulationEstimates *ppe = so_Estimation_get_PrecisionPopulationEstimates(est);
-        if (!ppe)
-            continue;
-        so_MLE *mle = so_PrecisionPopulationEstimates_get_MLE(ppe);
-        if (!mle)
-            continue;
-        so_Table *se = so_MLE_get_StandardError(mle);
-        if (!se)
-            continue;
-        int numrows_se = so_Table_get_number_of_rows(se);
-        char **names = (char **) so_Table_get_column_from_name(se, "Parameter");
-        pharmml_valueType value_type = so_Table_get_valueType(se, 1);      // SEs are in the second column
-        pharmml_columnType column_type = PHARMML_COLTYPE_UNDEFINED;         // SE table does not support this in the SO
-        for (int row = 0; row < numrows_se; row++) {
-            char *columnId = names[row];
-            if (so_Table_get_index_from_name(table, columnId) == -1) {    // Do we not yet have this parameter?
-                so_Table_new_column_no_copy(table, columnId, &column_type, 1, value_type, NULL);
-                numcols++;
-            }
-        }
+    return so_aggregate(self->num_SOBlock, so_SO_map_standard_errors, self);
+}
+
+/** \memberof so_SO
+ * Gather all mle relative standard errors for all parameters over all SOBlocks. SOBlocks having a CovarianceMatrix but
+ * no RelativeStandardError table will get one derived from the covariance matrix and the population estimates.
+ * \param self - The SO structure
+ * \return - A pointer to a newly created table with the results or NULL if out of memory
+ * \sa so_SOBlock_derive_standard_errors
+ */
+so_Table *so_SO_all_relative_standard_errors(so_SO *self)
+{
+    return so_aggregate(self->num_SOBlock, so_SO_map_relative_standard_errors, self);
+}
+
+/** \memberof so_SO
+ * Gather the eta and epsilon shrinkage over all SOBlocks. The result has one real column per random variable
+ * and one row per SOBlock. Random variables missing from an SOBlock are NA.
+ * \param self - The SO structure
+ * \return - A pointer to a newly created table with the results or NULL if out of memory
+ */
+so_Table *so_SO_all_shrinkage(so_SO *self)
+{
+    return so_aggregate(self->num_SOBlock, so_SO_map_shrinkage, self);
+}
+
+/** \memberof so_SO
+ * Gather the objective function value of all SOBlocks. The result has one row per SOBlock and the real column OFV
+ * which is the ToolObjFunction, the Deviance or -2 times the LogLikelihood in this order of preference and NA if none
+ * of these is available.
+ * \param self - The SO structure
+ * \return - A pointer to a newly created table with the results or NULL if out of memory
+ */
+so_Table *so_SO_all_ofv(so_SO *self)
+{
+    return so_aggregate(self->num_SOBlock, so_SO_map_ofv, self);
+}
+
+/** \memberof so_SO
+ * Gather the objective function measures and information criteria of all SOBlocks in one pass. The result has one row
+ * per SOBlock and the columns blkId, Likelihood, LogLikelihood, Deviance, ToolObjFunction, AIC, BIC and DIC followed by
+ * a summary of the IndividualContribToLL table: the number of non-missing contributions, their sum, minimum and maximum.
+ * Missing measures are NA.
+ * \param self - The SO structure
+ * \return - A pointer to a newly created table with the results or NULL if out of memory
+ * \sa so_SO_all_ofv
+ */
+so_Table *so_SO_all_objective_measures(so_SO *self)
+{
+    return so_aggregate(self->num_SOBlock, so_SO_map_objective_measures, self);
+}
+
+/** \memberof so_SO
+ * Gather the messages of the TaskInformation of all SOBlocks. The result has one row per message and the columns
+ * blkId, type, toolname, name, content and severity. Missing strings are empty and a missing severity is 0.
+ * \param self - The SO structure
+ * \return - A pointer to a newly created table with the results or NULL if out of memory
+ */
+so_Table *so_SO_all_messages(so_SO *self)
+{
+    return so_aggregate(self->num_SOBlock, so_SO_map_messages, self);
+}
+
+// Get the message index making sure that it covers the current SOBlocks. Changes to indexed
+// messages have already freed the index so only added SOBlocks need to be indexed.
+static so_MessageIndex *so_SO_message_index(so_SO *self)
+{
+    if (so_SO_extend_message_index(self)) {
+        return NULL;
     }
+    return self->message_index;
+}
 
-    // Add one row per SOBlock
-    for (int i = 0; i < so_SO_get_number_of_SOBlock(self); i++) {
-        so_SOBlock *block = so_SO_get_SOBlock(self, i);
-        so_Estimation *est = so_SOBlock_get_Estimation(block);
-        double *data = NULL;
-        char **names;
-        int numrows = 0;
-        if (est) {
-            so_PrecisionPopulationEstimates *pe = so_Estimation_get_PrecisionPopulationEstimates(est);
-            if (pe) {
-                so_MLE *mle = so_PrecisionPopulationEstimates_get_MLE(pe);
-                if (mle) {
-                    so_Table *se = so_MLE_get_StandardError(mle);
-                    if (se) {
-                        data = (double *) so_Table_get_column_from_name(se, "SE");
-                        names = (char **) so_Table_get_column_from_name(se, "Parameter");
-                        numrows = so_Table_get_number_of_rows(se);
-                    }
-                }
+// NULL type or toolname matches all
+static int so_MessageGroup_matches(so_MessageGroup *group, char *type, char *toolname)
+{
+    return (!type || strcmp(type, group->type) == 0) && (!toolname || strcmp(toolname, group->toolname) == 0);
+}
+
+/** \memberof so_SO
+ * Count the messages of the TaskInformation of all SOBlocks having at least a certain severity. The count is
+ * taken from the severity histograms of the message index that is built while reading the SO.
+ * Severities are counted as being between 0 and 10, i.e. higher severities as 10, and a missing Severity as 0.
+ * \param self - The SO structure
+ * \param min_severity - The lowest severity to count. At most 10.
+ * \param type - Only count messages of this type, e.g. "ERROR", or NULL for all types
+ * \param toolname - Only count messages from this tool or NULL for all tools
+ * \return The number of messages found or -1 if min_severity is above 10 or out of memory
+ * \sa so_SO_find_messages
+ */
+int so_SO_count_messages(so_SO *self, int min_severity, char *type, char *toolname)
+{
+    if (min_severity > SO_MESSAGE_MAX_SEVERITY) {
+        return -1;
+    }
+    so_MessageIndex *index = so_SO_message_index(self);
+    if (!index) {
+        return -1;
+    }
+
+    int first = min_severity < 0 ? 0 : min_severity;
+    int count = 0;
+    for (int i = 0; i < index->num_groups; i++) {
+        so_MessageGroup *group = &index->groups[i];
+        if (so_MessageGroup_matches(group, type, toolname)) {
+            for (int severity = first; severity <= SO_MESSAGE_MAX_SEVERITY; severity++) {
+                count += group->histogram[severity];
             }
         }
+    }
 
-        table->numrows++;
-
-        for (int col = 0; col < numcols; col++) {
-            so_Column *new_column = table->columns[col];
-            if (data) {
-                // Find row in se table
-                char *id = so_Table_get_columnId(table, col);
-                if (id) {
-                    int found = 0;
-                    for (int row = 0; row < numrows; row++) {           // Loop through rows to find id
-                        if (strcmp(names[row], id) == 0) {
-                            so_Column_add_real(new_column, data[row]);
-                            found = 1;
-                            break;
-                        }
-                    }
-                    if (!found)
-                        so_Column_add_real(new_column, pharmml_na());
-                } else {
-                    so_Column_add_real(new_column, pharmml_na());
-                }
-            } else {        // No table set all to NA
-                so_Column_add_real(new_column, pharmml_na());
-            }
+    return count;
+}
+
+/** \memberof so_SO
+ * Find the messages of the TaskInformation of all SOBlocks having at least a certain severity using the message
+ * index that is built while reading the SO. The index is rebuilt if SOBlocks or messages were changed.
+ * Severities are counted as being between 0 and 10 as in so_SO_count_messages.
+ * \param self - The SO structure
+ * \param min_severity - The lowest severity to include. At most 10.
+ * \param type - Only include messages of this type, e.g. "ERROR", or NULL for all types
+ * \param toolname - Only include messages from this tool or NULL for all tools
+ * \param num_messages - Pointer to where the number of found messages will be stored
+ * \return A newly allocated array of the messages in document order to be freed by the caller or NULL
+ * if min_severity is above 10 or out of memory. The messages themselves belong to the SO.
+ * \sa so_SO_count_messages, so_SO_all_messages
+ */
+so_Message **so_SO_find_messages(so_SO *self, int min_severity, char *type, char *toolname, int *num_messages)
+{
+    int count = so_SO_count_messages(self, min_severity, type, toolname);
+    if (count == -1) {
+        return NULL;
+    }
+    so_MessageIndex *index = self->message_index;
+
+    int *matching = malloc((index->num_groups + 1) * sizeof(int));
+    so_Message **messages = malloc((count + 1) * sizeof(so_Message *));
+    if (!matching || !messages) {
+        free(matching);
+        free(messages);
+        return NULL;
+    }
+    for (int i = 0; i < index->num_groups; i++) {
+        matching[i] = so_MessageGroup_matches(&index->groups[i], type, toolname);
+    }
+
+    int n = 0;
+    for (int i = 0; i < index->num_entries && n < count; i++) {
+        so_MessageEntry *entry = &index->entries[i];
+        if (matching[entry->group] && entry->severity >= min_severity) {
+            messages[n++] = entry->message;
         }
     }
+    free(matching);
 
-    return table;
+    *num_messages = n;
+    return messages;
 }
 
 xmlDoc *so_SO_pharmml_dom(so_SO *self)
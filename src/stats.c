@@ -0,0 +1,575 @@
+/* libsoc - Library to handle standardised output files
+ * Copyright (C) 2015 Rikard Nordgren
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * his library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <so/stats.h>
+#include <so/private/stats.h>
+#include <pharmml/string.h>
+
+/** \struct so_stats
+	 \brief Counters and timings collected while reading or writing an SO
+*/
+
+// Depth of the top level sections, i.e. the children of SOBlock
+#define SECTION_DEPTH 3
+
+so_stats *so_stats_current = NULL;
+
+static double so_stats_clock(void)
+{
+#if defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+    return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static void so_stats_counter_free(so_stats_counter *counter)
+{
+    so_Hash_free(counter->index);
+    for (int i = 0; i < counter->size; i++) {
+        free(counter->names[i]);
+    }
+    free(counter->names);
+    free(counter->counts);
+    free(counter->seconds);
+    memset(counter, 0, sizeof(so_stats_counter));
+}
+
+// Get the index of a named counter. Create the counter if needed.
+static int so_stats_counter_index(so_stats_counter *counter, const char *name)
+{
+    if (!counter->index) {
+        counter->index = so_Hash_new(64);
+        if (!counter->index) {
+            return -1;
+        }
+    }
+
+    int index = so_Hash_get(counter->index, name);
+    if (index >= 0) {
+        return index;
+    }
+
+    int new_size = counter->size + 1;
+    char **new_names = realloc(counter->names, new_size * sizeof(char *));
+    if (!new_names) {
+        return -1;
+    }
+    counter->names = new_names;
+    long *new_counts = realloc(counter->counts, new_size * sizeof(long));
+    if (!new_counts) {
+        return -1;
+    }
+    counter->counts = new_counts;
+    double *new_seconds = realloc(counter->seconds, new_size * sizeof(double));
+    if (!new_seconds) {
+        return -1;
+    }
+    counter->seconds = new_seconds;
+
+    // The names of the counters are not part of the string bytes being counted
+    size_t name_length = strlen(name) + 1;
+    char *name_copy = malloc(name_length);
+    if (!name_copy) {
+        return -1;
+    }
+    memcpy(name_copy, name, name_length);
+    so_stats *current = so_stats_current;
+    so_stats_current = NULL;
+    int fail = so_Hash_put(counter->index, name, counter->size);
+    so_stats_current = current;
+    if (fail) {
+        free(name_copy);
+        return -1;
+    }
+
+    index = counter->size;
+    counter->names[index] = name_copy;
+    counter->counts[index] = 0;
+    counter->seconds[index] = 0;
+    counter->size = new_size;
+
+    return index;
+}
+
+static so_stats_direction *so_stats_direction_of(so_stats *self, so_stats_mode mode)
+{
+    if (mode == SO_STATS_READ) {
+        return &self->read;
+    } else {
+        return &self->write;
+    }
+}
+
+/** \memberof so_stats
+ * Create a new so_stats structure with all counters set to zero.
+ * Statistics are only collected when the structure has been attached to a read or a write
+ * \return A pointer to the newly created struct or NULL if memory allocation failed
+ * \sa so_ReadContext_set_stats, so_SO_set_stats
+ */
+so_stats *so_stats_new(void)
+{
+    so_stats *stats = calloc(sizeof(so_stats), 1);
+    if (stats) {
+        stats->section = -1;
+    }
+
+    return stats;
+}
+
+/** \memberof so_stats
+ * Free all memory associated with an so_stats structure
+ * \param self - a pointer to the structure to free
+ */
+void so_stats_free(so_stats *self)
+{
+    if (self) {
+        if (so_stats_current == self) {
+            so_stats_current = NULL;
+        }
+        so_stats_counter_free(&self->read.elements);
+        so_stats_counter_free(&self->read.sections);
+        so_stats_counter_free(&self->write.elements);
+        so_stats_counter_free(&self->write.sections);
+        free(self);
+    }
+}
+
+/** \memberof so_stats
+ * Set all counters and timings to zero
+ * \param self - pointer to an so_stats
+ */
+void so_stats_reset(so_stats *self)
+{
+    so_stats_counter_free(&self->read.elements);
+    so_stats_counter_free(&self->read.sections);
+    so_stats_counter_free(&self->write.elements);
+    so_stats_counter_free(&self->write.sections);
+    memset(self, 0, sizeof(so_stats));
+    self->section = -1;
+}
+
+/** \memberof so_stats
+ * Get the number of bytes read or written
+ * \param self - pointer to an so_stats
+ * \param mode - SO_STATS_READ or SO_STATS_WRITE
+ * \return The number of bytes
+ */
+size_t so_stats_get_bytes(so_stats *self, so_stats_mode mode)
+{
+    return so_stats_direction_of(self, mode)->bytes;
+}
+
+/** \memberof so_stats
+ * Get the number of different element names that have been read or written
+ * \param self - pointer to an so_stats
+ * \param mode - SO_STATS_READ or SO_STATS_WRITE
+ * \return The number of element names
+ * \sa so_stats_get_element_name, so_stats_get_element_count
+ */
+int so_stats_get_number_of_elements(so_stats *self, so_stats_mode mode)
+{
+    return so_stats_direction_of(self, mode)->elements.size;
+}
+
+/** \memberof so_stats
+ * Get the local name of an element type
+ * \param self - pointer to an so_stats
+ * \param mode - SO_STATS_READ or SO_STATS_WRITE
+ * \param index - index of the element type
+ * \return The element name or NULL if index is out of range
+ */
+char *so_stats_get_element_name(so_stats *self, so_stats_mode mode, int index)
+{
+    so_stats_counter *elements = &so_stats_direction_of(self, mode)->elements;
+    if (index < 0 || index >= elements->size) {
+        return NULL;
+    }
+    return elements->names[index];
+}
+
+/** \memberof so_stats
+ * Get the number of start element events of an element type
+ * \param self - pointer to an so_stats
+ * \param mode - SO_STATS_READ or SO_STATS_WRITE
+ * \param index - index of the element type
+ * \return The number of events or 0 if index is out of range
+ */
+long so_stats_get_element_count(so_stats *self, so_stats_mode mode, int index)
+{
+    so_stats_counter *elements = &so_stats_direction_of(self, mode)->elements;
+    if (index < 0 || index >= elements->size) {
+        return 0;
+    }
+    return elements->counts[index];
+}
+
+/** \memberof so_stats
+ * Get the number of table cells of a certain valueType that were parsed or written
+ * \param self - pointer to an so_stats
+ * \param mode - SO_STATS_READ or SO_STATS_WRITE
+ * \param valueType - the valueType of the cells
+ * \return The number of cells
+ */
+long so_stats_get_cells(so_stats *self, so_stats_mode mode, pharmml_valueType valueType)
+{
+    if (valueType < 0 || valueType > PHARMML_VALUETYPE_ERROR) {
+        return 0;
+    }
+    return so_stats_direction_of(self, mode)->cells[valueType];
+}
+
+/** \memberof so_stats
+ * Get the number of string bytes that were duplicated while reading or
+ * written as string values
+ * \param self - pointer to an so_stats
+ * \param mode - SO_STATS_READ or SO_STATS_WRITE
+ * \return The number of bytes
+ */
+size_t so_stats_get_string_bytes(so_stats *self, so_stats_mode mode)
+{
+    return so_stats_direction_of(self, mode)->string_bytes;
+}
+
+/** \memberof so_stats
+ * Get the time spent converting between strings and numbers
+ * \param self - pointer to an so_stats
+ * \param mode - SO_STATS_READ or SO_STATS_WRITE
+ * \return The time in seconds
+ */
+double so_stats_get_number_conversion_time(so_stats *self, so_stats_mode mode)
+{
+    return so_stats_direction_of(self, mode)->conversion_time;
+}
+
+/** \memberof so_stats
+ * Get the number of different top level sections, i.e. children of SOBlock, that were timed
+ * \param self - pointer to an so_stats
+ * \param mode - SO_STATS_READ or SO_STATS_WRITE
+ * \return The number of sections
+ * \sa so_stats_get_section_name, so_stats_get_section_time
+ */
+int so_stats_get_number_of_sections(so_stats *self, so_stats_mode mode)
+{
+    return so_stats_direction_of(self, mode)->sections.size;
+}
+
+/** \memberof so_stats
+ * Get the name of a top level section
+ * \param self - pointer to an so_stats
+ * \param mode - SO_STATS_READ or SO_STATS_WRITE
+ * \param index - index of the section
+ * \return The section name or NULL if index is out of range
+ */
+char *so_stats_get_section_name(so_stats *self, so_stats_mode mode, int index)
+{
+    so_stats_counter *sections = &so_stats_direction_of(self, mode)->sections;
+    if (index < 0 || index >= sections->size) {
+        return NULL;
+    }
+    return sections->names[index];
+}
+
+/** \memberof so_stats
+ * Get the total time spent in a top level section summed over all SOBlocks
+ * \param self - pointer to an so_stats
+ * \param mode - SO_STATS_READ or SO_STATS_WRITE
+ * \param index - index of the section
+ * \return The time in seconds
+ */
+double so_stats_get_section_time(so_stats *self, so_stats_mode mode, int index)
+{
+    so_stats_counter *sections = &so_stats_direction_of(self, mode)->sections;
+    if (index < 0 || index >= sections->size) {
+        return 0;
+    }
+    return sections->seconds[index];
+}
+
+/** \memberof so_stats
+ * Get the number of times a column buffer had to be reallocated
+ * \param self - pointer to an so_stats
+ * \return The number of reallocations
+ */
+long so_stats_get_column_reallocs(so_stats *self)
+{
+    return self->column_reallocs;
+}
+
+/** \memberof so_stats
+ * Get the total size of all column buffer reallocations
+ * \param self - pointer to an so_stats
+ * \return The number of bytes
+ */
+size_t so_stats_get_column_realloc_bytes(so_stats *self)
+{
+    return self->column_realloc_bytes;
+}
+
+static void so_stats_print_direction(so_stats_direction *direction, const char *title, FILE *fp)
+{
+    fprintf(fp, "%s\n", title);
+    fprintf(fp, "  bytes: %lu\n", (unsigned long) direction->bytes);
+    fprintf(fp, "  string bytes: %lu\n", (unsigned long) direction->string_bytes);
+    fprintf(fp, "  number conversion time: %f s\n", direction->conversion_time);
+    for (int i = 0; i < PHARMML_VALUETYPE_ERROR; i++) {
+        fprintf(fp, "  %s cells: %ld\n", pharmml_valueType_to_string(i), direction->cells[i]);
+    }
+    for (int i = 0; i < direction->sections.size; i++) {
+        fprintf(fp, "  section %s: %f s\n", direction->sections.names[i], direction->sections.seconds[i]);
+    }
+    for (int i = 0; i < direction->elements.size; i++) {
+        fprintf(fp, "  element %s: %ld\n", direction->elements.names[i], direction->elements.counts[i]);
+    }
+}
+
+/** \memberof so_stats
+ * Print a human readable report of all statistics
+ * \param self - pointer to an so_stats
+ * \param fp - the stream to print to
+ * \return 0 for success
+ */
+int so_stats_print(so_stats *self, FILE *fp)
+{
+    so_stats_print_direction(&self->read, "read", fp);
+    fprintf(fp, "  column reallocs: %ld (%lu bytes)\n", self->column_reallocs, (unsigned long) self->column_realloc_bytes);
+    so_stats_print_direction(&self->write, "write", fp);
+
+    return ferror(fp) ? 1 : 0;
+}
+
+static void so_stats_counter_merge(so_stats_counter *counter, so_stats_counter *other)
+{
+    for (int i = 0; i < other->size; i++) {
+        int index = so_stats_counter_index(counter, other->names[i]);
+        if (index >= 0) {
+            counter->counts[index] += other->counts[i];
+            counter->seconds[index] += other->seconds[i];
+        }
+    }
+}
+
+static void so_stats_direction_merge(so_stats_direction *direction, so_stats_direction *other)
+{
+    direction->bytes += other->bytes;
+    so_stats_counter_merge(&direction->elements, &other->elements);
+    so_stats_counter_merge(&direction->sections, &other->sections);
+    for (int i = 0; i <= PHARMML_VALUETYPE_ERROR; i++) {
+        direction->cells[i] += other->cells[i];
+    }
+    direction->string_bytes += other->string_bytes;
+    direction->conversion_time += other->conversion_time;
+}
+
+/* Add all counters and timings of other to self. Used to combine statistics collected by different threads */
+void so_stats_merge(so_stats *self, so_stats *other)
+{
+    so_stats_direction_merge(&self->read, &other->read);
+    so_stats_direction_merge(&self->write, &other->write);
+    self->column_reallocs += other->column_reallocs;
+    self->column_realloc_bytes += other->column_realloc_bytes;
+}
+
+/* Start collecting statistics. Pass NULL to turn collection off */
+void so_stats_begin(so_stats *stats, so_stats_mode mode)
+{
+    so_stats_current = stats;
+    if (stats) {
+        stats->mode = mode;
+        stats->depth = 0;
+        stats->section = -1;
+    }
+}
+
+void so_stats_end(void)
+{
+    so_stats_section_end();
+    so_stats_current = NULL;
+}
+
+void so_stats_add_bytes(size_t bytes)
+{
+    if (so_stats_current) {
+        so_stats_direction_of(so_stats_current, so_stats_current->mode)->bytes += bytes;
+    }
+}
+
+/* Count one element. The namespace prefix, if any, will not be part of the name */
+void so_stats_count_element(const char *name)
+{
+    if (!so_stats_current) {
+        return;
+    }
+    const char *colon = strchr(name, ':');
+    if (colon) {
+        name = colon + 1;
+    }
+    so_stats_counter *elements = &so_stats_direction_of(so_stats_current, so_stats_current->mode)->elements;
+    int index = so_stats_counter_index(elements, name);
+    if (index >= 0) {
+        elements->counts[index]++;
+    }
+}
+
+/* Count an element and keep track of the depth to be able to time the top level sections */
+void so_stats_start_element(const char *name)
+{
+    if (!so_stats_current) {
+        return;
+    }
+    so_stats_count_element(name);
+    so_stats_current->depth++;
+    if (so_stats_current->depth == SECTION_DEPTH) {
+        so_stats_section_begin(name);
+    }
+}
+
+void so_stats_end_element(void)
+{
+    if (!so_stats_current) {
+        return;
+    }
+    if (so_stats_current->depth == SECTION_DEPTH) {
+        so_stats_section_end();
+    }
+    so_stats_current->depth--;
+}
+
+void so_stats_section_begin(const char *name)
+{
+    if (!so_stats_current) {
+        return;
+    }
+    const char *colon = strchr(name, ':');
+    if (colon) {
+        name = colon + 1;
+    }
+    so_stats_counter *sections = &so_stats_direction_of(so_stats_current, so_stats_current->mode)->sections;
+    so_stats_current->section = so_stats_counter_index(sections, name);
+    so_stats_current->section_start = so_stats_clock();
+}
+
+void so_stats_section_end(void)
+{
+    if (!so_stats_current || so_stats_current->section < 0) {
+        return;
+    }
+    so_stats_counter *sections = &so_stats_direction_of(so_stats_current, so_stats_current->mode)->sections;
+    sections->seconds[so_stats_current->section] += so_stats_clock() - so_stats_current->section_start;
+    sections->counts[so_stats_current->section]++;
+    so_stats_current->section = -1;
+}
+
+void so_stats_count_cell(pharmml_valueType valueType)
+{
+    if (so_stats_current && valueType >= 0 && valueType <= PHARMML_VALUETYPE_ERROR) {
+        so_stats_direction_of(so_stats_current, so_stats_current->mode)->cells[valueType]++;
+    }
+}
+
+void so_stats_count_cells(pharmml_valueType valueType, long n)
+{
+    if (so_stats_current && valueType >= 0 && valueType <= PHARMML_VALUETYPE_ERROR) {
+        so_stats_direction_of(so_stats_current, so_stats_current->mode)->cells[valueType] += n;
+    }
+}
+
+void so_stats_count_string(size_t bytes)
+{
+    if (so_stats_current) {
+        so_stats_direction_of(so_stats_current, so_stats_current->mode)->string_bytes += bytes;
+    }
+}
+
+void so_stats_count_realloc(size_t bytes)
+{
+    if (so_stats_current) {
+        so_stats_current->column_reallocs++;
+        so_stats_current->column_realloc_bytes += bytes;
+    }
+}
+
+/* Number conversions that are timed if statistics are being collected */
+
+double so_stats_string_to_double(const char *str)
+{
+    if (!so_stats_current) {
+        return pharmml_string_to_double(str);
+    }
+    double start = so_stats_clock();
+    double x = pharmml_string_to_double(str);
+    so_stats_direction_of(so_stats_current, so_stats_current->mode)->conversion_time += so_stats_clock() - start;
+    return x;
+}
+
+/* Convert n numbers stored one after the other as NUL terminated strings. Timed as one conversion. */
+void so_stats_strings_to_doubles(const char *str, double *values, int n)
+{
+    double start = so_stats_current ? so_stats_clock() : 0;
+    for (int i = 0; i < n; i++) {
+        values[i] = pharmml_string_to_double(str);
+        str += strlen(str) + 1;
+    }
+    if (so_stats_current) {
+        so_stats_direction_of(so_stats_current, so_stats_current->mode)->conversion_time += so_stats_clock() - start;
+    }
+}
+
+int so_stats_string_to_int(const char *str)
+{
+    if (!so_stats_current) {
+        return pharmml_string_to_int(str);
+    }
+    double start = so_stats_clock();
+    int x = pharmml_string_to_int(str);
+    so_stats_direction_of(so_stats_current, so_stats_current->mode)->conversion_time += so_stats_clock() - start;
+    return x;
+}
+
+char *so_stats_double_to_string(double x)
+{
+    if (!so_stats_current) {
+        return pharmml_double_to_string(x);
+    }
+    double start = so_stats_clock();
+    char *str = pharmml_double_to_string(x);
+    so_stats_direction_of(so_stats_current, so_stats_current->mode)->conversion_time += so_stats_clock() - start;
+    return str;
+}
+
+char *so_stats_int_to_string(int x)
+{
+    if (!so_stats_current) {
+        return pharmml_int_to_string(x);
+    }
+    double start = so_stats_clock();
+    char *str = pharmml_int_to_string(x);
+    so_stats_direction_of(so_stats_current, so_stats_current->mode)->conversion_time += so_stats_clock() - start;
+    return str;
+}
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <so/private/stats.h>
 
 double pharmml_string_to_double(const char *str)
 {
@@ -71,6 +72,7 @@ char *pharmml_strdup(const char *str)
     char *p = malloc(len);
     if (p) {
         memcpy(p, str, len);
+        so_stats_count_string(len);
     }
 
     return p;
@@ -82,11 +84,28 @@ char *pharmml_strndup(const char *str, size_t n)
     if (p) {
         memcpy(p, str, n);
         p[n] = '\0';
+        so_stats_count_string(n + 1);
     }
 
     return p;
 }
 
+// Append n characters to a string that is either NULL or allocated. Used for text content
+// that the SAX parser can deliver in several chunks. Return 0 for success.
+int pharmml_strnappend(char **str, const char *append, size_t n)
+{
+    size_t old_len = *str ? strlen(*str) : 0;
+    char *p = realloc(*str, old_len + n + 1);
+    if (!p) {
+        return 1;
+    }
+    memcpy(p + old_len, append, n);
+    p[old_len + n] = '\0';
+    so_stats_count_string(n + (old_len == 0));
+    *str = p;
+    return 0;
+}
+
 int pharmml_copy_string_array(char **source, char **dest, int length)
 {
     int fail = 0;
@@ -0,0 +1,345 @@
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <so.h>
+
+so_MLE *get_precision_mle(so_SOBlock *block)
+{
+    so_Estimation *est = so_SOBlock_get_Estimation(block);
+    return so_PrecisionPopulationEstimates_get_MLE(so_Estimation_get_PrecisionPopulationEstimates(est));
+}
+
+// Make copies of the pheno SOBlock having only the covariance matrix and with scaled estimates
+so_SO *bootstrap_so(int numblocks)
+{
+    so_SO *so = so_SO_read("pheno.SO.xml");
+    assert(so);
+    so_SOBlock *first = so_SO_get_SOBlock(so, 0);
+    char blkId[12];
+    for (int i = 1; i < numblocks; i++) {
+        so_SOBlock *block = so_SOBlock_copy(first);
+        snprintf(blkId, sizeof(blkId), "B%d", i);
+        so_SOBlock_set_blkId(block, blkId);
+        so_MLE *mle = get_precision_mle(block);
+        so_MLE_set_StandardError(mle, NULL);
+        so_MLE_set_RelativeStandardError(mle, NULL);
+        so_Table *estimates = so_PopulationEstimates_get_MLE(so_Estimation_get_PopulationEstimates(so_SOBlock_get_Estimation(block)));
+        for (int col = 0; col < so_Table_get_number_of_columns(estimates); col++) {
+            double *value = so_Table_get_writable_column(estimates, col);
+            value[0] *= 1 + i * 0.01;
+        }
+        so_SO_add_SOBlock(so, block);
+    }
+    return so;
+}
+
+void test_derive_standard_errors()
+{
+    so_SO *so = bootstrap_so(3);
+    so_Table *se = so_SO_all_standard_errors(so);
+    assert(se);
+    assert(so_Table_get_number_of_rows(se) == 3);
+    assert(so_Table_get_number_of_columns(se) == 5);
+    assert(strcmp(so_Table_get_columnId(se, 0), "TVCL") == 0);
+    for (int col = 0; col < 5; col++) {
+        double *values = so_Table_get_column_from_number(se, col);
+        // The SEs given by the tool agree with the derived from the covariance matrix
+        assert(fabs(values[1] - values[0]) < 1e-5 * values[0]);
+        assert(values[1] == values[2]);
+    }
+    so_Table_free(se);
+
+    // Derived tables were added lazily to the SOBlocks
+    so_Table *table = so_MLE_get_StandardError(get_precision_mle(so_SO_get_SOBlock(so, 1)));
+    assert(table);
+    assert(strcmp(((char **) so_Table_get_column_from_number(table, 0))[4], "SIGMA_1_1_") == 0);
+
+    so_Table *rse = so_SO_all_relative_standard_errors(so);
+    assert(rse);
+    double *tvcl = so_Table_get_column_from_name(rse, "TVCL");
+    assert(fabs(tvcl[0] - 7.10819770132328) < 1e-9);
+    assert(fabs(tvcl[1] - 7.10819770132328 / 1.01) < 1e-3);
+    assert(fabs(tvcl[2] - 7.10819770132328 / 1.02) < 1e-3);
+    so_Table_free(rse);
+
+    so_SO_free(so);
+}
+
+void test_missing_parameters()
+{
+    so_SO *so = bootstrap_so(2);
+    so_SOBlock *empty = so_SOBlock_new();
+    so_SOBlock_set_blkId(empty, "empty");
+    so_SO_add_SOBlock(so, empty);
+
+    // A parameter not in the first block
+    so_Table *table = so_MLE_get_StandardError(get_precision_mle(so_SO_get_SOBlock(so, 0)));
+    char **names = so_Table_get_writable_column(table, 0);
+    names[0] = realloc(names[0], 6);
+    strcpy(names[0], "OTHER");
+
+    so_Table *se = so_SO_all_standard_errors(so);
+    assert(so_Table_get_number_of_rows(se) == 3);
+    assert(so_Table_get_number_of_columns(se) == 6);
+    double *other = so_Table_get_column_from_name(se, "OTHER");
+    double *tvcl = so_Table_get_column_from_name(se, "TVCL");
+    assert(!pharmml_is_na(other[0]) && pharmml_is_na(other[1]) && pharmml_is_na(other[2]));
+    assert(pharmml_is_na(tvcl[0]) && !pharmml_is_na(tvcl[1]) && pharmml_is_na(tvcl[2]));
+    so_Table_free(se);
+
+    so_SO_free(so);
+}
+
+void test_population_estimates()
+{
+    so_SO *so = bootstrap_so(11);
+    so_SOBlock *empty = so_SOBlock_new();
+    so_SOBlock_set_blkId(empty, "empty");
+    so_SO_add_SOBlock(so, empty);
+
+    so_Table *estimates = so_SO_all_population_estimates(so);
+    assert(estimates);
+    assert(so_Table_get_number_of_rows(estimates) == 12);
+    assert(so_Table_get_number_of_columns(estimates) == 5);
+    assert(strcmp(so_Table_get_columnId(estimates, 4), "SIGMA_1_1_") == 0);
+    double *tvcl = so_Table_get_column_from_name(estimates, "TVCL");
+    assert(tvcl[0] == 0.00555363);
+    assert(fabs(tvcl[10] - 0.00555363 * 1.1) < 1e-12);
+    assert(pharmml_is_na(tvcl[11]));
+
+    double probs[] = { 0.975, 0.5, 0.025 };
+    so_Table *summary = so_Table_bootstrap_summary(estimates, 0, probs, 3);
+    assert(summary);
+    assert(so_Table_get_number_of_rows(summary) == 5);
+    assert(so_Table_get_number_of_columns(summary) == 9);
+    assert(strcmp(so_Table_get_columnId(summary, 6), "P97.5") == 0);
+    assert(strcmp(((char **) so_Table_get_column_from_name(summary, "parameter"))[0], "TVCL") == 0);
+    assert(((int *) so_Table_get_column_from_name(summary, "N"))[0] == 10);
+    assert(((double *) so_Table_get_column_from_name(summary, "ORIGINAL"))[0] == 0.00555363);
+    double mean = ((double *) so_Table_get_column_from_name(summary, "MEAN"))[0];
+    assert(fabs(mean - 0.00555363 * 1.055) < 1e-12);
+    assert(fabs(((double *) so_Table_get_column_from_name(summary, "BIAS"))[0] - 0.00555363 * 0.055) < 1e-12);
+    assert(fabs(((double *) so_Table_get_column_from_name(summary, "P50"))[0] - 0.00555363 * 1.055) < 1e-12);
+    double sd = ((double *) so_Table_get_column_from_name(summary, "SD"))[0];
+    assert(fabs(sd - 0.00555363 * 0.01 * sqrt(110.0 / 12)) < 1e-12);
+    so_Table_free(summary);
+
+    // Without an original row
+    summary = so_Table_bootstrap_summary(estimates, -1, probs, 0);
+    assert(so_Table_get_number_of_columns(summary) == 6);
+    assert(((int *) so_Table_get_column_from_name(summary, "N"))[1] == 11);
+    assert(pharmml_is_na(((double *) so_Table_get_column_from_name(summary, "BIAS"))[1]));
+    so_Table_free(summary);
+
+    assert(!so_Table_bootstrap_summary(estimates, 12, probs, 3));
+    probs[0] = 2;
+    assert(!so_Table_bootstrap_summary(estimates, 0, probs, 3));
+
+    so_Table_free(estimates);
+    so_SO_free(so);
+}
+
+void test_aggregators()
+{
+    so_SO *so = so_SO_read("../R/inst/extdata/pheno.SO.xml");
+    assert(so);
+    so_SO_add_SOBlock(so, so_SOBlock_copy(so_SO_get_SOBlock(so, 0)));
+    so_SOBlock *empty = so_SOBlock_new();
+    so_SOBlock_set_blkId(empty, "empty");
+    so_SO_add_SOBlock(so, empty);
+
+    so_Table *ofv = so_SO_all_ofv(so);
+    assert(so_Table_get_number_of_rows(ofv) == 3);
+    double *values = so_Table_get_column_from_name(ofv, "OFV");
+    assert(values[0] == 740.27802534150101 && values[1] == values[0] && pharmml_is_na(values[2]));
+    so_Table_free(ofv);
+
+    so_Table *messages = so_SO_all_messages(so);
+    assert(so_Table_get_number_of_rows(messages) == 26);
+    assert(so_Table_get_number_of_columns(messages) == 6);
+    assert(strcmp(((char **) so_Table_get_column_from_name(messages, "name"))[13], "estimation_successful") == 0);
+    assert(strcmp(((char **) so_Table_get_column_from_name(messages, "type"))[0], "INFORMATION") == 0);
+    assert(((int *) so_Table_get_column_from_name(messages, "severity"))[0] == 1);
+    assert(strcmp(((char **) so_Table_get_column_from_name(messages, "blkId"))[25], so_SOBlock_get_blkId(so_SO_get_SOBlock(so, 1))) == 0);
+    so_Table_free(messages);
+
+    // Shrinkage as one row with a column per eta and as one row per epsilon
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    so_Estimation *est = so_SOBlock_get_Estimation(so_SO_get_SOBlock(so, 1));
+    so_Table *eta = so_IndividualEstimates_create_EtaShrinkage(so_Estimation_get_IndividualEstimates(est));
+    so_Table_set_number_of_rows(eta, 1);
+    double eta_cl[] = { 12.5 };
+    double eta_v[] = { 3.5 };
+    so_Table_new_column(eta, "ETA_CL", &undefined, 1, PHARMML_VALUETYPE_REAL, eta_cl);
+    so_Table_new_column(eta, "ETA_V", &undefined, 1, PHARMML_VALUETYPE_REAL, eta_v);
+    so_Residuals *residuals = so_Estimation_get_Residuals(est);
+    if (!residuals) {
+        residuals = so_Estimation_create_Residuals(est);
+    }
+    so_Table *eps = so_Residuals_create_EpsShrinkage(residuals);
+    so_Table_set_number_of_rows(eps, 1);
+    char *eps_names[] = { "EPS_1" };
+    double eps_values[] = { 20 };
+    so_Table_new_column(eps, "parameter", &undefined, 1, PHARMML_VALUETYPE_STRING, eps_names);
+    so_Table_new_column(eps, "shrinkage", &undefined, 1, PHARMML_VALUETYPE_REAL, eps_values);
+
+    so_Table *shrinkage = so_SO_all_shrinkage(so);
+    assert(so_Table_get_number_of_rows(shrinkage) == 3);
+    assert(so_Table_get_number_of_columns(shrinkage) == 3);
+    assert(strcmp(so_Table_get_columnId(shrinkage, 2), "EPS_1") == 0);
+    double *shrinkage_cl = so_Table_get_column_from_name(shrinkage, "ETA_CL");
+    assert(pharmml_is_na(shrinkage_cl[0]) && shrinkage_cl[1] == 12.5 && pharmml_is_na(shrinkage_cl[2]));
+    assert(((double *) so_Table_get_column_from_name(shrinkage, "EPS_1"))[1] == 20);
+    so_Table_free(shrinkage);
+
+    so_SO_free(so);
+}
+
+void test_objective_measures()
+{
+    so_SO *so = so_SO_read("../R/inst/extdata/pheno.SO.xml");
+    assert(so);
+    so_SOBlock *copy = so_SOBlock_copy(so_SO_get_SOBlock(so, 0));
+    so_SO_add_SOBlock(so, copy);
+    so_OFMeasures *of = so_Estimation_get_OFMeasures(so_SOBlock_get_Estimation(copy));
+    so_InformationCriteria *ic = so_OFMeasures_create_InformationCriteria(of);
+    double aic = 756.3;
+    so_InformationCriteria_set_AIC(ic, &aic);
+
+    // A run-length encoded contribution column with a missing value
+    so_SOBlock *encoded = so_SOBlock_new();
+    so_SOBlock_set_blkId(encoded, "encoded");
+    so_SO_add_SOBlock(so, encoded);
+    of = so_Estimation_create_OFMeasures(so_SOBlock_create_Estimation(encoded));
+    double ll = -12;
+    so_OFMeasures_set_LogLikelihood(of, &ll);
+    so_Table *contrib = so_OFMeasures_create_IndividualContribToLL(of);
+    pharmml_columnType id_type = PHARMML_COLTYPE_ID;
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    int ids[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+    double contributions[] = { 2, 2, 2, 2, 2, 2, 2, 2, pharmml_na(), pharmml_na(), 4, 4 };
+    so_Table_set_number_of_rows(contrib, 12);
+    so_Table_new_column(contrib, "ID", &id_type, 1, PHARMML_VALUETYPE_INT, ids);
+    so_Table_new_column(contrib, "ICtoLL", &undefined, 1, PHARMML_VALUETYPE_REAL, contributions);
+    so_Table_encode_columns(contrib);
+    assert(so_Table_get_encoding(contrib, 1) == SO_COLUMN_RLE);
+
+    so_SOBlock *empty = so_SOBlock_new();
+    so_SOBlock_set_blkId(empty, "empty");
+    so_SO_add_SOBlock(so, empty);
+
+    so_Table *measures = so_SO_all_objective_measures(so);
+    assert(so_Table_get_number_of_rows(measures) == 4);
+    assert(so_Table_get_number_of_columns(measures) == 12);
+    assert(strcmp(so_Table_get_columnId(measures, 0), "blkId") == 0);
+    assert(strcmp(so_Table_get_columnId(measures, 6), "BIC") == 0);
+    assert(strcmp(so_Table_get_columnId(measures, 8), "IndividualContribToLL_N") == 0);
+
+    double *deviance = so_Table_get_column_from_name(measures, "Deviance");
+    assert(deviance[0] == 740.27802534150101 && deviance[1] == deviance[0] && pharmml_is_na(deviance[2]));
+    double *aics = so_Table_get_column_from_name(measures, "AIC");
+    assert(pharmml_is_na(aics[0]) && aics[1] == 756.3 && pharmml_is_na(aics[3]));
+    assert(((double *) so_Table_get_column_from_name(measures, "LogLikelihood"))[2] == -12);
+
+    int *n = so_Table_get_column_from_name(measures, "IndividualContribToLL_N");
+    double *sum = so_Table_get_column_from_name(measures, "IndividualContribToLL_SUM");
+    double *min = so_Table_get_column_from_name(measures, "IndividualContribToLL_MIN");
+    double *max = so_Table_get_column_from_name(measures, "IndividualContribToLL_MAX");
+    assert(n[0] == 59 && fabs(sum[0] - deviance[0]) < 1e-9);
+    assert(fabs(min[0] - 4.41317084290984) < 1e-12 && fabs(max[0] - 42.245541107085614) < 1e-12);
+    assert(n[2] == 10 && sum[2] == 24 && min[2] == 2 && max[2] == 4);
+    assert(n[3] == 0 && pharmml_is_na(sum[3]) && pharmml_is_na(min[3]) && pharmml_is_na(max[3]));
+    so_Table_free(measures);
+
+    so_SO_free(so);
+}
+
+void test_message_index()
+{
+    so_SO *so = so_SO_read("../R/inst/extdata/pheno.SO.xml");
+    assert(so);
+
+    assert(so_SO_count_messages(so, 0, NULL, NULL) == 13);
+    assert(so_SO_count_messages(so, 1, NULL, NULL) == 12);
+    assert(so_SO_count_messages(so, 2, NULL, NULL) == 0);
+    assert(so_SO_count_messages(so, 0, "INFORMATION", "NONMEM") == 11);
+    assert(so_SO_count_messages(so, 0, NULL, "nmoutput2so") == 2);
+    assert(so_SO_count_messages(so, 0, "ERROR", NULL) == 0);
+
+    int n;
+    so_Message **messages = so_SO_find_messages(so, 1, "WARNING", NULL, &n);
+    assert(n == 1);
+    assert(strcmp(so_Message_get_Name(messages[0]), "Name change") == 0);
+    assert(strcmp(so_Message_get_Content(messages[0]),
+        "Parameter label \"SIGMA(1,1)\" not specified or not a legal symbolIdType. Setting/changing it to: SIGMA_1_1_") == 0);
+    free(messages);
+
+    messages = so_SO_find_messages(so, 0, NULL, NULL, &n);
+    assert(n == 13);
+    assert(strcmp(so_Message_get_Name(messages[0]), "estimation_successful") == 0);
+    assert(strcmp(so_Message_get_Name(messages[12]), "nmoutput2so_version") == 0);
+    free(messages);
+
+    // The index follows added SOBlocks and messages
+    so_SOBlock *block = so_SOBlock_new();
+    so_SO_add_SOBlock(so, block);
+    so_Message *error = so_Message_new();
+    so_Message_set_type(error, "ERROR");
+    so_Message_set_Toolname(error, "NONMEM");
+    int severity = 15;
+    so_Message_set_Severity(error, &severity);
+    so_TaskInformation_add_Message(so_SOBlock_create_TaskInformation(block), error);
+    assert(so_SO_count_messages(so, 10, NULL, NULL) == 1);
+    assert(so_SO_count_messages(so, 0, NULL, "NONMEM") == 12);
+
+    so_TaskInformation_add_Message(so_SOBlock_get_TaskInformation(so_SO_get_SOBlock(so, 0)), so_Message_new());
+    assert(so_SO_count_messages(so, 0, NULL, NULL) == 15);
+    messages = so_SO_find_messages(so, 10, "ERROR", "NONMEM", &n);
+    assert(n == 1 && messages[0] == error);
+    free(messages);
+
+    // Changing an indexed message
+    severity = 3;
+    so_Message_set_Severity(error, &severity);
+    assert(so_SO_count_messages(so, 10, NULL, NULL) == 0);
+    assert(so_SO_count_messages(so, 3, "ERROR", NULL) == 1);
+    so_Message_set_type(error, "WARNING");
+    assert(so_SO_count_messages(so, 0, "ERROR", NULL) == 0);
+    assert(so_SO_count_messages(so, 0, "WARNING", NULL) == 2);
+
+    // Replacing a TaskInformation with one having the same number of messages
+    so_TaskInformation *ti = so_TaskInformation_new();
+    so_Message *info = so_TaskInformation_create_Message(ti);
+    so_Message_set_type(info, "INFORMATION");
+    so_SOBlock_set_TaskInformation(block, ti);
+    assert(so_SO_count_messages(so, 0, "WARNING", NULL) == 1);
+    assert(so_SO_count_messages(so, 0, "INFORMATION", NULL) == 13);
+
+    // Severities above 10 cannot be asked for
+    assert(so_SO_count_messages(so, 11, NULL, NULL) == -1);
+    assert(!so_SO_find_messages(so, 11, NULL, NULL, &n));
+
+    so_SO *copy = so_SO_copy(so);
+    assert(so_SO_count_messages(copy, 0, "", "") == 1);
+    so_SO_free(copy);
+
+    // A message that outlives its SO can still be changed
+    so_Message_ref(info);
+    so_SO_free(so);
+    so_Message_set_Severity(info, &severity);
+    so_Message_unref(info);
+}
+
+void main()
+{
+    test_derive_standard_errors();
+    test_missing_parameters();
+    test_population_estimates();
+    test_aggregators();
+    test_objective_measures();
+    test_message_index();
+
+    printf("estimates PASS\n");
+}
@@ -0,0 +1,508 @@
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <so.h>
+
+long file_size(char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+void check_table1(so_SO *so)
+{
+    assert(so);
+    so_Table *table = so_Estimation_get_Predictions(so_SOBlock_get_Estimation(so_SO_get_SOBlock(so, 0)));
+    assert(so_Table_get_number_of_rows(table) == 3);
+    assert(strcmp(so_Table_get_columnId(table, 3), "IPRED") == 0);
+}
+
+void test_compression()
+{
+    assert(so_compression_from_filename("run1.SO.xml.gz") == SO_COMPRESSION_GZIP);
+    assert(so_compression_from_filename("run1.SO.xml.zst") == SO_COMPRESSION_ZSTD);
+    assert(so_compression_from_filename("run1.SO.xml") == SO_COMPRESSION_NONE);
+    assert(so_compression_is_available(SO_COMPRESSION_NONE));
+
+    so_SO *so = so_SO_read("data/table1.SO.xml");
+    assert(so);
+
+    if (so_compression_is_available(SO_COMPRESSION_GZIP)) {
+        assert(so_SO_write(so, "io_test.SO.xml.gz", 1) == 0);
+        FILE *fp = fopen("io_test.SO.xml.gz", "rb");
+        unsigned char magic[2];
+        assert(fread(magic, 1, 2, fp) == 2);
+        fclose(fp);
+        assert(magic[0] == 0x1F && magic[1] == 0x8B);
+
+        so_SO *read = so_SO_read("io_test.SO.xml.gz");
+        check_table1(read);
+        so_SO_free(read);
+
+        // Explicit method and level regardless of file name
+        assert(so_SO_write_compressed(so, "io_test.SO.xml", 0, SO_COMPRESSION_GZIP, 9) == 0);
+        assert(so_SO_write(so, "io_test_plain.SO.xml", 0) == 0);
+        assert(file_size("io_test.SO.xml") < file_size("io_test_plain.SO.xml"));
+        read = so_SO_read("io_test.SO.xml");
+        check_table1(read);
+        so_SO_free(read);
+        remove("io_test.SO.xml.gz");
+        remove("io_test.SO.xml");
+        remove("io_test_plain.SO.xml");
+    }
+
+    if (so_compression_is_available(SO_COMPRESSION_ZSTD)) {
+        assert(so_SO_write(so, "io_test.SO.xml.zst", 0) == 0);
+        so_SO *read = so_SO_read("io_test.SO.xml.zst");
+        check_table1(read);
+        so_SO_free(read);
+        remove("io_test.SO.xml.zst");
+    } else {
+        assert(so_SO_write(so, "io_test.SO.xml.zst", 0) != 0);
+    }
+
+    // Errors when the output is closed are reported
+    if (access("/dev/full", W_OK) == 0) {
+        assert(so_SO_write_compressed(so, "/dev/full", 0, SO_COMPRESSION_NONE, -1) != 0);
+        for (int i = SO_COMPRESSION_GZIP; i <= SO_COMPRESSION_ZSTD; i++) {
+            if (so_compression_is_available(i)) {
+                assert(so_SO_write_compressed(so, "/dev/full", 0, i, -1) != 0);
+            }
+        }
+    }
+
+    so_SO_free(so);
+}
+
+int count_write(void *context, const char *buffer, int len)
+{
+    *(size_t *) context += len;
+    return len;
+}
+
+void test_memory_and_fd()
+{
+    so_SO *so = so_SO_read("data/table1.SO.xml");
+    assert(so);
+
+    char *buffer;
+    size_t size;
+    assert(so_SO_write_memory(so, &buffer, &size, 0) == 0);
+    assert(size == strlen(buffer));
+    assert(strstr(buffer, "IPRED"));
+
+    so_SO *read = so_SO_read_memory(buffer, size, NULL);
+    check_table1(read);
+    assert(so_SO_get_path(read) == NULL);
+    so_SO_free(read);
+
+    assert(!so_SO_read_memory(buffer, size / 2, NULL));
+
+    size_t count = 0;
+    assert(so_SO_write_callback(so, count_write, NULL, &count, 0) == 0);
+    assert(count == size);
+
+    int fd = open("io_test_fd.SO.xml", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    assert(so_SO_write_fd(so, fd, 0) == 0);
+    close(fd);
+    assert(file_size("io_test_fd.SO.xml") == size);
+
+    fd = open("io_test_fd.SO.xml", O_RDONLY);
+    assert(fd >= 0);
+    read = so_SO_read_fd(fd, NULL);
+    close(fd);
+    check_table1(read);
+
+    assert(so_SO_set_path(read, "data") == 0);
+    assert(strcmp(so_SO_get_path(read), "data/") == 0);
+    assert(so_SO_set_path(read, "data/") == 0);
+    assert(strcmp(so_SO_get_path(read), "data/") == 0);
+    assert(so_SO_set_path(read, NULL) == 0);
+    assert(so_SO_get_path(read) == NULL);
+    so_SO_free(read);
+
+    remove("io_test_fd.SO.xml");
+    free(buffer);
+    so_SO_free(so);
+}
+
+int failing_close(void *context)
+{
+    return -1;
+}
+
+void test_writer_close_error()
+{
+    size_t written = 0;
+    so_SO *header = so_SO_new();
+    so_Writer *writer = so_Writer_new_callback(count_write, failing_close, &written, 0);
+    assert(writer);
+    assert(so_Writer_start(writer, header) == 0);
+    so_SO_free(header);
+    assert(so_Writer_close(writer) != 0);
+    assert(written > 0);
+
+    if (access("/dev/full", W_OK) == 0) {
+        header = so_SO_new();
+        writer = so_Writer_new("/dev/full", 0);
+        assert(writer);
+        // Depending on the buffering of libxml2 the error shows when starting or when closing
+        int fail = so_Writer_start(writer, header);
+        so_SO_free(header);
+        fail = so_Writer_close(writer) || fail;
+        assert(fail);
+    }
+}
+
+void test_writer()
+{
+    so_SO *header = so_SO_new();
+    so_SO_set_Description(header, "streamed");
+    so_Writer *writer = so_Writer_new("io_test_writer.SO.xml", 1);
+    assert(writer);
+    assert(so_Writer_start(writer, header) == 0);
+    so_SO_free(header);
+
+    so_SOBlock *block = so_SOBlock_new();
+    so_SOBlock_set_blkId(block, "SO1");
+    assert(so_Writer_add_SOBlock(writer, block) == 0);
+
+    so_Table *definition = so_Table_new();
+    pharmml_columnType id_type = PHARMML_COLTYPE_ID;
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    char *no_data[1] = { NULL };     // The definition table has no rows
+    so_Table_new_column(definition, "ID", &id_type, 1, PHARMML_VALUETYPE_STRING, no_data);
+    so_Table_new_column(definition, "TIME", &undefined, 1, PHARMML_VALUETYPE_REAL, no_data);
+    so_Table_new_column(definition, "DOSE", &undefined, 1, PHARMML_VALUETYPE_INT, no_data);
+
+    assert(so_Writer_start_SOBlock(writer, "SO2") == 0);
+    assert(so_Writer_start_element(writer, "Simulation") == 0);
+    assert(so_Writer_start_element(writer, "SimulationBlock") == 0);
+    assert(so_Writer_write_attribute(writer, "replicate", "1") == 0);
+    assert(so_Writer_start_table(writer, "SimulatedProfiles", definition) == 0);
+    so_Table_unref(definition);
+    assert(so_Writer_write_attribute(writer, "name", "A") == 0);
+    char id[12];
+    for (int i = 0; i < 3000; i++) {
+        snprintf(id, sizeof(id), "%d", i / 10 + 1);
+        assert(so_Writer_start_row(writer) == 0);
+        assert(so_Writer_add_string(writer, id) == 0);
+        assert(so_Writer_add_real(writer, (i % 10) * 0.5) == 0);
+        assert(so_Writer_add_int(writer, i % 10 == 0 ? 100 : 0) == 0);
+        assert(so_Writer_end_row(writer) == 0);
+    }
+    assert(so_Writer_end_table(writer) == 0);
+    assert(so_Writer_end_element(writer) == 0);
+    assert(so_Writer_end_element(writer) == 0);
+    assert(so_Writer_end_element(writer) == 0);
+    assert(so_Writer_close(writer) == 0);
+
+    so_SO *so = so_SO_read("io_test_writer.SO.xml");
+    assert(so);
+    assert(strcmp(so_SO_get_Description(so), "streamed") == 0);
+    assert(so_SO_get_number_of_SOBlock(so) == 2);
+    assert(strcmp(so_SOBlock_get_blkId(so_SO_get_SOBlock(so, 0)), "SO1") == 0);
+    so_SOBlock *block2 = so_SO_get_SOBlock(so, 1);
+    assert(strcmp(so_SOBlock_get_blkId(block2), "SO2") == 0);
+    so_SimulationBlock *simblock = so_Simulation_get_SimulationBlock(so_SOBlock_get_Simulation(block2), 0);
+    assert(*so_SimulationBlock_get_replicate(simblock) == 1);
+    so_SimulationSubType *profiles = so_SimulationBlock_get_SimulatedProfiles(simblock, 0);
+    assert(strcmp(so_SimulationSubType_get_name(profiles), "A") == 0);
+    so_Table *table = so_SimulationSubType_get_base(profiles);
+    assert(so_Table_get_number_of_rows(table) == 3000);
+    assert(strcmp(((char **) so_Table_get_column_from_name(table, "ID"))[2999], "300") == 0);
+    assert(((double *) so_Table_get_column_from_name(table, "TIME"))[2999] == 4.5);
+    assert(((int *) so_Table_get_column_from_name(table, "DOSE"))[2990] == 100);
+    so_SO_free(so);
+    remove("io_test_writer.SO.xml");
+
+    // Misuse fails and makes the writer fail
+    writer = so_Writer_new("io_test_writer.SO.xml", 0);
+    assert(so_Writer_start(writer, NULL) == 0);
+    definition = so_Table_new();
+    so_Table_new_column(definition, "TIME", &undefined, 1, PHARMML_VALUETYPE_REAL, no_data);
+    assert(so_Writer_start_SOBlock(writer, NULL) == 0);
+    assert(so_Writer_start_table(writer, "Predictions", definition) == 0);
+    so_Table_unref(definition);
+    assert(so_Writer_start_row(writer) == 0);
+    assert(so_Writer_add_int(writer, 1) != 0);
+    assert(so_Writer_end_row(writer) != 0);
+    assert(so_Writer_close(writer) != 0);
+    remove("io_test_writer.SO.xml");
+}
+
+void test_write_many_blocks()
+{
+    // Many SOBlocks will be serialized in parallel if built with OpenMP
+    so_SO *so = so_SO_read("data/table1.SO.xml");
+    assert(so);
+    so_SOBlock *first = so_SO_get_SOBlock(so, 0);
+    char blkId[12];
+    for (int i = 1; i < 40; i++) {
+        if (i == 20) {
+            // Empty SOBlocks in the middle and at the end
+            so_SOBlock *empty = so_SOBlock_new();
+            so_SOBlock_set_blkId(empty, "E1");
+            so_SO_add_SOBlock(so, empty);
+        }
+        so_SOBlock *block = so_SOBlock_copy(first);
+        snprintf(blkId, sizeof(blkId), "B%d", i);
+        so_SOBlock_set_blkId(block, blkId);
+        so_SO_add_SOBlock(so, block);
+    }
+    so_SOBlock *empty = so_SOBlock_new();
+    so_SOBlock_set_blkId(empty, "E2");
+    so_SO_add_SOBlock(so, empty);
+    so_stats *stats = so_stats_new();
+    so_SO_set_stats(so, stats);
+
+    for (int pretty = 0; pretty < 2; pretty++) {
+        char *buffer;
+        size_t size;
+        assert(so_SO_write_memory(so, &buffer, &size, pretty) == 0);
+        so_SO *read = so_SO_read_memory(buffer, size, NULL);
+        free(buffer);
+        assert(so_SO_get_number_of_SOBlock(read) == 42);
+        for (int i = 1; i < 40; i++) {
+            snprintf(blkId, sizeof(blkId), "B%d", i);
+            assert(strcmp(so_SOBlock_get_blkId(so_SO_get_SOBlock(read, i < 20 ? i : i + 1)), blkId) == 0);
+        }
+        assert(strcmp(so_SOBlock_get_blkId(so_SO_get_SOBlock(read, 20)), "E1") == 0);
+        assert(strcmp(so_SOBlock_get_blkId(so_SO_get_SOBlock(read, 41)), "E2") == 0);
+        check_table1(read);
+        so_SO_free(read);
+    }
+
+    int found = 0;
+    for (int i = 0; i < so_stats_get_number_of_elements(stats, SO_STATS_WRITE); i++) {
+        if (strcmp(so_stats_get_element_name(stats, SO_STATS_WRITE, i), "SOBlock") == 0) {
+            assert(so_stats_get_element_count(stats, SO_STATS_WRITE, i) == 84);
+            found = 1;
+        }
+    }
+    assert(found);
+
+    so_SO_free(so);
+    so_stats_free(stats);
+}
+
+void check_table_range(char *filename, so_Scan *scan, int table)
+{
+    size_t offset = so_Scan_get_table_offset(scan, table);
+    size_t length = so_Scan_get_table_length(scan, table);
+    FILE *fp = fopen(filename, "rb");
+    char start[11] = { 0 };
+    char end[12] = { 0 };
+    fseek(fp, offset, SEEK_SET);
+    assert(fread(start, 1, 10, fp) == 10);
+    fseek(fp, offset + length - 11, SEEK_SET);
+    assert(fread(end, 1, 11, fp) == 11);
+    fclose(fp);
+    assert(strcmp(start, "<ds:Table>") == 0);
+    assert(strcmp(end, "</ds:Table>") == 0);
+}
+
+void test_scan()
+{
+    char *filename = "../R/inst/extdata/pheno.SO.xml";
+    so_Scan *scan = so_SO_scan(filename);
+    assert(scan);
+    assert(strcmp(so_Scan_get_id(scan), "i1") == 0);
+    assert(!so_Scan_get_metadataFile(scan));
+    assert(strcmp(so_Scan_get_PharmMLRef(scan), "pheno.xml") == 0);
+    assert(so_Scan_get_number_of_SOBlocks(scan) == 1);
+    assert(strcmp(so_Scan_get_blkId(scan, 0), "pheno") == 0);
+    assert(so_Scan_get_number_of_tool_files(scan, 0) == 0);
+    assert(so_Scan_get_number_of_messages(scan, 0) == 13);
+    assert(so_Scan_get_max_severity(scan, 0) == 1);
+    assert(so_Scan_get_RunTime(scan, 0) == 0.000277777777777778);
+
+    assert(so_Scan_get_number_of_tables(scan) == 10);
+    assert(strcmp(so_Scan_get_table_path(scan, 0), "Estimation/PopulationEstimates/MLE") == 0);
+    assert(so_Scan_get_table_number_of_rows(scan, 0) == 1);
+    assert(so_Scan_get_table_number_of_columns(scan, 0) == 5);
+    assert(strcmp(so_Scan_get_table_columnType(scan, 0, 2), "varParameter variance") == 0);
+    assert(strcmp(so_Scan_get_table_path(scan, 8), "Estimation/Predictions") == 0);
+    assert(so_Scan_get_table_block(scan, 8) == 0);
+    assert(so_Scan_get_table_number_of_rows(scan, 8) == 744);
+    assert(strcmp(so_Scan_get_table_columnId(scan, 8, 3), "IPRED") == 0);
+    assert(so_Scan_get_table_valueType(scan, 8, 0) == PHARMML_VALUETYPE_STRING);
+    assert(so_Scan_get_table_valueType(scan, 8, 1) == PHARMML_VALUETYPE_REAL);
+    for (int i = 0; i < so_Scan_get_number_of_tables(scan); i++) {
+        check_table_range(filename, scan, i);
+    }
+    so_Scan_free(scan);
+
+    // Many blocks with ToolSettings read across many buffers
+    so_SO *so = so_SO_read(filename);
+    so_SOBlock *first = so_SO_get_SOBlock(so, 0);
+    so_ToolSettings *settings = so_SOBlock_create_ToolSettings(first);
+    so_ExternalFile *file = so_ExternalFile_new();
+    so_ExternalFile_set_path(file, "run1.mod");
+    so_ToolSettings_add_File(settings, file);
+    char blkId[12];
+    for (int i = 1; i < 20; i++) {
+        so_SOBlock *block = so_SOBlock_copy(first);
+        snprintf(blkId, sizeof(blkId), "B%d", i);
+        so_SOBlock_set_blkId(block, blkId);
+        so_SO_add_SOBlock(so, block);
+    }
+    for (int pretty = 0; pretty < 2; pretty++) {
+        assert(so_SO_write(so, "io_test_scan.SO.xml", pretty) == 0);
+        scan = so_SO_scan("io_test_scan.SO.xml");
+        assert(so_Scan_get_number_of_SOBlocks(scan) == 20);
+        assert(so_Scan_get_number_of_tables(scan) == 200);
+        assert(strcmp(so_Scan_get_blkId(scan, 19), "B19") == 0);
+        assert(strcmp(so_Scan_get_tool_file(scan, 19, 0), "run1.mod") == 0);
+        assert(so_Scan_get_table_block(scan, 198) == 19);
+        assert(so_Scan_get_table_number_of_rows(scan, 198) == 744);
+        check_table_range("io_test_scan.SO.xml", scan, 198);
+        so_Scan_free(scan);
+    }
+
+    if (so_compression_is_available(SO_COMPRESSION_GZIP)) {
+        assert(so_SO_write(so, "io_test_scan.SO.xml.gz", 0) == 0);
+        scan = so_SO_scan("io_test_scan.SO.xml.gz");
+        assert(so_Scan_get_number_of_tables(scan) == 200);
+        assert(so_Scan_get_table_number_of_rows(scan, 198) == 744);
+        so_Scan_free(scan);
+        remove("io_test_scan.SO.xml.gz");
+    }
+
+    // A truncated file is not well formed
+    char *buffer;
+    size_t size;
+    assert(so_SO_write_memory(so, &buffer, &size, 0) == 0);
+    FILE *fp = fopen("io_test_scan.SO.xml", "wb");
+    assert(fwrite(buffer, 1, size / 2, fp) == size / 2);
+    fclose(fp);
+    free(buffer);
+    so_SO_free(so);
+    assert(!so_SO_scan("io_test_scan.SO.xml"));
+    remove("io_test_scan.SO.xml");
+    assert(!so_SO_scan("io_test_no_such_file.SO.xml"));
+}
+
+void check_same_table(so_Table *a, so_Table *b)
+{
+    assert(so_Table_get_number_of_rows(a) == so_Table_get_number_of_rows(b));
+    assert(so_Table_get_number_of_columns(a) == so_Table_get_number_of_columns(b));
+    for (int i = 0; i < so_Table_get_number_of_columns(a); i++) {
+        assert(strcmp(so_Table_get_columnId(a, i), so_Table_get_columnId(b, i)) == 0);
+        assert(so_Table_get_valueType(a, i) == so_Table_get_valueType(b, i));
+        if (so_Table_get_valueType(a, i) == PHARMML_VALUETYPE_REAL) {
+            double *x = so_Table_get_column_from_number(a, i);
+            double *y = so_Table_get_column_from_number(b, i);
+            for (int row = 0; row < so_Table_get_number_of_rows(a); row++) {
+                assert(x[row] == y[row]);
+            }
+        }
+    }
+}
+
+void test_load_table_at()
+{
+    char *filename = "../R/inst/extdata/pheno.SO.xml";
+    so_SO *so = so_SO_read(filename);
+    so_Estimation *estimation = so_SOBlock_get_Estimation(so_SO_get_SOBlock(so, 0));
+    so_Table *predictions = so_Estimation_get_Predictions(estimation);
+
+    so_Scan *scan = so_SO_scan(filename);
+    int table = so_Scan_find_table(scan, "pheno", "Predictions");
+    assert(table == 8);
+    assert(so_Scan_find_table(scan, NULL, "Estimation/PopulationEstimates/MLE") == 0);
+    assert(so_Scan_find_table(scan, "pheno", "PopulationEstimates/MLE") == 0);
+    assert(so_Scan_find_table(scan, NULL, "LE") == -1);
+    assert(so_Scan_find_table(scan, "other", "Predictions") == -1);
+
+    so_Table *loaded = so_SO_load_table_at(filename, scan, table);
+    assert(loaded);
+    check_same_table(predictions, loaded);
+    so_Table_free(loaded);
+    assert(!so_SO_load_table_at(filename, scan, so_Scan_get_number_of_tables(scan)));
+
+    // Round trip through an index file
+    assert(so_Scan_write_index(scan, "io_test_index.xml") == 0);
+    so_Scan *index = so_Scan_read_index("io_test_index.xml");
+    assert(index);
+    assert(strcmp(so_Scan_get_id(index), "i1") == 0);
+    assert(strcmp(so_Scan_get_PharmMLRef(index), "pheno.xml") == 0);
+    assert(so_Scan_get_number_of_SOBlocks(index) == 1);
+    assert(strcmp(so_Scan_get_blkId(index, 0), "pheno") == 0);
+    assert(so_Scan_get_number_of_messages(index, 0) == 13);
+    assert(so_Scan_get_max_severity(index, 0) == 1);
+    assert(so_Scan_get_RunTime(index, 0) == 0.000277777777777778);
+    assert(so_Scan_get_number_of_tables(index) == 10);
+    for (int i = 0; i < so_Scan_get_number_of_tables(index); i++) {
+        assert(strcmp(so_Scan_get_table_path(index, i), so_Scan_get_table_path(scan, i)) == 0);
+        assert(so_Scan_get_table_number_of_rows(index, i) == so_Scan_get_table_number_of_rows(scan, i));
+        assert(so_Scan_get_table_offset(index, i) == so_Scan_get_table_offset(scan, i));
+        assert(so_Scan_get_table_length(index, i) == so_Scan_get_table_length(scan, i));
+    }
+    assert(so_Scan_get_table_valueType(index, 8, 1) == PHARMML_VALUETYPE_REAL);
+    assert(strcmp(so_Scan_get_table_columnType(index, 0, 2), "varParameter variance") == 0);
+    loaded = so_SO_load_table_at(filename, index, so_Scan_find_table(index, "pheno", "MLE"));
+    check_same_table(so_PopulationEstimates_get_MLE(so_Estimation_get_PopulationEstimates(estimation)), loaded);
+    so_Table_free(loaded);
+    so_Scan_free(index);
+    so_Scan_free(scan);
+    remove("io_test_index.xml");
+    assert(!so_Scan_read_index("io_test_index.xml"));
+
+    // A file that has changed since it was scanned or is compressed cannot be used
+    so_SO_write(so, "io_test_load.SO.xml", 1);
+    scan = so_SO_scan("io_test_load.SO.xml");
+    loaded = so_SO_load_table_at("io_test_load.SO.xml", scan, 8);
+    check_same_table(predictions, loaded);
+    so_Table_free(loaded);
+    so_SO_write(so, "io_test_load.SO.xml", 0);
+    assert(!so_SO_load_table_at("io_test_load.SO.xml", scan, 8));
+    so_Scan_free(scan);
+    if (so_compression_is_available(SO_COMPRESSION_GZIP)) {
+        so_SO_write(so, "io_test_load.SO.xml.gz", 0);
+        scan = so_SO_scan("io_test_load.SO.xml.gz");
+        assert(!so_SO_load_table_at("io_test_load.SO.xml.gz", scan, 8));
+        so_Scan_free(scan);
+        remove("io_test_load.SO.xml.gz");
+    }
+    so_SO_free(so);
+
+    // Namespaces declared below the SO element
+    FILE *fp = fopen("io_test_load.SO.xml", "w");
+    fputs("<SO xmlns=\"http://www.pharmml.org/so/0.3/StandardisedOutput\">"
+        "<SOBlock blkId=\"A\" xmlns:d=\"http://www.pharmml.org/pharmml/0.8/Dataset\"><Estimation><Predictions>"
+        "<d:Definition><d:Column columnId=\"ID\" columnType=\"id\" valueType=\"string\" columnNum=\"1\"/>"
+        "<d:Column columnId=\"PRED\" columnType=\"undefined\" valueType=\"real\" columnNum=\"2\"/></d:Definition>"
+        "<d:Table><d:Row><ct:Id xmlns:ct=\"http://www.pharmml.org/pharmml/0.8/CommonTypes\">1</ct:Id><ct:Real xmlns:ct=\"http://www.pharmml.org/pharmml/0.8/CommonTypes\">2.5</ct:Real></d:Row></d:Table>"
+        "</Predictions></Estimation></SOBlock></SO>", fp);
+    fclose(fp);
+    scan = so_SO_scan("io_test_load.SO.xml");
+    loaded = so_SO_load_table_at("io_test_load.SO.xml", scan, so_Scan_find_table(scan, "A", "Predictions"));
+    assert(loaded);
+    assert(so_Table_get_number_of_rows(loaded) == 1);
+    assert(strcmp(((char **) so_Table_get_column_from_number(loaded, 0))[0], "1") == 0);
+    assert(((double *) so_Table_get_column_from_number(loaded, 1))[0] == 2.5);
+    so_Table_free(loaded);
+    so_Scan_free(scan);
+    remove("io_test_load.SO.xml");
+}
+
+void main()
+{
+    test_compression();
+    test_memory_and_fd();
+    test_writer();
+    test_writer_close_error();
+    test_write_many_blocks();
+    test_scan();
+    test_load_table_at();
+
+    printf("io PASS\n");
+}
@@ -0,0 +1,361 @@
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <so.h>
+
+#define HEADER "<SO xmlns=\"http://www.pharmml.org/so/0.3/StandardisedOutput\" xmlns:ct=\"http://www.pharmml.org/pharmml/0.8/CommonTypes\">" \
+    "<SOBlock blkId=\"b\"><Estimation><PrecisionPopulationEstimates><MLE><CovarianceMatrix><ct:Matrix matrixType=\"Any\">"
+#define FOOTER "</ct:Matrix></CovarianceMatrix></MLE></PrecisionPopulationEstimates></Estimation></SOBlock></SO>"
+
+so_SO *read_string(char *str)
+{
+    return so_SO_read_memory(str, strlen(str), NULL);
+}
+
+so_Matrix *get_matrix(so_SO *so)
+{
+    return so_MLE_get_CovarianceMatrix(so_PrecisionPopulationEstimates_get_MLE(
+        so_Estimation_get_PrecisionPopulationEstimates(so_SOBlock_get_Estimation(so_SO_get_SOBlock(so, 0)))));
+}
+
+// Build a large named matrix as text. The parser will give the texts in more than one chunk.
+char *large_matrix_xml(int n)
+{
+    char *xml = malloc(200 + n * 40 + n * n * 40);
+    char *p = xml;
+    p += sprintf(p, "%s<ct:RowNames>", HEADER);
+    for (int i = 0; i < n; i++) {
+        p += sprintf(p, "<ct:String>ROW_PARAMETER_%d</ct:String>", i);
+    }
+    p += sprintf(p, "</ct:RowNames><ct:ColumnNames>");
+    for (int i = 0; i < n; i++) {
+        p += sprintf(p, "<ct:String>COL_PARAMETER_%d</ct:String>", i);
+    }
+    p += sprintf(p, "</ct:ColumnNames>");
+    for (int i = 0; i < n; i++) {
+        p += sprintf(p, "<ct:MatrixRow>");
+        for (int j = 0; j < n; j++) {
+            p += sprintf(p, "<ct:Real>%d.25</ct:Real>", i * 1000 + j);
+        }
+        p += sprintf(p, "</ct:MatrixRow>");
+    }
+    sprintf(p, "%s", FOOTER);
+    return xml;
+}
+
+void test_large_matrix()
+{
+    int n = 300;
+    char *xml = large_matrix_xml(n);
+    so_SO *so = read_string(xml);
+    free(xml);
+    assert(so);
+    so_Matrix *matrix = get_matrix(so);
+    assert(so_Matrix_get_number_of_rows(matrix) == n);
+    assert(so_Matrix_get_number_of_columns(matrix) == n);
+    char name[32];
+    for (int i = 0; i < n; i++) {
+        sprintf(name, "ROW_PARAMETER_%d", i);
+        assert(strcmp(so_Matrix_get_RowNames(matrix, i), name) == 0);
+        sprintf(name, "COL_PARAMETER_%d", i);
+        assert(strcmp(so_Matrix_get_ColumnNames(matrix, i), name) == 0);
+    }
+    double *data = so_Matrix_get_data(matrix);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            assert(data[i * n + j] == i * 1000 + j + 0.25);
+        }
+    }
+
+    // Copies have their own names and names from the arena can be replaced
+    so_Matrix *copy = so_Matrix_copy(matrix);
+    assert(copy);
+    assert(so_Matrix_set_RowNames(copy, 0, "FIRST") == 0);
+    assert(strcmp(so_Matrix_get_RowNames(copy, 0), "FIRST") == 0);
+    assert(strcmp(so_Matrix_get_RowNames(matrix, 0), "ROW_PARAMETER_0") == 0);
+    assert(strcmp(so_Matrix_get_ColumnNames(copy, n - 1), "COL_PARAMETER_299") == 0);
+    assert(so_Matrix_get_data(copy)[n * n - 1] == (n - 1) * 1000 + n - 1 + 0.25);
+    so_Matrix *copy2 = so_Matrix_copy(copy);
+    assert(strcmp(so_Matrix_get_RowNames(copy2, 0), "FIRST") == 0);
+    so_Matrix_free(copy);
+    assert(strcmp(so_Matrix_get_RowNames(copy2, 1), "ROW_PARAMETER_1") == 0);
+    so_Matrix_free(copy2);
+
+    so_SO_free(so);
+}
+
+void test_unnamed_matrix()
+{
+    so_SO *so = read_string(HEADER
+        "<ct:MatrixRow><ct:Real>1</ct:Real><ct:Real>2</ct:Real></ct:MatrixRow>"
+        "<ct:MatrixRow><ct:Real>3</ct:Real><ct:Real>4</ct:Real></ct:MatrixRow>"
+        "<ct:MatrixRow><ct:Real>5</ct:Real><ct:Real>6</ct:Real></ct:MatrixRow>" FOOTER);
+    assert(so);
+    so_Matrix *matrix = get_matrix(so);
+    assert(so_Matrix_get_number_of_rows(matrix) == 3);
+    assert(so_Matrix_get_number_of_columns(matrix) == 2);
+    assert(so_Matrix_get_data(matrix)[5] == 6);
+    assert(so_Matrix_get_RowNames(matrix, 2) == NULL);
+    so_SO_free(so);
+}
+
+void test_bad_matrix()
+{
+    // More values than columns
+    so_SO *so = read_string(HEADER
+        "<ct:RowNames><ct:String>A</ct:String></ct:RowNames><ct:ColumnNames><ct:String>A</ct:String></ct:ColumnNames>"
+        "<ct:MatrixRow><ct:Real>1</ct:Real><ct:Real>2</ct:Real></ct:MatrixRow>\n" FOOTER);
+    assert(!so);
+
+    // More rows than row names
+    so = read_string(HEADER
+        "<ct:RowNames><ct:String>A</ct:String></ct:RowNames><ct:ColumnNames><ct:String>A</ct:String></ct:ColumnNames>"
+        "<ct:MatrixRow><ct:Real>1</ct:Real></ct:MatrixRow>\n<ct:MatrixRow><ct:Real>2</ct:Real></ct:MatrixRow>\n" FOOTER);
+    assert(!so);
+
+    // Compact XML without any text after the bad row. A value missing in the last row.
+    so = read_string(HEADER
+        "<ct:RowNames><ct:String>A</ct:String><ct:String>B</ct:String></ct:RowNames>"
+        "<ct:ColumnNames><ct:String>A</ct:String><ct:String>B</ct:String></ct:ColumnNames>"
+        "<ct:MatrixRow><ct:Real>1</ct:Real><ct:Real>2</ct:Real></ct:MatrixRow>"
+        "<ct:MatrixRow><ct:Real>3</ct:Real></ct:MatrixRow>" FOOTER);
+    assert(!so);
+
+    // Compact XML with more rows than row names
+    so = read_string(HEADER
+        "<ct:RowNames><ct:String>A</ct:String></ct:RowNames><ct:ColumnNames><ct:String>A</ct:String></ct:ColumnNames>"
+        "<ct:MatrixRow><ct:Real>1</ct:Real></ct:MatrixRow><ct:MatrixRow><ct:Real>2</ct:Real></ct:MatrixRow>" FOOTER);
+    assert(!so);
+}
+
+void test_symmetric_matrix()
+{
+    so_SO *so = so_SO_read("pheno.SO.xml");
+    assert(so);
+    so_Matrix *matrix = get_matrix(so);
+    int n = so_Matrix_get_number_of_rows(matrix);
+    assert(n == 5);
+    assert(so_Matrix_get_storage(matrix) == SO_MATRIX_PACKED_SYMMETRIC);
+    assert(so_Matrix_get_packed_data(matrix)[1] == so_Matrix_get_element(matrix, 1, 0));
+    assert(so_Matrix_get_element(matrix, 0, 1) == so_Matrix_get_element(matrix, 1, 0));
+
+    so_Matrix *copy = so_Matrix_copy(matrix);
+    assert(so_Matrix_get_storage(copy) == SO_MATRIX_PACKED_SYMMETRIC);
+    double *data = so_Matrix_get_data(copy);
+    assert(so_Matrix_get_storage(copy) == SO_MATRIX_DENSE);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            assert(data[i * n + j] == so_Matrix_get_element(matrix, i, j));
+        }
+    }
+    assert(so_Matrix_set_storage(copy, SO_MATRIX_PACKED_SYMMETRIC) == 0);
+    assert(so_Matrix_get_element(copy, 4, 3) == so_Matrix_get_element(matrix, 3, 4));
+    so_Matrix_free(copy);
+    so_SO_free(so);
+
+    // Non symmetric matrices cannot be packed
+    so_Matrix *dense = so_Matrix_new();
+    so_Matrix_set_size(dense, 2, 2);
+    so_Matrix_set_element(dense, 0, 1, 1.0);
+    assert(!so_Matrix_is_symmetric(dense));
+    assert(so_Matrix_set_storage(dense, SO_MATRIX_PACKED_SYMMETRIC) != 0);
+    assert(so_Matrix_get_storage(dense) == SO_MATRIX_DENSE);
+    so_Matrix_free(dense);
+
+    // Constructed packed matrices are written in full
+    so = so_SO_new();
+    so_SOBlock *block = so_SOBlock_new();
+    so_SOBlock_set_blkId(block, "b");
+    so_SO_add_SOBlock(so, block);
+    so_MLE *mle = so_PrecisionPopulationEstimates_create_MLE(
+        so_Estimation_create_PrecisionPopulationEstimates(so_SOBlock_create_Estimation(block)));
+    matrix = so_Matrix_new();
+    assert(so_Matrix_set_symmetric_size(matrix, 3) == 0);
+    char name[2] = "A";
+    for (int i = 0; i < 3; i++) {
+        name[0] = 'A' + i;
+        so_Matrix_set_RowNames(matrix, i, name);
+        so_Matrix_set_ColumnNames(matrix, i, name);
+        for (int j = 0; j <= i; j++) {
+            so_Matrix_set_element(matrix, i, j, i * 10 + j);
+        }
+    }
+    so_MLE_set_CovarianceMatrix(mle, matrix);
+    char *buffer;
+    size_t size;
+    assert(so_SO_write_memory(so, &buffer, &size, 0) == 0);
+    so_SO_free(so);
+    so = so_SO_read_memory(buffer, size, NULL);
+    free(buffer);
+    assert(so);
+    matrix = get_matrix(so);
+    assert(so_Matrix_get_storage(matrix) == SO_MATRIX_PACKED_SYMMETRIC);
+    assert(so_Matrix_get_element(matrix, 0, 2) == 20);
+    assert(strcmp(so_Matrix_get_ColumnNames(matrix, 2), "C") == 0);
+    so_SO_free(so);
+}
+
+so_Matrix *new_symmetric(int n, double *lower)
+{
+    so_Matrix *matrix = so_Matrix_new();
+    so_Matrix_set_symmetric_size(matrix, n);
+    memcpy(so_Matrix_get_packed_data(matrix), lower, n * (n + 1) / 2 * sizeof(double));
+    return matrix;
+}
+
+void test_linalg()
+{
+    double lower[] = { 4, 12, 37, -16, -43, 98 };
+    so_Matrix *a = new_symmetric(3, lower);
+    so_Matrix_set_RowNames(a, 0, "CL");
+    so_Matrix_set_ColumnNames(a, 0, "CL");
+
+    so_Matrix *chol = so_Matrix_cholesky(a);
+    assert(chol);
+    double expected_l[] = { 2, 0, 0, 6, 1, 0, -8, 5, 3 };
+    double *l = so_Matrix_get_data(chol);
+    for (int i = 0; i < 9; i++) {
+        assert(fabs(l[i] - expected_l[i]) < 1e-12);
+    }
+    assert(strcmp(so_Matrix_get_RowNames(chol, 0), "CL") == 0);
+    so_Matrix_free(chol);
+
+    double logdet;
+    assert(so_Matrix_log_determinant(a, &logdet) == 0);
+    assert(fabs(logdet - log(36)) < 1e-12);
+    assert(so_Matrix_is_positive_definite(a) == 1);
+
+    so_Matrix *inverse = so_Matrix_inverse(a);
+    assert(inverse);
+    assert(so_Matrix_get_storage(inverse) == SO_MATRIX_PACKED_SYMMETRIC);
+    assert(strcmp(so_Matrix_get_ColumnNames(inverse, 0), "CL") == 0);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            double sum = 0;
+            for (int k = 0; k < 3; k++) {
+                sum += so_Matrix_get_element(a, i, k) * so_Matrix_get_element(inverse, k, j);
+            }
+            assert(fabs(sum - (i == j)) < 1e-9);
+        }
+    }
+    so_Matrix_free(inverse);
+
+    so_Matrix *cor = so_Matrix_correlation(a);
+    assert(cor);
+    assert(so_Matrix_get_element(cor, 1, 1) == 1);
+    assert(fabs(so_Matrix_get_element(cor, 2, 0) - -16 / (2 * sqrt(98))) < 1e-12);
+    double sd[] = { 2, sqrt(37), sqrt(98) };
+    so_Matrix *cov = so_Matrix_covariance(cor, sd);
+    for (int i = 0; i < 6; i++) {
+        assert(fabs(so_Matrix_get_packed_data(cov)[i] - lower[i]) < 1e-12);
+    }
+    so_Matrix_free(cov);
+    so_Matrix_free(cor);
+    so_Matrix_free(a);
+
+    double indefinite[] = { 1, 2, 1 };
+    a = new_symmetric(2, indefinite);
+    assert(!so_Matrix_cholesky(a));
+    assert(!so_Matrix_inverse(a));
+    assert(so_Matrix_log_determinant(a, &logdet) != 0);
+    assert(so_Matrix_is_positive_definite(a) == 0);
+    double values[2];
+    so_Matrix *vectors;
+    assert(so_Matrix_eigen(a, values, &vectors) == 0);
+    assert(fabs(values[0] - -1) < 1e-12 && fabs(values[1] - 3) < 1e-12);
+    double *v = so_Matrix_get_data(vectors);
+    assert(fabs(fabs(v[1]) - sqrt(0.5)) < 1e-12 && fabs(v[1] - v[3]) < 1e-12);
+    so_Matrix_free(vectors);
+    double condition;
+    assert(so_Matrix_condition_number(a, &condition) == 0);
+    assert(fabs(condition - 3) < 1e-12);
+    so_Matrix_free(a);
+
+    so_Matrix *nonsquare = so_Matrix_new();
+    so_Matrix_set_size(nonsquare, 2, 3);
+    assert(!so_Matrix_inverse(nonsquare));
+    assert(so_Matrix_eigen(nonsquare, values, NULL) != 0);
+    so_Matrix_free(nonsquare);
+}
+
+void test_large_linalg()
+{
+    // Larger than the block size of the kernels
+    int n = 150;
+    so_Matrix *a = so_Matrix_new();
+    so_Matrix_set_symmetric_size(a, n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= i; j++) {
+            so_Matrix_set_element(a, i, j, i == j ? n : sin(i * 7 + j * 3) / 2);
+        }
+    }
+
+    so_Matrix *chol = so_Matrix_cholesky(a);
+    assert(chol);
+    double *l = so_Matrix_get_data(chol);
+    for (int i = 0; i < n; i += 7) {
+        for (int j = 0; j <= i; j += 3) {
+            double sum = 0;
+            for (int k = 0; k <= j; k++) {
+                sum += l[i * n + k] * l[j * n + k];
+            }
+            assert(fabs(sum - so_Matrix_get_element(a, i, j)) < 1e-9);
+        }
+    }
+    so_Matrix_free(chol);
+
+    so_Matrix *inverse = so_Matrix_inverse(a);
+    assert(inverse);
+    for (int i = 0; i < n; i += 11) {
+        for (int j = 0; j < n; j += 5) {
+            double sum = 0;
+            for (int k = 0; k < n; k++) {
+                sum += so_Matrix_get_element(a, i, k) * so_Matrix_get_element(inverse, k, j);
+            }
+            assert(fabs(sum - (i == j)) < 1e-9);
+        }
+    }
+    so_Matrix_free(inverse);
+
+    double *values = malloc(n * sizeof(double));
+    so_Matrix *vectors;
+    assert(so_Matrix_eigen(a, values, &vectors) == 0);
+    double trace = 0, sum = 0, log_sum = 0;
+    for (int i = 0; i < n; i++) {
+        trace += so_Matrix_get_element(a, i, i);
+        sum += values[i];
+        log_sum += log(values[i]);
+        assert(i == 0 || values[i - 1] <= values[i]);
+    }
+    assert(fabs(trace - sum) < 1e-8);
+    double logdet;
+    assert(so_Matrix_log_determinant(a, &logdet) == 0);
+    assert(fabs(logdet - log_sum) < 1e-8);
+
+    // A v = lambda v for the largest eigenvalue
+    double *v = so_Matrix_get_data(vectors);
+    for (int i = 0; i < n; i++) {
+        double av = 0;
+        for (int k = 0; k < n; k++) {
+            av += so_Matrix_get_element(a, i, k) * v[k * n + n - 1];
+        }
+        assert(fabs(av - values[n - 1] * v[i * n + n - 1]) < 1e-8);
+    }
+    so_Matrix_free(vectors);
+    free(values);
+    so_Matrix_free(a);
+}
+
+void main()
+{
+    test_large_matrix();
+    test_unnamed_matrix();
+    test_bad_matrix();
+    test_symmetric_matrix();
+    test_linalg();
+    test_large_linalg();
+
+    printf("matrix PASS\n");
+}
@@ -0,0 +1,64 @@
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <so.h>
+
+long element_count(so_stats *stats, so_stats_mode mode, char *name)
+{
+    for (int i = 0; i < so_stats_get_number_of_elements(stats, mode); i++) {
+        if (strcmp(so_stats_get_element_name(stats, mode, i), name) == 0) {
+            return so_stats_get_element_count(stats, mode, i);
+        }
+    }
+    return 0;
+}
+
+void main()
+{
+    so_stats *stats = so_stats_new();
+    so_ReadContext *context = so_ReadContext_new();
+    so_ReadContext_set_stats(context, stats);
+
+    so_SO *so = so_SO_read_with_context("data/table1.SO.xml", context);
+    assert(so);
+    assert(so_SO_get_stats(so) == stats);
+
+    FILE *fp = fopen("data/table1.SO.xml", "rb");
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    assert(so_stats_get_bytes(stats, SO_STATS_READ) == size);
+
+    assert(so_stats_get_cells(stats, SO_STATS_READ, PHARMML_VALUETYPE_REAL) == 9);
+    assert(so_stats_get_cells(stats, SO_STATS_READ, PHARMML_VALUETYPE_STRING) == 3);
+    assert(element_count(stats, SO_STATS_READ, "Row") == 3);
+    assert(element_count(stats, SO_STATS_READ, "Column") == 4);
+    assert(so_stats_get_number_of_sections(stats, SO_STATS_READ) == 1);
+    assert(strcmp(so_stats_get_section_name(stats, SO_STATS_READ, 0), "Estimation") == 0);
+    assert(so_stats_get_string_bytes(stats, SO_STATS_READ) > 0);
+
+    // The names of the counters are not counted as string bytes
+    size_t string_bytes = so_stats_get_string_bytes(stats, SO_STATS_READ);
+    so_SO *second = so_SO_read_with_context("data/table1.SO.xml", context);
+    assert(so_stats_get_string_bytes(stats, SO_STATS_READ) == 2 * string_bytes);
+    so_SO_free(second);
+
+    assert(so_SO_write(so, "stats_test.SO.xml", 1) == 0);
+    assert(so_stats_get_bytes(stats, SO_STATS_WRITE) > 0);
+    assert(so_stats_get_cells(stats, SO_STATS_WRITE, PHARMML_VALUETYPE_REAL) == 9);
+    assert(element_count(stats, SO_STATS_WRITE, "Row") == 3);
+    assert(element_count(stats, SO_STATS_WRITE, "SOBlock") == 1);
+    assert(so_stats_get_number_of_sections(stats, SO_STATS_WRITE) == 1);
+    remove("stats_test.SO.xml");
+
+    so_stats_reset(stats);
+    assert(so_stats_get_bytes(stats, SO_STATS_READ) == 0);
+    assert(so_stats_get_number_of_elements(stats, SO_STATS_READ) == 0);
+
+    so_SO_free(so);
+    so_ReadContext_free(context);
+    so_stats_free(stats);
+
+    printf("stats PASS\n");
+}
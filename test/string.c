@@ -31,5 +31,11 @@ void main()
     assert((strcmp("my s", dest) == 0) && "pharmml_strndup compare strings");
     free(dest);
 
+    dest = NULL;
+    assert((pharmml_strnappend(&dest, source, 2) == 0) && "pharmml_strnappend to NULL");
+    assert((pharmml_strnappend(&dest, source + 2, strlen(source) - 2) == 0) && "pharmml_strnappend to string");
+    assert((strcmp(source, dest) == 0) && "pharmml_strnappend compare strings");
+    free(dest);
+
     printf("string PASS\n");
 }
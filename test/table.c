@@ -2,6 +2,8 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <stdbool.h>
 #include <so.h>
 
 void test_new_table()
@@ -14,10 +16,11 @@ void test_new_table()
 
     double data[2] = { 2.14 , 3 };
 
-    so_Table_new_column(table, "myCol", PHARMML_COLTYPE_DV, PHARMML_VALUETYPE_REAL, data);
+    pharmml_columnType dv = PHARMML_COLTYPE_DV;
+    so_Table_new_column(table, "myCol", &dv, 1, PHARMML_VALUETYPE_REAL, data);
 
     assert(strcmp(so_Table_get_columnId(table, 0), "myCol") == 0);
-    assert(so_Table_get_columnType(table, 0) == PHARMML_COLTYPE_DV);
+    assert(so_Table_get_columnType(table, 0)[0] == PHARMML_COLTYPE_DV);
     assert(so_Table_get_valueType(table, 0) == PHARMML_VALUETYPE_REAL);
 
     double *my_data = (double *) so_Table_get_column_from_number(table, 0);
@@ -35,13 +38,691 @@ void test_new_table()
     so_Table_set_columnId(table, 0, "nextCol");
     assert(strcmp(so_Table_get_columnId(table, 0), "nextCol") == 0);
     so_Table_set_columnId(table, 1, "nonsense");  // Does not crash
-    so_Table_set_columnType(table, 0, PHARMML_COLTYPE_SS);
-    assert(so_Table_get_columnType(table, 0) == PHARMML_COLTYPE_SS);
-    so_Table_set_columnType(table, 1, PHARMML_COLTYPE_IDV); // Does not crash
+    so_Table_remove_columnType(table, 0);
+    so_Table_add_columnType(table, 0, PHARMML_COLTYPE_SS);
+    assert(so_Table_get_columnType(table, 0)[0] == PHARMML_COLTYPE_SS);
+    so_Table_add_columnType(table, 1, PHARMML_COLTYPE_IDV); // Does not crash
     so_Table_set_valueType(table, 0, PHARMML_VALUETYPE_INT);
     assert(so_Table_get_valueType(table, 0) == PHARMML_VALUETYPE_INT);
 }
 
+void test_copy_table()
+{
+    so_SO *so = so_SO_read("data/table1.SO.xml");
+    so_SO *copy = so_SO_copy(so);
+    so_SO_free(so);
+
+    so_Table *table = so_Estimation_get_Predictions(so_SOBlock_get_Estimation(so_SO_get_SOBlock(copy, 0)));
+    so_Table *table_copy = so_Table_copy(table);
+    assert(so_Table_get_number_of_columns(table_copy) == 4);
+    assert(so_Table_get_number_of_rows(table_copy) == 3);
+    assert(so_Table_get_column_from_number(table, 1) == so_Table_get_column_from_number(table_copy, 1));
+
+    double *time = (double *) so_Table_get_writable_column(table_copy, 1);
+    assert(time != so_Table_get_column_from_number(table, 1));
+    time[0] = 1.0;
+    assert(((double *) so_Table_get_column_from_number(table, 1))[0] == 60.3);
+
+    char **ids = (char **) so_Table_get_writable_column(table, 0);
+    assert(strcmp(ids[2], "60") == 0);
+    so_Table_free(table_copy);
+    assert(strcmp(ids[2], "60") == 0);
+
+    so_SO_free(copy);
+}
+
+void test_read_many_rows()
+{
+    int numrows = 2500;
+    double *real = malloc(numrows * sizeof(double));
+    int *integer = malloc(numrows * sizeof(int));
+    char **str = malloc(numrows * sizeof(char *));
+    for (int i = 0; i < numrows; i++) {
+        real[i] = i / 4.0;
+        integer[i] = i;
+        str[i] = (i % 3 == 0) ? "" : "ab";
+    }
+
+    so_SO *so = so_SO_new();
+    so_SOBlock *block = so_SO_create_SOBlock(so);
+    so_SOBlock_set_blkId(block, "b1");
+    so_Estimation *est = so_SOBlock_create_Estimation(block);
+    so_Table *table = so_Estimation_create_Predictions(est);
+    so_Table_set_number_of_rows(table, numrows);
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    so_Table_new_column(table, "REAL", &undefined, 1, PHARMML_VALUETYPE_REAL, real);
+    so_Table_new_column(table, "INT", &undefined, 1, PHARMML_VALUETYPE_INT, integer);
+    so_Table_new_column(table, "STR", &undefined, 1, PHARMML_VALUETYPE_STRING, str);
+    assert(so_SO_write(so, "many_rows.SO.xml", 0) == 0);
+    so_SO_free(so);
+
+    so = so_SO_read("many_rows.SO.xml");
+    assert(so);
+    table = so_Estimation_get_Predictions(so_SOBlock_get_Estimation(so_SO_get_SOBlock(so, 0)));
+    assert(so_Table_get_number_of_rows(table) == numrows);
+    double *read_real = (double *) so_Table_get_column_from_number(table, 0);
+    int *read_integer = (int *) so_Table_get_column_from_number(table, 1);
+    char **read_str = (char **) so_Table_get_column_from_number(table, 2);
+    for (int i = 0; i < numrows; i++) {
+        assert(read_real[i] == real[i]);
+        assert(read_integer[i] == integer[i]);
+        assert(strcmp(read_str[i], str[i]) == 0);
+    }
+    so_SO_free(so);
+    remove("many_rows.SO.xml");
+
+    free(real);
+    free(integer);
+    free(str);
+}
+
+int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+void test_column_summary()
+{
+    so_Table *table = so_Table_new();
+    so_Table_set_number_of_rows(table, 6);
+    char *ids[] = { "2", "2", "1", "2", "1", "3" };
+    double dv[] = { 1.0, 3.0, 10.0, 2.0, pharmml_na(), pharmml_na() };
+    int amt[] = { 4, 1, 3, 2, 6, 5 };
+    pharmml_columnType id = PHARMML_COLTYPE_ID;
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    so_Table_new_column(table, "ID", &id, 1, PHARMML_VALUETYPE_STRING, ids);
+    so_Table_new_column(table, "DV", &undefined, 1, PHARMML_VALUETYPE_REAL, dv);
+    so_Table_new_column(table, "AMT", &undefined, 1, PHARMML_VALUETYPE_INT, amt);
+
+    so_Table *summary = so_Table_column_summary(table, 1, 0);
+    assert(so_Table_get_number_of_rows(summary) == 1);
+    assert(((int *) so_Table_get_column_from_name(summary, "N"))[0] == 4);
+    assert(((int *) so_Table_get_column_from_name(summary, "NMISSING"))[0] == 2);
+    assert(((double *) so_Table_get_column_from_name(summary, "MIN"))[0] == 1.0);
+    assert(((double *) so_Table_get_column_from_name(summary, "MAX"))[0] == 10.0);
+    assert(((double *) so_Table_get_column_from_name(summary, "MEAN"))[0] == 4.0);
+    assert(fabs(((double *) so_Table_get_column_from_name(summary, "SD"))[0] - sqrt(50.0 / 3)) < 1e-12);
+    so_Table_free(summary);
+
+    summary = so_Table_column_summary(table, 1, 1);
+    assert(so_Table_get_number_of_rows(summary) == 3);
+    char **summary_ids = (char **) so_Table_get_column_from_name(summary, "ID");
+    assert(strcmp(summary_ids[0], "2") == 0);
+    assert(strcmp(summary_ids[1], "1") == 0);
+    assert(strcmp(summary_ids[2], "3") == 0);
+    int *n = (int *) so_Table_get_column_from_name(summary, "N");
+    assert(n[0] == 3 && n[1] == 1 && n[2] == 0);
+    double *mean = (double *) so_Table_get_column_from_name(summary, "MEAN");
+    assert(mean[0] == 2.0 && mean[1] == 10.0 && isnan(mean[2]));
+    so_Table_free(summary);
+
+    double probs[] = { 0.5, 0, 1, 0.25 };
+    so_Table *quantiles = so_Table_column_quantiles(table, 2, probs, 4, 0);
+    assert(so_Table_get_number_of_columns(quantiles) == 4);
+    assert(strcmp(so_Table_get_columnId(quantiles, 0), "P50") == 0);
+    assert(((double *) so_Table_get_column_from_number(quantiles, 0))[0] == 3.5);
+    assert(((double *) so_Table_get_column_from_number(quantiles, 1))[0] == 1);
+    assert(((double *) so_Table_get_column_from_number(quantiles, 2))[0] == 6);
+    assert(((double *) so_Table_get_column_from_number(quantiles, 3))[0] == 2.25);
+    so_Table_free(quantiles);
+
+    quantiles = so_Table_column_quantiles(table, 1, probs, 1, 1);
+    double *median = (double *) so_Table_get_column_from_number(quantiles, 1);
+    assert(median[0] == 2.0 && median[1] == 10.0 && isnan(median[2]));
+    so_Table_free(quantiles);
+
+    assert(so_Table_column_summary(table, 0, 0) == NULL);
+    so_Table_free(table);
+
+    // Compare selection with sorting for a larger column
+    int numrows = 5000;
+    double *values = malloc(numrows * sizeof(double));
+    double *sorted = malloc(numrows * sizeof(double));
+    srand(1);
+    for (int i = 0; i < numrows; i++) {
+        values[i] = (rand() % 100) / 7.0;
+        sorted[i] = values[i];
+    }
+    qsort(sorted, numrows, sizeof(double), compare_doubles);
+    table = so_Table_new();
+    so_Table_set_number_of_rows(table, numrows);
+    so_Table_new_column(table, "X", &undefined, 1, PHARMML_VALUETYPE_REAL, values);
+    double many_probs[] = { 0.95, 0.05, 0.5, 0.001, 0.999 };
+    quantiles = so_Table_column_quantiles(table, 0, many_probs, 5, 0);
+    for (int i = 0; i < 5; i++) {
+        double h = (numrows - 1) * many_probs[i];
+        int k = (int) floor(h);
+        double expected = sorted[k] + (h - k) * (sorted[k + 1] - sorted[k]);
+        assert(fabs(((double *) so_Table_get_column_from_number(quantiles, i))[0] - expected) < 1e-12);
+    }
+    so_Table_free(quantiles);
+    so_Table_free(table);
+    free(values);
+    free(sorted);
+}
+
+void test_group_index()
+{
+    so_Table *table = so_Table_new();
+    so_Table_set_number_of_rows(table, 7);
+    int ids[] = { 5, 5, 3, 5, 3, 9, 9 };
+    double time[] = { 0, 1, 0, 2, 1, 0, 1 };
+    pharmml_columnType id = PHARMML_COLTYPE_ID;
+    pharmml_columnType idv = PHARMML_COLTYPE_IDV;
+    so_Table_new_column(table, "TIME", &idv, 1, PHARMML_VALUETYPE_REAL, time);
+    assert(so_Table_group_index(table) == NULL);
+    so_Table_new_column(table, "ID", &id, 1, PHARMML_VALUETYPE_INT, ids);
+
+    so_GroupIndex *index = so_Table_group_index(table);
+    assert(index);
+    assert(so_Table_group_index(table) == index);
+    assert(so_GroupIndex_get_number_of_groups(index) == 3);
+    assert(strcmp(so_GroupIndex_get_id(index, 0), "5") == 0);
+    assert(strcmp(so_GroupIndex_get_id(index, 2), "9") == 0);
+    assert(so_GroupIndex_get_id(index, 3) == NULL);
+    assert(so_GroupIndex_find(index, "3") == 1);
+    assert(so_GroupIndex_find(index, "4") == -1);
+    assert(so_GroupIndex_get_number_of_rows(index, 0) == 3);
+    int *rows = so_GroupIndex_get_rows(index, 0);
+    assert(rows[0] == 0 && rows[1] == 1 && rows[2] == 3);
+    rows = so_GroupIndex_get_rows(index, 2);
+    assert(rows[0] == 5 && rows[1] == 6);
+    assert(so_GroupIndex_get_group_of_row(index, 4) == 1);
+    assert(so_GroupIndex_get_group_of_row(index, 7) == -1);
+
+    int *writable = (int *) so_Table_get_writable_column(table, 1);
+    writable[6] = 3;
+    index = so_Table_group_index(table);
+    assert(so_GroupIndex_get_number_of_rows(index, 1) == 3);
+    assert(so_GroupIndex_get_number_of_rows(index, 2) == 1);
+    so_Table_free(table);
+
+    // Missing string IDs form a group of their own
+    table = so_Table_new();
+    so_Table_set_number_of_rows(table, 4);
+    char *string_ids[] = { "a", "b", "a", "b" };
+    double dv[] = { 1, 2, 3, 4 };
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    so_Table_new_column(table, "ID", &id, 1, PHARMML_VALUETYPE_STRING, string_ids);
+    so_Table_new_column(table, "DV", &undefined, 1, PHARMML_VALUETYPE_REAL, dv);
+    char **writable_ids = (char **) so_Table_get_writable_column(table, 0);
+    free(writable_ids[1]);
+    writable_ids[1] = NULL;
+    free(writable_ids[3]);
+    writable_ids[3] = NULL;
+    index = so_Table_group_index(table);
+    assert(so_GroupIndex_get_number_of_groups(index) == 2);
+    assert(so_GroupIndex_find(index, NULL) == 1);
+    assert(so_GroupIndex_find(index, "b") == -1);
+    assert(so_GroupIndex_get_id(index, 1) == NULL);
+    rows = so_GroupIndex_get_rows(index, 1);
+    assert(rows[0] == 1 && rows[1] == 3);
+    so_Table *summary = so_Table_column_summary(table, 1, 1);
+    assert(strcmp(((char **) so_Table_get_column_from_name(summary, "ID"))[1], "") == 0);
+    assert(((double *) so_Table_get_column_from_name(summary, "MEAN"))[1] == 3);
+    so_Table_free(summary);
+    so_Table_free(table);
+}
+
+void test_sort()
+{
+    so_Table *table = so_Table_new();
+    so_Table_set_number_of_rows(table, 6);
+    char *ids[] = { "b", "a", "b", "a", "c", "a" };
+    double time[] = { 2.0, 1.0, pharmml_na(), -1.0, 0.0, 1.0 };
+    int dose[] = { -3, 7, 0, 2, 1, 5 };
+    pharmml_columnType id = PHARMML_COLTYPE_ID;
+    pharmml_columnType idv = PHARMML_COLTYPE_IDV;
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    so_Table_new_column(table, "ID", &id, 1, PHARMML_VALUETYPE_STRING, ids);
+    so_Table_new_column(table, "TIME", &idv, 1, PHARMML_VALUETYPE_REAL, time);
+    so_Table_new_column(table, "DOSE", &undefined, 1, PHARMML_VALUETYPE_INT, dose);
+
+    int *perm = so_Table_sort_permutation(table, NULL, 0);
+    int expected[] = { 3, 1, 5, 0, 2, 4 };
+    for (int i = 0; i < 6; i++) {
+        assert(perm[i] == expected[i]);
+    }
+    free(perm);
+
+    int keys[] = { 2 };
+    perm = so_Table_sort_permutation(table, keys, 1);
+    int expected_dose[] = { 0, 2, 4, 3, 5, 1 };
+    for (int i = 0; i < 6; i++) {
+        assert(perm[i] == expected_dose[i]);
+    }
+
+    so_TableView *view = so_Table_sorted_view(table, NULL, 0);
+    assert(so_TableView_get_number_of_rows(view) == 6);
+    double sorted_time[6];
+    assert(so_TableView_gather_column(view, 1, sorted_time) == 0);
+    assert(sorted_time[0] == -1.0 && sorted_time[3] == 2.0 && isnan(sorted_time[4]));
+    so_Table *sorted = so_TableView_materialize(view);
+    assert(strcmp(((char **) so_Table_get_column_from_number(sorted, 0))[5], "c") == 0);
+    assert(((int *) so_Table_get_column_from_number(sorted, 2))[0] == 2);
+
+    // Copies of a table that has not been copied before made, changed and freed from different threads
+    int failures = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:failures)
+#endif
+    for (int i = 0; i < 64; i++) {
+        so_Table *parallel_copy = so_Table_copy(sorted);
+        if (!parallel_copy || so_Table_apply_permutation(parallel_copy, perm) != 0) {
+            failures++;
+        } else {
+            failures += strcmp(((char **) so_Table_get_column_from_number(parallel_copy, 0))[4], "c") != 0;
+        }
+        so_Table_free(parallel_copy);
+    }
+    assert(failures == 0);
+
+    // A table that was shared owns its strings again when its copies are gone
+    so_Table *last_copy = so_Table_copy(sorted);
+    so_Table_free(last_copy);
+    assert(so_Table_apply_permutation(sorted, perm) == 0);
+    assert(strcmp(((char **) so_Table_get_column_from_number(sorted, 0))[4], "c") == 0);
+    assert(strcmp(((char **) so_Table_get_column_from_number(sorted, 0))[5], "a") == 0);
+    so_Table_free(sorted);
+
+    so_Table *copy = so_Table_copy(table);
+    assert(so_Table_apply_permutation(copy, perm) == 0);
+    assert(((int *) so_Table_get_column_from_number(copy, 2))[0] == -3);
+    assert(((int *) so_Table_get_column_from_number(copy, 2))[5] == 7);
+    assert(strcmp(((char **) so_Table_get_column_from_number(copy, 0))[1], "b") == 0);
+    assert(((int *) so_Table_get_column_from_number(table, 2))[1] == 7);
+    assert(strcmp(((char **) so_Table_get_column_from_number(table, 0))[1], "a") == 0);
+    so_Table_free(copy);
+    free(perm);
+
+    int not_permutation[] = { 0, 0, 1, 2, 3, 4 };
+    assert(so_Table_apply_permutation(table, not_permutation) == 1);
+
+    so_Table_unref(table);      // The view keeps the table alive
+    assert(so_TableView_get_rows(view)[0] == 3);
+    so_TableView_free(view);
+}
+
+void test_select()
+{
+    so_Table *table = so_Table_new();
+    so_Table_set_number_of_rows(table, 6);
+    char *ids[] = { "1", "1", "1", "2", "2", "2" };
+    double time[] = { 0, 1, 2, 0, pharmml_na(), 2 };
+    int mdv[] = { 1, 0, 0, 1, 0, 0 };
+    pharmml_columnType id = PHARMML_COLTYPE_ID;
+    pharmml_columnType idv = PHARMML_COLTYPE_IDV;
+    pharmml_columnType mdv_type = PHARMML_COLTYPE_MDV;
+    so_Table_new_column(table, "ID", &id, 1, PHARMML_VALUETYPE_STRING, ids);
+    so_Table_new_column(table, "TIME", &idv, 1, PHARMML_VALUETYPE_REAL, time);
+    so_Table_new_column(table, "MDV", &mdv_type, 1, PHARMML_VALUETYPE_INT, mdv);
+
+    so_Predicate *predicate = so_Predicate_new_and(
+        so_Predicate_new_compare("MDV", SO_PREDICATE_EQ, 0),
+        so_Predicate_new_range("TIME", 0.5, 10));
+    int numrows;
+    int *rows = so_Predicate_evaluate(predicate, table, &numrows);
+    assert(numrows == 3);
+    assert(rows[0] == 1 && rows[1] == 2 && rows[2] == 5);
+    free(rows);
+
+    char *columns[] = { "TIME", "ID" };
+    so_Table *selected = so_Table_select(table, predicate, columns, 2);
+    assert(so_Table_get_number_of_rows(selected) == 3);
+    assert(so_Table_get_number_of_columns(selected) == 2);
+    assert(strcmp(so_Table_get_columnId(selected, 0), "TIME") == 0);
+    assert(so_Table_get_columnType(selected, 0)[0] == PHARMML_COLTYPE_IDV);
+    assert(((double *) so_Table_get_column_from_number(selected, 0))[2] == 2);
+    assert(strcmp(((char **) so_Table_get_column_from_number(selected, 1))[2], "2") == 0);
+    so_Table_free(selected);
+    so_Predicate_free(predicate);
+
+    predicate = so_Predicate_new_or(
+        so_Predicate_new_string_equal("ID", "2"),
+        so_Predicate_new_compare("TIME", SO_PREDICATE_NE, 1));
+    so_TableView *view = so_Table_select_view(table, predicate);
+    assert(so_TableView_get_number_of_rows(view) == 5);
+    so_TableView_free(view);
+    so_Predicate_free(predicate);
+
+    predicate = so_Predicate_new_compare("NOCOLUMN", SO_PREDICATE_LT, 1);
+    assert(so_Table_select(table, predicate, NULL, 0) == NULL);
+    so_Predicate_free(predicate);
+
+    selected = so_Table_select(table, NULL, NULL, 0);
+    assert(so_Table_get_number_of_rows(selected) == 6);
+    assert(so_Table_get_number_of_columns(selected) == 3);
+    so_Table_free(selected);
+
+    so_Table_free(table);
+}
+
+void test_join()
+{
+    pharmml_columnType id = PHARMML_COLTYPE_ID;
+    pharmml_columnType idv = PHARMML_COLTYPE_IDV;
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+
+    so_Table *pred = so_Table_new();
+    so_Table_set_number_of_rows(pred, 4);
+    char *pred_ids[] = { "1", "1", "2", "3" };
+    double pred_time[] = { 0, 1, 0, 0 };
+    double ipred[] = { 10, 11, 20, 30 };
+    so_Table_new_column(pred, "ID", &id, 1, PHARMML_VALUETYPE_STRING, pred_ids);
+    so_Table_new_column(pred, "TIME", &idv, 1, PHARMML_VALUETYPE_REAL, pred_time);
+    so_Table_new_column(pred, "IPRED", &undefined, 1, PHARMML_VALUETYPE_REAL, ipred);
+
+    so_Table *res = so_Table_new();
+    so_Table_set_number_of_rows(res, 4);
+    char *res_ids[] = { "2", "1", "1", "4" };
+    double res_time[] = { 0, 1, 0, 0 };
+    double iwres[] = { 0.2, 0.11, 0.1, 0.4 };
+    double res_ipred[] = { 1, 2, 3, 4 };
+    so_Table_new_column(res, "SUBJECT", &id, 1, PHARMML_VALUETYPE_STRING, res_ids);
+    so_Table_new_column(res, "T", &idv, 1, PHARMML_VALUETYPE_REAL, res_time);
+    so_Table_new_column(res, "IWRES", &undefined, 1, PHARMML_VALUETYPE_REAL, iwres);
+    so_Table_new_column(res, "IPRED", &undefined, 1, PHARMML_VALUETYPE_REAL, res_ipred);
+
+    so_Table *joined = so_Table_join(pred, res, NULL, 0, SO_JOIN_INNER);
+    assert(so_Table_get_number_of_rows(joined) == 3);
+    assert(so_Table_get_number_of_columns(joined) == 5);
+    assert(strcmp(so_Table_get_columnId(joined, 0), "ID") == 0);
+    assert(so_Table_get_columnType(joined, 0)[0] == PHARMML_COLTYPE_ID);
+    assert(strcmp(so_Table_get_columnId(joined, 4), "IPRED_right") == 0);
+    double *joined_iwres = (double *) so_Table_get_column_from_name(joined, "IWRES");
+    assert(joined_iwres[0] == 0.1 && joined_iwres[1] == 0.11 && joined_iwres[2] == 0.2);
+    so_Table_free(joined);
+
+    joined = so_Table_join(pred, res, NULL, 0, SO_JOIN_LEFT);
+    assert(so_Table_get_number_of_rows(joined) == 4);
+    joined_iwres = (double *) so_Table_get_column_from_name(joined, "IWRES");
+    assert(isnan(joined_iwres[3]));
+    so_Table_free(joined);
+
+    joined = so_Table_join(pred, res, NULL, 0, SO_JOIN_FULL);
+    assert(so_Table_get_number_of_rows(joined) == 5);
+    assert(strcmp(((char **) so_Table_get_column_from_name(joined, "ID"))[4], "4") == 0);
+    assert(isnan(((double *) so_Table_get_column_from_name(joined, "IPRED"))[4]));
+    so_Table_free(joined);
+
+    char *keys[] = { "IPRED" };
+    joined = so_Table_join(pred, res, keys, 1, SO_JOIN_INNER);
+    assert(so_Table_get_number_of_rows(joined) == 0);
+    so_Table_free(joined);
+    char *missing_keys[] = { "NOCOLUMN" };
+    assert(so_Table_join(pred, res, missing_keys, 1, SO_JOIN_INNER) == NULL);
+
+    // Suffixes are added until the name is unique
+    double ipred_right[] = { 0, 0, 0, 0 };
+    so_Table_new_column(pred, "IPRED_right", &undefined, 1, PHARMML_VALUETYPE_REAL, ipred_right);
+    joined = so_Table_join(pred, res, NULL, 0, SO_JOIN_INNER);
+    assert(strcmp(so_Table_get_columnId(joined, 3), "IPRED_right") == 0);
+    assert(strcmp(so_Table_get_columnId(joined, 5), "IPRED_right_right") == 0);
+    assert(((double *) so_Table_get_column_from_number(joined, 5))[0] == 3);
+    so_Table_free(joined);
+
+    // Missing strings in a key column never match
+    char **pred_id_column = (char **) so_Table_get_column_from_name(pred, "ID");
+    free(pred_id_column[2]);
+    pred_id_column[2] = NULL;
+    char **res_id_column = (char **) so_Table_get_column_from_name(res, "SUBJECT");
+    free(res_id_column[0]);
+    res_id_column[0] = NULL;
+    joined = so_Table_join(pred, res, NULL, 0, SO_JOIN_FULL);
+    assert(so_Table_get_number_of_rows(joined) == 6);
+    char **joined_ids = (char **) so_Table_get_column_from_name(joined, "ID");
+    assert(strcmp(joined_ids[2], "") == 0 && strcmp(joined_ids[4], "") == 0 && strcmp(joined_ids[5], "4") == 0);
+    assert(isnan(((double *) so_Table_get_column_from_name(joined, "IWRES"))[2]));
+    so_Table_free(joined);
+
+    so_Table_free(pred);
+    so_Table_free(res);
+}
+
+void test_simulated_profiles()
+{
+    pharmml_columnType id = PHARMML_COLTYPE_ID;
+    pharmml_columnType idv = PHARMML_COLTYPE_IDV;
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+
+    so_SOBlock *block = so_SOBlock_new();
+    so_Simulation *sim = so_SOBlock_create_Simulation(block);
+
+    so_SimulationBlock *simblock = so_Simulation_create_SimulationBlock(sim);
+    int replicate = 1;
+    so_SimulationBlock_set_replicate(simblock, &replicate);
+    so_SimulationSubType *profiles = so_SimulationBlock_create_SimulatedProfiles(simblock);
+    so_SimulationSubType_set_name(profiles, "A");
+    so_Table *table = so_SimulationSubType_get_base(profiles);
+    so_Table_set_number_of_rows(table, 2);
+    char *ids1[] = { "1", "2" };
+    double time1[] = { 0, 1 };
+    int dv[] = { 5, 6 };
+    so_Table_new_column(table, "ID", &id, 1, PHARMML_VALUETYPE_STRING, ids1);
+    so_Table_new_column(table, "TIME", &idv, 1, PHARMML_VALUETYPE_REAL, time1);
+    so_Table_new_column(table, "DV", &undefined, 1, PHARMML_VALUETYPE_INT, dv);
+
+    simblock = so_Simulation_create_SimulationBlock(sim);
+    replicate = 2;
+    so_SimulationBlock_set_replicate(simblock, &replicate);
+    profiles = so_SimulationBlock_create_SimulatedProfiles(simblock);
+    table = so_SimulationSubType_get_base(profiles);
+    so_Table_set_number_of_rows(table, 3);
+    char *ids2[] = { "1", "2", "3" };
+    double time2[] = { 2, 3, 4 };
+    bool flag[] = { true, false, true };
+    so_Table_new_column(table, "ID", &id, 1, PHARMML_VALUETYPE_STRING, ids2);
+    so_Table_new_column(table, "TIME", &idv, 1, PHARMML_VALUETYPE_REAL, time2);
+    so_Table_new_column(table, "FLAG", &undefined, 1, PHARMML_VALUETYPE_BOOLEAN, flag);
+
+    so_Table *merged = so_SOBlock_all_simulated_profiles(block);
+    assert(so_Table_get_number_of_rows(merged) == 5);
+    assert(so_Table_get_number_of_columns(merged) == 6);
+    assert(so_Table_get_valueType(merged, 2) == PHARMML_VALUETYPE_INT);
+    assert(so_Table_get_valueType(merged, 3) == PHARMML_VALUETYPE_BOOLEAN);
+
+    char **merged_ids = (char **) so_Table_get_column_from_name(merged, "ID");
+    assert(strcmp(merged_ids[1], "2") == 0 && strcmp(merged_ids[4], "3") == 0);
+    double *merged_time = (double *) so_Table_get_column_from_name(merged, "TIME");
+    assert(merged_time[0] == 0 && merged_time[4] == 4);
+    int *merged_dv = (int *) so_Table_get_column_from_name(merged, "DV");
+    assert(merged_dv[1] == 6 && merged_dv[2] == 0);
+    bool *merged_flag = (bool *) so_Table_get_column_from_name(merged, "FLAG");
+    assert(!merged_flag[0] && merged_flag[2] && !merged_flag[3]);
+
+    so_Table *copy = so_Table_copy(merged);
+    int *copy_replicate = (int *) so_Table_get_column_from_name(copy, "replicate");
+    assert(copy_replicate[0] == 1 && copy_replicate[1] == 1 && copy_replicate[2] == 2 && copy_replicate[4] == 2);
+    so_Table_free(copy);
+
+    char **merged_name = (char **) so_Table_get_column_from_name(merged, "name");
+    assert(strcmp(merged_name[1], "A") == 0 && strcmp(merged_name[2], "") == 0);
+    int *merged_replicate = (int *) so_Table_get_column_from_name(merged, "replicate");
+    assert(merged_replicate[1] == 1 && merged_replicate[3] == 2);
+    so_Table_free(merged);
+
+    // A column with another valueType than in the profiles before
+    simblock = so_Simulation_create_SimulationBlock(sim);
+    profiles = so_SimulationBlock_create_SimulatedProfiles(simblock);
+    table = so_SimulationSubType_get_base(profiles);
+    so_Table_set_number_of_rows(table, 1);
+    double real_dv[] = { 7 };
+    so_Table_new_column(table, "DV", &undefined, 1, PHARMML_VALUETYPE_REAL, real_dv);
+    assert(so_SOBlock_all_simulated_profiles(block) == NULL);
+    so_SOBlock_free(block);
+
+    // A replicate column that is not an integer
+    block = so_SOBlock_new();
+    sim = so_SOBlock_create_Simulation(block);
+    simblock = so_Simulation_create_SimulationBlock(sim);
+    profiles = so_SimulationBlock_create_SimulatedProfiles(simblock);
+    table = so_SimulationSubType_get_base(profiles);
+    so_Table_set_number_of_rows(table, 1);
+    double real_replicate[] = { 1 };
+    so_Table_new_column(table, "replicate", &undefined, 1, PHARMML_VALUETYPE_REAL, real_replicate);
+    assert(so_SOBlock_all_simulated_profiles(block) == NULL);
+    so_SOBlock_free(block);
+}
+
+void test_encoding()
+{
+    int numrows = 100;
+    double *dose = malloc(numrows * sizeof(double));
+    int *id = malloc(numrows * sizeof(int));
+    char **arm = malloc(numrows * sizeof(char *));
+    double *dv = malloc(numrows * sizeof(double));
+    for (int i = 0; i < numrows; i++) {
+        dose[i] = 25;
+        id[i] = i / 10 + 1;
+        arm[i] = i < 50 ? "A" : "B";
+        dv[i] = i * 0.5;
+    }
+
+    so_SO *so = so_SO_new();
+    so_SOBlock *block = so_SO_create_SOBlock(so);
+    so_SOBlock_set_blkId(block, "b1");
+    so_Estimation *est = so_SOBlock_create_Estimation(block);
+    so_Table *table = so_Estimation_create_Predictions(est);
+    so_Table_set_number_of_rows(table, numrows);
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    so_Table_new_column(table, "DOSE", &undefined, 1, PHARMML_VALUETYPE_REAL, dose);
+    so_Table_new_column(table, "ID", &undefined, 1, PHARMML_VALUETYPE_INT, id);
+    so_Table_new_column(table, "ARM", &undefined, 1, PHARMML_VALUETYPE_STRING, arm);
+    so_Table_new_column(table, "DV", &undefined, 1, PHARMML_VALUETYPE_REAL, dv);
+    assert(so_Table_encode_columns(table) == 0);
+    assert(so_Table_get_encoding(table, 0) == SO_COLUMN_CONSTANT);
+    assert(so_Table_get_encoding(table, 1) == SO_COLUMN_RLE);
+    assert(so_Table_get_encoding(table, 2) == SO_COLUMN_RLE);
+    assert(so_Table_get_encoding(table, 3) == SO_COLUMN_PLAIN);
+
+    so_ColumnRun run = SO_COLUMN_RUN_INIT;
+    int num_runs = 0;
+    while (so_Table_next_run(table, 1, &run)) {
+        assert(run.start == num_runs * 10 && run.length == 10);
+        assert(*(int *) run.value == num_runs + 1);
+        num_runs++;
+    }
+    assert(num_runs == 10);
+
+    so_Table *summary = so_Table_column_summary(table, 0, 0);
+    assert(((int *) so_Table_get_column_from_name(summary, "N"))[0] == numrows);
+    assert(((double *) so_Table_get_column_from_name(summary, "MEAN"))[0] == 25);
+    so_Table_free(summary);
+    assert(so_Table_get_encoding(table, 0) == SO_COLUMN_CONSTANT);
+
+    assert(so_SO_write(so, "encoding.SO.xml", 0) == 0);
+    so_SO_free(so);
+
+    so = so_SO_read("encoding.SO.xml");
+    assert(so);
+    table = so_Estimation_get_Predictions(so_SOBlock_get_Estimation(so_SO_get_SOBlock(so, 0)));
+    assert(so_Table_get_encoding(table, 0) == SO_COLUMN_CONSTANT);
+    assert(so_Table_get_encoding(table, 2) == SO_COLUMN_RLE);
+    so_Table *copy = so_Table_copy(table);
+    char **read_arm = (char **) so_Table_get_column_from_name(table, "ARM");
+    assert(so_Table_get_encoding(table, 2) == SO_COLUMN_PLAIN);
+    assert(so_Table_get_encoding(copy, 2) == SO_COLUMN_RLE);
+    double *read_dose = (double *) so_Table_get_column_from_name(copy, "DOSE");
+    int *read_id = (int *) so_Table_get_column_from_name(copy, "ID");
+    for (int i = 0; i < numrows; i++) {
+        assert(read_dose[i] == dose[i]);
+        assert(read_id[i] == id[i]);
+        assert(strcmp(read_arm[i], arm[i]) == 0);
+    }
+    so_Table_free(copy);
+    so_SO_free(so);
+    remove("encoding.SO.xml");
+
+    free(dose);
+    free(id);
+    free(arm);
+    free(dv);
+}
+
+void test_real_storage()
+{
+    int numrows = 100;
+    double *conc = malloc(numrows * sizeof(double));
+    double *amt = malloc(numrows * sizeof(double));
+    for (int i = 0; i < numrows; i++) {
+        conc[i] = i * 0.01 + 1;
+        amt[i] = i * 1e7;
+    }
+    conc[1] = pharmml_na();
+    conc[2] = NAN;
+    conc[3] = -INFINITY;
+
+    so_SO *so = so_SO_new();
+    so_SOBlock *block = so_SO_create_SOBlock(so);
+    so_SOBlock_set_blkId(block, "b1");
+    so_Estimation *est = so_SOBlock_create_Estimation(block);
+    so_Table *table = so_Estimation_create_Predictions(est);
+    so_Table_set_number_of_rows(table, numrows);
+    pharmml_columnType undefined = PHARMML_COLTYPE_UNDEFINED;
+    so_Table_new_column(table, "CONC", &undefined, 1, PHARMML_VALUETYPE_REAL, conc);
+    so_Table_new_column(table, "AMT", &undefined, 1, PHARMML_VALUETYPE_REAL, amt);
+    assert(so_SO_write(so, "real_storage.SO.xml", 0) == 0);
+    so_SO_free(so);
+
+    so_ReadContext *context = so_ReadContext_new();
+    so_ReadContext_set_real_storage(context, SO_REAL_SCALED_INT32, 50);
+    so_ReadContext_set_real_decimals(context, 2);
+    so = so_SO_read_with_context("real_storage.SO.xml", context);
+    assert(so);
+    table = so_Estimation_get_Predictions(so_SOBlock_get_Estimation(so_SO_get_SOBlock(so, 0)));
+    assert(so_Table_get_encoding(table, 0) == SO_COLUMN_SCALED_INT32);
+    assert(so_Table_get_encoding(table, 1) == SO_COLUMN_SCALED_INT32);
+    so_ColumnRun run = SO_COLUMN_RUN_INIT;
+    assert(so_Table_next_run(table, 0, &run) && *(double *) run.value == 1);
+    assert(so_Table_next_run(table, 0, &run) && pharmml_is_na(*(double *) run.value));
+    double *read_conc = (double *) so_Table_get_column_from_name(table, "CONC");
+    double *read_amt = (double *) so_Table_get_column_from_name(table, "AMT");
+    assert(so_Table_get_encoding(table, 0) == SO_COLUMN_PLAIN);
+    assert(pharmml_is_na(read_conc[1]) && isnan(read_conc[2]) && !pharmml_is_na(read_conc[2]));
+    assert(isinf(read_conc[3]) && read_conc[3] < 0);
+    for (int i = 4; i < numrows; i++) {
+        assert(read_conc[i] == round(conc[i] * 100) / 100);
+        assert(read_amt[i] == amt[i]);
+    }
+    so_SO_free(so);
+
+    so_ReadContext_set_real_storage(context, SO_REAL_FLOAT32, 0);
+    so = so_SO_read_with_context("real_storage.SO.xml", context);
+    table = so_Estimation_get_Predictions(so_SOBlock_get_Estimation(so_SO_get_SOBlock(so, 0)));
+    assert(so_Table_get_encoding(table, 0) == SO_COLUMN_FLOAT32);
+    read_conc = (double *) so_Table_get_column_from_name(table, "CONC");
+    assert(pharmml_is_na(read_conc[1]) && isnan(read_conc[2]));
+    assert(read_conc[50] == (float) conc[50]);
+    so_SO_free(so);
+
+    so_ReadContext_set_real_storage(context, SO_REAL_FLOAT32, 1000);
+    so = so_SO_read_with_context("real_storage.SO.xml", context);
+    table = so_Estimation_get_Predictions(so_SOBlock_get_Estimation(so_SO_get_SOBlock(so, 0)));
+    assert(so_Table_get_encoding(table, 0) == SO_COLUMN_PLAIN);
+    so_SO_free(so);
+
+    // Reads with different contexts at the same time
+    so_ReadContext_set_real_storage(context, SO_REAL_FLOAT32, 0);
+    int failures = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:failures)
+#endif
+    for (int i = 0; i < 16; i++) {
+        so_SO *parallel_so = so_SO_read_with_context("real_storage.SO.xml", i % 2 ? context : NULL);
+        so_Table *parallel_table = so_Estimation_get_Predictions(so_SOBlock_get_Estimation(so_SO_get_SOBlock(parallel_so, 0)));
+        failures += so_Table_get_encoding(parallel_table, 0) != (i % 2 ? SO_COLUMN_FLOAT32 : SO_COLUMN_PLAIN);
+        so_SO_free(parallel_so);
+    }
+    assert(failures == 0);
+
+    so_ReadContext_free(context);
+    remove("real_storage.SO.xml");
+    free(conc);
+    free(amt);
+}
+
 void main()
 {
     so_SO *so = so_SO_read("data/table1.SO.xml");    
@@ -61,10 +742,10 @@ void main()
     assert(strcmp(so_Table_get_columnId(table, 3), "IPRED") == 0);
     assert(so_Table_get_columnId(table, 4) == NULL);
 
-    assert(so_Table_get_columnType(table, 0) == PHARMML_COLTYPE_ID);
-    assert(so_Table_get_columnType(table, 1) == PHARMML_COLTYPE_UNDEFINED);
-    assert(so_Table_get_columnType(table, 2) == 0);
-    assert(so_Table_get_columnType(table, 3) == PHARMML_COLTYPE_UNDEFINED);
+    assert(so_Table_get_columnType(table, 0)[0] == PHARMML_COLTYPE_ID);
+    assert(so_Table_get_columnType(table, 1)[0] == PHARMML_COLTYPE_UNDEFINED);
+    assert(so_Table_get_columnType(table, 2)[0] == 0);
+    assert(so_Table_get_columnType(table, 3)[0] == PHARMML_COLTYPE_UNDEFINED);
 
     assert(so_Table_get_valueType(table, 0) == PHARMML_VALUETYPE_STRING);
     assert(so_Table_get_valueType(table, 1) == PHARMML_VALUETYPE_REAL);
@@ -84,6 +765,16 @@ void main()
     so_SO_free(so);
 
     test_new_table();
+    test_copy_table();
+    test_read_many_rows();
+    test_column_summary();
+    test_group_index();
+    test_sort();
+    test_select();
+    test_join();
+    test_simulated_profiles();
+    test_encoding();
+    test_real_storage();
 
     printf("table PASS\n");
 }